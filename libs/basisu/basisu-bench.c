@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+//  basisu-bench.c
+//
+//  Startup benchmark for the on-disk cache of transcoded textures in
+//  sokol_basisu.h. Creates sokol-gfx images (on the dummy backend) from
+//  .basis files without a cache, then with a new cache directory (cold),
+//  and again with the filled cache (warm). Each run sets up sokol_basisu
+//  from scratch like a new launch of a sample. The synchronous and the
+//  async path are timed separately, each with its own cache subdirectory:
+//
+//  > basisu-bench basisu-bench-cache sapp/data/gltf/DamagedHelmet/*.basis
+//
+//  The cache directory must not exist yet, so that the first cached runs
+//  are really cold. The warm runs read the cache files from the OS file
+//  cache.
+//------------------------------------------------------------------------------
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "sokol_log.h"
+#include "sokol_basisu.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+#define NUM_WARM_RUNS (3)
+
+typedef struct {
+    char* path;
+    void* data;
+    size_t size;
+} file_t;
+
+static struct {
+    int num_files;
+    file_t* files;
+    int num_created;            // by the async callbacks
+    bool failed;
+} state;
+
+static bool load_file(file_t* file) {
+    FILE* fp = fopen(file->path, "rb");
+    if (!fp) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size > 0) {
+        file->size = (size_t)size;
+        file->data = malloc(file->size);
+        if (fread(file->data, 1, file->size, fp) != file->size) {
+            free(file->data);
+            file->data = 0;
+        }
+    }
+    fclose(fp);
+    return file->data != 0;
+}
+
+static void async_callback(const sbasisu_response_t* response) {
+    if (response->failed) {
+        state.failed = true;
+        return;
+    }
+    sg_destroy_image(sg_make_image(response->desc));
+    state.num_created++;
+}
+
+static void make_images_sync(void) {
+    for (int i = 0; i < state.num_files; i++) {
+        const sg_image img = sbasisu_make_image((sg_range){ state.files[i].data, state.files[i].size });
+        if (sg_query_image_state(img) != SG_RESOURCESTATE_VALID) {
+            state.failed = true;
+        }
+        sg_destroy_image(img);
+    }
+}
+
+static void make_images_async(void) {
+    state.num_created = 0;
+    for (int i = 0; i < state.num_files; i++) {
+        sbasisu_transcode_async(&(sbasisu_request_t){
+            .data = { state.files[i].data, state.files[i].size },
+            .callback = async_callback,
+        });
+    }
+    while (sbasisu_num_pending() > 0) {
+        sbasisu_dowork();
+    }
+    if (state.num_created != state.num_files) {
+        state.failed = true;
+    }
+}
+
+// one launch: setup sokol_basisu, create all images and shutdown again,
+// the cache statistics aren't reset by sbasisu_shutdown()
+static void run(const char* name, bool async, const char* cache_dir) {
+    const sbasisu_stats_t prev_stats = sbasisu_stats();
+    const uint64_t start = stm_now();
+    sbasisu_setup(&(sbasisu_desc_t){ .cache_dir = cache_dir });
+    if (async) {
+        make_images_async();
+    } else {
+        make_images_sync();
+    }
+    const sbasisu_stats_t stats = sbasisu_stats();
+    sbasisu_shutdown();
+    printf("%-5s %-8s %8.2f ms, cache hits %3d, misses %3d\n",
+        async ? "async" : "sync", name, stm_ms(stm_since(start)),
+        stats.num_cache_hits - prev_stats.num_cache_hits, stats.num_cache_misses - prev_stats.num_cache_misses);
+}
+
+static void make_dir(const char* path) {
+    #if defined(_WIN32)
+    _mkdir(path);
+    #else
+    mkdir(path, 0755);
+    #endif
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s new_cache_dir file.basis...\n", argv[0]);
+        return 10;
+    }
+    const char* cache_dir = argv[1];
+    struct stat st;
+    if (stat(cache_dir, &st) == 0) {
+        fprintf(stderr, "cache directory '%s' already exists, a cold run needs a new directory\n", cache_dir);
+        return 10;
+    }
+    state.num_files = argc - 2;
+    state.files = (file_t*) calloc((size_t)state.num_files, sizeof(file_t));
+    size_t total_size = 0;
+    for (int i = 0; i < state.num_files; i++) {
+        state.files[i].path = argv[i + 2];
+        if (!load_file(&state.files[i])) {
+            fprintf(stderr, "failed to load '%s'\n", state.files[i].path);
+            return 10;
+        }
+        total_size += state.files[i].size;
+    }
+
+    stm_setup();
+    sg_setup(&(sg_desc){ .logger.func = slog_func });
+    printf("%d files, %d KB, target format %d (alpha: %d)\n", state.num_files, (int)(total_size / 1024),
+        (int)sbasisu_pixelformat(false), (int)sbasisu_pixelformat(true));
+
+    make_dir(cache_dir);
+    for (int mode = 0; mode < 2; mode++) {
+        const bool async = (mode == 1);
+        char mode_dir[1024];
+        snprintf(mode_dir, sizeof(mode_dir), "%s/%s", cache_dir, async ? "async" : "sync");
+        run("no cache", async, 0);
+        run("cold", async, mode_dir);
+        for (int i = 0; i < NUM_WARM_RUNS; i++) {
+            run("warm", async, mode_dir);
+        }
+    }
+
+    sg_shutdown();
+    for (int i = 0; i < state.num_files; i++) {
+        free(state.files[i].data);
+    }
+    free(state.files);
+    if (state.failed) {
+        fprintf(stderr, "failed to create an image\n");
+        return 10;
+    }
+    return 0;
+}
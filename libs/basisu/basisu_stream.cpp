@@ -0,0 +1,382 @@
+//-----------------------------------------------------------------------------
+//  basisu_stream.cpp
+//-----------------------------------------------------------------------------
+#include "sokol_gfx.h"
+#include "sokol_basisu.h"
+#include "basisu_stream.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// the swap time per byte is estimated from the previous swaps, this is
+// the initial estimate (about 1 GB per second for the image upload)
+#define SBASISU_STREAM_INITIAL_SWAP_MS_PER_MB (1.0)
+
+struct sbasisu_stream_texture_t {
+    uint32_t id;            // for finding the texture of an async transcode
+    uint8_t* data;          // copy of the basis file
+    size_t size;
+    sg_image img;
+    int width;              // of level 0
+    int height;
+    sg_pixel_format pixel_format;
+    int num_levels;
+    int initial_level;      // the first level which fits into initial_size
+    int first_level;        // the first resident level
+    int transcoding_level;  // the level which is being transcoded, or -1
+    size_t level_size[SG_MAX_MIPMAPS];
+    uint8_t* levels[SG_MAX_MIPMAPS];    // copies of the initial levels, for dropping back to them
+    size_t resident_bytes;  // the image's levels and the copies of the initial levels
+    uint64_t last_used;     // frame index of the last sbasisu_stream_use()
+    bool blocked;           // didn't fit into the memory budget in the current update
+    bool failed;            // a level failed to transcode, the texture isn't upgraded anymore
+};
+
+// copied into the async transcode request
+struct sbasisu_stream_request_t {
+    uint32_t tex_id;
+    int level;
+};
+
+static struct {
+    bool valid;
+    sbasisu_stream_desc_t desc;
+    std::vector<sbasisu_stream_texture_t*> textures;
+    uint32_t next_id;
+    uint64_t frame_index;
+    size_t resident_bytes;
+    size_t transcoding_bytes;   // of the mip chains which are being transcoded
+    double swap_ms_per_byte;
+    double swap_ms;             // spent in the callbacks since the last update
+    int num_swaps;
+    sbasisu_stream_stats_t stats;
+} state;
+
+void sbasisu_stream_setup(const sbasisu_stream_desc_t* desc) {
+    assert(desc);
+    assert(!state.valid);
+    state.desc = *desc;
+    if (state.desc.memory_budget == 0) {
+        state.desc.memory_budget = 64 * 1024 * 1024;
+    }
+    if (state.desc.frame_budget_ms <= 0.0) {
+        state.desc.frame_budget_ms = 2.0;
+    }
+    if (state.desc.initial_size <= 0) {
+        state.desc.initial_size = 64;
+    }
+    state.frame_index = 1;
+    state.resident_bytes = 0;
+    state.transcoding_bytes = 0;
+    state.swap_ms_per_byte = SBASISU_STREAM_INITIAL_SWAP_MS_PER_MB / (1024.0 * 1024.0);
+    state.swap_ms = 0.0;
+    state.num_swaps = 0;
+    state.stats = { };
+    state.valid = true;
+}
+
+void sbasisu_stream_shutdown(void) {
+    assert(state.valid);
+    while (!state.textures.empty()) {
+        sbasisu_stream_destroy(state.textures.back());
+    }
+    state.valid = false;
+}
+
+// the transcoded size of the mip chain from first_level on
+static size_t chain_bytes(const sbasisu_stream_texture_t* tex, int first_level) {
+    size_t bytes = 0;
+    for (int i = first_level; i < tex->num_levels; i++) {
+        bytes += tex->level_size[i];
+    }
+    return bytes;
+}
+
+// the memory a texture needs with its image starting at first_level
+static size_t resident_bytes(const sbasisu_stream_texture_t* tex, int first_level) {
+    return chain_bytes(tex, first_level) + chain_bytes(tex, tex->initial_level);
+}
+
+// (re-)initialize the texture's image with the levels from first_level on, taken
+// from src (a transcoded mip chain ending at the smallest level), or from the
+// copies of the initial levels if src is null
+static void set_first_level(sbasisu_stream_texture_t* tex, int first_level, const sg_image_desc* src) {
+    sg_image_desc desc = { };
+    desc.type = SG_IMAGETYPE_2D;
+    desc.width = std::max(tex->width >> first_level, 1);
+    desc.height = std::max(tex->height >> first_level, 1);
+    desc.num_mipmaps = tex->num_levels - first_level;
+    desc.usage = SG_USAGE_IMMUTABLE;
+    desc.pixel_format = tex->pixel_format;
+    const int src_level = src ? (tex->num_levels - src->num_mipmaps) : tex->initial_level;
+    assert(src_level <= first_level);
+    for (int i = first_level; i < tex->num_levels; i++) {
+        if (src) {
+            desc.data.subimage[0][i - first_level] = src->data.subimage[0][i - src_level];
+        } else {
+            desc.data.subimage[0][i - first_level] = { tex->levels[i], tex->level_size[i] };
+        }
+        assert(desc.data.subimage[0][i - first_level].size == tex->level_size[i]);
+    }
+    if (tex->img.id == SG_INVALID_ID) {
+        tex->img = sg_alloc_image();
+    } else {
+        sg_uninit_image(tex->img);
+    }
+    sg_init_image(tex->img, &desc);
+    const size_t bytes = resident_bytes(tex, first_level);
+    state.resident_bytes = state.resident_bytes - tex->resident_bytes + bytes;
+    tex->resident_bytes = bytes;
+    tex->first_level = first_level;
+}
+
+static sbasisu_stream_texture_t* find_texture(uint32_t id) {
+    for (sbasisu_stream_texture_t* tex: state.textures) {
+        if (tex->id == id) {
+            return tex;
+        }
+    }
+    return nullptr;
+}
+
+// called from sbasisu_dowork(), the new level is swapped in right away if it's
+// still the next one, the texture may have been destroyed or evicted meanwhile
+static void transcode_callback(const sbasisu_response_t* response) {
+    if (!state.valid) {
+        return;
+    }
+    const sbasisu_stream_request_t* request = (const sbasisu_stream_request_t*) response->user_data;
+    sbasisu_stream_texture_t* tex = find_texture(request->tex_id);
+    if (!tex || (tex->transcoding_level != request->level)) {
+        return;
+    }
+    tex->transcoding_level = -1;
+    state.transcoding_bytes -= chain_bytes(tex, request->level);
+    if (response->failed) {
+        tex->failed = true;
+        return;
+    }
+    if (request->level != (tex->first_level - 1)) {
+        return;
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    set_first_level(tex, request->level, response->desc);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+    state.swap_ms += elapsed.count();
+    state.num_swaps++;
+    // a moving average, the upload time isn't exactly proportional to the size
+    const double ms_per_byte = elapsed.count() / (double)std::max(chain_bytes(tex, tex->first_level), (size_t)1);
+    state.swap_ms_per_byte = (state.swap_ms_per_byte * 0.75) + (ms_per_byte * 0.25);
+}
+
+sbasisu_stream_texture_t* sbasisu_stream_create(sg_range basisu_data) {
+    assert(state.valid);
+    assert(basisu_data.ptr && (basisu_data.size > 0));
+    sbasisu_image_info_t info;
+    if (!sbasisu_image_info(basisu_data, &info)) {
+        return nullptr;
+    }
+    sbasisu_stream_texture_t* tex = new sbasisu_stream_texture_t();
+    tex->id = ++state.next_id;
+    tex->data = (uint8_t*) malloc(basisu_data.size);
+    memcpy(tex->data, basisu_data.ptr, basisu_data.size);
+    tex->size = basisu_data.size;
+    tex->width = info.width;
+    tex->height = info.height;
+    tex->pixel_format = info.pixel_format;
+    tex->num_levels = info.num_mipmaps;
+    for (int i = 0; i < info.num_mipmaps; i++) {
+        tex->level_size[i] = info.level_size[i];
+    }
+    int level = 0;
+    while ((level < (tex->num_levels - 1)) &&
+           (std::max(info.width >> level, info.height >> level) > state.desc.initial_size))
+    {
+        level++;
+    }
+    tex->initial_level = level;
+    tex->transcoding_level = -1;
+    tex->last_used = state.frame_index;
+    // a cached texture is complete right away if it fits into the memory budget,
+    // otherwise the initial levels are small enough to be transcoded right away
+    sg_image_desc desc;
+    if (sbasisu_cache_load({ tex->data, tex->size }, &desc) && (desc.num_mipmaps == tex->num_levels)) {
+        if ((state.resident_bytes + state.transcoding_bytes + resident_bytes(tex, 0)) <= state.desc.memory_budget) {
+            level = 0;
+        }
+    } else {
+        sbasisu_free(&desc);
+        desc = sbasisu_transcode_levels({ tex->data, tex->size }, level);
+    }
+    // only the initial levels are kept in memory, the larger ones are
+    // transcoded again when the texture is upgraded after an eviction
+    const int desc_level = tex->num_levels - desc.num_mipmaps;
+    for (int i = tex->initial_level; i < tex->num_levels; i++) {
+        const sg_range& src = desc.data.subimage[0][i - desc_level];
+        assert(src.size == tex->level_size[i]);
+        tex->levels[i] = (uint8_t*) malloc(src.size);
+        memcpy(tex->levels[i], src.ptr, src.size);
+    }
+    set_first_level(tex, level, &desc);
+    sbasisu_free(&desc);
+    state.textures.push_back(tex);
+    return tex;
+}
+
+void sbasisu_stream_destroy(sbasisu_stream_texture_t* tex) {
+    assert(state.valid && tex);
+    auto it = std::find(state.textures.begin(), state.textures.end(), tex);
+    assert(it != state.textures.end());
+    state.textures.erase(it);
+    state.resident_bytes -= tex->resident_bytes;
+    // a level which is still being transcoded is dropped in the callback
+    if (tex->transcoding_level >= 0) {
+        state.transcoding_bytes -= chain_bytes(tex, tex->transcoding_level);
+    }
+    sg_destroy_image(tex->img);
+    for (int i = 0; i < tex->num_levels; i++) {
+        free(tex->levels[i]);
+    }
+    free(tex->data);
+    delete tex;
+}
+
+sg_image sbasisu_stream_image(const sbasisu_stream_texture_t* tex) {
+    assert(tex);
+    return tex->img;
+}
+
+int sbasisu_stream_first_level(const sbasisu_stream_texture_t* tex) {
+    assert(tex);
+    return tex->first_level;
+}
+
+void sbasisu_stream_use(sbasisu_stream_texture_t* tex) {
+    assert(tex);
+    tex->last_used = state.frame_index;
+}
+
+static bool recently_used(const sbasisu_stream_texture_t* tex) {
+    return (tex->last_used + 1) >= state.frame_index;
+}
+
+// the next texture to upgrade by one level, the lowest resolution goes first,
+// and the most recently used texture among those with the same resolution
+static sbasisu_stream_texture_t* next_upgrade(void) {
+    sbasisu_stream_texture_t* best = nullptr;
+    for (sbasisu_stream_texture_t* tex: state.textures) {
+        if ((tex->first_level == 0) || (tex->transcoding_level >= 0) || tex->blocked || tex->failed || !recently_used(tex)) {
+            continue;
+        }
+        if (!best ||
+            (tex->first_level > best->first_level) ||
+            ((tex->first_level == best->first_level) && (tex->last_used > best->last_used)))
+        {
+            best = tex;
+        }
+    }
+    return best;
+}
+
+// the least recently used texture with more than its initial mips, which
+// has been used less recently than the texture that needs the memory
+static sbasisu_stream_texture_t* lru_victim(const sbasisu_stream_texture_t* for_tex) {
+    sbasisu_stream_texture_t* victim = nullptr;
+    for (sbasisu_stream_texture_t* tex: state.textures) {
+        if ((tex->first_level < tex->initial_level) &&
+            (tex->last_used < for_tex->last_used) &&
+            (!victim || (tex->last_used < victim->last_used)))
+        {
+            victim = tex;
+        }
+    }
+    return victim;
+}
+
+// the estimated time to swap in the levels which are being transcoded,
+// a swap re-initializes the image with the new level and the smaller ones
+static double transcoding_swap_ms(void) {
+    size_t bytes = 0;
+    for (const sbasisu_stream_texture_t* tex: state.textures) {
+        if (tex->transcoding_level >= 0) {
+            bytes += chain_bytes(tex, tex->transcoding_level);
+        }
+    }
+    return (double)bytes * state.swap_ms_per_byte;
+}
+
+void sbasisu_stream_update(void) {
+    assert(state.valid);
+    const auto start_time = std::chrono::steady_clock::now();
+    state.stats.num_upgrades = state.num_swaps;
+    state.stats.num_evictions = 0;
+    for (sbasisu_stream_texture_t* tex: state.textures) {
+        tex->blocked = false;
+    }
+    // start transcoding the next level of the textures in upgrade order, as long as
+    // all levels in flight can be swapped in within one frame budget, one level is
+    // always allowed so that a level which alone exceeds the budget isn't stuck,
+    // each transcode produces the new level together with all smaller ones (the
+    // image data isn't kept on the CPU), that memory is reserved in the memory budget
+    double swap_ms = transcoding_swap_ms();
+    while (sbasisu_stream_texture_t* tex = next_upgrade()) {
+        const int level = tex->first_level - 1;
+        const double tex_swap_ms = (double)chain_bytes(tex, level) * state.swap_ms_per_byte;
+        if ((state.transcoding_bytes > 0) && ((swap_ms + tex_swap_ms) > state.desc.frame_budget_ms)) {
+            break;
+        }
+        const size_t extra_bytes = chain_bytes(tex, level);
+        while ((state.resident_bytes + state.transcoding_bytes + extra_bytes) > state.desc.memory_budget) {
+            sbasisu_stream_texture_t* victim = lru_victim(tex);
+            if (!victim) {
+                break;
+            }
+            set_first_level(victim, victim->initial_level, nullptr);
+            state.stats.num_evictions++;
+        }
+        if ((state.resident_bytes + state.transcoding_bytes + extra_bytes) > state.desc.memory_budget) {
+            tex->blocked = true;
+            continue;
+        }
+        const sbasisu_stream_request_t request = { tex->id, level };
+        tex->transcoding_level = level;
+        state.transcoding_bytes += extra_bytes;
+        swap_ms += tex_swap_ms;
+        sbasisu_request_t async_request = { };
+        async_request.data = { tex->data, tex->size };
+        async_request.callback = transcode_callback;
+        async_request.user_data = { &request, sizeof(request) };
+        async_request.first_level = level;
+        sbasisu_transcode_async(&async_request);
+    }
+    state.stats.num_textures = (int) state.textures.size();
+    state.stats.num_pending = 0;
+    state.stats.num_blocked = 0;
+    state.stats.num_transcoding = 0;
+    state.stats.pending_bytes = 0;
+    for (const sbasisu_stream_texture_t* tex: state.textures) {
+        if (tex->transcoding_level >= 0) {
+            state.stats.num_transcoding++;
+        }
+        if ((tex->first_level > 0) && recently_used(tex)) {
+            state.stats.num_pending++;
+            state.stats.pending_bytes += chain_bytes(tex, 0) - chain_bytes(tex, tex->first_level);
+            if (tex->blocked) {
+                state.stats.num_blocked++;
+            }
+        }
+    }
+    state.stats.resident_bytes = state.resident_bytes;
+    const std::chrono::duration<double, std::milli> update_time = std::chrono::steady_clock::now() - start_time;
+    state.stats.update_ms = update_time.count() + state.swap_ms;
+    state.swap_ms = 0.0;
+    state.num_swaps = 0;
+    state.frame_index++;
+}
+
+sbasisu_stream_stats_t sbasisu_stream_stats(void) {
+    return state.stats;
+}
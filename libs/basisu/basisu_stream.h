@@ -0,0 +1,79 @@
+#pragma once
+/*
+    basisu_stream.h -- mip-level streaming for Basis Universal textures
+
+    Include sokol_gfx.h and sokol_basisu.h before this file.
+
+    A streamed texture starts with its small mips only (up to initial_size
+    pixels). The higher-resolution mips are transcoded one level at a time
+    on the sbasisu_transcode_async() worker threads. Each upgrade transcodes
+    the new level together with all smaller levels again, and the finished
+    chain is swapped in from its completion callback in sbasisu_dowork(),
+    so no CPU copies of the image data are kept, except for the small
+    initial mips which textures are dropped back to. This trades about 1/3
+    more transcoding per upgrade for not holding the texture data twice.
+    sbasisu_stream_update() only starts as many transcodes as can be
+    swapped in within the per-frame time budget, measured from the previous
+    swaps. When the resident texture data would exceed the memory budget,
+    the least recently used textures are dropped back to their small mips.
+    The memory budget covers the resident image data, the copies of the
+    initial mips, and the mip chains which are being transcoded.
+
+    With a cache directory in sbasisu_setup(), a texture whose complete mip
+    chain is in the cache starts with all mips (if they fit into the memory
+    budget). The complete chain transcoded by the last upgrade is stored in
+    the cache by sbasisu_transcode_async(), and a later upgrade to level 0
+    is read from the cache instead of being transcoded again.
+
+    The sg_image handle of a streamed texture stays the same, the image is
+    re-initialized with sg_uninit_image()/sg_init_image() when the resident
+    mips change. Only textures which have been marked as used in the current
+    or last frame with sbasisu_stream_use() are upgraded.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "sokol_gfx.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct sbasisu_stream_texture_t sbasisu_stream_texture_t;
+
+typedef struct {
+    size_t memory_budget;       // max resident texture data in bytes (default: 64 MB)
+    double frame_budget_ms;     // time for swapping in new levels per frame (default: 2 ms)
+    int initial_size;           // max width and height of the initial mips (default: 64)
+} sbasisu_stream_desc_t;
+
+typedef struct {
+    int num_textures;
+    int num_pending;            // used textures which don't have all mips resident yet
+    int num_blocked;            // pending textures which don't fit into the memory budget
+    int num_transcoding;        // levels which are being transcoded
+    size_t resident_bytes;      // image data of all textures and the copies of their initial mips
+    size_t pending_bytes;       // missing mip data of the pending textures
+    int num_upgrades;           // mip levels swapped in since the previous update
+    int num_evictions;          // textures dropped to their initial mips by the last update
+    double update_ms;           // time spent in the last update and the swaps since the previous one
+} sbasisu_stream_stats_t;
+
+// sbasisu_setup() must have been called before
+void sbasisu_stream_setup(const sbasisu_stream_desc_t* desc);
+void sbasisu_stream_shutdown(void);
+// the basis data is copied, the initial mips are transcoded right away,
+// returns a null pointer if the data isn't a valid basis file
+sbasisu_stream_texture_t* sbasisu_stream_create(sg_range basisu_data);
+void sbasisu_stream_destroy(sbasisu_stream_texture_t* tex);
+sg_image sbasisu_stream_image(const sbasisu_stream_texture_t* tex);
+// the highest resident level, 0 when the texture is complete
+int sbasisu_stream_first_level(const sbasisu_stream_texture_t* tex);
+// mark a texture as used in the current frame
+void sbasisu_stream_use(sbasisu_stream_texture_t* tex);
+// call once per frame, together with sbasisu_dowork()
+void sbasisu_stream_update(void);
+sbasisu_stream_stats_t sbasisu_stream_stats(void);
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -15,6 +15,20 @@
 #include "basisu_transcoder.cpp"
 #include "sokol_gfx.h"
 #include "sokol_basisu.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <cstdio>
+#if defined(_WIN32)
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #define SBASISU_CACHE_MMAP (1)
+#endif
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -25,17 +39,261 @@
 
 static basist::etc1_global_selector_codebook *g_pGlobal_codebook;
 
-void sbasisu_setup(void) {
+// threads are not available in emscripten builds without pthreads support,
+// async transcodes are then done right away and called back in sbasisu_dowork()
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define SBASISU_NO_THREADS (1)
+#endif
+#define SBASISU_MAX_WORKERS (8)
+// released scratch buffers are kept for reuse, up to this many and this size
+#define SBASISU_MAX_POOLED_BUFFERS (8)
+#define SBASISU_MAX_POOLED_BYTES (64 * 1024 * 1024)
+// scratch buffers start with a header which holds the capacity
+#define SBASISU_BUFFER_HEADER_SIZE (16)
+#define SBASISU_MAX_PATH (512)
+#define SBASISU_CACHE_MAGIC (0x54434253)   // 'SBCT'
+#define SBASISU_CACHE_VERSION (1)
+
+// a cache file is this header followed by the transcoded levels at 16-byte
+// aligned offsets, it is named after the content hash and target format
+struct sbasisu_cache_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t content_hash;
+    uint64_t content_size;
+    uint32_t basis_format;
+    uint32_t pixel_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_mipmaps;
+    uint32_t level_offset[SG_MAX_MIPMAPS];
+    uint32_t level_size[SG_MAX_MIPMAPS];
+    uint32_t reserved;
+};
+static_assert((sizeof(sbasisu_cache_header_t) & 15) == 0, "cache header size must be a multiple of 16");
+
+// a memory-mapped cache file, found by the level 0 pointer in sbasisu_free()
+struct sbasisu_mapping_t {
+    const void* level0;
+    void* base;
+    size_t size;
+};
+
+// an async transcode request, each mip level is a separate job
+struct sbasisu_task_t {
+    uint32_t id;
+    uint64_t hash;                  // content hash for the cache, 0 if caching is disabled or not a complete chain
+    sg_range data;                  // copy of the basis file in a scratch buffer
+    basist::transcoder_texture_format fmt;
+    int first_level;                // the basis level of desc level 0
+    sg_image_desc desc;             // the level buffers are allocated upfront
+    std::atomic<int> num_pending_levels;
+    std::atomic<bool> failed;
+    void (*callback)(const sbasisu_response_t*);
+    uint64_t user_data[SBASISU_MAX_USERDATA_UINT64];
+};
+
+struct sbasisu_job_t {
+    sbasisu_task_t* task;
+    int level;                      // index into the task's desc levels
+};
+
+static struct {
+    int num_workers;
+    std::thread* threads;
+    std::mutex mutex;
+    std::condition_variable job_cond;
+    std::deque<sbasisu_job_t> jobs;         // levels of all tasks in submission order, largest first
+    std::vector<sbasisu_task_t*> done;      // finished tasks, waiting for sbasisu_dowork()
+    std::vector<sbasisu_task_t*> callbacks; // swapped with done in sbasisu_dowork()
+    bool quit;
+    uint32_t next_task_id;
+    int num_pending;
+    struct {
+        std::mutex mutex;
+        uint8_t* buffers[SBASISU_MAX_POOLED_BUFFERS];   // released scratch buffers
+        int num_buffers;
+        sbasisu_stats_t stats;
+    } pool;
+    struct {
+        char dir[SBASISU_MAX_PATH];     // empty if caching is disabled
+        std::mutex mutex;
+        std::vector<sbasisu_mapping_t> mappings;
+        std::atomic<uint32_t> next_tmp_id;
+    } cache;
+} state;
+
+static size_t buffer_capacity(const uint8_t* buf) {
+    size_t capacity;
+    memcpy(&capacity, buf - SBASISU_BUFFER_HEADER_SIZE, sizeof(capacity));
+    return capacity;
+}
+
+// get a scratch buffer of at least size bytes, the smallest pooled
+// buffer which is big enough is reused instead of allocating a new one
+static uint8_t* acquire_buffer(size_t size) {
+    std::lock_guard<std::mutex> lock(state.pool.mutex);
+    sbasisu_stats_t& stats = state.pool.stats;
+    int best = -1;
+    for (int i = 0; i < state.pool.num_buffers; i++) {
+        const size_t capacity = buffer_capacity(state.pool.buffers[i]);
+        if ((capacity >= size) && ((best < 0) || (capacity < buffer_capacity(state.pool.buffers[best])))) {
+            best = i;
+        }
+    }
+    uint8_t* buf;
+    if (best >= 0) {
+        buf = state.pool.buffers[best];
+        state.pool.buffers[best] = state.pool.buffers[--state.pool.num_buffers];
+        stats.pooled_bytes -= buffer_capacity(buf);
+        stats.num_allocs_avoided++;
+    } else {
+        uint8_t* base = (uint8_t*) malloc(SBASISU_BUFFER_HEADER_SIZE + size);
+        memcpy(base, &size, sizeof(size));
+        buf = base + SBASISU_BUFFER_HEADER_SIZE;
+        stats.scratch_bytes += size;
+        stats.num_allocs++;
+    }
+    if (stats.scratch_bytes > stats.peak_scratch_bytes) {
+        stats.peak_scratch_bytes = stats.scratch_bytes;
+    }
+    return buf;
+}
+
+// return a scratch buffer into the pool, or free it if the pool is full
+static void release_buffer(uint8_t* buf) {
+    std::lock_guard<std::mutex> lock(state.pool.mutex);
+    sbasisu_stats_t& stats = state.pool.stats;
+    const size_t capacity = buffer_capacity(buf);
+    if ((state.pool.num_buffers == SBASISU_MAX_POOLED_BUFFERS) || ((stats.pooled_bytes + capacity) > SBASISU_MAX_POOLED_BYTES)) {
+        stats.scratch_bytes -= capacity;
+        free(buf - SBASISU_BUFFER_HEADER_SIZE);
+    } else {
+        state.pool.buffers[state.pool.num_buffers++] = buf;
+        stats.pooled_bytes += capacity;
+    }
+}
+
+static void shutdown_pool(void) {
+    for (int i = 0; i < state.pool.num_buffers; i++) {
+        free(state.pool.buffers[i] - SBASISU_BUFFER_HEADER_SIZE);
+    }
+    state.pool.num_buffers = 0;
+    state.pool.stats.scratch_bytes = 0;
+    state.pool.stats.pooled_bytes = 0;
+}
+
+static void run_job(basist::basisu_transcoder* transcoder, uint32_t* cur_task_id, const sbasisu_job_t& job);
+
+static void delete_task(sbasisu_task_t* task) {
+    sbasisu_free(&task->desc);
+    if (task->data.ptr) {
+        release_buffer((uint8_t*)task->data.ptr);
+    }
+    delete task;
+}
+
+static void worker_func(void) {
+    // the transcoder state only needs to be initialized again
+    // when switching to a level of a different image
+    basist::basisu_transcoder transcoder(g_pGlobal_codebook);
+    uint32_t cur_task_id = 0;
+    while (true) {
+        sbasisu_job_t job;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.job_cond.wait(lock, [] { return state.quit || !state.jobs.empty(); });
+            if (state.quit) {
+                return;
+            }
+            job = state.jobs.front();
+            state.jobs.pop_front();
+        }
+        run_job(&transcoder, &cur_task_id, job);
+    }
+}
+
+static void setup_workers(int num_workers) {
+    if (num_workers == 0) {
+        num_workers = (int)std::thread::hardware_concurrency() - 1;
+    }
+    if (num_workers < 1) {
+        num_workers = 1;
+    } else if (num_workers > SBASISU_MAX_WORKERS) {
+        num_workers = SBASISU_MAX_WORKERS;
+    }
+    #if defined(SBASISU_NO_THREADS)
+    num_workers = 0;
+    #endif
+    state.num_workers = num_workers;
+    state.quit = false;
+    if (num_workers > 0) {
+        state.threads = new std::thread[num_workers];
+        for (int i = 0; i < num_workers; i++) {
+            state.threads[i] = std::thread(worker_func);
+        }
+    }
+}
+
+static void shutdown_workers(void) {
+    if (state.threads) {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.quit = true;
+        }
+        state.job_cond.notify_all();
+        for (int i = 0; i < state.num_workers; i++) {
+            state.threads[i].join();
+        }
+        delete [] state.threads;
+        state.threads = nullptr;
+    }
+    state.num_workers = 0;
+    // drop the tasks which haven't been called back, a task is
+    // deleted together with the last of its queued levels
+    for (const sbasisu_job_t& job: state.jobs) {
+        if (--job.task->num_pending_levels == 0) {
+            delete_task(job.task);
+        }
+    }
+    for (sbasisu_task_t* task: state.done) {
+        delete_task(task);
+    }
+    state.jobs.clear();
+    state.done.clear();
+    state.num_pending = 0;
+}
+
+static void setup_cache(const char* dir) {
+    state.cache.dir[0] = 0;
+    if (dir && dir[0]) {
+        assert(strlen(dir) < SBASISU_MAX_PATH);
+        snprintf(state.cache.dir, sizeof(state.cache.dir), "%s", dir);
+        // an error here just means that every lookup misses
+        #if defined(_WIN32)
+        _mkdir(dir);
+        #else
+        mkdir(dir, 0755);
+        #endif
+    }
+}
+
+void sbasisu_setup(const sbasisu_desc_t* desc) {
+    assert(desc);
     basist::basisu_transcoder_init();
     if (!g_pGlobal_codebook) {
         g_pGlobal_codebook = new basist::etc1_global_selector_codebook(
             basist::g_global_selector_cb_size,
             basist::g_global_selector_cb);
+        setup_workers(desc->num_workers);
+        setup_cache(desc->cache_dir);
     }
 }
 
 void sbasisu_shutdown(void) {
     if (g_pGlobal_codebook) {
+        shutdown_workers();
+        shutdown_pool();
         delete g_pGlobal_codebook;
         g_pGlobal_codebook = nullptr;
     }
@@ -83,59 +341,356 @@ static bool is_pvrtc(basist::transcoder_texture_format fmt) {
     }
 }
 
+// the size of a transcoded image level
+static uint32_t level_size(const basist::basisu_transcoder& transcoder, sg_range data, basist::transcoder_texture_format fmt, int level) {
+    const uint32_t bytes_per_block = basist::basis_get_bytes_per_block_or_pixel(fmt);
+    uint32_t orig_width, orig_height, total_blocks;
+    transcoder.get_image_level_desc(data.ptr, (uint32_t)data.size, 0, (uint32_t)level, orig_width, orig_height, total_blocks);
+    uint32_t required_size = total_blocks * bytes_per_block;
+    if (is_pvrtc(fmt)) {
+        // For PVRTC1, Basis only writes (or requires) total_blocks * bytes_per_block.
+        //  But GL requires extra padding for very small textures:
+        // https://www.khronos.org/registry/OpenGL/extensions/IMG/IMG_texture_compression_pvrtc.txt
+        const uint32_t width = (orig_width + 3) & ~3;
+        const uint32_t height = (orig_height + 3) & ~3;
+        required_size = (std::max(8U, width) * std::max(8U, height) * 4 + 7) / 8;
+    }
+    return required_size;
+}
+
+// the target format of a basis file
+static bool image_format(const basist::basisu_transcoder& transcoder, sg_range data, basist::transcoder_texture_format* out_fmt) {
+    basist::basisu_image_info img_info;
+    if (!transcoder.get_image_info(data.ptr, (uint32_t)data.size, img_info, 0)) {
+        return false;
+    }
+    *out_fmt = select_basis_textureformat(img_info.m_alpha_flag);
+    return true;
+}
+
+// fill in the image desc from the basis file header and allocate one scratch buffer
+// for num_levels levels from first_level on (0: all remaining levels), the levels
+// are transcoded with transcode_level()
+static bool alloc_image_desc(const basist::basisu_transcoder& transcoder, sg_range data, basist::transcoder_texture_format fmt, int first_level, int num_levels, sg_image_desc* desc) {
+    basist::basisu_image_info img_info;
+    if (!transcoder.get_image_info(data.ptr, (uint32_t)data.size, img_info, 0)) {
+        return false;
+    }
+    if ((first_level < 0) || ((uint32_t)first_level >= img_info.m_total_levels) || (num_levels < 0)) {
+        return false;
+    }
+    const int max_levels = (int) img_info.m_total_levels - first_level;
+    if ((num_levels == 0) || (num_levels > max_levels)) {
+        num_levels = max_levels;
+    }
+    uint32_t width, height, total_blocks;
+    if (!transcoder.get_image_level_desc(data.ptr, (uint32_t)data.size, 0, (uint32_t)first_level, width, height, total_blocks)) {
+        return false;
+    }
+    *desc = { };
+    desc->type = SG_IMAGETYPE_2D;
+    desc->width = (int) width;
+    desc->height = (int) height;
+    desc->num_mipmaps = num_levels;
+    assert(desc->num_mipmaps <= SG_MAX_MIPMAPS);
+    desc->usage = SG_USAGE_IMMUTABLE;
+    desc->pixel_format = basis_to_sg_pixelformat(fmt);
+    // level 0 is at the start of the buffer, so the buffer can be released through it
+    size_t level_offsets[SG_MAX_MIPMAPS];
+    size_t total_size = 0;
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        level_offsets[i] = total_size;
+        desc->data.subimage[0][i].size = level_size(transcoder, data, fmt, first_level + i);
+        total_size += (desc->data.subimage[0][i].size + 15) & ~(size_t)15;
+    }
+    if (total_size > 0) {
+        uint8_t* buf = acquire_buffer(total_size);
+        for (int i = 0; i < desc->num_mipmaps; i++) {
+            desc->data.subimage[0][i].ptr = buf + level_offsets[i];
+        }
+        std::lock_guard<std::mutex> lock(state.pool.mutex);
+        state.pool.stats.num_allocs_avoided += desc->num_mipmaps - 1;
+    }
+    return true;
+}
+
+static bool cache_enabled(void) {
+    return state.cache.dir[0] != 0;
+}
+
+// 64-bit FNV-1a
+static uint64_t content_hash(sg_range data) {
+    const uint8_t* ptr = (const uint8_t*) data.ptr;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < data.size; i++) {
+        hash = (hash ^ ptr[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void cache_path(char* buf, size_t buf_size, uint64_t hash, basist::transcoder_texture_format fmt) {
+    snprintf(buf, buf_size, "%s/%016llx-%02d.sbct", state.cache.dir, (unsigned long long)hash, (int)fmt);
+}
+
+static void count_cache_lookup(bool hit) {
+    std::lock_guard<std::mutex> lock(state.pool.mutex);
+    if (hit) {
+        state.pool.stats.num_cache_hits++;
+    } else {
+        state.pool.stats.num_cache_misses++;
+    }
+}
+
+static bool valid_cache_header(const sbasisu_cache_header_t& hdr, uint64_t hash, size_t content_size, basist::transcoder_texture_format fmt, size_t file_size) {
+    if ((hdr.magic != SBASISU_CACHE_MAGIC) ||
+        (hdr.version != SBASISU_CACHE_VERSION) ||
+        (hdr.content_hash != hash) ||
+        (hdr.content_size != content_size) ||
+        (hdr.basis_format != (uint32_t)fmt) ||
+        (hdr.pixel_format != (uint32_t)basis_to_sg_pixelformat(fmt)) ||
+        (hdr.num_mipmaps < 1) || (hdr.num_mipmaps > SG_MAX_MIPMAPS) ||
+        (hdr.level_offset[0] != sizeof(sbasisu_cache_header_t)))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < hdr.num_mipmaps; i++) {
+        if (((hdr.level_offset[i] & 15) != 0) || ((size_t)hdr.level_offset[i] + hdr.level_size[i] > file_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// look up a transcoded image in the cache directory, the levels of the image desc
+// point into the memory-mapped file, or into a scratch buffer without mmap
+static bool cache_load(uint64_t hash, size_t content_size, basist::transcoder_texture_format fmt, sg_image_desc* desc) {
+    if (!cache_enabled()) {
+        return false;
+    }
+    char path[SBASISU_MAX_PATH + 32];
+    cache_path(path, sizeof(path), hash, fmt);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        count_cache_lookup(false);
+        return false;
+    }
+    sbasisu_cache_header_t hdr = { };
+    fseek(fp, 0, SEEK_END);
+    const long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    bool valid = (file_size > 0) &&
+                 (fread(&hdr, sizeof(hdr), 1, fp) == 1) &&
+                 valid_cache_header(hdr, hash, content_size, fmt, (size_t)file_size);
+    const uint8_t* level0 = nullptr;
+    if (valid) {
+        #if defined(SBASISU_CACHE_MMAP)
+            void* base = mmap(nullptr, (size_t)file_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+            if (base == MAP_FAILED) {
+                valid = false;
+            } else {
+                level0 = (const uint8_t*)base + sizeof(hdr);
+                std::lock_guard<std::mutex> lock(state.cache.mutex);
+                state.cache.mappings.push_back({ level0, base, (size_t)file_size });
+            }
+        #else
+            const size_t data_size = (size_t)file_size - sizeof(hdr);
+            uint8_t* buf = acquire_buffer(data_size);
+            if (fread(buf, data_size, 1, fp) == 1) {
+                level0 = buf;
+            } else {
+                release_buffer(buf);
+                valid = false;
+            }
+        #endif
+    }
+    fclose(fp);
+    count_cache_lookup(valid);
+    if (!valid) {
+        return false;
+    }
+    *desc = { };
+    desc->type = SG_IMAGETYPE_2D;
+    desc->width = (int) hdr.width;
+    desc->height = (int) hdr.height;
+    desc->num_mipmaps = (int) hdr.num_mipmaps;
+    desc->usage = SG_USAGE_IMMUTABLE;
+    desc->pixel_format = basis_to_sg_pixelformat(fmt);
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        desc->data.subimage[0][i].ptr = level0 + (hdr.level_offset[i] - sizeof(hdr));
+        desc->data.subimage[0][i].size = hdr.level_size[i];
+    }
+    return true;
+}
+
+// write a transcoded image into the cache directory, the file is written under a
+// temporary name and renamed, so that a concurrent lookup never sees a partial file
+static void cache_store(uint64_t hash, size_t content_size, basist::transcoder_texture_format fmt, const sg_image_desc* desc) {
+    if (!cache_enabled()) {
+        return;
+    }
+    sbasisu_cache_header_t hdr = { };
+    hdr.magic = SBASISU_CACHE_MAGIC;
+    hdr.version = SBASISU_CACHE_VERSION;
+    hdr.content_hash = hash;
+    hdr.content_size = content_size;
+    hdr.basis_format = (uint32_t) fmt;
+    hdr.pixel_format = (uint32_t) desc->pixel_format;
+    hdr.width = (uint32_t) desc->width;
+    hdr.height = (uint32_t) desc->height;
+    hdr.num_mipmaps = (uint32_t) desc->num_mipmaps;
+    size_t offset = sizeof(hdr);
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        hdr.level_offset[i] = (uint32_t) offset;
+        hdr.level_size[i] = (uint32_t) desc->data.subimage[0][i].size;
+        offset += (hdr.level_size[i] + 15) & ~(size_t)15;
+    }
+    char path[SBASISU_MAX_PATH + 32];
+    char tmp_path[SBASISU_MAX_PATH + 48];
+    cache_path(path, sizeof(path), hash, fmt);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%u.tmp", path, (unsigned)++state.cache.next_tmp_id);
+    FILE* fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        return;
+    }
+    static const uint8_t padding[16] = { 0 };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (int i = 0; ok && (i < desc->num_mipmaps); i++) {
+        const sg_range& level = desc->data.subimage[0][i];
+        const size_t pad = ((level.size + 15) & ~(size_t)15) - level.size;
+        ok = (fwrite(level.ptr, level.size, 1, fp) == 1) && ((pad == 0) || (fwrite(padding, pad, 1, fp) == 1));
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) {
+        // rename() doesn't replace an existing file on Windows, the file
+        // is then already in the cache from a concurrent transcode
+        ok = rename(tmp_path, path) == 0;
+    }
+    if (!ok) {
+        remove(tmp_path);
+    }
+}
+
+// unmap a memory-mapped cache file, returns false if the pointer isn't from one
+static bool cache_unmap(const void* level0) {
+    #if defined(SBASISU_CACHE_MMAP)
+        std::lock_guard<std::mutex> lock(state.cache.mutex);
+        for (size_t i = 0; i < state.cache.mappings.size(); i++) {
+            const sbasisu_mapping_t& mapping = state.cache.mappings[i];
+            if (mapping.level0 == level0) {
+                munmap(mapping.base, mapping.size);
+                state.cache.mappings[i] = state.cache.mappings.back();
+                state.cache.mappings.pop_back();
+                return true;
+            }
+        }
+    #else
+        (void)level0;
+    #endif
+    return false;
+}
+
+// transcode an image level into its buffer, start_transcoding() must have been called
+static bool transcode_level(basist::basisu_transcoder* transcoder, sg_range data, basist::transcoder_texture_format fmt, int level, const sg_range& dst) {
+    const uint32_t bytes_per_block = basist::basis_get_bytes_per_block_or_pixel(fmt);
+    return transcoder->transcode_image_level(
+        data.ptr,
+        (uint32_t)data.size,
+        0,          // image index
+        (uint32_t)level,
+        (void*)dst.ptr,
+        (uint32_t)dst.size / bytes_per_block,
+        fmt,
+        0);          // decode_flags
+}
+
 sg_image_desc sbasisu_transcode(sg_range basisu_data) {
+    return sbasisu_transcode_levels(basisu_data, 0);
+}
+
+// only complete mip chains are cached
+sg_image_desc sbasisu_transcode_levels(sg_range basisu_data, int first_level) {
     assert(g_pGlobal_codebook);
     basist::basisu_transcoder transcoder(g_pGlobal_codebook);
-    transcoder.start_transcoding(basisu_data.ptr, (uint32_t)basisu_data.size);
-
-    basist::basisu_image_info img_info;
-    transcoder.get_image_info(basisu_data.ptr, (uint32_t)basisu_data.size, img_info, 0);
-    const basist::transcoder_texture_format fmt = select_basis_textureformat(img_info.m_alpha_flag);
+    basist::transcoder_texture_format fmt;
+    bool res = image_format(transcoder, basisu_data, &fmt);
+    assert(res); (void)res;
 
     sg_image_desc desc = { };
-    desc.type = SG_IMAGETYPE_2D;
-    desc.width = (int) img_info.m_width;
-    desc.height = (int) img_info.m_height;
-    desc.num_mipmaps = (int) img_info.m_total_levels;
-    assert(desc.num_mipmaps <= SG_MAX_MIPMAPS);
-    desc.usage = SG_USAGE_IMMUTABLE;
-    desc.pixel_format = basis_to_sg_pixelformat(fmt);
+    const uint64_t hash = (cache_enabled() && (first_level == 0)) ? content_hash(basisu_data) : 0;
+    if ((hash != 0) && cache_load(hash, basisu_data.size, fmt, &desc)) {
+        return desc;
+    }
+    transcoder.start_transcoding(basisu_data.ptr, (uint32_t)basisu_data.size);
+    res = alloc_image_desc(transcoder, basisu_data, fmt, first_level, 0, &desc);
+    assert(res); (void)res;
     for (int i = 0; i < desc.num_mipmaps; i++) {
-        const uint32_t bytes_per_block = basist::basis_get_bytes_per_block_or_pixel(fmt);
-        uint32_t orig_width, orig_height, total_blocks;
-        transcoder.get_image_level_desc(basisu_data.ptr, (uint32_t)basisu_data.size, 0, i, orig_width, orig_height, total_blocks);
-        uint32_t required_size = total_blocks * bytes_per_block;
-        if (is_pvrtc(fmt)) {
-            // For PVRTC1, Basis only writes (or requires) total_blocks * bytes_per_block.
-            //  But GL requires extra padding for very small textures:
-            // https://www.khronos.org/registry/OpenGL/extensions/IMG/IMG_texture_compression_pvrtc.txt
-            const uint32_t width = (orig_width + 3) & ~3;
-            const uint32_t height = (orig_height + 3) & ~3;
-            required_size = (std::max(8U, width) * std::max(8U, height) * 4 + 7) / 8;
-        }
-        void* ptr = malloc(required_size);
-        desc.data.subimage[0][i].ptr = ptr;
-        desc.data.subimage[0][i].size = required_size;
-        bool res = transcoder.transcode_image_level(
-            basisu_data.ptr,
-            (uint32_t)basisu_data.size,
-            0,          // image index
-            i,          // level index
-            ptr,
-            required_size / bytes_per_block,
-            fmt,
-            0);          // decode_flags
+        res = transcode_level(&transcoder, basisu_data, fmt, first_level + i, desc.data.subimage[0][i]);
         assert(res); (void)res;
     }
+    if (hash != 0) {
+        cache_store(hash, basisu_data.size, fmt, &desc);
+    }
     return desc;
 }
 
+bool sbasisu_image_info(sg_range basisu_data, sbasisu_image_info_t* out_info) {
+    assert(g_pGlobal_codebook);
+    assert(out_info);
+    *out_info = { };
+    basist::basisu_transcoder transcoder(g_pGlobal_codebook);
+    basist::basisu_image_info img_info;
+    if (!transcoder.validate_header(basisu_data.ptr, (uint32_t)basisu_data.size) ||
+        !transcoder.get_image_info(basisu_data.ptr, (uint32_t)basisu_data.size, img_info, 0) ||
+        (img_info.m_total_levels < 1) || (img_info.m_total_levels > SG_MAX_MIPMAPS))
+    {
+        return false;
+    }
+    const basist::transcoder_texture_format fmt = select_basis_textureformat(img_info.m_alpha_flag);
+    out_info->width = (int) img_info.m_width;
+    out_info->height = (int) img_info.m_height;
+    out_info->num_mipmaps = (int) img_info.m_total_levels;
+    out_info->pixel_format = basis_to_sg_pixelformat(fmt);
+    for (int i = 0; i < out_info->num_mipmaps; i++) {
+        out_info->level_size[i] = level_size(transcoder, basisu_data, fmt, i);
+    }
+    return true;
+}
+
+bool sbasisu_cache_load(sg_range basisu_data, sg_image_desc* out_desc) {
+    assert(g_pGlobal_codebook);
+    assert(out_desc);
+    *out_desc = { };
+    if (!cache_enabled()) {
+        return false;
+    }
+    basist::basisu_transcoder transcoder(g_pGlobal_codebook);
+    basist::transcoder_texture_format fmt;
+    if (!transcoder.validate_header(basisu_data.ptr, (uint32_t)basisu_data.size) || !image_format(transcoder, basisu_data, &fmt)) {
+        return false;
+    }
+    return cache_load(content_hash(basisu_data), basisu_data.size, fmt, out_desc);
+}
+
+void sbasisu_cache_store(sg_range basisu_data, const sg_image_desc* desc) {
+    assert(g_pGlobal_codebook);
+    assert(desc);
+    if (!cache_enabled()) {
+        return;
+    }
+    basist::basisu_transcoder transcoder(g_pGlobal_codebook);
+    basist::transcoder_texture_format fmt;
+    if (!transcoder.validate_header(basisu_data.ptr, (uint32_t)basisu_data.size) || !image_format(transcoder, basisu_data, &fmt)) {
+        return;
+    }
+    assert(desc->pixel_format == basis_to_sg_pixelformat(fmt));
+    cache_store(content_hash(basisu_data), basisu_data.size, fmt, desc);
+}
+
 void sbasisu_free(const sg_image_desc* desc) {
     assert(desc);
-    for (int i = 0; i < desc->num_mipmaps; i++) {
-        if (desc->data.subimage[0][i].ptr) {
-            free((void*)desc->data.subimage[0][i].ptr);
-        }
+    const void* level0 = desc->data.subimage[0][0].ptr;
+    if (level0 && !cache_unmap(level0)) {
+        release_buffer((uint8_t*)level0);
     }
 }
 
@@ -146,6 +701,116 @@ sg_image sbasisu_make_image(sg_range basisu_data) {
     return img;
 }
 
+// transcode one level of an async task, the task is handed over
+// to sbasisu_dowork() when its last level is done
+static void run_job(basist::basisu_transcoder* transcoder, uint32_t* cur_task_id, const sbasisu_job_t& job) {
+    sbasisu_task_t* task = job.task;
+    const sg_range data = task->data;
+    if (*cur_task_id != task->id) {
+        *cur_task_id = task->id;
+        if (!transcoder->start_transcoding(data.ptr, (uint32_t)data.size)) {
+            *cur_task_id = 0;
+            task->failed = true;
+        }
+    }
+    if (!task->failed) {
+        if (!transcode_level(transcoder, data, task->fmt, task->first_level + job.level, task->desc.data.subimage[0][job.level])) {
+            task->failed = true;
+        }
+    }
+    if (--task->num_pending_levels == 0) {
+        if (!task->failed && (task->hash != 0)) {
+            cache_store(task->hash, data.size, task->fmt, &task->desc);
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done.push_back(task);
+    }
+}
+
+void sbasisu_transcode_async(const sbasisu_request_t* request) {
+    assert(g_pGlobal_codebook);
+    assert(request && request->data.ptr && (request->data.size > 0) && request->callback);
+    assert((request->first_level >= 0) && (request->num_levels >= 0));
+    sbasisu_task_t* task = new sbasisu_task_t();
+    assert(request->user_data.size <= sizeof(task->user_data));
+    task->id = ++state.next_task_id;
+    if (task->id == 0) {
+        task->id = ++state.next_task_id;
+    }
+    task->callback = request->callback;
+    task->first_level = request->first_level;
+    if (request->user_data.ptr) {
+        memcpy(task->user_data, request->user_data.ptr, request->user_data.size);
+    }
+    state.num_pending++;
+
+    // the header is parsed, the cache is looked up and the level buffers are allocated
+    // on the calling thread, the pixel format query and the allocations aren't thread-safe,
+    // cached images are called back without being transcoded
+    const sg_range src = request->data;
+    const bool complete_chain = (request->first_level == 0) && (request->num_levels == 0);
+    basist::basisu_transcoder transcoder(g_pGlobal_codebook);
+    bool valid = transcoder.validate_header(src.ptr, (uint32_t)src.size) &&
+                 image_format(transcoder, src, &task->fmt);
+    bool cached = false;
+    if (valid) {
+        task->hash = (cache_enabled() && complete_chain) ? content_hash(src) : 0;
+        cached = (task->hash != 0) && cache_load(task->hash, src.size, task->fmt, &task->desc);
+        valid = cached || (alloc_image_desc(transcoder, src, task->fmt, request->first_level, request->num_levels, &task->desc) && (task->desc.num_mipmaps > 0));
+    }
+    if (!valid || cached) {
+        task->failed = !valid;
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done.push_back(task);
+        return;
+    }
+    uint8_t* data_copy = acquire_buffer(src.size);
+    memcpy(data_copy, src.ptr, src.size);
+    task->data = { data_copy, src.size };
+    task->num_pending_levels = task->desc.num_mipmaps;
+    if (state.num_workers == 0) {
+        uint32_t cur_task_id = 0;
+        for (int i = 0; i < task->desc.num_mipmaps; i++) {
+            run_job(&transcoder, &cur_task_id, { task, i });
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (int i = 0; i < task->desc.num_mipmaps; i++) {
+            state.jobs.push_back({ task, i });
+        }
+    }
+    state.job_cond.notify_all();
+}
+
+void sbasisu_dowork(void) {
+    assert(g_pGlobal_codebook);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.callbacks.swap(state.done);
+    }
+    for (sbasisu_task_t* task: state.callbacks) {
+        sbasisu_response_t response = { };
+        response.failed = task->failed;
+        response.desc = &task->desc;
+        response.user_data = task->user_data;
+        task->callback(&response);
+        delete_task(task);
+        state.num_pending--;
+    }
+    state.callbacks.clear();
+}
+
+int sbasisu_num_pending(void) {
+    return state.num_pending;
+}
+
+sbasisu_stats_t sbasisu_stats(void) {
+    std::lock_guard<std::mutex> lock(state.pool.mutex);
+    return state.pool.stats;
+}
+
 sg_pixel_format sbasisu_pixelformat(bool has_alpha) {
     return basis_to_sg_pixelformat(select_basis_textureformat(has_alpha));
 }
@@ -3,6 +3,16 @@
     basisu_sokol.h -- C-API wrapper and sokol_gfx.h glue code for Basis Universal
 
     Include sokol_gfx.h before this file.
+
+    sbasisu_transcode_async() transcodes on a pool of worker threads, the
+    mip levels of an image are transcoded in parallel. The completion
+    callbacks are called from sbasisu_dowork() on the thread which calls
+    it, so that sokol-gfx images are only created on the render thread.
+
+    With a cache_dir in sbasisu_desc_t, transcoded images are written to
+    that directory, keyed by a hash of the basis data and the target format.
+    Later transcodes of the same data map the cache file into the image
+    desc instead of transcoding again. Only complete mip chains are cached.
 */
 #include <stdint.h>
 #include <stdbool.h>
@@ -12,7 +22,15 @@
 extern "C" {
 #endif
 
-void sbasisu_setup(void);
+// max size of the user data copied with an async transcode request
+#define SBASISU_MAX_USERDATA_UINT64 (8)
+
+typedef struct {
+    int num_workers;        // number of transcoding threads (default: number of cores - 1, max 8)
+    const char* cache_dir;  // optional directory for transcoded images, created if it doesn't exist
+} sbasisu_desc_t;
+
+void sbasisu_setup(const sbasisu_desc_t* desc);
 void sbasisu_shutdown(void);
 
 // all in one image creation function
@@ -22,10 +40,64 @@ sg_image sbasisu_make_image(sg_range basisu_data);
 sg_image_desc sbasisu_transcode(sg_range basisu_data);
 void sbasisu_free(const sg_image_desc* desc);
 
+// header information without transcoding
+typedef struct {
+    int width;
+    int height;
+    int num_mipmaps;
+    sg_pixel_format pixel_format;           // the transcoding target format
+    size_t level_size[SG_MAX_MIPMAPS];      // transcoded size of each level in bytes
+} sbasisu_image_info_t;
+
+// returns false if the data isn't a valid basis file
+bool sbasisu_image_info(sg_range basisu_data, sbasisu_image_info_t* out_info);
+// transcode the mip chain from first_level on, the image desc has the size of first_level
+sg_image_desc sbasisu_transcode_levels(sg_range basisu_data, int first_level);
+
+// look up the complete transcoded mip chain in the cache directory without transcoding,
+// returns false if caching is disabled or the image isn't cached, free with sbasisu_free()
+bool sbasisu_cache_load(sg_range basisu_data, sg_image_desc* out_desc);
+// write a complete transcoded mip chain (e.g. assembled from separately transcoded levels) into the cache
+void sbasisu_cache_store(sg_range basisu_data, const sg_image_desc* desc);
+
+// async transcoding
+typedef struct {
+    bool failed;
+    const sg_image_desc* desc;  // the transcoded image, only valid inside the callback
+    void* user_data;            // copy of the request's user data
+} sbasisu_response_t;
+
+typedef struct {
+    sg_range data;              // copied, can be freed after sbasisu_transcode_async() returns
+    void (*callback)(const sbasisu_response_t*);
+    sg_range user_data;         // copied, max SBASISU_MAX_USERDATA_UINT64 * 8 bytes
+    int first_level;            // optional, the image desc has the size of first_level
+    int num_levels;             // optional, default: all levels from first_level on
+} sbasisu_request_t;
+
+void sbasisu_transcode_async(const sbasisu_request_t* request);
+// call once per frame to invoke the callbacks of finished transcodes
+void sbasisu_dowork(void);
+// number of async transcodes which haven't been called back yet
+int sbasisu_num_pending(void);
+
+// scratch memory and cache statistics, the transcoded levels of an image share one buffer,
+// and released buffers (also the copies of async transcode data) are pooled for reuse
+typedef struct {
+    int num_allocs;             // number of scratch buffer allocations
+    int num_allocs_avoided;     // compared to one allocation per level and data copy
+    size_t scratch_bytes;       // currently allocated, including pooled buffers
+    size_t peak_scratch_bytes;
+    size_t pooled_bytes;        // in released buffers kept for reuse
+    int num_cache_hits;         // only counted with a cache_dir
+    int num_cache_misses;
+} sbasisu_stats_t;
+
+sbasisu_stats_t sbasisu_stats(void);
+
 // query supported pixel format
 sg_pixel_format sbasisu_pixelformat(bool has_alpha);
 
 #if defined(__cplusplus)
 } // extern "C"
 #endif
-
@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+//  ozzbake-tool.cc
+//
+//  Command line tool to convert an ozz-animation mesh archive into the
+//  GPU-ready ozzutil mesh format (see ozzbake.h):
+//
+//  > ozzbake input.ozz output.ozzmesh
+//------------------------------------------------------------------------------
+#include "ozz/base/io/stream.h"
+#include "ozz/base/io/archive.h"
+#include "ozz/util/mesh.h"
+
+#include "ozzbake.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s input.ozz output.ozzmesh\n", argv[0]);
+        return 10;
+    }
+    ozz::io::File in_file(argv[1], "rb");
+    if (!in_file.opened()) {
+        fprintf(stderr, "failed to open '%s'\n", argv[1]);
+        return 10;
+    }
+    ozz::io::IArchive archive(&in_file);
+    if (!archive.TestTag<ozz::sample::Mesh>()) {
+        fprintf(stderr, "'%s' is not an ozz mesh archive\n", argv[1]);
+        return 10;
+    }
+    ozz::sample::Mesh mesh;
+    archive >> mesh;
+    if (mesh.parts.empty()) {
+        fprintf(stderr, "'%s' contains no mesh parts\n", argv[1]);
+        return 10;
+    }
+    if (mesh.parts.size() > 1) {
+        fprintf(stderr, "warning: only the first of %d mesh parts is baked\n", (int)mesh.parts.size());
+    }
+
+    const size_t baked_size = ozz_bake_mesh(mesh, nullptr, 0);
+    void* baked = malloc(baked_size);
+    ozz_bake_stats_t stats = { };
+    if (!baked || (ozz_bake_mesh(mesh, baked, baked_size, true, &stats) != baked_size)) {
+        fprintf(stderr, "out of memory baking '%s'\n", argv[1]);
+        free(baked);
+        return 10;
+    }
+    FILE* out_file = fopen(argv[2], "wb");
+    bool ok = false;
+    if (out_file) {
+        ok = (fwrite(baked, baked_size, 1, out_file) == 1);
+        ok &= (fclose(out_file) == 0);
+    }
+    free(baked);
+    if (!ok) {
+        fprintf(stderr, "failed to write '%s'\n", argv[2]);
+        return 10;
+    }
+    printf("%s: %d vertices, %d indices, %d skin joints, %d bytes, ACMR %.3f => %.3f\n",
+        argv[2], (int)(mesh.parts[0].positions.size() / 3), mesh.triangle_index_count(), mesh.num_joints(), (int)baked_size,
+        stats.acmr_before, stats.acmr_after);
+    return 0;
+}
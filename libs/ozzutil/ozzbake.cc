@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+//  ozzbake.cc
+//
+//  Converts ozz-animation meshes into the GPU-ready ozzutil mesh format.
+//------------------------------------------------------------------------------
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/util/mesh.h"
+
+#include "util/meshopt.h"
+#include "ozzbake.h"
+
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+static uint32_t pack_u32(uint8_t x, uint8_t y, uint8_t z, uint8_t w) {
+    return (uint32_t)(((uint32_t)w<<24)|((uint32_t)z<<16)|((uint32_t)y<<8)|x);
+}
+
+static uint32_t pack_f4_byte4n(float x, float y, float z, float w) {
+    int8_t x8 = (int8_t) (x * 127.0f);
+    int8_t y8 = (int8_t) (y * 127.0f);
+    int8_t z8 = (int8_t) (z * 127.0f);
+    int8_t w8 = (int8_t) (w * 127.0f);
+    return pack_u32((uint8_t)x8, (uint8_t)y8, (uint8_t)z8, (uint8_t)w8);
+}
+
+static uint32_t pack_f4_ubyte4n(float x, float y, float z, float w) {
+    uint8_t x8 = (uint8_t) (x * 255.0f);
+    uint8_t y8 = (uint8_t) (y * 255.0f);
+    uint8_t z8 = (uint8_t) (z * 255.0f);
+    uint8_t w8 = (uint8_t) (w * 255.0f);
+    return pack_u32(x8, y8, z8, w8);
+}
+
+static uint32_t align16(uint32_t val) {
+    return (val + 15) & ~15u;
+}
+
+size_t ozz_bake_mesh(const ozz::sample::Mesh& mesh, void* buf, size_t buf_size, bool optimize, ozz_bake_stats_t* out_stats) {
+    // only the first part of the mesh is baked
+    assert(!mesh.parts.empty());
+    const ozz::sample::Mesh::Part& part = mesh.parts[0];
+    const uint32_t num_vertices = (uint32_t) (part.positions.size() / 3);
+    const uint32_t num_indices = (uint32_t) mesh.triangle_indices.size();
+    const uint32_t num_skin_joints = (uint32_t) mesh.num_joints();
+    assert(part.normals.size() == (num_vertices * 3));
+    assert(part.joint_indices.size() == (num_vertices * 4));
+    assert(part.joint_weights.size() == (num_vertices * 3));
+    assert(mesh.joint_remaps.size() == num_skin_joints);
+
+    ozz_baked_mesh_header_t hdr = { };
+    hdr.magic = OZZ_BAKED_MESH_MAGIC;
+    hdr.version = OZZ_BAKED_MESH_VERSION;
+    hdr.num_vertices = num_vertices;
+    hdr.num_indices = num_indices;
+    hdr.num_skin_joints = num_skin_joints;
+    hdr.inverse_bindposes_offset = align16(sizeof(ozz_baked_mesh_header_t));
+    hdr.vertices_offset = align16(hdr.inverse_bindposes_offset + num_skin_joints * 16 * sizeof(float));
+    hdr.indices_offset = align16(hdr.vertices_offset + num_vertices * sizeof(ozz_vertex_t));
+    hdr.joint_remaps_offset = align16(hdr.indices_offset + num_indices * sizeof(uint16_t));
+    hdr.size = align16(hdr.joint_remaps_offset + num_skin_joints * sizeof(uint16_t));
+    if ((buf == nullptr) || (buf_size < hdr.size)) {
+        return hdr.size;
+    }
+
+    uint8_t* dst = (uint8_t*) buf;
+    memset(dst, 0, hdr.size);
+    memcpy(dst, &hdr, sizeof(hdr));
+
+    float* bindposes = (float*) (dst + hdr.inverse_bindposes_offset);
+    for (uint32_t i = 0; i < num_skin_joints; i++) {
+        for (int col = 0; col < 4; col++) {
+            ozz::math::StorePtrU(mesh.inverse_bind_poses[i].cols[col], &bindposes[i * 16 + col * 4]);
+        }
+    }
+
+    ozz_vertex_t* vertices = (ozz_vertex_t*) (dst + hdr.vertices_offset);
+    const float* positions = part.positions.data();
+    const float* normals = part.normals.data();
+    const uint16_t* joint_indices = part.joint_indices.data();
+    const float* joint_weights = part.joint_weights.data();
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        ozz_vertex_t* v = &vertices[i];
+        v->position[0] = positions[i * 3 + 0];
+        v->position[1] = positions[i * 3 + 1];
+        v->position[2] = positions[i * 3 + 2];
+        const float nx = normals[i * 3 + 0];
+        const float ny = normals[i * 3 + 1];
+        const float nz = normals[i * 3 + 2];
+        v->normal = pack_f4_byte4n(nx, ny, nz, 0.0f);
+        const uint8_t ji0 = (uint8_t) joint_indices[i * 4 + 0];
+        const uint8_t ji1 = (uint8_t) joint_indices[i * 4 + 1];
+        const uint8_t ji2 = (uint8_t) joint_indices[i * 4 + 2];
+        const uint8_t ji3 = (uint8_t) joint_indices[i * 4 + 3];
+        v->joint_indices = pack_u32(ji0, ji1, ji2, ji3);
+        const float jw0 = joint_weights[i * 3 + 0];
+        const float jw1 = joint_weights[i * 3 + 1];
+        const float jw2 = joint_weights[i * 3 + 2];
+        const float jw3 = 1.0f - (jw0 + jw1 + jw2);
+        v->joint_weights = pack_f4_ubyte4n(jw0, jw1, jw2, jw3);
+    }
+
+    // reorder triangles for the vertex cache and against overdraw, and then
+    // the vertices into the order they are used by the triangles
+    uint16_t* dst_indices = (uint16_t*) (dst + hdr.indices_offset);
+    if (optimize) {
+        uint32_t* indices = (uint32_t*) calloc(num_indices > 0 ? num_indices : 1, sizeof(uint32_t));
+        if (!indices) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < num_indices; i++) {
+            indices[i] = mesh.triangle_indices[i];
+        }
+        if (out_stats) {
+            out_stats->acmr_before = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+        }
+        meshopt_optimize_vertex_cache(indices, num_indices, num_vertices);
+        meshopt_optimize_overdraw(indices, num_indices, vertices[0].position, num_vertices, sizeof(ozz_vertex_t), 1.05f);
+        meshopt_optimize_vertex_fetch(vertices, num_vertices, sizeof(ozz_vertex_t), indices, num_indices);
+        if (out_stats) {
+            out_stats->acmr_after = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+        }
+        for (uint32_t i = 0; i < num_indices; i++) {
+            dst_indices[i] = (uint16_t) indices[i];
+        }
+        free(indices);
+    } else {
+        memcpy(dst_indices, mesh.triangle_indices.data(), num_indices * sizeof(uint16_t));
+    }
+    memcpy(dst + hdr.joint_remaps_offset, mesh.joint_remaps.data(), num_skin_joints * sizeof(uint16_t));
+    return hdr.size;
+}
@@ -0,0 +1,56 @@
+#pragma once
+/*
+    Offline-baked, GPU-ready skinned mesh format for ozzutil.
+
+    A baked mesh is a small header followed by the packed vertices,
+    16-bit triangle indices, joint remaps and inverse bind pose matrices
+    in their final layout, so that loading only needs to fix up pointers
+    and create the vertex- and index-buffer (see ozz_load_baked_mesh()).
+
+    Baked meshes are created from ozz-animation mesh archives with the
+    ozzbake command line tool, the mesh is optimized for the GPU vertex
+    cache, overdraw and vertex fetch during baking. All values are little-endian, and all
+    offsets are relative to the start of the header and 16-byte aligned.
+*/
+#include <stdint.h>
+#include <stddef.h>
+
+#define OZZ_BAKED_MESH_MAGIC (0x4B425A4F)   // 'OZBK'
+#define OZZ_BAKED_MESH_VERSION (1)
+
+typedef struct {
+    float position[3];
+    uint32_t normal;
+    uint32_t joint_indices;
+    uint32_t joint_weights;
+} ozz_vertex_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // total size in bytes including the header
+    uint32_t num_vertices;
+    uint32_t num_indices;               // number of uint16_t triangle indices
+    uint32_t num_skin_joints;
+    uint32_t vertices_offset;           // ozz_vertex_t[num_vertices]
+    uint32_t indices_offset;            // uint16_t[num_indices]
+    uint32_t joint_remaps_offset;       // uint16_t[num_skin_joints]
+    uint32_t inverse_bindposes_offset;  // column-major float[16][num_skin_joints]
+} ozz_baked_mesh_header_t;
+
+// vertex cache efficiency of the baked mesh (see util/meshopt.h)
+typedef struct {
+    float acmr_before;
+    float acmr_after;
+} ozz_bake_stats_t;
+
+#if defined(__cplusplus)
+namespace ozz { namespace sample { struct Mesh; } }
+
+// bake the first part of an ozz mesh into the buffer, returns the number of bytes
+// required for the baked mesh, call with a null buffer to only query the size,
+// returns 0 if temporary memory couldn't be allocated, with optimize the
+// triangles and vertices are reordered for vertex cache, overdraw and
+// vertex fetch efficiency (out_stats is only written when optimizing)
+size_t ozz_bake_mesh(const ozz::sample::Mesh& mesh, void* buf, size_t buf_size, bool optimize = true, ozz_bake_stats_t* out_stats = nullptr);
+#endif
@@ -0,0 +1,567 @@
+//------------------------------------------------------------------------------
+//  ozzgltf.cc
+//
+//  The offline skeleton and animation builders of ozz-animation are not
+//  part of this repository, so the glTF data is converted into archives
+//  in the runtime's serialization format, which are then loaded like
+//  any other ozz-animation file (see ozz_load_skeleton/animation()).
+//------------------------------------------------------------------------------
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/base/io/stream.h"
+#include "ozz/base/io/archive.h"
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/maths/soa_math_archive.h"
+#include "ozz/base/maths/simd_math.h"
+
+#include "ozzgltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+// the serialized skeleton, this must match Skeleton::Load() version 2
+struct skeleton_writer_t {
+    int num_joints;
+    const char* names;          // all names back-to-back, each zero-terminated
+    int num_name_chars;
+    const int16_t* parents;
+    const ozz::math::SoaTransform* bind_poses;
+    int num_soa_joints;
+
+    void Save(ozz::io::OArchive& archive) const {
+        archive << static_cast<int32_t>(num_joints);
+        archive << static_cast<int32_t>(num_name_chars);
+        archive << ozz::io::MakeArray(names, (size_t)num_name_chars);
+        archive << ozz::io::MakeArray(parents, (size_t)num_joints);
+        archive << ozz::io::MakeArray(bind_poses, (size_t)num_soa_joints);
+    }
+};
+
+// keyframes in the layout of ozz-animation's Float3Key and QuaternionKey
+struct float3_key_t {
+    float ratio;
+    uint16_t track;
+    uint16_t value[3];  // half-floats
+};
+
+struct quat_key_t {
+    float ratio;
+    uint16_t track;
+    uint8_t largest;    // index of the omitted largest component
+    bool sign;          // sign of the largest component
+    int16_t value[3];   // the 3 smallest components, quantized
+};
+
+// the serialized animation, this must match Animation::Load() version 6
+struct animation_writer_t {
+    float duration;
+    int num_tracks;
+    const ozz::vector<float3_key_t>* translations;
+    const ozz::vector<quat_key_t>* rotations;
+    const ozz::vector<float3_key_t>* scales;
+
+    void Save(ozz::io::OArchive& archive) const {
+        archive << duration;
+        archive << static_cast<int32_t>(num_tracks);
+        archive << static_cast<int32_t>(0);     // no name
+        archive << static_cast<int32_t>(translations->size());
+        archive << static_cast<int32_t>(rotations->size());
+        archive << static_cast<int32_t>(scales->size());
+        for (const float3_key_t& key : *translations) {
+            archive << key.ratio;
+            archive << key.track;
+            archive << ozz::io::MakeArray(key.value);
+        }
+        for (const quat_key_t& key : *rotations) {
+            archive << key.ratio;
+            archive << key.track;
+            archive << key.largest;
+            archive << key.sign;
+            archive << ozz::io::MakeArray(key.value);
+        }
+        for (const float3_key_t& key : *scales) {
+            archive << key.ratio;
+            archive << key.track;
+            archive << ozz::io::MakeArray(key.value);
+        }
+    }
+};
+
+namespace ozz {
+namespace io {
+OZZ_IO_TYPE_VERSION(2, skeleton_writer_t)
+OZZ_IO_TYPE_TAG("ozz-skeleton", skeleton_writer_t)
+OZZ_IO_TYPE_VERSION(6, animation_writer_t)
+OZZ_IO_TYPE_TAG("ozz-animation", animation_writer_t)
+}  // namespace io
+}  // namespace ozz
+
+struct cache_item_t {
+    uint64_t hash;
+    ozz_asset_t* asset;
+    int refs;
+};
+
+static struct {
+    ozz::vector<cache_item_t> cache;
+    ozz_gltf_stats_t stats;
+} state;
+
+// an uncompressed keyframe while building the tracks
+struct raw_key_t {
+    float time;
+    float value[4];
+};
+
+// a keyframe in the final order, see sort_keys()
+struct sort_key_t {
+    int group;          // 0 for the first key of a track, 1 for the second, 2 for all others
+    float prev_ratio;   // ratio of the previous key of the same track
+    int track;
+    float ratio;
+    float value[4];
+};
+
+// FNV-1a over the conversion inputs
+static uint64_t hash_bytes(uint64_t hash, const void* ptr, size_t num_bytes) {
+    const uint8_t* bytes = (const uint8_t*) ptr;
+    for (size_t i = 0; i < num_bytes; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static int channel_num_components(const ozz_gltf_channel_t* ch) {
+    return (ch->path == OZZ_GLTF_PATH_ROTATION) ? 4 : 3;
+}
+
+static uint64_t hash_desc(const ozz_gltf_desc_t* desc) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = hash_bytes(hash, &desc->num_joints, sizeof(desc->num_joints));
+    for (int i = 0; i < desc->num_joints; i++) {
+        // field by field, the struct has padding
+        const ozz_gltf_joint_t* j = &desc->joints[i];
+        hash = hash_bytes(hash, &j->parent, sizeof(j->parent));
+        hash = hash_bytes(hash, &j->has_matrix, sizeof(j->has_matrix));
+        if (j->has_matrix) {
+            hash = hash_bytes(hash, j->matrix, sizeof(j->matrix));
+        } else {
+            hash = hash_bytes(hash, j->translation, sizeof(j->translation));
+            hash = hash_bytes(hash, j->rotation, sizeof(j->rotation));
+            hash = hash_bytes(hash, j->scale, sizeof(j->scale));
+        }
+    }
+    if (desc->inverse_bind_matrices) {
+        hash = hash_bytes(hash, desc->inverse_bind_matrices, (size_t)desc->num_joints * 16 * sizeof(float));
+    }
+    for (int i = 0; i < desc->num_channels; i++) {
+        const ozz_gltf_channel_t* ch = &desc->channels[i];
+        const int values_per_key = channel_num_components(ch) * ((ch->interpolation == OZZ_GLTF_INTERPOLATION_CUBICSPLINE) ? 3 : 1);
+        const int header[4] = { ch->joint, (int)ch->path, (int)ch->interpolation, ch->num_keys };
+        hash = hash_bytes(hash, header, sizeof(header));
+        hash = hash_bytes(hash, ch->times, (size_t)ch->num_keys * sizeof(float));
+        hash = hash_bytes(hash, ch->values, (size_t)(ch->num_keys * values_per_key) * sizeof(float));
+    }
+    return hash;
+}
+
+static bool validate_desc(const ozz_gltf_desc_t* desc) {
+    if ((desc->num_joints <= 0) || (desc->num_joints > OZZ_GLTF_MAX_JOINTS) || !desc->joints) {
+        return false;
+    }
+    for (int i = 0; i < desc->num_joints; i++) {
+        const int parent = desc->joints[i].parent;
+        if ((parent < -1) || (parent >= desc->num_joints) || (parent == i)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < desc->num_channels; i++) {
+        const ozz_gltf_channel_t* ch = &desc->channels[i];
+        if ((ch->joint < 0) || (ch->joint >= desc->num_joints) || (ch->num_keys <= 0) || !ch->times || !ch->values) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ozz-animation expects parents before their children in depth-first order,
+// returns false if the parent links contain a cycle
+static bool sort_joints(const ozz_gltf_desc_t* desc, ozz::vector<int>* order, ozz::vector<int>* skel_index) {
+    const int num_joints = desc->num_joints;
+    order->clear();
+    skel_index->assign(num_joints, -1);
+    ozz::vector<int> stack;
+    for (int root = num_joints - 1; root >= 0; root--) {
+        if (desc->joints[root].parent == -1) {
+            stack.push_back(root);
+        }
+    }
+    while (!stack.empty()) {
+        const int joint = stack.back();
+        stack.pop_back();
+        (*skel_index)[joint] = (int)order->size();
+        order->push_back(joint);
+        // push in reverse so that children are visited in their original order
+        for (int child = num_joints - 1; child >= 0; child--) {
+            if (desc->joints[child].parent == joint) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return (int)order->size() == num_joints;
+}
+
+static void rest_pose(const ozz_gltf_joint_t* joint, float* t, float* r, float* s) {
+    if (joint->has_matrix) {
+        using namespace ozz::math;
+        Float4x4 m;
+        for (int col = 0; col < 4; col++) {
+            m.cols[col] = simd_float4::LoadPtrU(&joint->matrix[col * 4]);
+        }
+        SimdFloat4 st, sr, ss;
+        if (ToAffine(m, &st, &sr, &ss)) {
+            float tmp[4];
+            StorePtrU(st, tmp);
+            memcpy(t, tmp, 3 * sizeof(float));
+            StorePtrU(sr, r);
+            StorePtrU(ss, tmp);
+            memcpy(s, tmp, 3 * sizeof(float));
+            return;
+        }
+        // a degenerate matrix only keeps its translation
+        memcpy(t, &joint->matrix[12], 3 * sizeof(float));
+        r[0] = r[1] = r[2] = 0.0f; r[3] = 1.0f;
+        s[0] = s[1] = s[2] = 1.0f;
+        return;
+    }
+    memcpy(t, joint->translation, 3 * sizeof(float));
+    memcpy(r, joint->rotation, 4 * sizeof(float));
+    memcpy(s, joint->scale, 3 * sizeof(float));
+}
+
+static bool write_archive(ozz::io::MemoryStream* stream, ozz::vector<char>* out) {
+    const size_t size = stream->Size();
+    out->resize(size);
+    stream->Seek(0, ozz::io::Stream::kSet);
+    return (size > 0) && (stream->Read(out->data(), size) == size);
+}
+
+static bool convert_skeleton(const ozz_gltf_desc_t* desc, const ozz::vector<int>& order, const ozz::vector<int>& skel_index, ozz::vector<char>* out) {
+    using namespace ozz::math;
+    const int num_joints = desc->num_joints;
+    const int num_soa_joints = (num_joints + 3) / 4;
+    ozz::vector<int16_t> parents(num_joints);
+    for (int i = 0; i < num_joints; i++) {
+        const int parent = desc->joints[order[i]].parent;
+        parents[i] = (parent == -1) ? -1 : (int16_t)skel_index[parent];
+    }
+    // the rest poses as SoA, one lane per joint, padding joints are identity
+    ozz::vector<SoaTransform> bind_poses(num_soa_joints);
+    for (int i = 0; i < num_soa_joints; i++) {
+        float t[3][4], r[4][4], s[3][4];
+        for (int lane = 0; lane < 4; lane++) {
+            float jt[3] = { 0.0f, 0.0f, 0.0f };
+            float jr[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            float js[3] = { 1.0f, 1.0f, 1.0f };
+            const int joint = i * 4 + lane;
+            if (joint < num_joints) {
+                rest_pose(&desc->joints[order[joint]], jt, jr, js);
+            }
+            for (int c = 0; c < 3; c++) {
+                t[c][lane] = jt[c];
+                s[c][lane] = js[c];
+            }
+            for (int c = 0; c < 4; c++) {
+                r[c][lane] = jr[c];
+            }
+        }
+        bind_poses[i].translation = SoaFloat3::Load(simd_float4::LoadPtrU(t[0]), simd_float4::LoadPtrU(t[1]), simd_float4::LoadPtrU(t[2]));
+        bind_poses[i].rotation = SoaQuaternion::Load(simd_float4::LoadPtrU(r[0]), simd_float4::LoadPtrU(r[1]), simd_float4::LoadPtrU(r[2]), simd_float4::LoadPtrU(r[3]));
+        bind_poses[i].scale = SoaFloat3::Load(simd_float4::LoadPtrU(s[0]), simd_float4::LoadPtrU(s[1]), simd_float4::LoadPtrU(s[2]));
+    }
+    // joints are unnamed, so the names are just zero-terminators
+    ozz::vector<char> names(num_joints, 0);
+
+    skeleton_writer_t writer = { };
+    writer.num_joints = num_joints;
+    writer.names = names.data();
+    writer.num_name_chars = num_joints;
+    writer.parents = parents.data();
+    writer.bind_poses = bind_poses.data();
+    writer.num_soa_joints = num_soa_joints;
+    ozz::io::MemoryStream stream;
+    {
+        ozz::io::OArchive archive(&stream);
+        archive << writer;
+    }
+    return write_archive(&stream, out);
+}
+
+// gather the keys of one channel, step keys are emulated with a copy
+// of each key right before the next key
+static void channel_keys(const ozz_gltf_channel_t* ch, ozz::vector<raw_key_t>* keys) {
+    const int num_components = channel_num_components(ch);
+    const bool cubic = ch->interpolation == OZZ_GLTF_INTERPOLATION_CUBICSPLINE;
+    keys->clear();
+    for (int k = 0; k < ch->num_keys; k++) {
+        raw_key_t key = { };
+        key.time = (ch->times[k] > 0.0f) ? ch->times[k] : 0.0f;
+        // cubic spline keys are in-tangent, value, out-tangent
+        const float* src = &ch->values[(cubic ? (k * 3 + 1) : k) * num_components];
+        memcpy(key.value, src, (size_t)num_components * sizeof(float));
+        if ((ch->interpolation == OZZ_GLTF_INTERPOLATION_STEP) && (k > 0)) {
+            raw_key_t hold = keys->back();
+            hold.time = key.time;
+            keys->push_back(hold);
+        }
+        keys->push_back(key);
+    }
+}
+
+// Build the keys of one track in ratio space, with a key at ratio 0 and 1, and
+// append them to the sort list. Rotations are normalized and kept in the same
+// hemisphere as their predecessor, since ozz-animation interpolates with nlerp.
+static void append_track(int track, ozz::vector<raw_key_t>* keys, const float* rest, int num_components, float duration, ozz::vector<sort_key_t>* out) {
+    if (keys->empty()) {
+        raw_key_t key = { };
+        memcpy(key.value, rest, (size_t)num_components * sizeof(float));
+        keys->push_back(key);
+    }
+    if (keys->front().time > 0.0f) {
+        raw_key_t first = keys->front();
+        first.time = 0.0f;
+        keys->insert(keys->begin(), first);
+    }
+    if ((keys->back().time < duration) || (keys->size() < 2)) {
+        raw_key_t last = keys->back();
+        last.time = duration;
+        keys->push_back(last);
+    }
+    float prev_ratio = -1.0f;
+    float prev_q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (size_t k = 0; k < keys->size(); k++) {
+        const raw_key_t& src = (*keys)[k];
+        sort_key_t key = { };
+        key.group = (k < 2) ? (int)k : 2;
+        key.prev_ratio = prev_ratio;
+        key.track = track;
+        key.ratio = std::min(1.0f, std::max(0.0f, src.time / duration));
+        memcpy(key.value, src.value, sizeof(key.value));
+        if (num_components == 4) {
+            float len = sqrtf(key.value[0]*key.value[0] + key.value[1]*key.value[1] + key.value[2]*key.value[2] + key.value[3]*key.value[3]);
+            if (len < 1e-8f) {
+                key.value[0] = key.value[1] = key.value[2] = 0.0f;
+                key.value[3] = len = 1.0f;
+            }
+            const float dot = prev_q[0]*key.value[0] + prev_q[1]*key.value[1] + prev_q[2]*key.value[2] + prev_q[3]*key.value[3];
+            const float scale = ((dot < 0.0f) && (k > 0)) ? (-1.0f / len) : (1.0f / len);
+            for (int c = 0; c < 4; c++) {
+                key.value[c] *= scale;
+                prev_q[c] = key.value[c];
+            }
+        }
+        prev_ratio = key.ratio;
+        out->push_back(key);
+    }
+}
+
+// The sampling job initializes its cache from the first and second key of
+// all tracks, which must be the first 2 rows of keys in track order, all
+// other keys are consumed in the order their predecessor's ratio is reached.
+static void sort_keys(ozz::vector<sort_key_t>* keys) {
+    std::stable_sort(keys->begin(), keys->end(), [](const sort_key_t& a, const sort_key_t& b) {
+        if (a.group != b.group) {
+            return a.group < b.group;
+        }
+        if (a.prev_ratio != b.prev_ratio) {
+            return a.prev_ratio < b.prev_ratio;
+        }
+        return a.track < b.track;
+    });
+}
+
+static float3_key_t compress_float3(const sort_key_t& src) {
+    float3_key_t key = { };
+    key.ratio = src.ratio;
+    key.track = (uint16_t)src.track;
+    for (int c = 0; c < 3; c++) {
+        key.value[c] = ozz::math::FloatToHalf(src.value[c]);
+    }
+    return key;
+}
+
+// store the 3 smallest components of a normalized quaternion, same as
+// ozz-animation's offline builder, the largest is restored at runtime
+static quat_key_t compress_quat(const sort_key_t& src) {
+    quat_key_t key = { };
+    key.ratio = src.ratio;
+    key.track = (uint16_t)src.track;
+    int largest = 0;
+    for (int c = 1; c < 4; c++) {
+        if (fabsf(src.value[c]) > fabsf(src.value[largest])) {
+            largest = c;
+        }
+    }
+    key.largest = (uint8_t)largest;
+    key.sign = src.value[largest] < 0.0f;
+    const float float_to_int = 32767.0f * 1.41421356f;
+    for (int c = 0, i = 0; c < 4; c++) {
+        if (c != largest) {
+            const int val = (int)floorf(src.value[c] * float_to_int + 0.5f);
+            key.value[i++] = (int16_t)std::min(32767, std::max(-32767, val));
+        }
+    }
+    return key;
+}
+
+static bool convert_animation(const ozz_gltf_desc_t* desc, const ozz::vector<int>& order, const ozz::vector<int>& skel_index, ozz::vector<char>* out) {
+    const int num_joints = desc->num_joints;
+    const int num_tracks = ((num_joints + 3) / 4) * 4;
+    float duration = 0.0f;
+    for (int i = 0; i < desc->num_channels; i++) {
+        const ozz_gltf_channel_t* ch = &desc->channels[i];
+        duration = std::max(duration, ch->times[ch->num_keys - 1]);
+    }
+    if (duration <= 0.0f) {
+        duration = 1.0f;
+    }
+    ozz::vector<sort_key_t> sorted[3];
+    ozz::vector<raw_key_t> keys;
+    const float identity[3][4] = { { 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 0.0f } };
+    for (int track = 0; track < num_tracks; track++) {
+        float rest[3][4] = { };
+        if (track < num_joints) {
+            rest_pose(&desc->joints[order[track]], rest[0], rest[1], rest[2]);
+        } else {
+            memcpy(rest, identity, sizeof(rest));
+        }
+        for (int path = 0; path < 3; path++) {
+            keys.clear();
+            // the first channel targeting this joint and path wins
+            for (int i = 0; i < desc->num_channels; i++) {
+                const ozz_gltf_channel_t* ch = &desc->channels[i];
+                if ((skel_index[ch->joint] == track) && ((int)ch->path == path)) {
+                    channel_keys(ch, &keys);
+                    break;
+                }
+            }
+            append_track(track, &keys, rest[path], (path == OZZ_GLTF_PATH_ROTATION) ? 4 : 3, duration, &sorted[path]);
+        }
+    }
+    ozz::vector<float3_key_t> translations;
+    ozz::vector<quat_key_t> rotations;
+    ozz::vector<float3_key_t> scales;
+    for (int path = 0; path < 3; path++) {
+        sort_keys(&sorted[path]);
+    }
+    for (const sort_key_t& key : sorted[OZZ_GLTF_PATH_TRANSLATION]) {
+        translations.push_back(compress_float3(key));
+    }
+    for (const sort_key_t& key : sorted[OZZ_GLTF_PATH_ROTATION]) {
+        rotations.push_back(compress_quat(key));
+    }
+    for (const sort_key_t& key : sorted[OZZ_GLTF_PATH_SCALE]) {
+        scales.push_back(compress_float3(key));
+    }
+
+    animation_writer_t writer = { };
+    writer.duration = duration;
+    writer.num_tracks = num_joints;
+    writer.translations = &translations;
+    writer.rotations = &rotations;
+    writer.scales = &scales;
+    ozz::io::MemoryStream stream;
+    {
+        ozz::io::OArchive archive(&stream);
+        archive << writer;
+    }
+    return write_archive(&stream, out);
+}
+
+static ozz_asset_t* convert(const ozz_gltf_desc_t* desc) {
+    ozz_asset_t* asset = ozz_create_asset();
+    ozz::vector<int> order, skel_index;
+    if (!validate_desc(desc) || !sort_joints(desc, &order, &skel_index)) {
+        ozz_set_load_failed(asset);
+        return asset;
+    }
+    ozz::vector<char> archive;
+    if (!convert_skeleton(desc, order, skel_index, &archive)) {
+        ozz_set_load_failed(asset);
+        return asset;
+    }
+    ozz_load_skeleton(asset, archive.data(), archive.size());
+    if (!convert_animation(desc, order, skel_index, &archive)) {
+        ozz_set_load_failed(asset);
+        return asset;
+    }
+    ozz_load_animation(asset, archive.data(), archive.size());
+
+    // the skin joints keep the glTF order, and are remapped to the sorted skeleton joints
+    const int num_joints = desc->num_joints;
+    ozz::vector<uint16_t> joint_remaps(num_joints);
+    ozz::vector<float> inverse_bindposes(num_joints * 16, 0.0f);
+    for (int i = 0; i < num_joints; i++) {
+        joint_remaps[i] = (uint16_t)skel_index[i];
+        if (desc->inverse_bind_matrices) {
+            memcpy(&inverse_bindposes[i * 16], &desc->inverse_bind_matrices[i * 16], 16 * sizeof(float));
+        } else {
+            for (int c = 0; c < 4; c++) {
+                inverse_bindposes[i * 16 + c * 5] = 1.0f;
+            }
+        }
+    }
+    ozz_load_skin(asset, joint_remaps.data(), inverse_bindposes.data(), num_joints);
+    return asset;
+}
+
+ozz_asset_t* ozz_gltf_import(const ozz_gltf_desc_t* desc) {
+    assert(desc);
+    state.stats.num_imports++;
+    const uint64_t hash = hash_desc(desc);
+    for (cache_item_t& item : state.cache) {
+        if (item.hash == hash) {
+            item.refs++;
+            state.stats.num_cache_hits++;
+            return item.asset;
+        }
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    cache_item_t item = { };
+    item.hash = hash;
+    item.asset = convert(desc);
+    item.refs = 1;
+    state.cache.push_back(item);
+    state.stats.num_cached_assets = (int)state.cache.size();
+    const std::chrono::duration<double, std::milli> convert_time = std::chrono::steady_clock::now() - start_time;
+    state.stats.convert_time_ms += convert_time.count();
+    return item.asset;
+}
+
+void ozz_gltf_release(ozz_asset_t* asset) {
+    assert(asset);
+    for (size_t i = 0; i < state.cache.size(); i++) {
+        cache_item_t& item = state.cache[i];
+        if (item.asset == asset) {
+            assert(item.refs > 0);
+            if (--item.refs == 0) {
+                ozz_destroy_asset(asset);
+                state.cache.erase(state.cache.begin() + i);
+            }
+            break;
+        }
+    }
+    // free the cache memory once it's empty, ozz-animation checks for leaks at exit
+    if (state.cache.empty()) {
+        ozz::vector<cache_item_t>().swap(state.cache);
+    }
+    state.stats.num_cached_assets = (int)state.cache.size();
+}
+
+ozz_gltf_stats_t ozz_gltf_stats(void) {
+    return state.stats;
+}
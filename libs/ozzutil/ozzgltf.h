@@ -0,0 +1,85 @@
+#pragma once
+/*
+    Converts a glTF skin and its animation channels into an ozz-animation
+    skeleton and animation at load time (see ozzgltf.cc).
+
+    The glTF data is described with plain structs, so this header doesn't
+    depend on a specific glTF parser. The result is an ozzutil asset with
+    skeleton, animation and skin joints but without a mesh, the skinned
+    vertices are rendered from the caller's own vertex buffers through the
+    joint texture (see ozz_load_skin()).
+
+    Converted assets are cached by content, importing the same skin and
+    animation again (for instance by several nodes sharing a skin, or when
+    reloading a scene) returns the cached asset instead of converting again.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "ozzutil.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// ozz-animation keyframes store the track index in 13 bits
+#define OZZ_GLTF_MAX_JOINTS (8191)
+
+typedef enum {
+    OZZ_GLTF_PATH_TRANSLATION,
+    OZZ_GLTF_PATH_ROTATION,
+    OZZ_GLTF_PATH_SCALE,
+} ozz_gltf_path_t;
+
+// ozz-animation only interpolates linearly, step keys are duplicated and
+// only the values of cubic spline keys are used (without tangents)
+typedef enum {
+    OZZ_GLTF_INTERPOLATION_LINEAR,
+    OZZ_GLTF_INTERPOLATION_STEP,
+    OZZ_GLTF_INTERPOLATION_CUBICSPLINE,
+} ozz_gltf_interpolation_t;
+
+// a skin joint and its rest pose, joints can be in any order
+typedef struct {
+    int parent;                 // index of the closest ancestor in the skin's joints, or -1
+    float translation[3];
+    float rotation[4];          // quaternion xyzw
+    float scale[3];
+    bool has_matrix;            // the rest pose is the column-major matrix instead of TRS
+    float matrix[16];
+} ozz_gltf_joint_t;
+
+// an animation channel targeting a skin joint, the data is an animation
+// sampler's tightly packed float input (seconds) and output accessors
+typedef struct {
+    int joint;                  // index into the skin's joints
+    ozz_gltf_path_t path;
+    ozz_gltf_interpolation_t interpolation;
+    int num_keys;
+    const float* times;         // num_keys
+    const float* values;        // num_keys * 3 or 4 floats (3 times that for cubic splines)
+} ozz_gltf_channel_t;
+
+typedef struct {
+    int num_joints;
+    const ozz_gltf_joint_t* joints;
+    const float* inverse_bind_matrices;     // column-major 4x4 per joint, null for identity
+    int num_channels;
+    const ozz_gltf_channel_t* channels;     // joints without a channel keep their rest pose
+} ozz_gltf_desc_t;
+
+typedef struct {
+    int num_imports;            // number of ozz_gltf_import() calls
+    int num_cache_hits;         // number of imports which returned a cached asset
+    int num_cached_assets;      // number of assets currently in the cache
+    double convert_time_ms;     // total time spent converting
+} ozz_gltf_stats_t;
+
+// returns the cached or newly converted asset, call ozz_load_failed() to check for
+// invalid data, and release the asset with ozz_gltf_release() instead of ozz_destroy_asset()
+ozz_asset_t* ozz_gltf_import(const ozz_gltf_desc_t* desc);
+void ozz_gltf_release(ozz_asset_t* asset);
+ozz_gltf_stats_t ozz_gltf_stats(void);
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+//  ozzskin-bench.cc
+//
+//  Micro-benchmark for writing skinning matrices into the joint upload
+//  buffer of ozzutil. Times the 4x3 matrix palette format, and compares the
+//  dual-quaternion conversion in ozzskin.h with the previous one through
+//  ToAffine(), by default at 64 joints x 512 instances:
+//
+//  > ozzskin-bench [num_frames]
+//------------------------------------------------------------------------------
+#include "ozz/base/maths/simd_math.h"
+#include "ozzskin.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#define NUM_JOINTS (64)
+#define NUM_INSTANCES (512)
+
+using namespace ozz::math;
+
+// the previous dual-quaternion path, one matrix at a time with a full affine decomposition
+static void write_dual_quaternions_affine(const Float4x4* m, int num, float* ptr) {
+    for (int i = 0; i < num; i++) {
+        SimdFloat4 t, q, s;
+        if (!ToAffine(m[i], &t, &q, &s)) {
+            t = simd_float4::zero();
+            q = simd_float4::w_axis();
+        }
+        const SimdFloat4 half = simd_float4::Load1(0.5f);
+        const SimdFloat4 dual_xyz = (SplatW(q) * t + Cross3(t, q)) * half;
+        const SimdFloat4 dual = SetW(dual_xyz, -Dot3(t, q) * half);
+        StorePtrU(q, ptr + i * 8);
+        StorePtrU(dual, ptr + i * 8 + 4);
+    }
+}
+
+// the largest difference between two dual-quaternion outputs, relative for
+// values above 1 (the dual parts grow with the translation)
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    float max_diff = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        const float diff = fabsf(a[i] - b[i]) / fmaxf(fabsf(a[i]), 1.0f);
+        max_diff = (diff > max_diff) ? diff : max_diff;
+    }
+    return max_diff;
+}
+
+typedef void (*write_func_t)(const Float4x4& m, float* ptr);
+typedef void (*write_batch_func_t)(const Float4x4* m, int num, float* ptr);
+
+static struct {
+    std::vector<Float4x4> model_matrices;       // NUM_JOINTS per instance
+    std::vector<Float4x4> inverse_bindposes;    // NUM_JOINTS
+    std::vector<float> upload_buffer;           // one row of NUM_JOINTS * 12 floats per instance
+} state;
+
+// skin all instances once, like ozz_update_instances() does on a single thread
+static void skin_frame(write_func_t write_func, int floats_per_joint) {
+    for (int inst = 0; inst < NUM_INSTANCES; inst++) {
+        const Float4x4* model = &state.model_matrices[inst * NUM_JOINTS];
+        float* row_ptr = &state.upload_buffer[inst * NUM_JOINTS * 12];
+        for (int i = 0; i < NUM_JOINTS; i++) {
+            const Float4x4 skin_matrix = model[i] * state.inverse_bindposes[i];
+            write_func(skin_matrix, &row_ptr[i * floats_per_joint]);
+        }
+    }
+}
+
+// the dual-quaternion writers convert 4 skinning matrices at once
+static void skin_frame_batched(write_batch_func_t write_func) {
+    for (int inst = 0; inst < NUM_INSTANCES; inst++) {
+        const Float4x4* model = &state.model_matrices[inst * NUM_JOINTS];
+        float* row_ptr = &state.upload_buffer[inst * NUM_JOINTS * 12];
+        for (int i = 0; i < NUM_JOINTS; i += 4) {
+            const int num = ((NUM_JOINTS - i) < 4) ? (NUM_JOINTS - i) : 4;
+            Float4x4 skin_matrices[4];
+            for (int k = 0; k < num; k++) {
+                skin_matrices[k] = model[i + k] * state.inverse_bindposes[i + k];
+            }
+            write_func(skin_matrices, num, &row_ptr[i * 8]);
+        }
+    }
+}
+
+// returns the fastest frame in milliseconds
+template<typename FRAME_FUNC> static double bench(const char* name, int num_frames, FRAME_FUNC frame_func) {
+    double min_ms = 1.0e9;
+    double total_ms = 0.0;
+    for (int frame = 0; frame < num_frames; frame++) {
+        const auto start_time = std::chrono::steady_clock::now();
+        frame_func();
+        const std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - start_time;
+        total_ms += frame_time.count();
+        if (frame_time.count() < min_ms) {
+            min_ms = frame_time.count();
+        }
+    }
+    printf("%-18s %8.3f ms/frame (min %.3f ms)\n", name, total_ms / num_frames, min_ms);
+    return min_ms;
+}
+
+int main(int argc, char* argv[]) {
+    const int num_frames = (argc > 1) ? atoi(argv[1]) : 200;
+    if (num_frames <= 0) {
+        fprintf(stderr, "usage: %s [num_frames]\n", argv[0]);
+        return 10;
+    }
+
+    // rigid joint transforms which differ per joint and instance
+    state.model_matrices.resize(NUM_INSTANCES * NUM_JOINTS);
+    state.inverse_bindposes.resize(NUM_JOINTS);
+    for (int i = 0; i < NUM_JOINTS; i++) {
+        const SimdFloat4 pos = simd_float4::Load(0.0f, (float)i * 0.1f, 0.0f, 0.0f);
+        state.inverse_bindposes[i] = Invert(Float4x4::Translation(pos));
+    }
+    for (int inst = 0; inst < NUM_INSTANCES; inst++) {
+        for (int i = 0; i < NUM_JOINTS; i++) {
+            const float angle = (float)(inst * NUM_JOINTS + i) * 0.001f;
+            const Float4x4 rot = Float4x4::FromEuler(simd_float4::Load(angle, angle * 0.5f, 0.0f, 0.0f));
+            const SimdFloat4 pos = simd_float4::Load((float)inst, (float)i * 0.1f, 0.0f, 0.0f);
+            state.model_matrices[inst * NUM_JOINTS + i] = Float4x4::Translation(pos) * rot;
+        }
+    }
+    state.upload_buffer.resize(NUM_INSTANCES * NUM_JOINTS * 12);
+
+    // the direct dual-quaternion conversion must match the affine decomposition,
+    // also on matrices with a (non-uniform) scale, and for partial batches
+    skin_frame_batched(write_dual_quaternions_affine);
+    const std::vector<float> dq_reference = state.upload_buffer;
+    skin_frame_batched(ozz_skin_write_dual_quaternions);
+    float dq_diff = max_difference(dq_reference, state.upload_buffer);
+    for (int i = 0; i < NUM_JOINTS; i++) {
+        Float4x4 m[4];
+        for (int k = 0; k < 4; k++) {
+            const Float4x4 scale = Float4x4::Scaling(simd_float4::Load(1.0f + (float)(i + k) * 0.1f, 2.0f, 0.5f, 1.0f));
+            m[k] = state.model_matrices[i * 4 + k] * scale;
+        }
+        const int num = 1 + (i % 4);
+        std::vector<float> a(32, 0.0f), b(32, 0.0f);
+        write_dual_quaternions_affine(m, num, a.data());
+        ozz_skin_write_dual_quaternions(m, num, b.data());
+        const float diff = max_difference(a, b);
+        dq_diff = (diff > dq_diff) ? diff : dq_diff;
+    }
+    if (dq_diff > 1.0e-4f) {
+        fprintf(stderr, "dual-quaternion output differs from the affine decomposition by %g!\n", dq_diff);
+        return 10;
+    }
+
+    printf("%d joints x %d instances, %d frames\n", NUM_JOINTS, NUM_INSTANCES, num_frames);
+    bench("matrix", num_frames, [] { skin_frame(ozz_skin_write_matrix, 12); });
+    const double dq_affine_ms = bench("dual-quat (affine)", num_frames, [] { skin_frame_batched(write_dual_quaternions_affine); });
+    const double dq_ms = bench("dual-quaternion", num_frames, [] { skin_frame_batched(ozz_skin_write_dual_quaternions); });
+    printf("dual-quaternion speedup: %.2fx (max difference %g)\n", dq_affine_ms / dq_ms, dq_diff);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  ozzskin.h
+//
+//  Write skinning matrices into the joint texture layouts of ozzutil (used
+//  by ozzutil.cc and the ozzskin-bench tool).
+//------------------------------------------------------------------------------
+#include "ozz/base/maths/simd_math.h"
+
+// write a skinning matrix as 3 texels (a transposed 4x3 matrix)
+static inline void ozz_skin_write_matrix(const ozz::math::Float4x4& m, float* ptr) {
+    const ozz::math::SimdFloat4& c0 = m.cols[0];
+    const ozz::math::SimdFloat4& c1 = m.cols[1];
+    const ozz::math::SimdFloat4& c2 = m.cols[2];
+    const ozz::math::SimdFloat4& c3 = m.cols[3];
+    *ptr++ = ozz::math::GetX(c0); *ptr++ = ozz::math::GetX(c1); *ptr++ = ozz::math::GetX(c2); *ptr++ = ozz::math::GetX(c3);
+    *ptr++ = ozz::math::GetY(c0); *ptr++ = ozz::math::GetY(c1); *ptr++ = ozz::math::GetY(c2); *ptr++ = ozz::math::GetY(c3);
+    *ptr++ = ozz::math::GetZ(c0); *ptr++ = ozz::math::GetZ(c1); *ptr++ = ozz::math::GetZ(c2); *ptr++ = ozz::math::GetZ(c3);
+}
+
+// convert up to 4 skinning matrices into dual-quaternions (real part xyzw,
+// followed by dual part xyzw), the 4 matrices are converted at once with one
+// matrix per SIMD lane, the rotation is taken directly from the upper 3x3 with
+// the trace method (cf. ToQuaternion(), the case is selected per lane), any
+// scale is removed by normalizing the columns, the dual part is built from the
+// translation column
+static inline void ozz_skin_write_dual_quaternions(const ozz::math::Float4x4* m, int num, float* ptr) {
+    using namespace ozz::math;
+    // rows[r][c] holds the element at row r and column c of all 4 matrices,
+    // missing matrices of a partial batch are identity matrices
+    const Float4x4 identity = Float4x4::identity();
+    const Float4x4* src[4];
+    for (int i = 0; i < 4; i++) {
+        src[i] = (i < num) ? &m[i] : &identity;
+    }
+    SimdFloat4 rows[3][4];
+    for (int c = 0; c < 4; c++) {
+        const SimdFloat4 cols[4] = { src[0]->cols[c], src[1]->cols[c], src[2]->cols[c], src[3]->cols[c] };
+        SimdFloat4 soa[4];
+        Transpose4x4(cols, soa);
+        rows[0][c] = soa[0];
+        rows[1][c] = soa[1];
+        rows[2][c] = soa[2];
+    }
+    const SimdFloat4 one = simd_float4::one();
+    const SimdFloat4 half = simd_float4::Load1(0.5f);
+    const SimdFloat4 min_sq_len = simd_float4::Load1(1.0e-24f);
+    SimdFloat4 r[3][3];
+    for (int c = 0; c < 3; c++) {
+        const SimdFloat4 sq_len = Max(rows[0][c] * rows[0][c] + rows[1][c] * rows[1][c] + rows[2][c] * rows[2][c], min_sq_len);
+        const SimdFloat4 inv_len = one / Sqrt(sq_len);
+        r[0][c] = rows[0][c] * inv_len;
+        r[1][c] = rows[1][c] * inv_len;
+        r[2][c] = rows[2][c] * inv_len;
+    }
+    const SimdFloat4 dx = r[2][1] - r[1][2];
+    const SimdFloat4 dy = r[0][2] - r[2][0];
+    const SimdFloat4 dz = r[1][0] - r[0][1];
+    const SimdFloat4 sx = r[2][1] + r[1][2];
+    const SimdFloat4 sy = r[0][2] + r[2][0];
+    const SimdFloat4 sz = r[1][0] + r[0][1];
+    const SimdInt4 case_w = CmpGt(r[0][0] + r[1][1] + r[2][2], simd_float4::zero());
+    const SimdInt4 case_x = And(CmpGt(r[0][0], r[1][1]), CmpGt(r[0][0], r[2][2]));
+    const SimdInt4 case_y = CmpGt(r[1][1], r[2][2]);
+    const SimdFloat4 t = Select(case_w, one + r[0][0] + r[1][1] + r[2][2],
+                         Select(case_x, one + r[0][0] - r[1][1] - r[2][2],
+                         Select(case_y, one - r[0][0] + r[1][1] - r[2][2],
+                                        one - r[0][0] - r[1][1] + r[2][2])));
+    SimdFloat4 q[4] = {
+        Select(case_w, dx, Select(case_x, t, Select(case_y, sz, sy))),
+        Select(case_w, dy, Select(case_x, sz, Select(case_y, t, sx))),
+        Select(case_w, dz, Select(case_x, sy, Select(case_y, sx, t))),
+        Select(case_w, t, Select(case_x, dx, Select(case_y, dy, dz))),
+    };
+    // the normalized columns of a skinning matrix aren't exactly orthogonal,
+    // so the quaternion is normalized instead of scaled by 0.5 / sqrt(t)
+    const SimdFloat4 inv_len = one / Sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    q[0] = q[0] * inv_len;
+    q[1] = q[1] * inv_len;
+    q[2] = q[2] * inv_len;
+    q[3] = q[3] * inv_len;
+    // dual = 0.5 * (t, 0) * q
+    const SimdFloat4& tx = rows[0][3];
+    const SimdFloat4& ty = rows[1][3];
+    const SimdFloat4& tz = rows[2][3];
+    const SimdFloat4 dual[4] = {
+        (q[3] * tx + ty * q[2] - tz * q[1]) * half,
+        (q[3] * ty + tz * q[0] - tx * q[2]) * half,
+        (q[3] * tz + tx * q[1] - ty * q[0]) * half,
+        -(tx * q[0] + ty * q[1] + tz * q[2]) * half,
+    };
+    SimdFloat4 real_aos[4];
+    SimdFloat4 dual_aos[4];
+    Transpose4x4(q, real_aos);
+    Transpose4x4(dual, dual_aos);
+    for (int i = 0; (i < 4) && (i < num); i++) {
+        StorePtrU(real_aos[i], ptr + i * 8);
+        StorePtrU(dual_aos[i], ptr + i * 8 + 4);
+    }
+}
@@ -10,30 +10,88 @@
 #include "ozz/base/containers/vector.h"
 #include "ozz/base/maths/soa_transform.h"
 #include "ozz/base/maths/vec_float.h"
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/memory/allocator.h"
 #include "ozz/util/mesh.h"
 
 #include "ozzutil.h"
+#include "ozzskin.h"
+#include "spanstream.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+// threads are not available in emscripten builds without pthreads support
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define OZZ_NO_THREADS (1)
+#endif
+#define OZZ_MAX_WORKERS (64)
+// the joint texture height grows and shrinks in power-of-two steps of rows
+#define OZZ_MIN_JOINT_TEXTURE_ROWS (16)
+
+struct ozz_instance_private_t;
+
+// per-worker scratch data, each worker samples and converts into its own
+// buffers so that no mutable state is shared between threads
+struct ozz_worker_t {
+    ozz::vector<ozz::math::SoaTransform> local_matrices;
+    ozz::vector<ozz::math::Float4x4> model_matrices;
+};
 
 static struct {
     bool valid;
     ozz_desc_t desc;
+    ozz_palette_format_t palette_format;
+    int texels_per_joint;       // 3 for the 4x3 matrix formats, 2 for dual-quaternions
     int joint_texture_width;    // in number of pixels
-    int joint_texture_height;   // in number of pixels
+    int joint_texture_height;   // in number of pixels, this is the current height, not max_instances
     int joint_texture_pitch;    // in number of floats
     sg_image joint_texture;
     sg_sampler smp;
     float* joint_upload_buffer;
+    uint16_t* joint_upload_buffer_f16;  // only for OZZ_PALETTE_FORMAT_MATRIX_RGBA16F
+    struct {
+        int* refs;                  // number of instances per row
+        bool* dirty;                // rows written since last upload
+        int num_live;               // highest live row + 1
+        int num_dirty;              // number of unique rows written since last upload
+        int dirty_min;
+        int dirty_max;
+    } rows;
+    ozz_stats_t stats;
+    struct {
+        ozz_lod_desc_t levels[OZZ_NUM_LODS];
+        uint64_t frame_index;       // number of ozz_update_instances() calls
+        ozz::vector<ozz_instance_private_t*> items;     // instances evaluated this frame
+    } lod;
+    struct {
+        int num_workers;            // including the calling thread
+        ozz_worker_t* workers;      // [0] is used by the calling thread
+        std::thread* threads;       // num_workers - 1 background threads
+        std::mutex mutex;
+        std::condition_variable start_cond;
+        std::condition_variable done_cond;
+        uint64_t generation;        // bumped to kick off a new batch of work
+        int num_busy;               // number of background threads still working on current batch
+        bool quit;
+        // the current batch of work
+        ozz_instance_private_t** items;
+        int num_items;
+        double seconds;
+        std::atomic<int> next_item;
+    } jobs;
 } state;
 
-struct ozz_private_t {
-    int index;
+// shared, immutable character data (skeleton, animation and mesh), loaded
+// once and referenced by any number of instances
+struct ozz_asset_private_t {
     ozz::animation::Skeleton skel;
     ozz::animation::Animation anim;
     ozz::vector<uint16_t> joint_remaps;
     ozz::vector<ozz::math::Float4x4> mesh_inverse_bindposes;
-    ozz::vector<ozz::math::SoaTransform> local_matrices;
-    ozz::vector<ozz::math::Float4x4> model_matrices;
-    ozz::animation::SamplingCache cache;
     sg_buffer vbuf = { };
     sg_buffer ibuf = { };
     int num_skin_joints;
@@ -44,6 +102,163 @@ struct ozz_private_t {
     bool load_failed = false;
 };
 
+// the lightweight per-instance state, the sampling cache lives here (and not in
+// the per-worker scratch) so that it keeps its keyframe cursors between frames
+struct ozz_instance_private_t {
+    const ozz_asset_private_t* asset;
+    int index;
+    double time_offset;
+    int lod;
+    bool visible;
+    bool evaluated;         // false until the first evaluation, regardless of LOD
+    ozz::animation::SamplingCache cache;
+    size_t cache_size;      // bytes allocated by the sampling cache
+};
+
+// forwards to the previous ozz allocator, installed once in ozz_setup(), and
+// counts the bytes allocated on a thread while that thread has set a counter,
+// used to measure the sampling cache allocation
+class ozz_counting_allocator_t : public ozz::memory::Allocator {
+public:
+    void* Allocate(size_t size, size_t alignment) override {
+        if (counter) {
+            *counter += size;
+        }
+        return fwd->Allocate(size, alignment);
+    }
+    void Deallocate(void* block) override {
+        fwd->Deallocate(block);
+    }
+    ozz::memory::Allocator* fwd = nullptr;
+    static thread_local size_t* counter;
+};
+thread_local size_t* ozz_counting_allocator_t::counter = nullptr;
+static ozz_counting_allocator_t counting_allocator;
+
+// size the instance's sampling cache for the asset's skeleton
+static void resize_cache(ozz_instance_private_t* self) {
+    const int num_joints = self->asset->skel.num_joints();
+    if (self->cache.max_tracks() < num_joints) {
+        size_t num_bytes = 0;
+        ozz_counting_allocator_t::counter = &num_bytes;
+        self->cache.Resize(num_joints);
+        ozz_counting_allocator_t::counter = nullptr;
+        self->cache_size = num_bytes;
+    }
+}
+
+static void run_jobs(ozz_worker_t* worker);
+
+static void worker_func(int worker_index) {
+    ozz_worker_t* worker = &state.jobs.workers[worker_index];
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(state.jobs.mutex);
+            state.jobs.start_cond.wait(lock, [generation] { return state.jobs.quit || (state.jobs.generation != generation); });
+            if (state.jobs.quit) {
+                return;
+            }
+            generation = state.jobs.generation;
+        }
+        run_jobs(worker);
+        {
+            std::lock_guard<std::mutex> lock(state.jobs.mutex);
+            if (--state.jobs.num_busy == 0) {
+                state.jobs.done_cond.notify_one();
+            }
+        }
+    }
+}
+
+static void setup_workers(int num_workers) {
+    #if defined(OZZ_NO_THREADS)
+    num_workers = 1;
+    #endif
+    if (num_workers < 1) {
+        num_workers = 1;
+    }
+    else if (num_workers > OZZ_MAX_WORKERS) {
+        num_workers = OZZ_MAX_WORKERS;
+    }
+    state.jobs.num_workers = num_workers;
+    state.jobs.workers = new ozz_worker_t[num_workers];
+    state.jobs.generation = 0;
+    state.jobs.num_busy = 0;
+    state.jobs.quit = false;
+    if (num_workers > 1) {
+        state.jobs.threads = new std::thread[num_workers - 1];
+        for (int i = 1; i < num_workers; i++) {
+            state.jobs.threads[i - 1] = std::thread(worker_func, i);
+        }
+    }
+}
+
+static void shutdown_workers(void) {
+    if (state.jobs.threads) {
+        {
+            std::lock_guard<std::mutex> lock(state.jobs.mutex);
+            state.jobs.quit = true;
+        }
+        state.jobs.start_cond.notify_all();
+        for (int i = 0; i < (state.jobs.num_workers - 1); i++) {
+            state.jobs.threads[i].join();
+        }
+        delete [] state.jobs.threads;
+        state.jobs.threads = nullptr;
+    }
+    // the worker scratch buffers must be freed before ozz-animation's leak check runs
+    delete [] state.jobs.workers;
+    state.jobs.workers = nullptr;
+    state.jobs.num_workers = 0;
+}
+
+// sokol-gfx can only update entire images, so instead of uploading a sub-rect,
+// the joint texture is only as high as needed for the live rows (rounded up
+// to a power of two to avoid recreating it too often)
+static int joint_texture_height_for_rows(int num_rows) {
+    int height = OZZ_MIN_JOINT_TEXTURE_ROWS;
+    while (height < num_rows) {
+        height *= 2;
+    }
+    return (height < state.desc.max_instances) ? height : state.desc.max_instances;
+}
+
+static void make_joint_texture(int height) {
+    // it's ok to call sg_destroy_image with an invalid id
+    sg_destroy_image(state.joint_texture);
+    state.joint_texture_height = height;
+    sg_image_desc img_desc = { };
+    img_desc.width = state.joint_texture_width;
+    img_desc.height = state.joint_texture_height;
+    img_desc.num_mipmaps = 1;
+    if (state.palette_format == OZZ_PALETTE_FORMAT_MATRIX_RGBA16F) {
+        img_desc.pixel_format = SG_PIXELFORMAT_RGBA16F;
+    }
+    else {
+        img_desc.pixel_format = SG_PIXELFORMAT_RGBA32F;
+    }
+    img_desc.usage = SG_USAGE_STREAM;
+    state.joint_texture = sg_make_image(&img_desc);
+}
+
+// several instances may share a row, and an instance may be updated more
+// than once per upload, each row is only counted once
+static void mark_row_dirty(int row) {
+    if (state.rows.dirty[row]) {
+        return;
+    }
+    state.rows.dirty[row] = true;
+    if (state.rows.num_dirty == 0) {
+        state.rows.dirty_min = state.rows.dirty_max = row;
+    }
+    else {
+        state.rows.dirty_min = (row < state.rows.dirty_min) ? row : state.rows.dirty_min;
+        state.rows.dirty_max = (row > state.rows.dirty_max) ? row : state.rows.dirty_max;
+    }
+    state.rows.num_dirty++;
+}
+
 void ozz_setup(const ozz_desc_t* desc) {
     assert(!state.valid);
     assert(desc);
@@ -52,17 +267,15 @@ void ozz_setup(const ozz_desc_t* desc) {
 
     state.valid = true;
     state.desc = *desc;
-    state.joint_texture_width = desc->max_palette_joints * 3;
-    state.joint_texture_height = desc->max_instances;
+    counting_allocator.fwd = ozz::memory::SetDefaulAllocator(&counting_allocator);
+    state.palette_format = (desc->palette_format == OZZ_PALETTE_FORMAT_DEFAULT) ? OZZ_PALETTE_FORMAT_MATRIX_RGBA32F : desc->palette_format;
+    state.texels_per_joint = (state.palette_format == OZZ_PALETTE_FORMAT_DUALQUAT_RGBA32F) ? 2 : 3;
+    state.joint_texture_width = desc->max_palette_joints * state.texels_per_joint;
     state.joint_texture_pitch = state.joint_texture_width * 4;
-
-    sg_image_desc img_desc = { };
-    img_desc.width = state.joint_texture_width;
-    img_desc.height = state.joint_texture_height;
-    img_desc.num_mipmaps = 1;
-    img_desc.pixel_format = SG_PIXELFORMAT_RGBA32F;
-    img_desc.usage = SG_USAGE_STREAM;
-    state.joint_texture = sg_make_image(&img_desc);
+    make_joint_texture(joint_texture_height_for_rows(0));
+    state.stats = { };
+    state.stats.joint_texture_width = state.joint_texture_width;
+    state.stats.joint_texture_height = state.joint_texture_height;
 
     sg_sampler_desc smp_desc = { };
     smp_desc.min_filter = SG_FILTER_NEAREST;
@@ -71,15 +284,53 @@ void ozz_setup(const ozz_desc_t* desc) {
     smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
     state.smp = sg_make_sampler(&smp_desc);
 
-    state.joint_upload_buffer = (float*) calloc(state.joint_texture_pitch * state.joint_texture_height, sizeof(float));
+    state.joint_upload_buffer = (float*) calloc(state.joint_texture_pitch * desc->max_instances, sizeof(float));
+    if (state.palette_format == OZZ_PALETTE_FORMAT_MATRIX_RGBA16F) {
+        state.joint_upload_buffer_f16 = (uint16_t*) calloc(state.joint_texture_pitch * desc->max_instances, sizeof(uint16_t));
+    }
+    state.rows.refs = (int*) calloc(desc->max_instances, sizeof(int));
+    state.rows.dirty = (bool*) calloc(desc->max_instances, sizeof(bool));
+
+    // default LOD levels unless any level is provided
+    bool has_lods = false;
+    for (int i = 0; i < OZZ_NUM_LODS; i++) {
+        has_lods |= (desc->lods[i].update_interval > 0);
+    }
+    for (int i = 0; i < OZZ_NUM_LODS; i++) {
+        if (has_lods) {
+            state.lod.levels[i].min_distance = desc->lods[i].min_distance;
+            state.lod.levels[i].update_interval = (desc->lods[i].update_interval > 0) ? desc->lods[i].update_interval : 1;
+        }
+        else {
+            state.lod.levels[i].min_distance = (i == 0) ? 0.0f : 10.0f * (float)(1 << (i - 1));
+            state.lod.levels[i].update_interval = 1 << i;
+        }
+    }
+    state.lod.frame_index = 0;
+
+    setup_workers(desc->num_workers);
 }
 
 void ozz_shutdown(void) {
     assert(state.valid);
     assert(state.joint_upload_buffer);
+    shutdown_workers();
     free(state.joint_upload_buffer);
+    free(state.joint_upload_buffer_f16);
+    state.joint_upload_buffer_f16 = nullptr;
+    free(state.rows.refs);
+    state.rows.refs = nullptr;
+    free(state.rows.dirty);
+    state.rows.dirty = nullptr;
+    // free the evaluation list memory, ozz-animation checks for leaks at exit
+    ozz::vector<ozz_instance_private_t*>().swap(state.lod.items);
+    state.rows.num_live = 0;
+    state.rows.num_dirty = 0;
     // it's ok to call sg_destroy_image with an invalid id
     sg_destroy_image(state.joint_texture);
+    sg_destroy_sampler(state.smp);
+    state.joint_texture = { };
+    ozz::memory::SetDefaulAllocator(counting_allocator.fwd);
     state.valid = false;
 }
 
@@ -93,50 +344,123 @@ sg_sampler ozz_joint_sampler(void) {
     return state.smp;
 }
 
-ozz_instance_t* ozz_create_instance(int index) {
+ozz_asset_t* ozz_create_asset(void) {
     assert(state.valid);
-    assert(index < state.desc.max_instances);
-    ozz_private_t* self = new ozz_private_t();
+    ozz_asset_private_t* self = new ozz_asset_private_t();
+    return (ozz_asset_t*) self;
+}
+
+void ozz_destroy_asset(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    // it's ok to call sg_destroy_buffer with an invalid id
+    sg_destroy_buffer(self->vbuf);
+    sg_destroy_buffer(self->ibuf);
+    delete self;
+}
+
+ozz_instance_t* ozz_create_instance(ozz_asset_t* asset, int index) {
+    assert(state.valid && asset);
+    assert((index >= 0) && (index < state.desc.max_instances));
+    ozz_instance_private_t* self = new ozz_instance_private_t();
+    self->asset = (const ozz_asset_private_t*) asset;
     self->index = index;
+    self->visible = true;
+    // otherwise the cache is sized in the first update
+    if (self->asset->skel_loaded) {
+        resize_cache(self);
+    }
+    state.rows.refs[index]++;
+    if (index >= state.rows.num_live) {
+        state.rows.num_live = index + 1;
+    }
     return (ozz_instance_t*) self;
 }
 
 void ozz_destroy_instance(ozz_instance_t* ozz) {
     assert(state.valid && ozz);
-    ozz_private_t* self = (ozz_private_t*) ozz;
-    // it's ok to call sg_destroy_buffer with an invalid id    
-    sg_destroy_buffer(self->vbuf);
-    sg_destroy_buffer(self->ibuf);
+    ozz_instance_private_t* self = (ozz_instance_private_t*) ozz;
+    assert(state.rows.refs[self->index] > 0);
+    state.rows.refs[self->index]--;
+    while ((state.rows.num_live > 0) && (state.rows.refs[state.rows.num_live - 1] == 0)) {
+        state.rows.num_live--;
+    }
     delete self;
 }
 
-void ozz_load_skeleton(ozz_instance_t* ozz, const void* data, size_t num_bytes) {
-    assert(state.valid && ozz && data && (num_bytes > 0));
-    ozz_private_t* self = (ozz_private_t*) ozz;
-    ozz::io::MemoryStream stream;
-    stream.Write(data, num_bytes);
-    stream.Seek(0, ozz::io::Stream::kSet);
+void ozz_set_time_offset(ozz_instance_t* ozz, double seconds) {
+    assert(state.valid && ozz);
+    ((ozz_instance_private_t*)ozz)->time_offset = seconds;
+}
+
+void ozz_set_lod_distance(ozz_instance_t* ozz, float distance) {
+    assert(state.valid && ozz);
+    int lod = 0;
+    while (((lod + 1) < OZZ_NUM_LODS) && (distance >= state.lod.levels[lod + 1].min_distance)) {
+        lod++;
+    }
+    ((ozz_instance_private_t*)ozz)->lod = lod;
+}
+
+int ozz_lod(ozz_instance_t* ozz) {
+    assert(state.valid && ozz);
+    return ((ozz_instance_private_t*)ozz)->lod;
+}
+
+void ozz_set_visible(ozz_instance_t* ozz, bool visible) {
+    assert(state.valid && ozz);
+    ozz_instance_private_t* self = (ozz_instance_private_t*) ozz;
+    // the joint palette row is stale after being culled, so don't wait for the LOD interval
+    if (visible && !self->visible) {
+        self->evaluated = false;
+    }
+    self->visible = visible;
+}
+
+bool ozz_visible(ozz_instance_t* ozz) {
+    assert(state.valid && ozz);
+    return ((ozz_instance_private_t*)ozz)->visible;
+}
+
+size_t ozz_instance_memory_size(ozz_instance_t* ozz) {
+    assert(state.valid && ozz);
+    const ozz_instance_private_t* self = (const ozz_instance_private_t*) ozz;
+    return sizeof(ozz_instance_private_t) + self->cache_size;
+}
+
+// the skin joint remaps must index skeleton joints, checked once both are loaded
+static bool skin_matches_skeleton(const ozz_asset_private_t* self) {
+    const int num_joints = self->skel.num_joints();
+    for (uint16_t remap: self->joint_remaps) {
+        if (remap >= num_joints) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ozz_load_skeleton(ozz_asset_t* asset, const void* data, size_t num_bytes) {
+    assert(state.valid && asset && data && (num_bytes > 0));
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    // deserialize directly from the caller's buffer
+    ozz_span_stream_t stream(data, num_bytes);
     ozz::io::IArchive archive(&stream);
     if (archive.TestTag<ozz::animation::Skeleton>()) {
         archive >> self->skel;
         self->skel_loaded = true;
-        const int num_soa_joints = self->skel.num_soa_joints();
-        const int num_joints = self->skel.num_joints();
-        self->local_matrices.resize(num_soa_joints);
-        self->model_matrices.resize(num_joints);
-        self->cache.Resize(num_joints);
+        if (self->mesh_loaded && !skin_matches_skeleton(self)) {
+            self->load_failed = true;
+        }
     }
     else {
         self->load_failed = true;
     }
 }
 
-void ozz_load_animation(ozz_instance_t* ozz, const void* data, size_t num_bytes) {
-    assert(state.valid && ozz && data && (num_bytes > 0));
-    ozz_private_t* self = (ozz_private_t*) ozz;
-    ozz::io::MemoryStream stream;
-    stream.Write(data, num_bytes);
-    stream.Seek(0, ozz::io::Stream::kSet);
+void ozz_load_animation(ozz_asset_t* asset, const void* data, size_t num_bytes) {
+    assert(state.valid && asset && data && (num_bytes > 0));
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    ozz_span_stream_t stream(data, num_bytes);
     ozz::io::IArchive archive(&stream);
     if (archive.TestTag<ozz::animation::Animation>()) {
         archive >> self->anim;
@@ -147,153 +471,298 @@ void ozz_load_animation(ozz_instance_t* ozz, const void* data, size_t num_bytes)
     }
 }
 
-static uint32_t pack_u32(uint8_t x, uint8_t y, uint8_t z, uint8_t w) {
-    return (uint32_t)(((uint32_t)w<<24)|((uint32_t)z<<16)|((uint32_t)y<<8)|x);
-}
-
-static uint32_t pack_f4_byte4n(float x, float y, float z, float w) {
-    int8_t x8 = (int8_t) (x * 127.0f);
-    int8_t y8 = (int8_t) (y * 127.0f);
-    int8_t z8 = (int8_t) (z * 127.0f);
-    int8_t w8 = (int8_t) (w * 127.0f);
-    return pack_u32((uint8_t)x8, (uint8_t)y8, (uint8_t)z8, (uint8_t)w8);
+// copy the skin joint remaps and inverse bind poses
+static void set_skin(ozz_asset_private_t* self, const uint16_t* joint_remaps, const float* bindposes, int num_skin_joints) {
+    self->num_skin_joints = num_skin_joints;
+    self->joint_remaps.assign(joint_remaps, joint_remaps + num_skin_joints);
+    self->mesh_inverse_bindposes.resize(num_skin_joints);
+    for (int i = 0; i < num_skin_joints; i++) {
+        for (int col = 0; col < 4; col++) {
+            self->mesh_inverse_bindposes[i].cols[col] = ozz::math::simd_float4::LoadPtrU(&bindposes[i * 16 + col * 4]);
+        }
+    }
 }
 
-static uint32_t pack_f4_ubyte4n(float x, float y, float z, float w) {
-    uint8_t x8 = (uint8_t) (x * 255.0f);
-    uint8_t y8 = (uint8_t) (y * 255.0f);
-    uint8_t z8 = (uint8_t) (z * 255.0f);
-    uint8_t w8 = (uint8_t) (w * 255.0f);
-    return pack_u32(x8, y8, z8, w8);
+// create the GPU buffers and copy the joint data from a baked mesh, the
+// vertex and index data is used in place
+static bool load_baked_mesh(ozz_asset_private_t* self, const void* data, size_t num_bytes) {
+    if (num_bytes < sizeof(ozz_baked_mesh_header_t)) {
+        return false;
+    }
+    const uint8_t* base = (const uint8_t*) data;
+    ozz_baked_mesh_header_t hdr;
+    memcpy(&hdr, base, sizeof(hdr));
+    if ((hdr.magic != OZZ_BAKED_MESH_MAGIC) || (hdr.version != OZZ_BAKED_MESH_VERSION) || (hdr.size > num_bytes)) {
+        return false;
+    }
+    // each skin joint needs its own texels in the joint texture row
+    if (hdr.num_skin_joints > (uint32_t)state.desc.max_palette_joints) {
+        return false;
+    }
+    if (((hdr.vertices_offset + (uint64_t)hdr.num_vertices * sizeof(ozz_vertex_t)) > hdr.size) ||
+        ((hdr.indices_offset + (uint64_t)hdr.num_indices * sizeof(uint16_t)) > hdr.size) ||
+        ((hdr.joint_remaps_offset + (uint64_t)hdr.num_skin_joints * sizeof(uint16_t)) > hdr.size) ||
+        ((hdr.inverse_bindposes_offset + (uint64_t)hdr.num_skin_joints * 16 * sizeof(float)) > hdr.size))
+    {
+        return false;
+    }
+    const uint16_t* joint_remaps = (const uint16_t*) (base + hdr.joint_remaps_offset);
+    const float* bindposes = (const float*) (base + hdr.inverse_bindposes_offset);
+    set_skin(self, joint_remaps, bindposes, (int) hdr.num_skin_joints);
+    if (self->skel_loaded && !skin_matches_skeleton(self)) {
+        return false;
+    }
+    self->num_triangle_indices = (int) hdr.num_indices;
+
+    // create vertex- and index-buffer
+    sg_buffer_desc vbuf_desc = { };
+    vbuf_desc.type = SG_BUFFERTYPE_VERTEXBUFFER;
+    vbuf_desc.data.ptr = base + hdr.vertices_offset;
+    vbuf_desc.data.size = hdr.num_vertices * sizeof(ozz_vertex_t);
+    self->vbuf = sg_make_buffer(&vbuf_desc);
+
+    sg_buffer_desc ibuf_desc = { };
+    ibuf_desc.type = SG_BUFFERTYPE_INDEXBUFFER;
+    ibuf_desc.data.ptr = base + hdr.indices_offset;
+    ibuf_desc.data.size = hdr.num_indices * sizeof(uint16_t);
+    self->ibuf = sg_make_buffer(&ibuf_desc);
+    return true;
 }
 
-void ozz_load_mesh(ozz_instance_t* ozz, const void* data, size_t num_bytes) {
-    assert(state.valid && ozz && data && (num_bytes > 0));
-    ozz_private_t* self = (ozz_private_t*) ozz;
-    ozz::io::MemoryStream stream;
-    stream.Write(data, num_bytes);
-    stream.Seek(0, ozz::io::Stream::kSet);
+void ozz_load_mesh(ozz_asset_t* asset, const void* data, size_t num_bytes) {
+    assert(state.valid && asset && data && (num_bytes > 0));
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    ozz_span_stream_t stream(data, num_bytes);
     ozz::io::IArchive archive(&stream);
 
-    // only load the first part of the first mesh
+    // only load the first part of the first mesh, the mesh is converted
+    // into the baked format in memory but not optimized, use the ozzbake
+    // tool and ozz_load_baked_mesh() for optimized meshes
     if (archive.TestTag<ozz::sample::Mesh>()) {
         ozz::sample::Mesh mesh;
         archive >> mesh;
-        self->mesh_loaded = true;
-        self->num_skin_joints = mesh.num_joints();
-        self->num_triangle_indices = (int)mesh.triangle_index_count();
-        self->joint_remaps = std::move(mesh.joint_remaps);
-        self->mesh_inverse_bindposes = std::move(mesh.inverse_bind_poses);
-
-        // convert mesh data into packed vertices
-        size_t num_vertices = (mesh.parts[0].positions.size() / 3);
-        assert(mesh.parts[0].normals.size() == (num_vertices * 3));
-        assert(mesh.parts[0].joint_indices.size() == (num_vertices * 4));
-        assert(mesh.parts[0].joint_weights.size() == (num_vertices * 3));
-        const float* positions = &mesh.parts[0].positions[0];
-        const float* normals = &mesh.parts[0].normals[0];
-        const uint16_t* joint_indices = &mesh.parts[0].joint_indices[0];
-        const float* joint_weights = &mesh.parts[0].joint_weights[0];
-        ozz_vertex_t* vertices = (ozz_vertex_t*) calloc(num_vertices, sizeof(ozz_vertex_t));
-        for (int i = 0; i < (int)num_vertices; i++) {
-            ozz_vertex_t* v = &vertices[i];
-            v->position[0] = positions[i * 3 + 0];
-            v->position[1] = positions[i * 3 + 1];
-            v->position[2] = positions[i * 3 + 2];
-            const float nx = normals[i * 3 + 0];
-            const float ny = normals[i * 3 + 1];
-            const float nz = normals[i * 3 + 2];
-            v->normal = pack_f4_byte4n(nx, ny, nz, 0.0f);
-            const uint8_t ji0 = (uint8_t) joint_indices[i * 4 + 0];
-            const uint8_t ji1 = (uint8_t) joint_indices[i * 4 + 1];
-            const uint8_t ji2 = (uint8_t) joint_indices[i * 4 + 2];
-            const uint8_t ji3 = (uint8_t) joint_indices[i * 4 + 3];
-            v->joint_indices = pack_u32(ji0, ji1, ji2, ji3);
-            const float jw0 = joint_weights[i * 3 + 0];
-            const float jw1 = joint_weights[i * 3 + 1];
-            const float jw2 = joint_weights[i * 3 + 2];
-            const float jw3 = 1.0f - (jw0 + jw1 + jw2);
-            v->joint_weights = pack_f4_ubyte4n(jw0, jw1, jw2, jw3);
-        }
-
-        // create vertex- and index-buffer
-        sg_buffer_desc vbuf_desc = { };
-        vbuf_desc.type = SG_BUFFERTYPE_VERTEXBUFFER;
-        vbuf_desc.data.ptr = vertices;
-        vbuf_desc.data.size = num_vertices * sizeof(ozz_vertex_t);
-        self->vbuf = sg_make_buffer(&vbuf_desc);
-        free(vertices); vertices = nullptr;
-
-        sg_buffer_desc ibuf_desc = { };
-        ibuf_desc.type = SG_BUFFERTYPE_INDEXBUFFER;
-        ibuf_desc.data.ptr = &mesh.triangle_indices[0];
-        ibuf_desc.data.size = self->num_triangle_indices * sizeof(uint16_t);
-        self->ibuf = sg_make_buffer(&ibuf_desc);
+        const size_t baked_size = ozz_bake_mesh(mesh, nullptr, 0);
+        void* baked = malloc(baked_size);
+        self->mesh_loaded = baked &&
+                            (ozz_bake_mesh(mesh, baked, baked_size, false) == baked_size) &&
+                            load_baked_mesh(self, baked, baked_size);
+        self->load_failed |= !self->mesh_loaded;
+        free(baked);
     }
     else {
         self->load_failed = true;
     }
 }
 
-void ozz_set_load_failed(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    ozz_private_t* self = (ozz_private_t*) ozz;
+void ozz_load_baked_mesh(ozz_asset_t* asset, const void* data, size_t num_bytes) {
+    assert(state.valid && asset && data && (num_bytes > 0));
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    self->mesh_loaded = load_baked_mesh(self, data, num_bytes);
+    self->load_failed |= !self->mesh_loaded;
+}
+
+void ozz_load_skin(ozz_asset_t* asset, const uint16_t* joint_remaps, const float* inverse_bindposes, int num_skin_joints) {
+    assert(state.valid && asset && joint_remaps && inverse_bindposes);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    // each skin joint needs its own texels in the joint texture row
+    if ((num_skin_joints <= 0) || (num_skin_joints > state.desc.max_palette_joints)) {
+        self->load_failed = true;
+        return;
+    }
+    set_skin(self, joint_remaps, inverse_bindposes, num_skin_joints);
+    self->mesh_loaded = true;
+}
+
+void ozz_set_load_failed(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
     self->load_failed = true;
 }
 
-bool ozz_all_loaded(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    ozz_private_t* self = (ozz_private_t*) ozz;
+bool ozz_all_loaded(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
     return self->skel_loaded && self->anim_loaded && self->mesh_loaded && !self->load_failed;
 }
 
-bool ozz_load_failed(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    return ((ozz_private_t*)ozz)->load_failed;
+bool ozz_load_failed(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    return ((ozz_asset_private_t*)asset)->load_failed;
 }
 
-sg_buffer ozz_vertex_buffer(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    return ((ozz_private_t*)ozz)->vbuf;
+sg_buffer ozz_vertex_buffer(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    return ((ozz_asset_private_t*)asset)->vbuf;
 }
 
-sg_buffer ozz_index_buffer(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    return ((ozz_private_t*)ozz)->ibuf;
+sg_buffer ozz_index_buffer(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    return ((ozz_asset_private_t*)asset)->ibuf;
 }
 
-void ozz_update_instance(ozz_instance_t* ozz, double seconds) {
-    assert(state.valid && ozz);
-    assert(state.joint_upload_buffer);
+// sample the animation, compute skinning matrices and write them to the
+// instance's row in the joint upload buffer, using a worker's scratch buffers
+static void update_instance(ozz_worker_t* worker, ozz_instance_private_t* self, double seconds) {
+    const ozz_asset_private_t* asset = self->asset;
+    assert(asset->skel_loaded && asset->anim_loaded && asset->mesh_loaded);
+    const int num_soa_joints = asset->skel.num_soa_joints();
+    const int num_joints = asset->skel.num_joints();
+    if ((int)worker->local_matrices.size() < num_soa_joints) {
+        worker->local_matrices.resize(num_soa_joints);
+    }
+    if ((int)worker->model_matrices.size() < num_joints) {
+        worker->model_matrices.resize(num_joints);
+    }
+    assert(self->cache.max_tracks() >= num_joints);
 
-    ozz_private_t* self = (ozz_private_t*) ozz;
-    const float anim_duration = self->anim.duration();
-    const float anim_ratio = fmodf((float)seconds / anim_duration, 1.0f);
+    const float anim_duration = asset->anim.duration();
+    const float anim_ratio = fmodf((float)(seconds + self->time_offset) / anim_duration, 1.0f);
 
     ozz::animation::SamplingJob sampling_job;
-    sampling_job.animation = &self->anim;
+    sampling_job.animation = &asset->anim;
     sampling_job.cache = &self->cache;
     sampling_job.ratio = anim_ratio;
-    sampling_job.output = make_span(self->local_matrices);
+    sampling_job.output = make_span(worker->local_matrices);
     sampling_job.Run();
 
     ozz::animation::LocalToModelJob ltm_job;
-    ltm_job.skeleton = &self->skel;
-    ltm_job.input = make_span(self->local_matrices);
-    ltm_job.output = make_span(self->model_matrices);
+    ltm_job.skeleton = &asset->skel;
+    ltm_job.input = make_span(worker->local_matrices);
+    ltm_job.output = make_span(worker->model_matrices);
     ltm_job.Run();
 
-    for (int i = 0; i < self->num_skin_joints; i++) {
-        ozz::math::Float4x4 skin_matrix = self->model_matrices[self->joint_remaps[i]] * self->mesh_inverse_bindposes[i];
-        const ozz::math::SimdFloat4& c0 = skin_matrix.cols[0];
-        const ozz::math::SimdFloat4& c1 = skin_matrix.cols[1];
-        const ozz::math::SimdFloat4& c2 = skin_matrix.cols[2];
-        const ozz::math::SimdFloat4& c3 = skin_matrix.cols[3];
+    // the half-float format is converted in one batch before upload,
+    // so both matrix formats write the same float layout here
+    float* row_ptr = &state.joint_upload_buffer[self->index*state.joint_texture_pitch];
+    if (state.palette_format == OZZ_PALETTE_FORMAT_DUALQUAT_RGBA32F) {
+        // dual-quaternions are converted 4 joints at a time
+        for (int i = 0; i < asset->num_skin_joints; i += 4) {
+            const int num = ((asset->num_skin_joints - i) < 4) ? (asset->num_skin_joints - i) : 4;
+            ozz::math::Float4x4 skin_matrices[4];
+            for (int k = 0; k < num; k++) {
+                skin_matrices[k] = worker->model_matrices[asset->joint_remaps[i + k]] * asset->mesh_inverse_bindposes[i + k];
+            }
+            ozz_skin_write_dual_quaternions(skin_matrices, num, &row_ptr[i*8]);
+        }
+    }
+    else {
+        for (int i = 0; i < asset->num_skin_joints; i++) {
+            ozz::math::Float4x4 skin_matrix = worker->model_matrices[asset->joint_remaps[i]] * asset->mesh_inverse_bindposes[i];
+            ozz_skin_write_matrix(skin_matrix, &row_ptr[i*12]);
+        }
+    }
+}
+
+// grab instances from the current batch until all are taken, each
+// instance writes a separate row of the joint upload buffer, so no
+// further synchronization is needed
+static void run_jobs(ozz_worker_t* worker) {
+    int item;
+    while ((item = state.jobs.next_item.fetch_add(1)) < state.jobs.num_items) {
+        update_instance(worker, state.jobs.items[item], state.jobs.seconds);
+    }
+}
+
+void ozz_update_instance(ozz_instance_t* ozz, double seconds) {
+    assert(state.valid && ozz);
+    assert(state.joint_upload_buffer);
+    ozz_instance_private_t* self = (ozz_instance_private_t*) ozz;
+    mark_row_dirty(self->index);
+    resize_cache(self);
+    update_instance(&state.jobs.workers[0], self, seconds);
+    self->evaluated = true;
+}
+
+// evaluate the instances in state.lod.items on all workers
+static void run_batch(double seconds) {
+    const int num_instances = (int) state.lod.items.size();
+    state.jobs.items = state.lod.items.data();
+    state.jobs.num_items = num_instances;
+    state.jobs.seconds = seconds;
+    state.jobs.next_item = 0;
+    const int num_threads = state.jobs.num_workers - 1;
+    if ((num_threads > 0) && (num_instances > 1)) {
+        {
+            std::lock_guard<std::mutex> lock(state.jobs.mutex);
+            state.jobs.num_busy = num_threads;
+            state.jobs.generation++;
+        }
+        state.jobs.start_cond.notify_all();
+        // the calling thread participates as worker 0
+        run_jobs(&state.jobs.workers[0]);
+        std::unique_lock<std::mutex> lock(state.jobs.mutex);
+        state.jobs.done_cond.wait(lock, [] { return state.jobs.num_busy == 0; });
+    }
+    else {
+        run_jobs(&state.jobs.workers[0]);
+    }
+}
+
+void ozz_update_instances(ozz_instance_t** instances, int num_instances, double seconds) {
+    assert(state.valid && instances && (num_instances >= 0));
+    assert(state.joint_upload_buffer);
+    const auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < OZZ_NUM_LODS; i++) {
+        state.stats.num_lod_instances[i] = 0;
+    }
+    state.stats.num_culled_instances = 0;
+
+    // pick the instances which need to be evaluated this frame, an instance
+    // in a throttled LOD level is updated when the frame index plus its row
+    // index hits the update interval, which spreads the work evenly over frames
+    state.lod.items.clear();
+    for (int i = 0; i < num_instances; i++) {
+        ozz_instance_private_t* self = (ozz_instance_private_t*) instances[i];
+        if (!self->visible) {
+            state.stats.num_culled_instances++;
+            continue;
+        }
+        state.stats.num_lod_instances[self->lod]++;
+        const uint64_t interval = (uint64_t) state.lod.levels[self->lod].update_interval;
+        if (!self->evaluated || (((state.lod.frame_index + (uint64_t)self->index) % interval) == 0)) {
+            self->evaluated = true;
+            mark_row_dirty(self->index);
+            resize_cache(self);
+            state.lod.items.push_back(self);
+        }
+    }
+    state.lod.frame_index++;
+    state.stats.num_evaluated_instances = (int) state.lod.items.size();
+    if (!state.lod.items.empty()) {
+        run_batch(seconds);
+    }
+    const std::chrono::duration<double, std::milli> eval_time = std::chrono::steady_clock::now() - start_time;
+    state.stats.anim_eval_time_ms = eval_time.count();
+}
+
+int ozz_num_workers(void) {
+    assert(state.valid);
+    return state.jobs.num_workers;
+}
 
-        float* ptr = &state.joint_upload_buffer[self->index*state.joint_texture_pitch + i*12];
-        *ptr++ = ozz::math::GetX(c0); *ptr++ = ozz::math::GetX(c1); *ptr++ = ozz::math::GetX(c2); *ptr++ = ozz::math::GetX(c3);
-        *ptr++ = ozz::math::GetY(c0); *ptr++ = ozz::math::GetY(c1); *ptr++ = ozz::math::GetY(c2); *ptr++ = ozz::math::GetY(c3);
-        *ptr++ = ozz::math::GetZ(c0); *ptr++ = ozz::math::GetZ(c1); *ptr++ = ozz::math::GetZ(c2); *ptr++ = ozz::math::GetZ(c3);
+// convert a range of floats into half-floats, 8 at a time, num must be
+// a multiple of 4
+static void float_to_half(const float* src, uint16_t* dst, size_t num) {
+    using namespace ozz::math;
+    assert((num & 3) == 0);
+    size_t i = 0;
+    #if defined(OZZ_SIMD_SSE2)
+    for (; (i + 8) <= num; i += 8) {
+        // sign-extend the 16-bit results so that the saturating pack leaves them intact
+        const SimdInt4 h0 = FloatToHalf(simd_float4::LoadPtrU(src + i));
+        const SimdInt4 h1 = FloatToHalf(simd_float4::LoadPtrU(src + i + 4));
+        const __m128i lo = _mm_srai_epi32(_mm_slli_epi32(h0, 16), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_slli_epi32(h1, 16), 16);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    #endif
+    int tmp[4];
+    for (; i < num; i += 4) {
+        StorePtrU(FloatToHalf(simd_float4::LoadPtrU(src + i)), tmp);
+        dst[i + 0] = (uint16_t) tmp[0];
+        dst[i + 1] = (uint16_t) tmp[1];
+        dst[i + 2] = (uint16_t) tmp[2];
+        dst[i + 3] = (uint16_t) tmp[3];
     }
 }
 
@@ -301,11 +770,55 @@ void ozz_update_joint_texture(void) {
     assert(state.valid);
     assert(state.joint_upload_buffer);
 
-    // FIXME: upload partial texture? (needs sokol-gfx fixes)
+    state.stats.num_live_rows = state.rows.num_live;
+    state.stats.joint_texture_width = state.joint_texture_width;
+    state.stats.num_dirty_rows = state.rows.num_dirty;
+    state.stats.upload_bytes = 0;
+
+    // if no rows have changed, the texture content from the last upload is still valid
+    if (state.rows.num_dirty == 0) {
+        state.stats.joint_texture_height = state.joint_texture_height;
+        return;
+    }
+
+    // live instances are expected in the top rows, resize the texture to cover
+    // all live rows and all rows written this frame, the upload buffer keeps
+    // the content of live rows which haven't been updated
+    int num_rows = state.rows.num_live;
+    if (state.rows.dirty_max >= num_rows) {
+        num_rows = state.rows.dirty_max + 1;
+    }
+    const int height = joint_texture_height_for_rows(num_rows);
+    if (height != state.joint_texture_height) {
+        make_joint_texture(height);
+    }
+    const size_t num_elements = (size_t) (state.joint_texture_pitch * state.joint_texture_height);
     sg_image_data img_data = { };
-    img_data.subimage[0][0].ptr = state.joint_upload_buffer;
-    img_data.subimage[0][0].size = (size_t) (state.joint_texture_pitch * state.joint_texture_height * sizeof(float));
+    size_t num_bytes;
+    if (state.palette_format == OZZ_PALETTE_FORMAT_MATRIX_RGBA16F) {
+        // only the rows written since the last upload need to be converted
+        const size_t offset = (size_t) (state.rows.dirty_min * state.joint_texture_pitch);
+        const size_t num = (size_t) ((state.rows.dirty_max + 1 - state.rows.dirty_min) * state.joint_texture_pitch);
+        float_to_half(state.joint_upload_buffer + offset, state.joint_upload_buffer_f16 + offset, num);
+        num_bytes = num_elements * sizeof(uint16_t);
+        img_data.subimage[0][0].ptr = state.joint_upload_buffer_f16;
+    }
+    else {
+        num_bytes = num_elements * sizeof(float);
+        img_data.subimage[0][0].ptr = state.joint_upload_buffer;
+    }
+    img_data.subimage[0][0].size = num_bytes;
     sg_update_image(state.joint_texture, img_data);
+
+    state.stats.joint_texture_height = state.joint_texture_height;
+    state.stats.upload_bytes = num_bytes;
+    memset(state.rows.dirty + state.rows.dirty_min, 0, (size_t)(state.rows.dirty_max + 1 - state.rows.dirty_min) * sizeof(bool));
+    state.rows.num_dirty = 0;
+}
+
+ozz_stats_t ozz_stats(void) {
+    assert(state.valid);
+    return state.stats;
 }
 
 float ozz_joint_texture_pixel_width(void) {
@@ -313,6 +826,16 @@ float ozz_joint_texture_pixel_width(void) {
     return 1.0f / (float)state.joint_texture_width;
 }
 
+ozz_palette_format_t ozz_palette_format(void) {
+    assert(state.valid);
+    return state.palette_format;
+}
+
+float ozz_joint_texture_pixel_height(void) {
+    assert(state.valid);
+    return 1.0f / (float)state.joint_texture_height;
+}
+
 float ozz_joint_texture_u(ozz_instance_t* ozz) {
     assert(state.valid && ozz);
     (void)ozz;
@@ -322,13 +845,25 @@ float ozz_joint_texture_u(ozz_instance_t* ozz) {
 
 float ozz_joint_texture_v(ozz_instance_t* ozz) {
     assert(state.valid && ozz);
-    ozz_private_t* self = (ozz_private_t*) ozz;
+    ozz_instance_private_t* self = (ozz_instance_private_t*) ozz;
     const float half_pixel_y = 0.5f / (float)state.joint_texture_height;
     return half_pixel_y + (self->index / (float)state.joint_texture_height);
 }
 
-int ozz_num_triangle_indices(ozz_instance_t* ozz) {
-    assert(state.valid && ozz);
-    ozz_private_t* self = (ozz_private_t*) ozz;
+int ozz_num_triangle_indices(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
     return self->num_triangle_indices;
 }
+
+int ozz_num_skeleton_joints(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    return self->skel.num_joints();
+}
+
+int ozz_num_skin_joints(ozz_asset_t* asset) {
+    assert(state.valid && asset);
+    ozz_asset_private_t* self = (ozz_asset_private_t*) asset;
+    return self->num_skin_joints;
+}
@@ -5,46 +5,110 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "sokol_gfx.h"
+#include "ozzbake.h"  // ozz_vertex_t and the baked mesh format
 
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
-typedef void* ozz_t;
+typedef void* ozz_asset_t;
 typedef void* ozz_instance_t;
 
+// joint palette layout in the joint texture
+typedef enum {
+    OZZ_PALETTE_FORMAT_DEFAULT,             // OZZ_PALETTE_FORMAT_MATRIX_RGBA32F
+    OZZ_PALETTE_FORMAT_MATRIX_RGBA32F,      // transposed 4x3 matrix, 3 RGBA32F texels per joint
+    OZZ_PALETTE_FORMAT_MATRIX_RGBA16F,      // transposed 4x3 matrix, 3 RGBA16F texels per joint
+    OZZ_PALETTE_FORMAT_DUALQUAT_RGBA32F,    // dual-quaternion (no scale), 2 RGBA32F texels per joint
+} ozz_palette_format_t;
+
+// number of animation LOD levels, LOD 0 is the closest and updates every frame
+#define OZZ_NUM_LODS (4)
+
+// animation LOD level, instances at or beyond min_distance are only
+// evaluated every update_interval-th call to ozz_update_instances(),
+// the default levels are 0/10/20/40 units with 1/2/4/8 frames
 typedef struct {
-    float position[3];
-    uint32_t normal;
-    uint32_t joint_indices;
-    uint32_t joint_weights;
-} ozz_vertex_t;
+    float min_distance;
+    int update_interval;
+} ozz_lod_desc_t;
 
 typedef struct {
     int max_palette_joints;
     int max_instances;
+    ozz_palette_format_t palette_format;
+    int num_workers;        // number of threads for ozz_update_instances() including the calling thread (default: 1)
+    ozz_lod_desc_t lods[OZZ_NUM_LODS];  // all zero for the default LOD levels
 } ozz_desc_t;
 
+// animation statistics of the last ozz_update_instances() call, and
+// joint texture statistics of the last ozz_update_joint_texture() call
+typedef struct {
+    int num_lod_instances[OZZ_NUM_LODS];    // number of instances per LOD level
+    int num_evaluated_instances;            // number of instances evaluated (not skipped by LOD or culling)
+    int num_culled_instances;               // number of instances skipped because they are not visible
+    double anim_eval_time_ms;               // wall-clock time spent in ozz_update_instances()
+    int num_live_rows;          // highest row index of a live instance + 1
+    int num_dirty_rows;         // number of unique rows written by ozz_update_instance(s)
+    int joint_texture_width;    // joint texture width in pixels (depends on palette format)
+    int joint_texture_height;   // current joint texture height in rows
+    size_t upload_bytes;        // number of bytes uploaded into the joint texture
+} ozz_stats_t;
+
 void ozz_setup(const ozz_desc_t* desc);
 void ozz_shutdown(void);
 sg_image ozz_joint_texture(void);
 sg_sampler ozz_joint_sampler(void);
-ozz_instance_t* ozz_create_instance(int index);
+ozz_palette_format_t ozz_palette_format(void);
+// shared character data (skeleton, animation and mesh)
+ozz_asset_t* ozz_create_asset(void);
+void ozz_destroy_asset(ozz_asset_t* asset);
+void ozz_load_skeleton(ozz_asset_t* asset, const void* data, size_t num_bytes);
+void ozz_load_animation(ozz_asset_t* asset, const void* data, size_t num_bytes);
+void ozz_load_mesh(ozz_asset_t* asset, const void* data, size_t num_bytes);
+// load a mesh created by the ozzbake tool, this skips the vertex conversion,
+// data must be 16-byte aligned
+void ozz_load_baked_mesh(ozz_asset_t* asset, const void* data, size_t num_bytes);
+// set the skin joints directly instead of loading a mesh, for vertex data which is
+// rendered from the caller's own buffers, joint_remaps are skeleton joint indices and
+// inverse_bindposes are column-major 4x4 matrices, both num_skin_joints long
+void ozz_load_skin(ozz_asset_t* asset, const uint16_t* joint_remaps, const float* inverse_bindposes, int num_skin_joints);
+void ozz_set_load_failed(ozz_asset_t* asset);
+bool ozz_all_loaded(ozz_asset_t* asset);
+bool ozz_load_failed(ozz_asset_t* asset);
+sg_buffer ozz_vertex_buffer(ozz_asset_t* asset);
+sg_buffer ozz_index_buffer(ozz_asset_t* asset);
+int ozz_num_triangle_indices(ozz_asset_t* asset);
+int ozz_num_skeleton_joints(ozz_asset_t* asset);
+int ozz_num_skin_joints(ozz_asset_t* asset);
+// per-instance animation state, index is the instance's row in the joint texture,
+// keep live instances in the top rows to keep the joint texture small
+ozz_instance_t* ozz_create_instance(ozz_asset_t* asset, int index);
 void ozz_destroy_instance(ozz_instance_t* ozz);
-sg_buffer ozz_vertex_buffer(ozz_instance_t* ozz);
-sg_buffer ozz_index_buffer(ozz_instance_t* ozz);
-bool ozz_all_loaded(ozz_instance_t* ozz);
-bool ozz_load_failed(ozz_instance_t* ozz);
-void ozz_load_skeleton(ozz_instance_t* ozz, const void* data, size_t num_bytes);
-void ozz_load_animation(ozz_instance_t* ozz, const void* data, size_t num_bytes);
-void ozz_load_mesh(ozz_instance_t* ozz, const void* data, size_t num_bytes);
-void ozz_set_load_failed(ozz_instance_t* ozz);
+void ozz_set_time_offset(ozz_instance_t* ozz, double seconds);
+// selects the instance's animation LOD level from its distance to the camera
+void ozz_set_lod_distance(ozz_instance_t* ozz, float distance);
+int ozz_lod(ozz_instance_t* ozz);
+// invisible instances are skipped in ozz_update_instances(), and evaluated
+// in the first update after they become visible again
+void ozz_set_visible(ozz_instance_t* ozz, bool visible);
+bool ozz_visible(ozz_instance_t* ozz);
+// includes the sampling cache, which is sized on creation when the skeleton
+// is already loaded, otherwise in the first update
+size_t ozz_instance_memory_size(ozz_instance_t* ozz);
 void ozz_update_instance(ozz_instance_t* ozz, double seconds);
+// distant instances are only evaluated every Nth call (see ozz_lod_desc_t), staggered
+// by their row index, skipped instances keep their last joint palette row
+void ozz_update_instances(ozz_instance_t** instances, int num_instances, double seconds);
+int ozz_num_workers(void);
+// NOTE: the joint texture is recreated when the number of live rows changes, query
+// ozz_joint_texture() and ozz_joint_texture_v() again after calling this function
 void ozz_update_joint_texture(void);
+ozz_stats_t ozz_stats(void);
 float ozz_joint_texture_pixel_width(void);
+float ozz_joint_texture_pixel_height(void);
 float ozz_joint_texture_u(ozz_instance_t* ozz);
 float ozz_joint_texture_v(ozz_instance_t* ozz);
-int ozz_num_triangle_indices(ozz_instance_t* ozz);
 
 #if defined(__cplusplus)
 } // extern "C"
@@ -0,0 +1,66 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  spanstream.h
+//
+//  A read-only ozz::io::Stream over an existing memory range (for instance
+//  the buffer of a sokol_fetch response), so that ozz archives can be
+//  deserialized in place, without first copying the data into an
+//  ozz::io::MemoryStream.
+//
+//  The memory range must remain valid while the stream is in use.
+//------------------------------------------------------------------------------
+#include "ozz/base/io/stream.h"
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+class ozz_span_stream_t : public ozz::io::Stream {
+public:
+    ozz_span_stream_t(const void* data, size_t num_bytes):
+        data_((const uint8_t*)data),
+        size_((num_bytes > (size_t)INT_MAX) ? 0 : num_bytes),
+        tell_(0) { }
+
+    bool opened() const override {
+        return data_ != nullptr;
+    }
+    size_t Read(void* buffer, size_t num_bytes) override {
+        const size_t avail = size_ - (size_t)tell_;
+        if (num_bytes > avail) {
+            num_bytes = avail;
+        }
+        memcpy(buffer, data_ + tell_, num_bytes);
+        tell_ += (int)num_bytes;
+        return num_bytes;
+    }
+    size_t Write(const void*, size_t) override {
+        return 0;
+    }
+    int Seek(int offset, Origin origin) override {
+        int base;
+        switch (origin) {
+            case kCurrent:  base = tell_; break;
+            case kEnd:      base = (int)size_; break;
+            case kSet:      base = 0; break;
+            default:        return -1;
+        }
+        // unlike MemoryStream, seeking beyond the end isn't allowed since nothing can be written
+        const long long pos = (long long)base + offset;
+        if ((pos < 0) || (pos > (long long)size_)) {
+            return -1;
+        }
+        tell_ = (int)pos;
+        return 0;
+    }
+    int Tell() const override {
+        return tell_;
+    }
+    size_t Size() const override {
+        return size_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    int tell_;
+};
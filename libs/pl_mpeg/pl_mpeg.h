@@ -126,6 +126,12 @@ samples for the left and right channel interleaved, or if the
 PLM_AUDIO_SEPARATE_CHANNELS is defined *before* including this library, into
 two separate float arrays - one for each channel.
 
+The inverse DCT and the motion compensation of the video decoder use SSE2,
+AVX2 or NEON when the compiler targets these instruction sets (e.g. with
+-msse2, -mavx2 or on arm64). The decoded frames are exactly the same as with
+the plain C versions, which are used on other targets or when PLM_NO_SIMD is
+defined.
+
 
 See below for detailed the API documentation.
 
@@ -279,6 +285,15 @@ int plm_get_video_enabled(plm_t *self);
 void plm_set_video_enabled(plm_t *self, int enabled);
 
 
+// Get or set the number of threads for video decoding, including the calling
+// thread. With more than one thread, the slices of each picture are decoded in
+// parallel. The decoded frames are the same as with a single thread. Default
+// is 1. Thread support can be compiled out by defining PLM_NO_THREADS.
+
+int plm_get_video_threads(plm_t *self);
+void plm_set_video_threads(plm_t *self, int num_threads);
+
+
 // Get or set whether audio decoding is enabled. When enabling, you can set the
 // desired audio stream (0-3) to decode.
 
@@ -384,6 +399,10 @@ plm_samples_t *plm_decode_audio(plm_t *self);
 #define PLM_BUFFER_DEFAULT_SIZE (128 * 1024)
 #endif
 
+#ifndef PLM_VIDEO_MAX_THREADS
+#define PLM_VIDEO_MAX_THREADS 16
+#endif
+
 
 // Create a buffer instance with a filename. Returns NULL if the file could not
 // be opened.
@@ -516,6 +535,12 @@ int plm_video_get_height(plm_video_t *self);
 void plm_video_set_no_delay(plm_video_t *self, int no_delay);
 
 
+// Get or set the number of decoding threads. See plm_set_video_threads().
+
+int plm_video_get_threads(plm_video_t *self);
+void plm_video_set_threads(plm_video_t *self, int num_threads);
+
+
 // Get the current internal time in seconds
 
 double plm_video_get_time(plm_video_t *self);
@@ -599,6 +624,43 @@ plm_samples_t *plm_audio_decode(plm_audio_t *self);
 #include <string.h>
 #include <stdlib.h>
 
+// Threads aren't available in emscripten builds without pthreads support
+#if !defined(PLM_NO_THREADS) && defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	#define PLM_NO_THREADS
+#endif
+
+#if !defined(PLM_NO_THREADS)
+	#if defined(_WIN32)
+		#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+		#endif
+		#ifndef NOMINMAX
+		#define NOMINMAX
+		#endif
+		#include <windows.h>
+	#else
+		#include <pthread.h>
+	#endif
+#endif
+
+// SIMD versions of the IDCT and motion compensation, selected at compile time
+#if !defined(PLM_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		#define PLM_SIMD_SSE2
+		#include <emmintrin.h>
+		#if defined(__SSE4_1__)
+			#include <smmintrin.h>
+		#endif
+		#if defined(__AVX2__)
+			#define PLM_SIMD_AVX2
+			#include <immintrin.h>
+		#endif
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+		#define PLM_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#endif
+
 #if defined(__clang__)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wtypedef-redefinition"
@@ -703,6 +765,14 @@ void plm_set_video_enabled(plm_t *self, int enabled) {
 		: 0;
 }
 
+int plm_get_video_threads(plm_t *self) {
+	return plm_video_get_threads(self->video_decoder);
+}
+
+void plm_set_video_threads(plm_t *self, int num_threads) {
+	plm_video_set_threads(self->video_decoder, num_threads);
+}
+
 int plm_get_width(plm_t *self) {
 	return plm_video_get_width(self->video_decoder);
 }
@@ -1765,6 +1835,40 @@ typedef struct {
 	int v;
 } plm_video_motion_t;
 
+// The decoding state of a slice. The slices of a picture are independent, with
+// multiple threads each thread decodes slices with its own plm_video_slice_t,
+// which reads the slice data with its own buffer.
+
+typedef struct plm_video_slice_t {
+	plm_buffer_t *buffer;
+	plm_buffer_t slice_buffer;
+
+	plm_video_motion_t motion_forward;
+	plm_video_motion_t motion_backward;
+
+	int quantizer_scale;
+	int slice_begin;
+	int macroblock_address;
+
+	int mb_row;
+	int mb_col;
+
+	int macroblock_type;
+	int macroblock_intra;
+
+	int dc_predictor[3];
+
+	int block_data[64];
+} plm_video_slice_t;
+
+typedef struct plm_video_worker_t plm_video_worker_t;
+
+typedef struct {
+	size_t offset;
+	size_t length;
+	int slice;
+} plm_video_slice_data_t;
+
 typedef struct plm_video_t {
 	double framerate;
 	double time;
@@ -1789,17 +1893,7 @@ typedef struct plm_video_t {
 
 	int has_sequence_header;
 
-	int quantizer_scale;
-	int slice_begin;
-	int macroblock_address;
-
-	int mb_row;
-	int mb_col;
-
-	int macroblock_type;
-	int macroblock_intra;
-
-	int dc_predictor[3];
+	plm_video_slice_t slice;
 
 	plm_buffer_t *buffer;
 	int destroy_buffer_when_done;
@@ -1809,14 +1903,51 @@ typedef struct plm_video_t {
 	plm_frame_t frame_backward;
 	uint8_t *frames_data;
 
-	int block_data[64];
 	uint8_t intra_quant_matrix[64];
 	uint8_t non_intra_quant_matrix[64];
 
 	int has_reference_frame;
 	int assume_no_b_frames;
+
+	// Multithreaded slice decoding, the slice data of a picture is copied
+	// into slice_data and the slices are then decoded by all threads
+	int num_threads;
+	plm_video_worker_t *workers;
+	uint8_t *slice_data;
+	size_t slice_data_length;
+	size_t slice_data_capacity;
+	plm_video_slice_data_t *slices;
+	int num_slices;
+	int slices_capacity;
+	int next_slice;
+	int num_slices_done;
+	unsigned int generation;
+	int quit;
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			SRWLOCK lock;
+			CONDITION_VARIABLE job_cond;
+			CONDITION_VARIABLE done_cond;
+		#else
+			pthread_mutex_t mutex;
+			pthread_cond_t job_cond;
+			pthread_cond_t done_cond;
+		#endif
+	#endif
 } plm_video_t;
 
+struct plm_video_worker_t {
+	plm_video_t *video;
+	plm_video_slice_t ctx;
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			HANDLE thread;
+		#else
+			pthread_t thread;
+		#endif
+	#endif
+};
+
 static inline uint8_t plm_clamp(int n) {
 	return n > 255
 		? 255
@@ -1826,16 +1957,37 @@ static inline uint8_t plm_clamp(int n) {
 void plm_video_decode_sequence_header(plm_video_t *self);
 void plm_video_init_frame(plm_video_t *self, plm_frame_t *frame, uint8_t *base);
 void plm_video_decode_picture(plm_video_t *self);
-void plm_video_decode_slice(plm_video_t *self, int slice);
-void plm_video_decode_macroblock(plm_video_t *self);
-void plm_video_decode_motion_vectors(plm_video_t *self);
-int plm_video_decode_motion_vector(plm_video_t *self, int r_size, int motion);
-void plm_video_predict_macroblock(plm_video_t *self);
-void plm_video_copy_macroblock(plm_video_t *self, int motion_h, int motion_v, plm_frame_t *d);
-void plm_video_interpolate_macroblock(plm_video_t *self, int motion_h, int motion_v, plm_frame_t *d);
-void plm_video_process_macroblock(plm_video_t *self, uint8_t *d, uint8_t *s, int mh, int mb, int bs, int interp);
-void plm_video_decode_block(plm_video_t *self, int block);
+int plm_video_collect_slices(plm_video_t *self);
+void plm_video_decode_slices_threaded(plm_video_t *self);
+void plm_video_decode_slices(plm_video_t *self, plm_video_slice_t *ctx);
+void plm_video_create_workers(plm_video_t *self);
+void plm_video_destroy_workers(plm_video_t *self);
+void plm_video_lock(plm_video_t *self);
+void plm_video_unlock(plm_video_t *self);
+void plm_video_decode_slice(plm_video_t *self, plm_video_slice_t *ctx, int slice);
+void plm_video_decode_macroblock(plm_video_t *self, plm_video_slice_t *ctx);
+void plm_video_decode_motion_vectors(plm_video_t *self, plm_video_slice_t *ctx);
+int plm_video_decode_motion_vector(plm_video_slice_t *ctx, int r_size, int motion);
+void plm_video_predict_macroblock(plm_video_t *self, plm_video_slice_t *ctx);
+void plm_video_copy_macroblock(plm_video_t *self, plm_video_slice_t *ctx, int motion_h, int motion_v, plm_frame_t *d);
+void plm_video_interpolate_macroblock(plm_video_t *self, plm_video_slice_t *ctx, int motion_h, int motion_v, plm_frame_t *d);
+void plm_video_process_macroblock(plm_video_t *self, plm_video_slice_t *ctx, uint8_t *d, uint8_t *s, int mh, int mb, int bs, int interp);
+void plm_video_process_block_scalar(uint8_t *d, uint8_t *s, int dw, int block_size, int mode);
+void plm_video_decode_block(plm_video_t *self, plm_video_slice_t *ctx, int block);
 void plm_video_idct(int *block);
+void plm_video_idct_scalar(int *block);
+
+#if defined(PLM_SIMD_SSE2)
+void plm_video_process_block_sse2(uint8_t *d, uint8_t *s, int dw, int block_size, int mode);
+void plm_video_idct_sse2(int *block);
+#endif
+#if defined(PLM_SIMD_AVX2)
+void plm_video_idct_avx2(int *block);
+#endif
+#if defined(PLM_SIMD_NEON)
+void plm_video_process_block_neon(uint8_t *d, uint8_t *s, int dw, int block_size, int mode);
+void plm_video_idct_neon(int *block);
+#endif
 
 plm_video_t * plm_video_create_with_buffer(plm_buffer_t *buffer, int destroy_when_done) {
 	plm_video_t *self = (plm_video_t *)malloc(sizeof(plm_video_t));
@@ -1843,6 +1995,7 @@ plm_video_t * plm_video_create_with_buffer(plm_buffer_t *buffer, int destroy_whe
 
 	self->buffer = buffer;
 	self->destroy_buffer_when_done = destroy_when_done;
+	self->num_threads = 1;
 	self->start_code = plm_buffer_find_start_code(self->buffer, PLM_START_SEQUENCE);
 	if (self->start_code != -1) {
 		plm_video_decode_sequence_header(self);
@@ -1851,6 +2004,10 @@ plm_video_t * plm_video_create_with_buffer(plm_buffer_t *buffer, int destroy_whe
 }
 
 void plm_video_destroy(plm_video_t *self) {
+	plm_video_destroy_workers(self);
+	free(self->slice_data);
+	free(self->slices);
+
 	if (self->destroy_buffer_when_done) {
 		plm_buffer_destroy(self->buffer);
 	}
@@ -1878,6 +2035,31 @@ void plm_video_set_no_delay(plm_video_t *self, int no_delay) {
 	self->assume_no_b_frames = no_delay;
 }
 
+int plm_video_get_threads(plm_video_t *self) {
+	return self->num_threads;
+}
+
+void plm_video_set_threads(plm_video_t *self, int num_threads) {
+	#if defined(PLM_NO_THREADS)
+		num_threads = 1;
+	#endif
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	else if (num_threads > PLM_VIDEO_MAX_THREADS) {
+		num_threads = PLM_VIDEO_MAX_THREADS;
+	}
+	if (num_threads == self->num_threads) {
+		return;
+	}
+
+	plm_video_destroy_workers(self);
+	self->num_threads = num_threads;
+	if (num_threads > 1) {
+		plm_video_create_workers(self);
+	}
+}
+
 double plm_video_get_time(plm_video_t *self) {
 	return self->time;
 }
@@ -2072,12 +2254,18 @@ void plm_video_decode_picture(plm_video_t *self) {
 	} while (self->start_code == PLM_START_EXTENSION || self->start_code == PLM_START_USER_DATA);
 
 
-	while (self->start_code >= PLM_START_SLICE_FIRST && self->start_code <= PLM_START_SLICE_LAST) {
-		plm_video_decode_slice(self, self->start_code & 0x000000FF);
-		if (self->macroblock_address == self->mb_size - 1) {
-			break;
+	if (self->num_threads > 1) {
+		plm_video_decode_slices_threaded(self);
+	}
+	else {
+		self->slice.buffer = self->buffer;
+		while (self->start_code >= PLM_START_SLICE_FIRST && self->start_code <= PLM_START_SLICE_LAST) {
+			plm_video_decode_slice(self, &self->slice, self->start_code & 0x000000FF);
+			if (self->slice.macroblock_address == self->mb_size - 1) {
+				break;
+			}
+			self->start_code = plm_buffer_next_start_code(self->buffer);
 		}
-		self->start_code = plm_buffer_next_start_code(self->buffer);
 	}
 
 	// If this is a reference picutre rotate the prediction pointers
@@ -2090,88 +2278,323 @@ void plm_video_decode_picture(plm_video_t *self) {
 	}
 }
 
-void plm_video_decode_slice(plm_video_t *self, int slice) {
-	self->slice_begin = TRUE;
-	self->macroblock_address = (slice - 1) * self->mb_width - 1;
+int plm_video_collect_slices(plm_video_t *self) {
+	// Each slice is terminated with a start code, like in the stream, and
+	// padded so that plm_buffer_no_start_code() can see it. A slice at the
+	// end of the data is copied as is, so that it's decoded the same way.
+	static const uint8_t trailer[8] = {0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+	plm_buffer_t *buffer = self->buffer;
+	int num_slices = 0;
+	self->slice_data_length = 0;
+	while (self->start_code >= PLM_START_SLICE_FIRST && self->start_code <= PLM_START_SLICE_LAST) {
+		// Find the end of the slice without moving the read position, so
+		// that loading more data doesn't discard the start of the slice
+		size_t length = 0;
+		int found = FALSE;
+		while (plm_buffer_has(buffer, (length + 5) << 3)) {
+			uint8_t *p = buffer->bytes + (buffer->bit_index >> 3) + length;
+			if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01) {
+				found = TRUE;
+				break;
+			}
+			length++;
+		}
+		size_t start = buffer->bit_index >> 3;
+		if (!found) {
+			length = buffer->length - start;
+		}
+		size_t trailer_length = found ? sizeof(trailer) : 0;
+
+		size_t required = self->slice_data_length + length + trailer_length;
+		if (required > self->slice_data_capacity) {
+			size_t new_capacity = self->slice_data_capacity ? self->slice_data_capacity * 2 : PLM_BUFFER_DEFAULT_SIZE;
+			while (new_capacity < required) {
+				new_capacity *= 2;
+			}
+			self->slice_data = (uint8_t *)realloc(self->slice_data, new_capacity);
+			self->slice_data_capacity = new_capacity;
+		}
+		if (num_slices == self->slices_capacity) {
+			self->slices_capacity = self->slices_capacity ? self->slices_capacity * 2 : 64;
+			self->slices = (plm_video_slice_data_t *)realloc(self->slices, self->slices_capacity * sizeof(plm_video_slice_data_t));
+		}
 
-	// Reset motion vectors and DC predictors
-	self->motion_backward.h = self->motion_forward.h = 0;
-	self->motion_backward.v = self->motion_forward.v = 0;
-	self->dc_predictor[0] = 128;
-	self->dc_predictor[1] = 128;
-	self->dc_predictor[2] = 128;
+		plm_video_slice_data_t *slice = &self->slices[num_slices++];
+		slice->offset = self->slice_data_length;
+		slice->length = length + trailer_length;
+		slice->slice = self->start_code & 0x000000FF;
+		memcpy(self->slice_data + slice->offset, buffer->bytes + start, length);
+		memcpy(self->slice_data + slice->offset + length, trailer, trailer_length);
+		self->slice_data_length = required;
 
-	self->quantizer_scale = plm_buffer_read(self->buffer, 5);
+		buffer->bit_index = (start + length) << 3;
+		self->start_code = plm_buffer_next_start_code(buffer);
+	}
+	return num_slices;
+}
+
+void plm_video_decode_slices_threaded(plm_video_t *self) {
+	int num_slices = plm_video_collect_slices(self);
+
+	// Wake up the workers, and help decoding the slices
+	plm_video_lock(self);
+	self->num_slices = num_slices;
+	self->next_slice = 0;
+	self->num_slices_done = 0;
+	self->generation++;
+	plm_video_unlock(self);
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			WakeAllConditionVariable(&self->job_cond);
+		#else
+			pthread_cond_broadcast(&self->job_cond);
+		#endif
+	#endif
+
+	plm_video_decode_slices(self, &self->slice);
+
+	// Wait for the slices still being decoded by the workers
+	plm_video_lock(self);
+	while (self->num_slices_done < self->num_slices) {
+		#if !defined(PLM_NO_THREADS)
+			#if defined(_WIN32)
+				SleepConditionVariableSRW(&self->done_cond, &self->lock, INFINITE, 0);
+			#else
+				pthread_cond_wait(&self->done_cond, &self->mutex);
+			#endif
+		#endif
+	}
+	plm_video_unlock(self);
+}
+
+void plm_video_decode_slices(plm_video_t *self, plm_video_slice_t *ctx) {
+	ctx->buffer = &ctx->slice_buffer;
+	while (TRUE) {
+		plm_video_lock(self);
+		int index = (self->next_slice < self->num_slices) ? self->next_slice++ : -1;
+		plm_video_unlock(self);
+		if (index < 0) {
+			return;
+		}
+
+		plm_video_slice_data_t *slice = &self->slices[index];
+		memset(&ctx->slice_buffer, 0, sizeof(plm_buffer_t));
+		ctx->slice_buffer.bytes = self->slice_data + slice->offset;
+		ctx->slice_buffer.length = slice->length;
+		ctx->slice_buffer.capacity = slice->length;
+		ctx->slice_buffer.mode = PLM_BUFFER_MODE_FIXED_MEM;
+		plm_video_decode_slice(self, ctx, slice->slice);
+
+		plm_video_lock(self);
+		int all_done = (++self->num_slices_done == self->num_slices);
+		plm_video_unlock(self);
+		if (all_done) {
+			#if !defined(PLM_NO_THREADS)
+				#if defined(_WIN32)
+					WakeAllConditionVariable(&self->done_cond);
+				#else
+					pthread_cond_broadcast(&self->done_cond);
+				#endif
+			#endif
+		}
+	}
+}
+
+#if !defined(PLM_NO_THREADS)
+#if defined(_WIN32)
+DWORD WINAPI plm_video_worker_func(LPVOID user) {
+#else
+void *plm_video_worker_func(void *user) {
+#endif
+	plm_video_worker_t *worker = (plm_video_worker_t *)user;
+	plm_video_t *self = worker->video;
+	unsigned int generation = 0;
+	while (TRUE) {
+		plm_video_lock(self);
+		while (!self->quit && self->generation == generation) {
+			#if defined(_WIN32)
+				SleepConditionVariableSRW(&self->job_cond, &self->lock, INFINITE, 0);
+			#else
+				pthread_cond_wait(&self->job_cond, &self->mutex);
+			#endif
+		}
+		int quit = self->quit;
+		generation = self->generation;
+		plm_video_unlock(self);
+		if (quit) {
+			return 0;
+		}
+		plm_video_decode_slices(self, &worker->ctx);
+	}
+}
+#endif
+
+void plm_video_create_workers(plm_video_t *self) {
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			InitializeSRWLock(&self->lock);
+			InitializeConditionVariable(&self->job_cond);
+			InitializeConditionVariable(&self->done_cond);
+		#else
+			pthread_mutex_init(&self->mutex, NULL);
+			pthread_cond_init(&self->job_cond, NULL);
+			pthread_cond_init(&self->done_cond, NULL);
+		#endif
+		self->quit = FALSE;
+		self->workers = (plm_video_worker_t *)calloc(self->num_threads - 1, sizeof(plm_video_worker_t));
+		for (int i = 0; i < self->num_threads - 1; i++) {
+			plm_video_worker_t *worker = &self->workers[i];
+			worker->video = self;
+			#if defined(_WIN32)
+				worker->thread = CreateThread(NULL, 0, plm_video_worker_func, worker, 0, NULL);
+			#else
+				pthread_create(&worker->thread, NULL, plm_video_worker_func, worker);
+			#endif
+		}
+	#endif
+}
+
+void plm_video_destroy_workers(plm_video_t *self) {
+	if (!self->workers) {
+		return;
+	}
+	#if !defined(PLM_NO_THREADS)
+		plm_video_lock(self);
+		self->quit = TRUE;
+		plm_video_unlock(self);
+		#if defined(_WIN32)
+			WakeAllConditionVariable(&self->job_cond);
+		#else
+			pthread_cond_broadcast(&self->job_cond);
+		#endif
+		for (int i = 0; i < self->num_threads - 1; i++) {
+			#if defined(_WIN32)
+				WaitForSingleObject(self->workers[i].thread, INFINITE);
+				CloseHandle(self->workers[i].thread);
+			#else
+				pthread_join(self->workers[i].thread, NULL);
+			#endif
+		}
+		#if !defined(_WIN32)
+			pthread_cond_destroy(&self->done_cond);
+			pthread_cond_destroy(&self->job_cond);
+			pthread_mutex_destroy(&self->mutex);
+		#endif
+	#endif
+	free(self->workers);
+	self->workers = NULL;
+}
+
+void plm_video_lock(plm_video_t *self) {
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			AcquireSRWLockExclusive(&self->lock);
+		#else
+			pthread_mutex_lock(&self->mutex);
+		#endif
+	#else
+		(void)self;
+	#endif
+}
+
+void plm_video_unlock(plm_video_t *self) {
+	#if !defined(PLM_NO_THREADS)
+		#if defined(_WIN32)
+			ReleaseSRWLockExclusive(&self->lock);
+		#else
+			pthread_mutex_unlock(&self->mutex);
+		#endif
+	#else
+		(void)self;
+	#endif
+}
+
+void plm_video_decode_slice(plm_video_t *self, plm_video_slice_t *ctx, int slice) {
+	ctx->slice_begin = TRUE;
+	ctx->macroblock_address = (slice - 1) * self->mb_width - 1;
+
+	// Take full_px and r_size from the picture header, reset motion vectors
+	// and DC predictors
+	ctx->motion_forward = self->motion_forward;
+	ctx->motion_backward = self->motion_backward;
+	ctx->motion_backward.h = ctx->motion_forward.h = 0;
+	ctx->motion_backward.v = ctx->motion_forward.v = 0;
+	ctx->dc_predictor[0] = 128;
+	ctx->dc_predictor[1] = 128;
+	ctx->dc_predictor[2] = 128;
+
+	ctx->quantizer_scale = plm_buffer_read(ctx->buffer, 5);
 
 	// Skip extra
-	while (plm_buffer_read(self->buffer, 1)) {
-		plm_buffer_skip(self->buffer, 8);
+	while (plm_buffer_read(ctx->buffer, 1)) {
+		plm_buffer_skip(ctx->buffer, 8);
 	}
 
 	do {
-		plm_video_decode_macroblock(self);
+		plm_video_decode_macroblock(self, ctx);
 	} while (
-		self->macroblock_address < self->mb_size - 1 &&
-		plm_buffer_no_start_code(self->buffer)
+		ctx->macroblock_address < self->mb_size - 1 &&
+		plm_buffer_no_start_code(ctx->buffer)
 	);
 }
 
-void plm_video_decode_macroblock(plm_video_t *self) {
-	// Decode self->macroblock_address_increment
+void plm_video_decode_macroblock(plm_video_t *self, plm_video_slice_t *ctx) {
+	// Decode ctx->macroblock_address_increment
 	int increment = 0;
-	int t = plm_buffer_read_vlc(self->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
+	int t = plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
 
 	while (t == 34) {
 		// macroblock_stuffing
-		t = plm_buffer_read_vlc(self->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
+		t = plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
 	}
 	while (t == 35) {
 		// macroblock_escape
 		increment += 33;
-		t = plm_buffer_read_vlc(self->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
+		t = plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_MACROBLOCK_ADDRESS_INCREMENT);
 	}
 	increment += t;
 
 	// Process any skipped macroblocks
-	if (self->slice_begin) {
-		// The first self->macroblock_address_increment of each slice is relative
+	if (ctx->slice_begin) {
+		// The first ctx->macroblock_address_increment of each slice is relative
 		// to beginning of the preverious row, not the preverious macroblock
-		self->slice_begin = FALSE;
-		self->macroblock_address += increment;
+		ctx->slice_begin = FALSE;
+		ctx->macroblock_address += increment;
 	}
 	else {
-		if (self->macroblock_address + increment >= self->mb_size) {
+		if (ctx->macroblock_address + increment >= self->mb_size) {
 			return; // invalid
 		}
 		if (increment > 1) {
 			// Skipped macroblocks reset DC predictors
-			self->dc_predictor[0] = 128;
-			self->dc_predictor[1] = 128;
-			self->dc_predictor[2] = 128;
+			ctx->dc_predictor[0] = 128;
+			ctx->dc_predictor[1] = 128;
+			ctx->dc_predictor[2] = 128;
 
 			// Skipped macroblocks in P-pictures reset motion vectors
 			if (self->picture_type == PLM_VIDEO_PICTURE_TYPE_PREDICTIVE) {
-				self->motion_forward.h = 0;
-				self->motion_forward.v = 0;
+				ctx->motion_forward.h = 0;
+				ctx->motion_forward.v = 0;
 			}
 		}
 
 		// Predict skipped macroblocks
 		while (increment > 1) {
-			self->macroblock_address++;
-			self->mb_row = self->macroblock_address / self->mb_width;
-			self->mb_col = self->macroblock_address % self->mb_width;
+			ctx->macroblock_address++;
+			ctx->mb_row = ctx->macroblock_address / self->mb_width;
+			ctx->mb_col = ctx->macroblock_address % self->mb_width;
 
-			plm_video_predict_macroblock(self);
+			plm_video_predict_macroblock(self, ctx);
 			increment--;
 		}
-		self->macroblock_address++;
+		ctx->macroblock_address++;
 	}
 
-	self->mb_row = self->macroblock_address / self->mb_width;
-	self->mb_col = self->macroblock_address % self->mb_width;
+	ctx->mb_row = ctx->macroblock_address / self->mb_width;
+	ctx->mb_col = ctx->macroblock_address % self->mb_width;
 
-	if (self->mb_col >= self->mb_width || self->mb_row >= self->mb_height) {
+	if (ctx->mb_col >= self->mb_width || ctx->mb_row >= self->mb_height) {
 		return; // corrupt stream;
 	}
 
@@ -2180,74 +2603,74 @@ void plm_video_decode_macroblock(plm_video_t *self) {
 	// macroblock_type = read_huffman(self->bits, mbTable);
 
 	const plm_vlc_t *table = PLM_VIDEO_MACROBLOCK_TYPE[self->picture_type];
-	self->macroblock_type = plm_buffer_read_vlc(self->buffer, table);
+	ctx->macroblock_type = plm_buffer_read_vlc(ctx->buffer, table);
 
-	self->macroblock_intra = (self->macroblock_type & 0x01);
-	self->motion_forward.is_set = (self->macroblock_type & 0x08);
-	self->motion_backward.is_set = (self->macroblock_type & 0x04);
+	ctx->macroblock_intra = (ctx->macroblock_type & 0x01);
+	ctx->motion_forward.is_set = (ctx->macroblock_type & 0x08);
+	ctx->motion_backward.is_set = (ctx->macroblock_type & 0x04);
 
 	// Quantizer scale
-	if ((self->macroblock_type & 0x10) != 0) {
-		self->quantizer_scale = plm_buffer_read(self->buffer, 5);
+	if ((ctx->macroblock_type & 0x10) != 0) {
+		ctx->quantizer_scale = plm_buffer_read(ctx->buffer, 5);
 	}
 
-	if (self->macroblock_intra) {
+	if (ctx->macroblock_intra) {
 		// Intra-coded macroblocks reset motion vectors
-		self->motion_backward.h = self->motion_forward.h = 0;
-		self->motion_backward.v = self->motion_forward.v = 0;
+		ctx->motion_backward.h = ctx->motion_forward.h = 0;
+		ctx->motion_backward.v = ctx->motion_forward.v = 0;
 	}
 	else {
 		// Non-intra macroblocks reset DC predictors
-		self->dc_predictor[0] = 128;
-		self->dc_predictor[1] = 128;
-		self->dc_predictor[2] = 128;
+		ctx->dc_predictor[0] = 128;
+		ctx->dc_predictor[1] = 128;
+		ctx->dc_predictor[2] = 128;
 
-		plm_video_decode_motion_vectors(self);
-		plm_video_predict_macroblock(self);
+		plm_video_decode_motion_vectors(self, ctx);
+		plm_video_predict_macroblock(self, ctx);
 	}
 
 	// Decode blocks
-	int cbp = ((self->macroblock_type & 0x02) != 0)
-		? plm_buffer_read_vlc(self->buffer, PLM_VIDEO_CODE_BLOCK_PATTERN)
-		: (self->macroblock_intra ? 0x3f : 0);
+	int cbp = ((ctx->macroblock_type & 0x02) != 0)
+		? plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_CODE_BLOCK_PATTERN)
+		: (ctx->macroblock_intra ? 0x3f : 0);
 
 	for (int block = 0, mask = 0x20; block < 6; block++) {
 		if ((cbp & mask) != 0) {
-			plm_video_decode_block(self, block);
+			plm_video_decode_block(self, ctx, block);
 		}
 		mask >>= 1;
 	}
 }
 
-void plm_video_decode_motion_vectors(plm_video_t *self) {
+void plm_video_decode_motion_vectors(plm_video_t *self, plm_video_slice_t *ctx) {
 
 	// Forward
-	if (self->motion_forward.is_set) {
-		int r_size = self->motion_forward.r_size;
-		self->motion_forward.h = plm_video_decode_motion_vector(self, r_size, self->motion_forward.h);
-		self->motion_forward.v = plm_video_decode_motion_vector(self, r_size, self->motion_forward.v);
+	if (ctx->motion_forward.is_set) {
+		int r_size = ctx->motion_forward.r_size;
+		ctx->motion_forward.h = plm_video_decode_motion_vector(ctx, r_size, ctx->motion_forward.h);
+		ctx->motion_forward.v = plm_video_decode_motion_vector(ctx, r_size, ctx->motion_forward.v);
 	}
 	else if (self->picture_type == PLM_VIDEO_PICTURE_TYPE_PREDICTIVE) {
 		// No motion information in P-picture, reset vectors
-		self->motion_forward.h = 0;
-		self->motion_forward.v = 0;
+		ctx->motion_forward.h = 0;
+		ctx->motion_forward.v = 0;
 	}
 
-	if (self->motion_backward.is_set) {
-		int r_size = self->motion_backward.r_size;
-		self->motion_backward.h = plm_video_decode_motion_vector(self, r_size, self->motion_backward.h);
-		self->motion_backward.v = plm_video_decode_motion_vector(self, r_size, self->motion_backward.v);
+	if (ctx->motion_backward.is_set) {
+		int r_size = ctx->motion_backward.r_size;
+		ctx->motion_backward.h = plm_video_decode_motion_vector(ctx, r_size, ctx->motion_backward.h);
+		ctx->motion_backward.v = plm_video_decode_motion_vector(ctx, r_size, ctx->motion_backward.v);
 	}
 }
 
-int plm_video_decode_motion_vector(plm_video_t *self, int r_size, int motion) {
+int plm_video_decode_motion_vector(plm_video_slice_t *ctx, int r_size, int motion) {
 	int fscale = 1 << r_size;
-	int m_code = plm_buffer_read_vlc(self->buffer, PLM_VIDEO_MOTION);
+	int m_code = plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_MOTION);
 	int r = 0;
 	int d;
 
 	if ((m_code != 0) && (fscale != 1)) {
-		r = plm_buffer_read(self->buffer, r_size);
+		r = plm_buffer_read(ctx->buffer, r_size);
 		d = ((abs(m_code) - 1) << r_size) + r + 1;
 		if (m_code < 0) {
 			d = -d;
@@ -2268,51 +2691,51 @@ int plm_video_decode_motion_vector(plm_video_t *self, int r_size, int motion) {
 	return motion;
 }
 
-void plm_video_predict_macroblock(plm_video_t *self) {
-	int fw_h = self->motion_forward.h;
-	int fw_v = self->motion_forward.v;
+void plm_video_predict_macroblock(plm_video_t *self, plm_video_slice_t *ctx) {
+	int fw_h = ctx->motion_forward.h;
+	int fw_v = ctx->motion_forward.v;
 
-	if (self->motion_forward.full_px) {
+	if (ctx->motion_forward.full_px) {
 		fw_h <<= 1;
 		fw_v <<= 1;
 	}
 
 	if (self->picture_type == PLM_VIDEO_PICTURE_TYPE_B) {
-		int bw_h = self->motion_backward.h;
-		int bw_v = self->motion_backward.v;
+		int bw_h = ctx->motion_backward.h;
+		int bw_v = ctx->motion_backward.v;
 
-		if (self->motion_backward.full_px) {
+		if (ctx->motion_backward.full_px) {
 			bw_h <<= 1;
 			bw_v <<= 1;
 		}
 
-		if (self->motion_forward.is_set) {
-			plm_video_copy_macroblock(self, fw_h, fw_v, &self->frame_forward);
-			if (self->motion_backward.is_set) {
-				plm_video_interpolate_macroblock(self, bw_h, bw_v, &self->frame_backward);
+		if (ctx->motion_forward.is_set) {
+			plm_video_copy_macroblock(self, ctx, fw_h, fw_v, &self->frame_forward);
+			if (ctx->motion_backward.is_set) {
+				plm_video_interpolate_macroblock(self, ctx, bw_h, bw_v, &self->frame_backward);
 			}
 		}
 		else {
-			plm_video_copy_macroblock(self, bw_h, bw_v, &self->frame_backward);
+			plm_video_copy_macroblock(self, ctx, bw_h, bw_v, &self->frame_backward);
 		}
 	}
 	else {
-		plm_video_copy_macroblock(self, fw_h, fw_v, &self->frame_forward);
+		plm_video_copy_macroblock(self, ctx, fw_h, fw_v, &self->frame_forward);
 	}
 }
 
-void plm_video_copy_macroblock(plm_video_t *self, int motion_h, int motion_v, plm_frame_t *d) {
+void plm_video_copy_macroblock(plm_video_t *self, plm_video_slice_t *ctx, int motion_h, int motion_v, plm_frame_t *d) {
 	plm_frame_t *s = &self->frame_current;
-	plm_video_process_macroblock(self, s->y.data, d->y.data, motion_h, motion_v, 16, FALSE);
-	plm_video_process_macroblock(self, s->cr.data, d->cr.data, motion_h / 2, motion_v / 2, 8, FALSE);
-	plm_video_process_macroblock(self, s->cb.data, d->cb.data, motion_h / 2, motion_v / 2, 8, FALSE);
+	plm_video_process_macroblock(self, ctx, s->y.data, d->y.data, motion_h, motion_v, 16, FALSE);
+	plm_video_process_macroblock(self, ctx, s->cr.data, d->cr.data, motion_h / 2, motion_v / 2, 8, FALSE);
+	plm_video_process_macroblock(self, ctx, s->cb.data, d->cb.data, motion_h / 2, motion_v / 2, 8, FALSE);
 }
 
-void plm_video_interpolate_macroblock(plm_video_t *self, int motion_h, int motion_v, plm_frame_t *d) {
+void plm_video_interpolate_macroblock(plm_video_t *self, plm_video_slice_t *ctx, int motion_h, int motion_v, plm_frame_t *d) {
 	plm_frame_t *s = &self->frame_current;
-	plm_video_process_macroblock(self, s->y.data, d->y.data, motion_h, motion_v, 16, TRUE);
-	plm_video_process_macroblock(self, s->cr.data, d->cr.data, motion_h / 2, motion_v / 2, 8, TRUE);
-	plm_video_process_macroblock(self, s->cb.data, d->cb.data, motion_h / 2, motion_v / 2, 8, TRUE);
+	plm_video_process_macroblock(self, ctx, s->y.data, d->y.data, motion_h, motion_v, 16, TRUE);
+	plm_video_process_macroblock(self, ctx, s->cr.data, d->cr.data, motion_h / 2, motion_v / 2, 8, TRUE);
+	plm_video_process_macroblock(self, ctx, s->cb.data, d->cb.data, motion_h / 2, motion_v / 2, 8, TRUE);
 }
 
 #define PLM_BLOCK_SET(DEST, DEST_INDEX, DEST_WIDTH, SOURCE_INDEX, SOURCE_WIDTH, BLOCK_SIZE, OP) do { \
@@ -2328,7 +2751,7 @@ void plm_video_interpolate_macroblock(plm_video_t *self, int motion_h, int motio
 	}} while(FALSE)
 
 void plm_video_process_macroblock(
-	plm_video_t *self, uint8_t *d, uint8_t *s,
+	plm_video_t *self, plm_video_slice_t *ctx, uint8_t *d, uint8_t *s,
 	int motion_h, int motion_v, int block_size, int interpolate
 ) {
 	int dw = self->mb_width * block_size;
@@ -2338,20 +2761,36 @@ void plm_video_process_macroblock(
 	int odd_h = (motion_h & 1) == 1;
 	int odd_v = (motion_v & 1) == 1;
 
-	unsigned int si = ((self->mb_row * block_size) + vp) * dw + (self->mb_col * block_size) + hp;
-	unsigned int di = (self->mb_row * dw + self->mb_col) * block_size;
+	unsigned int si = ((ctx->mb_row * block_size) + vp) * dw + (ctx->mb_col * block_size) + hp;
+	unsigned int di = (ctx->mb_row * dw + ctx->mb_col) * block_size;
 
 	unsigned int max_address = (dw * (self->mb_height * block_size - block_size + 1) - block_size);
 	if (si > max_address || di > max_address) {
 		return; // corrupt video
 	}
 
+	int mode = (interpolate << 2) | (odd_h << 1) | (odd_v);
+	#if defined(PLM_SIMD_SSE2)
+		plm_video_process_block_sse2(d + di, s + si, dw, block_size, mode);
+	#elif defined(PLM_SIMD_NEON)
+		plm_video_process_block_neon(d + di, s + si, dw, block_size, mode);
+	#else
+		plm_video_process_block_scalar(d + di, s + si, dw, block_size, mode);
+	#endif
+}
+
+// Copy (or average with d when interpolating) a block of s, shifted by half
+// a pixel horizontally (mode & 2) and/or vertically (mode & 1)
+void plm_video_process_block_scalar(uint8_t *d, uint8_t *s, int dw, int block_size, int mode) {
+	unsigned int si = 0;
+	unsigned int di = 0;
+
 	#define PLM_MB_CASE(INTERPOLATE, ODD_H, ODD_V, OP) \
 		case ((INTERPOLATE << 2) | (ODD_H << 1) | (ODD_V)): \
 			PLM_BLOCK_SET(d, di, dw, si, dw, block_size, OP); \
 			break
 
-	switch ((interpolate << 2) | (odd_h << 1) | (odd_v)) {
+	switch (mode) {
 		PLM_MB_CASE(0, 0, 0, (s[si]));
 		PLM_MB_CASE(0, 0, 1, (s[si] + s[si + dw] + 1) >> 1);
 		PLM_MB_CASE(0, 1, 0, (s[si] + s[si + 1] + 1) >> 1);
@@ -2366,40 +2805,199 @@ void plm_video_process_macroblock(
 	#undef PLM_MB_CASE
 }
 
-void plm_video_decode_block(plm_video_t *self, int block) {
+// The cases of plm_video_process_block_scalar() for a SIMD row of block_size
+// pixels. PLM_LOAD, PLM_STORE, PLM_AVG (rounded average of two rows, the same
+// as (a + b + 1) >> 1) and PLM_AVG4 (rounded average of the 2x2 neighborhood
+// of each pixel) are defined for each instruction set and block size.
+#define PLM_SIMD_MB_CASE(INTERPOLATE, ODD_H, ODD_V, OP) \
+	case ((INTERPOLATE << 2) | (ODD_H << 1) | (ODD_V)): \
+		for (int y = 0; y < block_size; y++) { \
+			PLM_STORE(d, OP); \
+			s += dw; \
+			d += dw; \
+		} \
+		break
+
+#define PLM_SIMD_MB_CASES() \
+	PLM_SIMD_MB_CASE(0, 0, 0, PLM_LOAD(s)); \
+	PLM_SIMD_MB_CASE(0, 0, 1, PLM_AVG(PLM_LOAD(s), PLM_LOAD(s + dw))); \
+	PLM_SIMD_MB_CASE(0, 1, 0, PLM_AVG(PLM_LOAD(s), PLM_LOAD(s + 1))); \
+	PLM_SIMD_MB_CASE(0, 1, 1, PLM_AVG4(s, dw)); \
+	PLM_SIMD_MB_CASE(1, 0, 0, PLM_AVG(PLM_LOAD(d), PLM_LOAD(s))); \
+	PLM_SIMD_MB_CASE(1, 0, 1, PLM_AVG(PLM_LOAD(d), PLM_AVG(PLM_LOAD(s), PLM_LOAD(s + dw)))); \
+	PLM_SIMD_MB_CASE(1, 1, 0, PLM_AVG(PLM_LOAD(d), PLM_AVG(PLM_LOAD(s), PLM_LOAD(s + 1)))); \
+	PLM_SIMD_MB_CASE(1, 1, 1, PLM_AVG(PLM_LOAD(d), PLM_AVG4(s, dw)))
+
+#if defined(PLM_SIMD_SSE2)
+
+static inline __m128i plm_video_avg4_8_sse2(const uint8_t *s, int dw) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_add_epi16(
+		_mm_add_epi16(
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)s), zero),
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + 1)), zero)
+		),
+		_mm_add_epi16(
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + dw)), zero),
+			_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + dw + 1)), zero)
+		)
+	);
+	sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+	return _mm_packus_epi16(sum, sum);
+}
+
+static inline __m128i plm_video_avg4_16_sse2(const uint8_t *s, int dw) {
+	__m128i a = _mm_loadu_si128((const __m128i *)s);
+	__m128i b = _mm_loadu_si128((const __m128i *)(s + 1));
+	__m128i c = _mm_loadu_si128((const __m128i *)(s + dw));
+	__m128i e = _mm_loadu_si128((const __m128i *)(s + dw + 1));
+	#if defined(PLM_SIMD_AVX2)
+		__m256i sum = _mm256_add_epi16(
+			_mm256_add_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(b)),
+			_mm256_add_epi16(_mm256_cvtepu8_epi16(c), _mm256_cvtepu8_epi16(e))
+		);
+		sum = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+		return _mm_packus_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	#else
+		__m128i zero = _mm_setzero_si128();
+		__m128i two = _mm_set1_epi16(2);
+		__m128i lo = _mm_add_epi16(
+			_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+			_mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(e, zero))
+		);
+		__m128i hi = _mm_add_epi16(
+			_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+			_mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(e, zero))
+		);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+		return _mm_packus_epi16(lo, hi);
+	#endif
+}
+
+void plm_video_process_block_sse2(uint8_t *d, uint8_t *s, int dw, int block_size, int mode) {
+	#define PLM_AVG(A, B) _mm_avg_epu8(A, B)
+	if (block_size == 16) {
+		#define PLM_LOAD(P) _mm_loadu_si128((const __m128i *)(P))
+		#define PLM_STORE(P, V) _mm_storeu_si128((__m128i *)(P), V)
+		#define PLM_AVG4(P, W) plm_video_avg4_16_sse2(P, W)
+		switch (mode) {
+			PLM_SIMD_MB_CASES();
+		}
+		#undef PLM_LOAD
+		#undef PLM_STORE
+		#undef PLM_AVG4
+	}
+	else {
+		#define PLM_LOAD(P) _mm_loadl_epi64((const __m128i *)(P))
+		#define PLM_STORE(P, V) _mm_storel_epi64((__m128i *)(P), V)
+		#define PLM_AVG4(P, W) plm_video_avg4_8_sse2(P, W)
+		switch (mode) {
+			PLM_SIMD_MB_CASES();
+		}
+		#undef PLM_LOAD
+		#undef PLM_STORE
+		#undef PLM_AVG4
+	}
+	#undef PLM_AVG
+}
+
+#endif // PLM_SIMD_SSE2
+
+#if defined(PLM_SIMD_NEON)
+
+static inline uint8x8_t plm_video_avg4_8_neon(const uint8_t *s, int dw) {
+	uint16x8_t sum = vaddq_u16(
+		vaddl_u8(vld1_u8(s), vld1_u8(s + 1)),
+		vaddl_u8(vld1_u8(s + dw), vld1_u8(s + dw + 1))
+	);
+	return vrshrn_n_u16(sum, 2);
+}
+
+static inline uint8x16_t plm_video_avg4_16_neon(const uint8_t *s, int dw) {
+	uint8x16_t a = vld1q_u8(s);
+	uint8x16_t b = vld1q_u8(s + 1);
+	uint8x16_t c = vld1q_u8(s + dw);
+	uint8x16_t e = vld1q_u8(s + dw + 1);
+	uint16x8_t lo = vaddq_u16(
+		vaddl_u8(vget_low_u8(a), vget_low_u8(b)),
+		vaddl_u8(vget_low_u8(c), vget_low_u8(e))
+	);
+	uint16x8_t hi = vaddq_u16(
+		vaddl_u8(vget_high_u8(a), vget_high_u8(b)),
+		vaddl_u8(vget_high_u8(c), vget_high_u8(e))
+	);
+	return vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2));
+}
+
+void plm_video_process_block_neon(uint8_t *d, uint8_t *s, int dw, int block_size, int mode) {
+	if (block_size == 16) {
+		#define PLM_LOAD(P) vld1q_u8(P)
+		#define PLM_STORE(P, V) vst1q_u8(P, V)
+		#define PLM_AVG(A, B) vrhaddq_u8(A, B)
+		#define PLM_AVG4(P, W) plm_video_avg4_16_neon(P, W)
+		switch (mode) {
+			PLM_SIMD_MB_CASES();
+		}
+		#undef PLM_LOAD
+		#undef PLM_STORE
+		#undef PLM_AVG
+		#undef PLM_AVG4
+	}
+	else {
+		#define PLM_LOAD(P) vld1_u8(P)
+		#define PLM_STORE(P, V) vst1_u8(P, V)
+		#define PLM_AVG(A, B) vrhadd_u8(A, B)
+		#define PLM_AVG4(P, W) plm_video_avg4_8_neon(P, W)
+		switch (mode) {
+			PLM_SIMD_MB_CASES();
+		}
+		#undef PLM_LOAD
+		#undef PLM_STORE
+		#undef PLM_AVG
+		#undef PLM_AVG4
+	}
+}
+
+#endif // PLM_SIMD_NEON
+
+#undef PLM_SIMD_MB_CASES
+#undef PLM_SIMD_MB_CASE
+
+void plm_video_decode_block(plm_video_t *self, plm_video_slice_t *ctx, int block) {
 
 	int n = 0;
 	uint8_t *quant_matrix;
 
 	// Decode DC coefficient of intra-coded blocks
-	if (self->macroblock_intra) {
+	if (ctx->macroblock_intra) {
 		int predictor;
 		int dct_size;
 
 		// DC prediction
 		int plane_index = block > 3 ? block - 3 : 0;
-		predictor = self->dc_predictor[plane_index];
-		dct_size = plm_buffer_read_vlc(self->buffer, PLM_VIDEO_DCT_SIZE[plane_index]);
+		predictor = ctx->dc_predictor[plane_index];
+		dct_size = plm_buffer_read_vlc(ctx->buffer, PLM_VIDEO_DCT_SIZE[plane_index]);
 
 		// Read DC coeff
 		if (dct_size > 0) {
-			int differential = plm_buffer_read(self->buffer, dct_size);
+			int differential = plm_buffer_read(ctx->buffer, dct_size);
 			if ((differential & (1 << (dct_size - 1))) != 0) {
-				self->block_data[0] = predictor + differential;
+				ctx->block_data[0] = predictor + differential;
 			}
 			else {
-				self->block_data[0] = predictor + ((-1 << dct_size) | (differential + 1));
+				ctx->block_data[0] = predictor + ((-1 << dct_size) | (differential + 1));
 			}
 		}
 		else {
-			self->block_data[0] = predictor;
+			ctx->block_data[0] = predictor;
 		}
 
 		// Save predictor value
-		self->dc_predictor[plane_index] = self->block_data[0];
+		ctx->dc_predictor[plane_index] = ctx->block_data[0];
 
 		// Dequantize + premultiply
-		self->block_data[0] <<= (3 + 5);
+		ctx->block_data[0] <<= (3 + 5);
 
 		quant_matrix = self->intra_quant_matrix;
 		n = 1;
@@ -2412,21 +3010,21 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 	int level = 0;
 	while (TRUE) {
 		int run = 0;
-		uint16_t coeff = plm_buffer_read_vlc_uint(self->buffer, PLM_VIDEO_DCT_COEFF);
+		uint16_t coeff = plm_buffer_read_vlc_uint(ctx->buffer, PLM_VIDEO_DCT_COEFF);
 
-		if ((coeff == 0x0001) && (n > 0) && (plm_buffer_read(self->buffer, 1) == 0)) {
+		if ((coeff == 0x0001) && (n > 0) && (plm_buffer_read(ctx->buffer, 1) == 0)) {
 			// end_of_block
 			break;
 		}
 		if (coeff == 0xffff) {
 			// escape
-			run = plm_buffer_read(self->buffer, 6);
-			level = plm_buffer_read(self->buffer, 8);
+			run = plm_buffer_read(ctx->buffer, 6);
+			level = plm_buffer_read(ctx->buffer, 8);
 			if (level == 0) {
-				level = plm_buffer_read(self->buffer, 8);
+				level = plm_buffer_read(ctx->buffer, 8);
 			}
 			else if (level == 128) {
-				level = plm_buffer_read(self->buffer, 8) - 256;
+				level = plm_buffer_read(ctx->buffer, 8) - 256;
 			}
 			else if (level > 128) {
 				level = level - 256;
@@ -2435,7 +3033,7 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 		else {
 			run = coeff >> 8;
 			level = coeff & 0xff;
-			if (plm_buffer_read(self->buffer, 1)) {
+			if (plm_buffer_read(ctx->buffer, 1)) {
 				level = -level;
 			}
 		}
@@ -2450,10 +3048,10 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 
 		// Dequantize, oddify, clip
 		level <<= 1;
-		if (!self->macroblock_intra) {
+		if (!ctx->macroblock_intra) {
 			level += (level < 0 ? -1 : 1);
 		}
-		level = (level * self->quantizer_scale * quant_matrix[de_zig_zagged]) >> 4;
+		level = (level * ctx->quantizer_scale * quant_matrix[de_zig_zagged]) >> 4;
 		if ((level & 1) == 0) {
 			level -= level > 0 ? 1 : -1;
 		}
@@ -2465,7 +3063,7 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 		}
 
 		// Save premultiplied coefficient
-		self->block_data[de_zig_zagged] = level * PLM_VIDEO_PREMULTIPLIER_MATRIX[de_zig_zagged];
+		ctx->block_data[de_zig_zagged] = level * PLM_VIDEO_PREMULTIPLIER_MATRIX[de_zig_zagged];
 	}
 
 	// Move block to its place
@@ -2476,7 +3074,7 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 	if (block < 4) {
 		d = self->frame_current.y.data;
 		dw = self->luma_width;
-		di = (self->mb_row * self->luma_width + self->mb_col) << 4;
+		di = (ctx->mb_row * self->luma_width + ctx->mb_col) << 4;
 		if ((block & 1) != 0) {
 			di += 8;
 		}
@@ -2487,12 +3085,12 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 	else {
 		d = (block == 4) ? self->frame_current.cb.data : self->frame_current.cr.data;
 		dw = self->chroma_width;
-		di = ((self->mb_row * self->luma_width) << 2) + (self->mb_col << 3);
+		di = ((ctx->mb_row * self->luma_width) << 2) + (ctx->mb_col << 3);
 	}
 
-	int *s = self->block_data;
+	int *s = ctx->block_data;
 	int si = 0;
-	if (self->macroblock_intra) {
+	if (ctx->macroblock_intra) {
 		// Overwrite (no prediction)
 		if (n == 1) {
 			int clamped = plm_clamp((s[0] + 128) >> 8);
@@ -2502,7 +3100,7 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 		else {
 			plm_video_idct(s);
 			PLM_BLOCK_SET(d, di, dw, si, 8, 8, plm_clamp(s[si]));
-			memset(self->block_data, 0, sizeof(self->block_data));
+			memset(ctx->block_data, 0, sizeof(ctx->block_data));
 		}
 	}
 	else {
@@ -2515,12 +3113,24 @@ void plm_video_decode_block(plm_video_t *self, int block) {
 		else {
 			plm_video_idct(s);
 			PLM_BLOCK_SET(d, di, dw, si, 8, 8, plm_clamp(d[di] + s[si]));
-			memset(self->block_data, 0, sizeof(self->block_data));
+			memset(ctx->block_data, 0, sizeof(ctx->block_data));
 		}
 	}
 }
 
 void plm_video_idct(int *block) {
+	#if defined(PLM_SIMD_AVX2)
+		plm_video_idct_avx2(block);
+	#elif defined(PLM_SIMD_SSE2)
+		plm_video_idct_sse2(block);
+	#elif defined(PLM_SIMD_NEON)
+		plm_video_idct_neon(block);
+	#else
+		plm_video_idct_scalar(block);
+	#endif
+}
+
+void plm_video_idct_scalar(int *block) {
 	int
 		b1, b3, b4, b6, b7, tmp1, tmp2, m0,
 		x0, x1, x2, x3, x4, y3, y4, y5, y6, y7;
@@ -2586,6 +3196,313 @@ void plm_video_idct(int *block) {
 	}
 }
 
+// One pass of plm_video_idct_scalar() over 8 vectors of 32 bit values, each
+// lane transforms one column (or one row, when the block is transposed).
+// ADD, SUB, MUL and SRA8 (arithmetic shift right by 8) are the vector ops,
+// C128, C473, C196 and C362 vectors of these constants. The row pass adds
+// ROUND (C128) to the results and shifts them with FINAL (SRA8).
+#define PLM_IDCT_PASS(TYPE, IN, OUT, ADD, SUB, MUL, SRA8, ROUND, FINAL) do { \
+	TYPE b1 = IN[4]; \
+	TYPE b3 = ADD(IN[2], IN[6]); \
+	TYPE b4 = SUB(IN[5], IN[3]); \
+	TYPE tmp1 = ADD(IN[1], IN[7]); \
+	TYPE tmp2 = ADD(IN[3], IN[5]); \
+	TYPE b6 = SUB(IN[1], IN[7]); \
+	TYPE b7 = ADD(tmp1, tmp2); \
+	TYPE m0 = IN[0]; \
+	TYPE x4 = SUB(SRA8(ADD(SUB(MUL(b6, C473), MUL(b4, C196)), C128)), b7); \
+	TYPE x0 = SUB(x4, SRA8(ADD(MUL(SUB(tmp1, tmp2), C362), C128))); \
+	TYPE x1 = SUB(m0, b1); \
+	TYPE x2 = SUB(SRA8(ADD(MUL(SUB(IN[2], IN[6]), C362), C128)), b3); \
+	TYPE x3 = ADD(m0, b1); \
+	TYPE y3 = ADD(x1, x2); \
+	TYPE y4 = ADD(x3, b3); \
+	TYPE y5 = SUB(x1, x2); \
+	TYPE y6 = SUB(x3, b3); \
+	/* y7n is -y7 of the scalar version */ \
+	TYPE y7n = ADD(x0, SRA8(ADD(ADD(MUL(b4, C473), MUL(b6, C196)), C128))); \
+	OUT[0] = FINAL(ADD(ADD(b7, y4), ROUND)); \
+	OUT[1] = FINAL(ADD(ADD(x4, y3), ROUND)); \
+	OUT[2] = FINAL(ADD(SUB(y5, x0), ROUND)); \
+	OUT[3] = FINAL(ADD(ADD(y6, y7n), ROUND)); \
+	OUT[4] = FINAL(ADD(SUB(y6, y7n), ROUND)); \
+	OUT[5] = FINAL(ADD(ADD(x0, y5), ROUND)); \
+	OUT[6] = FINAL(ADD(SUB(y3, x4), ROUND)); \
+	OUT[7] = FINAL(ADD(SUB(y4, b7), ROUND)); \
+	} while(FALSE)
+
+#define PLM_IDCT_NOP(V) (V)
+
+#if defined(PLM_SIMD_SSE2)
+
+static inline __m128i plm_video_mullo_sse2(__m128i a, __m128i b) {
+	// The low 32 bits of the products, SSE2 has no _mm_mullo_epi32()
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+	);
+}
+
+static inline void plm_video_transpose4_sse2(__m128i *r0, __m128i *r1, __m128i *r2, __m128i *r3) {
+	__m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+	__m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+	__m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+	__m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+	*r0 = _mm_unpacklo_epi64(t0, t1);
+	*r1 = _mm_unpackhi_epi64(t0, t1);
+	*r2 = _mm_unpacklo_epi64(t2, t3);
+	*r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Transpose the 8x8 block of rows[0..7] (left half) and rows[8..15] (right
+// half) into columns in the same layout
+static inline void plm_video_transpose8_sse2(__m128i *rows) {
+	__m128i *l = rows;
+	__m128i *r = rows + 8;
+	plm_video_transpose4_sse2(&l[0], &l[1], &l[2], &l[3]);
+	plm_video_transpose4_sse2(&l[4], &l[5], &l[6], &l[7]);
+	plm_video_transpose4_sse2(&r[0], &r[1], &r[2], &r[3]);
+	plm_video_transpose4_sse2(&r[4], &r[5], &r[6], &r[7]);
+	for (int i = 0; i < 4; i++) {
+		__m128i t = l[4 + i];
+		l[4 + i] = r[i];
+		r[i] = t;
+	}
+}
+
+void plm_video_idct_sse2(int *block) {
+	#if defined(__SSE4_1__)
+		#define PLM_MUL(A, B) _mm_mullo_epi32(A, B)
+	#else
+		#define PLM_MUL(A, B) plm_video_mullo_sse2(A, B)
+	#endif
+	#define PLM_SRA8(V) _mm_srai_epi32(V, 8)
+
+	__m128i C128 = _mm_set1_epi32(128);
+	__m128i C473 = _mm_set1_epi32(473);
+	__m128i C196 = _mm_set1_epi32(196);
+	__m128i C362 = _mm_set1_epi32(362);
+	__m128i zero = _mm_setzero_si128();
+
+	// Left columns in v[0..7], right columns in v[8..15]. The loads and stores
+	// are unrolled, GCC turns these loops into a memcpy through the stack.
+	__m128i v[16] = {
+		_mm_loadu_si128((const __m128i *)(block + 0 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 1 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 2 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 3 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 4 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 5 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 6 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 7 * 8)),
+		_mm_loadu_si128((const __m128i *)(block + 0 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 1 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 2 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 3 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 4 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 5 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 6 * 8 + 4)),
+		_mm_loadu_si128((const __m128i *)(block + 7 * 8 + 4))
+	};
+
+	// Transform columns
+	PLM_IDCT_PASS(__m128i, v, v, _mm_add_epi32, _mm_sub_epi32, PLM_MUL, PLM_SRA8, zero, PLM_IDCT_NOP);
+	PLM_IDCT_PASS(__m128i, (v + 8), (v + 8), _mm_add_epi32, _mm_sub_epi32, PLM_MUL, PLM_SRA8, zero, PLM_IDCT_NOP);
+
+	// Transform rows
+	plm_video_transpose8_sse2(v);
+	PLM_IDCT_PASS(__m128i, v, v, _mm_add_epi32, _mm_sub_epi32, PLM_MUL, PLM_SRA8, C128, PLM_SRA8);
+	PLM_IDCT_PASS(__m128i, (v + 8), (v + 8), _mm_add_epi32, _mm_sub_epi32, PLM_MUL, PLM_SRA8, C128, PLM_SRA8);
+	plm_video_transpose8_sse2(v);
+
+	_mm_storeu_si128((__m128i *)(block + 0 * 8), v[0]);
+	_mm_storeu_si128((__m128i *)(block + 1 * 8), v[1]);
+	_mm_storeu_si128((__m128i *)(block + 2 * 8), v[2]);
+	_mm_storeu_si128((__m128i *)(block + 3 * 8), v[3]);
+	_mm_storeu_si128((__m128i *)(block + 4 * 8), v[4]);
+	_mm_storeu_si128((__m128i *)(block + 5 * 8), v[5]);
+	_mm_storeu_si128((__m128i *)(block + 6 * 8), v[6]);
+	_mm_storeu_si128((__m128i *)(block + 7 * 8), v[7]);
+	_mm_storeu_si128((__m128i *)(block + 0 * 8 + 4), v[8]);
+	_mm_storeu_si128((__m128i *)(block + 1 * 8 + 4), v[9]);
+	_mm_storeu_si128((__m128i *)(block + 2 * 8 + 4), v[10]);
+	_mm_storeu_si128((__m128i *)(block + 3 * 8 + 4), v[11]);
+	_mm_storeu_si128((__m128i *)(block + 4 * 8 + 4), v[12]);
+	_mm_storeu_si128((__m128i *)(block + 5 * 8 + 4), v[13]);
+	_mm_storeu_si128((__m128i *)(block + 6 * 8 + 4), v[14]);
+	_mm_storeu_si128((__m128i *)(block + 7 * 8 + 4), v[15]);
+
+	#undef PLM_MUL
+	#undef PLM_SRA8
+}
+
+#endif // PLM_SIMD_SSE2
+
+#if defined(PLM_SIMD_AVX2)
+
+static inline void plm_video_transpose8_avx2(__m256i *r) {
+	__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+void plm_video_idct_avx2(int *block) {
+	#define PLM_SRA8(V) _mm256_srai_epi32(V, 8)
+
+	__m256i C128 = _mm256_set1_epi32(128);
+	__m256i C473 = _mm256_set1_epi32(473);
+	__m256i C196 = _mm256_set1_epi32(196);
+	__m256i C362 = _mm256_set1_epi32(362);
+	__m256i zero = _mm256_setzero_si256();
+
+	// Unrolled loads and stores, see plm_video_idct_sse2()
+	__m256i v[8] = {
+		_mm256_loadu_si256((const __m256i *)(block + 0 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 1 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 2 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 3 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 4 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 5 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 6 * 8)),
+		_mm256_loadu_si256((const __m256i *)(block + 7 * 8))
+	};
+
+	// Transform columns
+	PLM_IDCT_PASS(__m256i, v, v, _mm256_add_epi32, _mm256_sub_epi32, _mm256_mullo_epi32, PLM_SRA8, zero, PLM_IDCT_NOP);
+
+	// Transform rows
+	plm_video_transpose8_avx2(v);
+	PLM_IDCT_PASS(__m256i, v, v, _mm256_add_epi32, _mm256_sub_epi32, _mm256_mullo_epi32, PLM_SRA8, C128, PLM_SRA8);
+	plm_video_transpose8_avx2(v);
+
+	_mm256_storeu_si256((__m256i *)(block + 0 * 8), v[0]);
+	_mm256_storeu_si256((__m256i *)(block + 1 * 8), v[1]);
+	_mm256_storeu_si256((__m256i *)(block + 2 * 8), v[2]);
+	_mm256_storeu_si256((__m256i *)(block + 3 * 8), v[3]);
+	_mm256_storeu_si256((__m256i *)(block + 4 * 8), v[4]);
+	_mm256_storeu_si256((__m256i *)(block + 5 * 8), v[5]);
+	_mm256_storeu_si256((__m256i *)(block + 6 * 8), v[6]);
+	_mm256_storeu_si256((__m256i *)(block + 7 * 8), v[7]);
+
+	#undef PLM_SRA8
+}
+
+#endif // PLM_SIMD_AVX2
+
+#if defined(PLM_SIMD_NEON)
+
+static inline void plm_video_transpose4_neon(int32x4_t *r0, int32x4_t *r1, int32x4_t *r2, int32x4_t *r3) {
+	int32x4x2_t p0 = vtrnq_s32(*r0, *r1);
+	int32x4x2_t p1 = vtrnq_s32(*r2, *r3);
+	*r0 = vcombine_s32(vget_low_s32(p0.val[0]), vget_low_s32(p1.val[0]));
+	*r1 = vcombine_s32(vget_low_s32(p0.val[1]), vget_low_s32(p1.val[1]));
+	*r2 = vcombine_s32(vget_high_s32(p0.val[0]), vget_high_s32(p1.val[0]));
+	*r3 = vcombine_s32(vget_high_s32(p0.val[1]), vget_high_s32(p1.val[1]));
+}
+
+// Same layout as plm_video_transpose8_sse2()
+static inline void plm_video_transpose8_neon(int32x4_t *rows) {
+	int32x4_t *l = rows;
+	int32x4_t *r = rows + 8;
+	plm_video_transpose4_neon(&l[0], &l[1], &l[2], &l[3]);
+	plm_video_transpose4_neon(&l[4], &l[5], &l[6], &l[7]);
+	plm_video_transpose4_neon(&r[0], &r[1], &r[2], &r[3]);
+	plm_video_transpose4_neon(&r[4], &r[5], &r[6], &r[7]);
+	for (int i = 0; i < 4; i++) {
+		int32x4_t t = l[4 + i];
+		l[4 + i] = r[i];
+		r[i] = t;
+	}
+}
+
+void plm_video_idct_neon(int *block) {
+	#define PLM_SRA8(V) vshrq_n_s32(V, 8)
+
+	int32x4_t C128 = vdupq_n_s32(128);
+	int32x4_t C473 = vdupq_n_s32(473);
+	int32x4_t C196 = vdupq_n_s32(196);
+	int32x4_t C362 = vdupq_n_s32(362);
+	int32x4_t zero = vdupq_n_s32(0);
+
+	// Left columns in v[0..7], right columns in v[8..15], unrolled loads and
+	// stores, see plm_video_idct_sse2()
+	int32x4_t v[16] = {
+		vld1q_s32(block + 0 * 8),
+		vld1q_s32(block + 1 * 8),
+		vld1q_s32(block + 2 * 8),
+		vld1q_s32(block + 3 * 8),
+		vld1q_s32(block + 4 * 8),
+		vld1q_s32(block + 5 * 8),
+		vld1q_s32(block + 6 * 8),
+		vld1q_s32(block + 7 * 8),
+		vld1q_s32(block + 0 * 8 + 4),
+		vld1q_s32(block + 1 * 8 + 4),
+		vld1q_s32(block + 2 * 8 + 4),
+		vld1q_s32(block + 3 * 8 + 4),
+		vld1q_s32(block + 4 * 8 + 4),
+		vld1q_s32(block + 5 * 8 + 4),
+		vld1q_s32(block + 6 * 8 + 4),
+		vld1q_s32(block + 7 * 8 + 4)
+	};
+
+	// Transform columns
+	PLM_IDCT_PASS(int32x4_t, v, v, vaddq_s32, vsubq_s32, vmulq_s32, PLM_SRA8, zero, PLM_IDCT_NOP);
+	PLM_IDCT_PASS(int32x4_t, (v + 8), (v + 8), vaddq_s32, vsubq_s32, vmulq_s32, PLM_SRA8, zero, PLM_IDCT_NOP);
+
+	// Transform rows
+	plm_video_transpose8_neon(v);
+	PLM_IDCT_PASS(int32x4_t, v, v, vaddq_s32, vsubq_s32, vmulq_s32, PLM_SRA8, C128, PLM_SRA8);
+	PLM_IDCT_PASS(int32x4_t, (v + 8), (v + 8), vaddq_s32, vsubq_s32, vmulq_s32, PLM_SRA8, C128, PLM_SRA8);
+	plm_video_transpose8_neon(v);
+
+	vst1q_s32(block + 0 * 8, v[0]);
+	vst1q_s32(block + 1 * 8, v[1]);
+	vst1q_s32(block + 2 * 8, v[2]);
+	vst1q_s32(block + 3 * 8, v[3]);
+	vst1q_s32(block + 4 * 8, v[4]);
+	vst1q_s32(block + 5 * 8, v[5]);
+	vst1q_s32(block + 6 * 8, v[6]);
+	vst1q_s32(block + 7 * 8, v[7]);
+	vst1q_s32(block + 0 * 8 + 4, v[8]);
+	vst1q_s32(block + 1 * 8 + 4, v[9]);
+	vst1q_s32(block + 2 * 8 + 4, v[10]);
+	vst1q_s32(block + 3 * 8 + 4, v[11]);
+	vst1q_s32(block + 4 * 8 + 4, v[12]);
+	vst1q_s32(block + 5 * 8 + 4, v[13]);
+	vst1q_s32(block + 6 * 8 + 4, v[14]);
+	vst1q_s32(block + 7 * 8 + 4, v[15]);
+
+	#undef PLM_SRA8
+}
+
+#endif // PLM_SIMD_NEON
+
+#undef PLM_IDCT_PASS
+#undef PLM_IDCT_NOP
+
 void plm_frame_to_rgb(plm_frame_t *frame, uint8_t *rgb) {
 	// Chroma values are the same for each block of 4 pixels, so we proccess
 	// 2 lines at a time, 2 neighboring pixels each.
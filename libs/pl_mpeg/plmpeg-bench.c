@@ -0,0 +1,188 @@
+//------------------------------------------------------------------------------
+//  plmpeg-bench.c
+//
+//  Headless video decoding benchmark for pl_mpeg. Decodes all video frames
+//  at max speed with 1, 2, 4 and 8 slice decoding threads, checks that the
+//  frames are exactly the same as with a single thread, and reports the
+//  frames per second for each thread count:
+//
+//  > plmpeg-bench bjork-all-is-full-of-love.mpg
+//
+//  The per-frame hashes of the single-threaded decode can be saved and
+//  checked by another build (e.g. plmpeg-bench-scalar, which is compiled
+//  with PLM_NO_SIMD):
+//
+//  > plmpeg-bench-scalar video.mpg --save hashes.txt
+//  > plmpeg-bench video.mpg --check hashes.txt
+//------------------------------------------------------------------------------
+#define PL_MPEG_IMPLEMENTATION
+#include "pl_mpeg.h"
+#define SOKOL_TIME_IMPL
+#include "sokol_time.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_THREAD_COUNTS (4)
+static const int thread_counts[NUM_THREAD_COUNTS] = { 1, 2, 4, 8 };
+
+typedef struct {
+    uint64_t* hashes;       // one per frame
+    int num_frames;
+    int capacity;
+    double seconds;
+} decode_result_t;
+
+static uint64_t fnv1a(const uint8_t* ptr, size_t num_bytes, uint64_t hash) {
+    for (size_t i = 0; i < num_bytes; i++) {
+        hash = (hash ^ ptr[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t frame_hash(const plm_frame_t* frame) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = fnv1a(frame->y.data, frame->y.width * frame->y.height, hash);
+    hash = fnv1a(frame->cb.data, frame->cb.width * frame->cb.height, hash);
+    hash = fnv1a(frame->cr.data, frame->cr.width * frame->cr.height, hash);
+    return hash;
+}
+
+static void add_hash(decode_result_t* res, uint64_t hash) {
+    if (res->num_frames == res->capacity) {
+        res->capacity = (res->capacity == 0) ? 1024 : (res->capacity * 2);
+        res->hashes = (uint64_t*) realloc(res->hashes, (size_t)res->capacity * sizeof(uint64_t));
+    }
+    res->hashes[res->num_frames++] = hash;
+}
+
+// decode all video frames, the hashing isn't included in the decode time
+static bool decode(const char* path, int num_threads, decode_result_t* res) {
+    // plm_create_with_filename() is compiled out in this version of pl_mpeg.h
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    plm_t* plm = plm_create_with_file(fp, 1);
+    plm_set_audio_enabled(plm, false, 0);
+    plm_set_video_threads(plm, num_threads);
+    memset(res, 0, sizeof(decode_result_t));
+    uint64_t decode_ticks = 0;
+    while (true) {
+        const uint64_t start = stm_now();
+        plm_frame_t* frame = plm_decode_video(plm);
+        decode_ticks += stm_since(start);
+        if (!frame) {
+            break;
+        }
+        add_hash(res, frame_hash(frame));
+    }
+    res->seconds = stm_sec(decode_ticks);
+    plm_destroy(plm);
+    return res->num_frames > 0;
+}
+
+// returns the index of the first differing frame, or -1
+static int first_mismatch(const uint64_t* hashes, int num_frames, const decode_result_t* ref) {
+    for (int i = 0; i < num_frames; i++) {
+        if ((i >= ref->num_frames) || (hashes[i] != ref->hashes[i])) {
+            return i;
+        }
+    }
+    return (num_frames == ref->num_frames) ? -1 : num_frames;
+}
+
+static bool save_hashes(const char* path, const decode_result_t* res) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+    for (int i = 0; i < res->num_frames; i++) {
+        fprintf(fp, "%016llx\n", (unsigned long long)res->hashes[i]);
+    }
+    return fclose(fp) == 0;
+}
+
+static bool load_hashes(const char* path, decode_result_t* res) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return false;
+    }
+    memset(res, 0, sizeof(decode_result_t));
+    unsigned long long hash;
+    while (fscanf(fp, "%llx", &hash) == 1) {
+        add_hash(res, (uint64_t)hash);
+    }
+    fclose(fp);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* save_path = 0;
+    const char* check_path = 0;
+    if ((argc == 4) && (strcmp(argv[2], "--save") == 0)) {
+        save_path = argv[3];
+    }
+    else if ((argc == 4) && (strcmp(argv[2], "--check") == 0)) {
+        check_path = argv[3];
+    }
+    else if (argc != 2) {
+        fprintf(stderr, "usage: %s video.mpg [--save hashes.txt | --check hashes.txt]\n", argv[0]);
+        return 10;
+    }
+    const char* path = argv[1];
+    stm_setup();
+
+    decode_result_t ref = { 0 };
+    bool ok = true;
+    for (int i = 0; i < NUM_THREAD_COUNTS; i++) {
+        decode_result_t res;
+        if (!decode(path, thread_counts[i], &res)) {
+            fprintf(stderr, "failed to decode '%s'\n", path);
+            return 10;
+        }
+        int mismatch = -1;
+        if (i == 0) {
+            ref = res;
+        }
+        else {
+            mismatch = first_mismatch(res.hashes, res.num_frames, &ref);
+            free(res.hashes);
+        }
+        printf("%d thread(s): %d frames, %8.1f fps", thread_counts[i], res.num_frames, res.num_frames / res.seconds);
+        if (mismatch >= 0) {
+            printf(", MISMATCH at frame %d\n", mismatch);
+            ok = false;
+        }
+        else {
+            printf("\n");
+        }
+    }
+
+    if (save_path) {
+        if (!save_hashes(save_path, &ref)) {
+            fprintf(stderr, "failed to write '%s'\n", save_path);
+            ok = false;
+        }
+    }
+    else if (check_path) {
+        decode_result_t check;
+        if (!load_hashes(check_path, &check)) {
+            fprintf(stderr, "failed to read '%s'\n", check_path);
+            return 10;
+        }
+        const int mismatch = first_mismatch(check.hashes, check.num_frames, &ref);
+        if (mismatch >= 0) {
+            printf("MISMATCH with '%s' at frame %d\n", check_path, mismatch);
+            ok = false;
+        }
+        else {
+            printf("all frames match '%s'\n", check_path);
+        }
+        free(check.hashes);
+    }
+    free(ref.hashes);
+    return ok ? 0 : 10;
+}
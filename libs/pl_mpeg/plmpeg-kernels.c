@@ -0,0 +1,223 @@
+//------------------------------------------------------------------------------
+//  plmpeg-kernels.c
+//
+//  Checks that the SIMD versions of the pl_mpeg IDCT and motion compensation
+//  kernels compiled for this target (SSE2, AVX2 or NEON) produce exactly the
+//  same output as the plain C versions on random blocks, and reports the
+//  time per block of each kernel:
+//
+//  > plmpeg-kernels [num_iterations]
+//
+//  The kernels are selected at compile time, so decoding a whole stream
+//  with the scalar kernels needs a separate build. plmpeg-bench-scalar is
+//  compiled with PLM_NO_SIMD for this:
+//
+//  > plmpeg-bench-scalar video.mpg --save hashes.txt
+//  > plmpeg-bench video.mpg --check hashes.txt
+//------------------------------------------------------------------------------
+#define PL_MPEG_IMPLEMENTATION
+#include "pl_mpeg.h"
+#define SOKOL_TIME_IMPL
+#include "sokol_time.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef void (*idct_func_t)(int* block);
+typedef void (*mc_func_t)(uint8_t* d, uint8_t* s, int dw, int block_size, int mode);
+
+typedef struct {
+    const char* name;
+    idct_func_t func;
+} idct_kernel_t;
+
+typedef struct {
+    const char* name;
+    mc_func_t func;
+} mc_kernel_t;
+
+// the scalar kernel must come first, it is the reference for the others
+static const idct_kernel_t idct_kernels[] = {
+    { "scalar", plm_video_idct_scalar },
+    #if defined(PLM_SIMD_SSE2)
+    { "sse2", plm_video_idct_sse2 },
+    #endif
+    #if defined(PLM_SIMD_AVX2)
+    { "avx2", plm_video_idct_avx2 },
+    #endif
+    #if defined(PLM_SIMD_NEON)
+    { "neon", plm_video_idct_neon },
+    #endif
+};
+#define NUM_IDCT_KERNELS ((int)(sizeof(idct_kernels) / sizeof(idct_kernels[0])))
+
+static const mc_kernel_t mc_kernels[] = {
+    { "scalar", plm_video_process_block_scalar },
+    #if defined(PLM_SIMD_SSE2)
+    { "sse2", plm_video_process_block_sse2 },
+    #endif
+    #if defined(PLM_SIMD_NEON)
+    { "neon", plm_video_process_block_neon },
+    #endif
+};
+#define NUM_MC_KERNELS ((int)(sizeof(mc_kernels) / sizeof(mc_kernels[0])))
+
+// a plane of 64x64 pixels, the blocks are placed with an offset of up to
+// 20 pixels (and one extra row and column for the half-pixel modes)
+#define PLANE_WIDTH (64)
+#define PLANE_SIZE (PLANE_WIDTH * PLANE_WIDTH)
+
+static uint32_t rand_state = 0x2F6E2B1;
+static uint32_t xorshift32(void) {
+    uint32_t x = rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rand_state = x;
+}
+
+// sparse coefficients like in a dequantized block, with small, medium and
+// out-of-range values to also cover the clamping and overflow paths
+static void random_block(int* block, int iteration) {
+    const int range = ((iteration % 3) == 0) ? (2048 * 90) : (((iteration % 3) == 1) ? 4096 : 64);
+    for (int i = 0; i < 64; i++) {
+        block[i] = ((xorshift32() & 3) == 0) ? ((int)(xorshift32() % (uint32_t)(2 * range)) - range) : 0;
+    }
+}
+
+// returns the number of blocks where any SIMD kernel differs from the scalar kernel
+static int check_idct(int num_iterations) {
+    int num_mismatches = 0;
+    for (int it = 0; it < num_iterations; it++) {
+        int input[64];
+        int ref[64];
+        random_block(input, it);
+        memcpy(ref, input, sizeof(ref));
+        idct_kernels[0].func(ref);
+        for (int k = 1; k < NUM_IDCT_KERNELS; k++) {
+            int block[64];
+            memcpy(block, input, sizeof(block));
+            idct_kernels[k].func(block);
+            if (memcmp(block, ref, sizeof(block)) != 0) {
+                if (num_mismatches == 0) {
+                    fprintf(stderr, "idct %s differs from scalar at iteration %d\n", idct_kernels[k].name, it);
+                }
+                num_mismatches++;
+            }
+        }
+    }
+    return num_mismatches;
+}
+
+static int check_mc(int num_iterations) {
+    static uint8_t src[PLANE_SIZE];
+    static uint8_t dst[PLANE_SIZE];
+    static uint8_t ref[PLANE_SIZE];
+    static uint8_t res[PLANE_SIZE];
+    int num_mismatches = 0;
+    for (int it = 0; it < num_iterations; it++) {
+        for (int i = 0; i < PLANE_SIZE; i++) {
+            src[i] = (uint8_t)xorshift32();
+            dst[i] = (uint8_t)xorshift32();
+        }
+        const int block_size = (it & 1) ? 16 : 8;
+        const int mode = (it >> 1) & 7;
+        const int dst_offset = (int)(xorshift32() % 20) * PLANE_WIDTH + (int)(xorshift32() % 20);
+        const int src_offset = (int)(xorshift32() % 20) * PLANE_WIDTH + (int)(xorshift32() % 20);
+        memcpy(ref, dst, sizeof(ref));
+        mc_kernels[0].func(ref + dst_offset, src + src_offset, PLANE_WIDTH, block_size, mode);
+        for (int k = 1; k < NUM_MC_KERNELS; k++) {
+            memcpy(res, dst, sizeof(res));
+            mc_kernels[k].func(res + dst_offset, src + src_offset, PLANE_WIDTH, block_size, mode);
+            if (memcmp(res, ref, sizeof(res)) != 0) {
+                if (num_mismatches == 0) {
+                    fprintf(stderr, "motion compensation %s differs from scalar at iteration %d (block size %d, mode %d)\n",
+                        mc_kernels[k].name, it, block_size, mode);
+                }
+                num_mismatches++;
+            }
+        }
+    }
+    return num_mismatches;
+}
+
+// the input blocks are generated up front so that only the kernel is timed
+static void bench_idct(int num_iterations) {
+    #define NUM_BENCH_BLOCKS (256)
+    static int inputs[NUM_BENCH_BLOCKS][64];
+    static int blocks[NUM_BENCH_BLOCKS][64];
+    for (int i = 0; i < NUM_BENCH_BLOCKS; i++) {
+        random_block(inputs[i], i);
+    }
+    const int num_rounds = (num_iterations + NUM_BENCH_BLOCKS - 1) / NUM_BENCH_BLOCKS;
+    for (int k = 0; k < NUM_IDCT_KERNELS; k++) {
+        uint64_t ticks = 0;
+        int checksum = 0;
+        for (int round = 0; round < num_rounds; round++) {
+            memcpy(blocks, inputs, sizeof(blocks));
+            const uint64_t start = stm_now();
+            for (int i = 0; i < NUM_BENCH_BLOCKS; i++) {
+                idct_kernels[k].func(blocks[i]);
+            }
+            ticks += stm_since(start);
+            checksum += blocks[round % NUM_BENCH_BLOCKS][round & 63];
+        }
+        const double ns_per_block = stm_ns(ticks) / ((double)num_rounds * NUM_BENCH_BLOCKS);
+        printf("idct %-8s %7.1f ns/block (checksum %d)\n", idct_kernels[k].name, ns_per_block, checksum);
+    }
+    #undef NUM_BENCH_BLOCKS
+}
+
+static void bench_mc(int num_iterations) {
+    static uint8_t src[PLANE_SIZE];
+    static uint8_t dst[PLANE_SIZE];
+    for (int i = 0; i < PLANE_SIZE; i++) {
+        src[i] = (uint8_t)xorshift32();
+        dst[i] = (uint8_t)xorshift32();
+    }
+    for (int block_size = 8; block_size <= 16; block_size += 8) {
+        for (int mode = 0; mode < 8; mode++) {
+            printf("mc %2dx%-2d mode %d:", block_size, block_size, mode);
+            for (int k = 0; k < NUM_MC_KERNELS; k++) {
+                const uint64_t start = stm_now();
+                for (int i = 0; i < num_iterations; i++) {
+                    const int offset = (i & 7) * (PLANE_WIDTH + 1);
+                    mc_kernels[k].func(dst + offset, src + offset, PLANE_WIDTH, block_size, mode);
+                }
+                const double ns_per_block = stm_ns(stm_since(start)) / num_iterations;
+                printf("  %s %6.1f ns", mc_kernels[k].name, ns_per_block);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const int num_iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (num_iterations <= 0) {
+        fprintf(stderr, "usage: %s [num_iterations]\n", argv[0]);
+        return 10;
+    }
+    stm_setup();
+
+    printf("idct kernels:");
+    for (int k = 0; k < NUM_IDCT_KERNELS; k++) {
+        printf(" %s", idct_kernels[k].name);
+    }
+    printf(", motion compensation kernels:");
+    for (int k = 0; k < NUM_MC_KERNELS; k++) {
+        printf(" %s", mc_kernels[k].name);
+    }
+    printf("\n");
+
+    const int idct_mismatches = check_idct(num_iterations);
+    const int mc_mismatches = check_mc(num_iterations / 2);
+    printf("idct: %d mismatches in %d blocks\n", idct_mismatches, num_iterations);
+    printf("motion compensation: %d mismatches in %d blocks\n", mc_mismatches, num_iterations / 2);
+
+    bench_idct(num_iterations * 10);
+    bench_mc(num_iterations * 10);
+    return ((idct_mismatches == 0) && (mc_mismatches == 0)) ? 0 : 10;
+}
@@ -0,0 +1,12 @@
+#define SOKOL_IMPL
+/* sokol_gfx.h with the dummy backend for headless command line tools,
+   the 3D-API define from the build options is replaced */
+#undef SOKOL_GLCORE33
+#undef SOKOL_GLES3
+#undef SOKOL_D3D11
+#undef SOKOL_METAL
+#undef SOKOL_WGPU
+#define SOKOL_DUMMY_BACKEND
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "sokol_log.h"
@@ -45,6 +45,7 @@ typedef struct {
     hmm_mat4 view;
     hmm_mat4 proj;
     hmm_mat4 view_proj;
+    hmm_vec4 frustum[6];    /* normalized left, right, bottom, top, near, far planes (xyz: normal, w: distance) */
 } camera_t;
 
 static float _cam_def(float val, float def) {
@@ -93,6 +94,33 @@ static hmm_vec3 _cam_euclidean(float latitude, float longitude) {
     return HMM_Vec3(cosf(lat) * sinf(lng), sinf(lat), cosf(lat) * cosf(lng));
 }
 
+/* extract the view frustum planes from the view-proj matrix, normals point inward */
+static void _cam_update_frustum(camera_t* cam) {
+    const hmm_mat4* m = &cam->view_proj;
+    for (int i = 0; i < 6; i++) {
+        const int row = i >> 1;
+        const float sign = (i & 1) ? -1.0f : 1.0f;
+        hmm_vec4 p = HMM_Vec4(m->Elements[0][3] + sign * m->Elements[0][row],
+                              m->Elements[1][3] + sign * m->Elements[1][row],
+                              m->Elements[2][3] + sign * m->Elements[2][row],
+                              m->Elements[3][3] + sign * m->Elements[3][row]);
+        const float len = HMM_LengthVec3(p.XYZ);
+        cam->frustum[i] = HMM_DivideVec4f(p, len);
+    }
+}
+
+/* test a bounding sphere against the view frustum from the last cam_update() */
+static inline bool cam_sphere_visible(const camera_t* cam, hmm_vec3 center, float radius) {
+    assert(cam);
+    for (int i = 0; i < 6; i++) {
+        const hmm_vec4 p = cam->frustum[i];
+        if ((HMM_DotVec3(p.XYZ, center) + p.W) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* update the view, proj and view_proj matrix */
 static void cam_update(camera_t* cam, int fb_width, int fb_height) {
     assert(cam);
@@ -103,6 +131,7 @@ static void cam_update(camera_t* cam, int fb_width, int fb_height) {
     cam->view = HMM_LookAt(cam->eye_pos, cam->center, HMM_Vec3(0.0f, 1.0f, 0.0f));
     cam->proj = HMM_Perspective(cam->aspect, w/h, cam->nearz, cam->farz);
     cam->view_proj = HMM_MultiplyMat4(cam->proj, cam->view);
+    _cam_update_frustum(cam);
 }
 
 /* handle sokol-app input events */
@@ -0,0 +1,172 @@
+//------------------------------------------------------------------------------
+//  gltf-stress-gen.c
+//
+//  Writes a glTF stress scene for cgltf-sapp: a grid of cube nodes, one row
+//  node per 100 nodes with the rest of the row as its children, and the
+//  vertex data in a separate .bin file:
+//
+//  > gltf-stress-gen stress.gltf [num_nodes] [num_meshes]
+//
+//  The nodes cycle through num_meshes meshes, each with its own vertex data
+//  (defaults: 10000 nodes and 100 meshes). With num_meshes equal to
+//  num_nodes no two nodes can be instanced together. Load and frame times
+//  are measured with cgltf-sapp-bench:
+//
+//  > cgltf-sapp-bench stress.gltf
+//------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROW_SIZE (100)
+#define GRID_SPACING (3.0f)
+#define NUM_CUBE_VERTICES (24)
+#define NUM_CUBE_INDICES (36)
+
+// interleaved position, normal, texcoord
+typedef struct {
+    float pos[3];
+    float normal[3];
+    float uv[2];
+} vertex_t;
+
+// 4 vertices per face, with the face normal
+static void make_cube(float size, vertex_t* vertices, uint16_t* indices) {
+    static const float normals[6][3] = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    };
+    static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    for (int face = 0; face < 6; face++) {
+        const float* n = normals[face];
+        // two axes perpendicular to the face normal, in counter-clockwise order
+        const int axis = (n[0] != 0.0f) ? 0 : ((n[1] != 0.0f) ? 1 : 2);
+        const float sign = n[axis];
+        const int u_axis = (axis + 1) % 3;
+        const int v_axis = (axis + 2) % 3;
+        for (int c = 0; c < 4; c++) {
+            vertex_t* v = &vertices[face * 4 + c];
+            v->pos[axis] = sign * size;
+            v->pos[u_axis] = corners[c][0] * size;
+            v->pos[v_axis] = corners[c][1] * size * sign;
+            memcpy(v->normal, n, sizeof(v->normal));
+            v->uv[0] = (corners[c][0] + 1.0f) * 0.5f;
+            v->uv[1] = (corners[c][1] + 1.0f) * 0.5f;
+        }
+        static const uint16_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < 6; i++) {
+            indices[face * 6 + i] = (uint16_t)(face * 4 + quad[i]);
+        }
+    }
+}
+
+// the .bin file: the shared index data, followed by the vertex data of each mesh
+static bool write_bin(const char* path, int num_meshes) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    vertex_t vertices[NUM_CUBE_VERTICES];
+    uint16_t indices[NUM_CUBE_INDICES];
+    make_cube(1.0f, vertices, indices);
+    fwrite(indices, sizeof(indices), 1, fp);
+    for (int mesh = 0; mesh < num_meshes; mesh++) {
+        make_cube(0.5f + 0.5f * (float)(mesh % 8) / 8.0f, vertices, indices);
+        fwrite(vertices, sizeof(vertices), 1, fp);
+    }
+    return fclose(fp) == 0;
+}
+
+static bool write_gltf(const char* path, const char* bin_name, int num_nodes, int num_meshes) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+    const size_t index_bytes = NUM_CUBE_INDICES * sizeof(uint16_t);
+    const size_t vertex_bytes = NUM_CUBE_VERTICES * sizeof(vertex_t);
+    fprintf(fp, "{\n\"asset\": { \"version\": \"2.0\", \"generator\": \"gltf-stress-gen\" },\n");
+    fprintf(fp, "\"buffers\": [ { \"uri\": \"%s\", \"byteLength\": %d } ],\n", bin_name, (int)(index_bytes + num_meshes * vertex_bytes));
+    fprintf(fp, "\"bufferViews\": [\n");
+    fprintf(fp, "  { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": %d, \"target\": 34963 },\n", (int)index_bytes);
+    fprintf(fp, "  { \"buffer\": 0, \"byteOffset\": %d, \"byteLength\": %d, \"byteStride\": %d, \"target\": 34962 }\n",
+        (int)index_bytes, (int)(num_meshes * vertex_bytes), (int)sizeof(vertex_t));
+    fprintf(fp, "],\n\"accessors\": [\n");
+    fprintf(fp, "  { \"bufferView\": 0, \"componentType\": 5123, \"count\": %d, \"type\": \"SCALAR\" }", NUM_CUBE_INDICES);
+    for (int mesh = 0; mesh < num_meshes; mesh++) {
+        const int offset = (int)(mesh * vertex_bytes);
+        const float size = 0.5f + 0.5f * (float)(mesh % 8) / 8.0f;
+        fprintf(fp, ",\n  { \"bufferView\": 1, \"byteOffset\": %d, \"componentType\": 5126, \"count\": %d, \"type\": \"VEC3\", "
+            "\"min\": [%g, %g, %g], \"max\": [%g, %g, %g] }", offset, NUM_CUBE_VERTICES, -size, -size, -size, size, size, size);
+        fprintf(fp, ",\n  { \"bufferView\": 1, \"byteOffset\": %d, \"componentType\": 5126, \"count\": %d, \"type\": \"VEC3\" }",
+            offset + 12, NUM_CUBE_VERTICES);
+        fprintf(fp, ",\n  { \"bufferView\": 1, \"byteOffset\": %d, \"componentType\": 5126, \"count\": %d, \"type\": \"VEC2\" }",
+            offset + 24, NUM_CUBE_VERTICES);
+    }
+    fprintf(fp, "\n],\n\"materials\": [ { \"pbrMetallicRoughness\": { \"baseColorFactor\": [0.8, 0.8, 0.8, 1.0], "
+        "\"metallicFactor\": 0.5, \"roughnessFactor\": 0.5 } } ],\n");
+    fprintf(fp, "\"meshes\": [\n");
+    for (int mesh = 0; mesh < num_meshes; mesh++) {
+        const int acc = 1 + mesh * 3;
+        fprintf(fp, "  { \"primitives\": [ { \"attributes\": { \"POSITION\": %d, \"NORMAL\": %d, \"TEXCOORD_0\": %d }, "
+            "\"indices\": 0, \"material\": 0 } ] }%s\n", acc, acc + 1, acc + 2, (mesh + 1 < num_meshes) ? "," : "");
+    }
+    // row nodes are placed in the world, their children relative to them
+    fprintf(fp, "],\n\"nodes\": [\n");
+    for (int node = 0; node < num_nodes; node++) {
+        const int col = node % ROW_SIZE;
+        const int row = node / ROW_SIZE;
+        fprintf(fp, "  { \"mesh\": %d, ", node % num_meshes);
+        if (col == 0) {
+            fprintf(fp, "\"translation\": [%g, 0, %g]", -0.5f * ROW_SIZE * GRID_SPACING, (row - 0.5f * (num_nodes / ROW_SIZE)) * GRID_SPACING);
+            const int last_child = (node + ROW_SIZE <= num_nodes) ? (node + ROW_SIZE - 1) : (num_nodes - 1);
+            if (last_child > node) {
+                fprintf(fp, ", \"children\": [");
+                for (int child = node + 1; child <= last_child; child++) {
+                    fprintf(fp, "%d%s", child, (child < last_child) ? ", " : "");
+                }
+                fprintf(fp, "]");
+            }
+        }
+        else {
+            fprintf(fp, "\"translation\": [%g, 0, 0]", col * GRID_SPACING);
+        }
+        fprintf(fp, " }%s\n", (node + 1 < num_nodes) ? "," : "");
+    }
+    fprintf(fp, "],\n\"scenes\": [ { \"nodes\": [");
+    for (int node = 0; node < num_nodes; node += ROW_SIZE) {
+        fprintf(fp, "%s%d", (node > 0) ? ", " : "", node);
+    }
+    fprintf(fp, "] } ],\n\"scene\": 0\n}\n");
+    return fclose(fp) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    const int num_nodes = (argc > 2) ? atoi(argv[2]) : 10000;
+    const int num_meshes = (argc > 3) ? atoi(argv[3]) : 100;
+    if ((argc < 2) || (argc > 4) || (num_nodes <= 0) || (num_meshes <= 0)) {
+        fprintf(stderr, "usage: %s stress.gltf [num_nodes] [num_meshes]\n", argv[0]);
+        return 10;
+    }
+    // the .bin file goes next to the .gltf file, and is referenced without its directory
+    const char* gltf_path = argv[1];
+    char bin_path[1024];
+    snprintf(bin_path, sizeof(bin_path), "%s", gltf_path);
+    char* ext = strrchr(bin_path, '.');
+    if (ext && !strchr(ext, '/') && !strchr(ext, '\\')) {
+        *ext = 0;
+    }
+    strncat(bin_path, ".bin", sizeof(bin_path) - strlen(bin_path) - 1);
+    const char* bin_name = bin_path;
+    for (const char* p = bin_path; *p; p++) {
+        if ((*p == '/') || (*p == '\\')) {
+            bin_name = p + 1;
+        }
+    }
+    if (!write_bin(bin_path, num_meshes) || !write_gltf(gltf_path, bin_name, num_nodes, num_meshes)) {
+        fprintf(stderr, "failed to write '%s'\n", gltf_path);
+        return 10;
+    }
+    printf("%s: %d nodes, %d meshes\n", gltf_path, num_nodes, num_meshes);
+    return 0;
+}
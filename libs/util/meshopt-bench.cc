@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+//  meshopt-bench.cc
+//
+//  Headless benchmark for the mesh optimization passes in meshopt.h, runs
+//  the vertex cache, overdraw and vertex fetch passes on ozz-animation mesh
+//  archives and on the indexed triangle primitives of glTF files, and
+//  reports the ACMR and time of each pass:
+//
+//  > meshopt-bench ozz_skin_mesh.ozz DamagedHelmet.gltf
+//
+//  glTF files are loaded with their buffers (e.g. DamagedHelmet.bin).
+//------------------------------------------------------------------------------
+#include "ozz/base/io/stream.h"
+#include "ozz/base/io/archive.h"
+#include "ozz/util/mesh.h"
+
+#define CGLTF_IMPLEMENTATION
+#define _CRT_SECURE_NO_WARNINGS
+#include "cgltf/cgltf.h"
+
+#include "meshopt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// an indexed triangle mesh with float3 positions as vertices
+struct mesh_t {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+};
+
+static double ms_since(std::chrono::steady_clock::time_point start_time) {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+    return elapsed.count();
+}
+
+// run the passes in the same order as ozzbake and cgltf-sapp and print the results
+static void optimize_mesh(const char* name, mesh_t& mesh) {
+    const size_t num_vertices = mesh.positions.size() / 3;
+    const size_t num_indices = mesh.indices.size();
+    uint32_t* indices = mesh.indices.data();
+    printf("%s: %d vertices, %d triangles\n", name, (int)num_vertices, (int)(num_indices / 3));
+
+    const float acmr_before = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+    auto start_time = std::chrono::steady_clock::now();
+    meshopt_optimize_vertex_cache(indices, num_indices, num_vertices);
+    const double vertex_cache_ms = ms_since(start_time);
+    const float acmr_vertex_cache = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+
+    start_time = std::chrono::steady_clock::now();
+    meshopt_optimize_overdraw(indices, num_indices, mesh.positions.data(), num_vertices, 3 * sizeof(float), 1.05f);
+    const double overdraw_ms = ms_since(start_time);
+    const float acmr_overdraw = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+
+    start_time = std::chrono::steady_clock::now();
+    const size_t num_referenced = meshopt_optimize_vertex_fetch(mesh.positions.data(), num_vertices, 3 * sizeof(float), indices, num_indices);
+    const double vertex_fetch_ms = ms_since(start_time);
+
+    printf("  ACMR:         %.3f => %.3f (vertex cache) => %.3f (overdraw)\n", acmr_before, acmr_vertex_cache, acmr_overdraw);
+    printf("  vertex cache: %8.3f ms\n", vertex_cache_ms);
+    printf("  overdraw:     %8.3f ms\n", overdraw_ms);
+    printf("  vertex fetch: %8.3f ms (%d referenced vertices)\n", vertex_fetch_ms, (int)num_referenced);
+}
+
+// all parts of an ozz mesh share one index buffer
+static bool bench_ozz_mesh(const char* path) {
+    ozz::io::File file(path, "rb");
+    if (!file.opened()) {
+        fprintf(stderr, "failed to open '%s'\n", path);
+        return false;
+    }
+    ozz::io::IArchive archive(&file);
+    if (!archive.TestTag<ozz::sample::Mesh>()) {
+        fprintf(stderr, "'%s' is not an ozz mesh archive\n", path);
+        return false;
+    }
+    ozz::sample::Mesh ozz_mesh;
+    archive >> ozz_mesh;
+    mesh_t mesh;
+    for (const ozz::sample::Mesh::Part& part: ozz_mesh.parts) {
+        mesh.positions.insert(mesh.positions.end(), part.positions.begin(), part.positions.end());
+    }
+    mesh.indices.assign(ozz_mesh.triangle_indices.begin(), ozz_mesh.triangle_indices.end());
+    optimize_mesh(path, mesh);
+    return true;
+}
+
+// each indexed triangle-list primitive is optimized separately
+static bool bench_gltf(const char* path) {
+    // the file data must outlive the cgltf_data, a GLB's binary chunk is used in place
+    std::vector<uint8_t> file_data;
+    FILE* fp = fopen(path, "rb");
+    if (fp) {
+        uint8_t chunk[64 * 1024];
+        size_t num_bytes;
+        while ((num_bytes = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+            file_data.insert(file_data.end(), chunk, chunk + num_bytes);
+        }
+        fclose(fp);
+    }
+    cgltf_options options = { };
+    cgltf_data* gltf = nullptr;
+    if (file_data.empty() ||
+        (cgltf_parse(&options, file_data.data(), file_data.size(), &gltf) != cgltf_result_success) ||
+        (cgltf_load_buffers(&options, gltf, path) != cgltf_result_success))
+    {
+        fprintf(stderr, "failed to load '%s'\n", path);
+        cgltf_free(gltf);
+        return false;
+    }
+    for (cgltf_size mesh_index = 0; mesh_index < gltf->meshes_count; mesh_index++) {
+        const cgltf_mesh* gltf_mesh = &gltf->meshes[mesh_index];
+        for (cgltf_size prim_index = 0; prim_index < gltf_mesh->primitives_count; prim_index++) {
+            const cgltf_primitive* prim = &gltf_mesh->primitives[prim_index];
+            const cgltf_accessor* pos_acc = nullptr;
+            for (cgltf_size attr_index = 0; attr_index < prim->attributes_count; attr_index++) {
+                if (prim->attributes[attr_index].type == cgltf_attribute_type_position) {
+                    pos_acc = prim->attributes[attr_index].data;
+                }
+            }
+            if ((prim->type != cgltf_primitive_type_triangles) || !prim->indices || !pos_acc) {
+                continue;
+            }
+            mesh_t mesh;
+            mesh.positions.resize(pos_acc->count * 3);
+            for (cgltf_size i = 0; i < pos_acc->count; i++) {
+                cgltf_accessor_read_float(pos_acc, i, &mesh.positions[i * 3], 3);
+            }
+            mesh.indices.resize(prim->indices->count);
+            for (cgltf_size i = 0; i < prim->indices->count; i++) {
+                mesh.indices[i] = (uint32_t) cgltf_accessor_read_index(prim->indices, i);
+            }
+            char name[256];
+            snprintf(name, sizeof(name), "%s (mesh %d, primitive %d)", path, (int)mesh_index, (int)prim_index);
+            optimize_mesh(name, mesh);
+        }
+    }
+    cgltf_free(gltf);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s mesh.ozz|scene.gltf|scene.glb...\n", argv[0]);
+        return 10;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; i++) {
+        const char* ext = strrchr(argv[i], '.');
+        if (ext && (strcmp(ext, ".ozz") == 0)) {
+            ok &= bench_ozz_mesh(argv[i]);
+        }
+        else {
+            ok &= bench_gltf(argv[i]);
+        }
+    }
+    return ok ? 0 : 10;
+}
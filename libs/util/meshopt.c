@@ -0,0 +1,421 @@
+//------------------------------------------------------------------------------
+//  meshopt.c
+//
+//  See meshopt.h for details.
+//------------------------------------------------------------------------------
+#include "meshopt.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// size of the LRU cache modelled by the Forsyth algorithm
+#define FORSYTH_CACHE_SIZE (32)
+#define FORSYTH_MAX_VALENCE (64)
+
+// the vertex score tables for the Forsyth algorithm, the cache score rewards
+// recently used vertices, the valence score favours vertices with few remaining
+// triangles, so that they are finished off instead of lingering
+static float forsyth_cache_scores[FORSYTH_CACHE_SIZE];
+static float forsyth_valence_scores[FORSYTH_MAX_VALENCE];
+static bool forsyth_tables_valid;
+
+static void forsyth_init_tables(void) {
+    if (forsyth_tables_valid) {
+        return;
+    }
+    for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+        if (i < 3) {
+            // the last triangle's vertices get a fixed score, so that the
+            // exact order within the last triangle doesn't matter
+            forsyth_cache_scores[i] = 0.75f;
+        } else {
+            const float scaler = 1.0f / (float)(FORSYTH_CACHE_SIZE - 3);
+            forsyth_cache_scores[i] = powf(1.0f - (float)(i - 3) * scaler, 1.5f);
+        }
+    }
+    forsyth_valence_scores[0] = 0.0f;
+    for (int i = 1; i < FORSYTH_MAX_VALENCE; i++) {
+        forsyth_valence_scores[i] = 2.0f / sqrtf((float)i);
+    }
+    forsyth_tables_valid = true;
+}
+
+static float forsyth_vertex_score(int cache_pos, uint32_t num_live_tris) {
+    if (num_live_tris == 0) {
+        // no triangles left which use this vertex
+        return -1.0f;
+    }
+    float score = (cache_pos >= 0) ? forsyth_cache_scores[cache_pos] : 0.0f;
+    const uint32_t valence = (num_live_tris < FORSYTH_MAX_VALENCE) ? num_live_tris : (FORSYTH_MAX_VALENCE - 1);
+    score += forsyth_valence_scores[valence];
+    return score;
+}
+
+void meshopt_optimize_vertex_cache(uint32_t* indices, size_t num_indices, size_t num_vertices) {
+    assert(indices && ((num_indices % 3) == 0));
+    const size_t num_tris = num_indices / 3;
+    if ((num_tris == 0) || (num_vertices == 0)) {
+        return;
+    }
+    forsyth_init_tables();
+
+    // per-vertex list of triangles which haven't been emitted yet
+    uint32_t* num_live = (uint32_t*) calloc(num_vertices, sizeof(uint32_t));
+    uint32_t* adj_offsets = (uint32_t*) malloc(num_vertices * sizeof(uint32_t));
+    uint32_t* adj_tris = (uint32_t*) malloc(num_indices * sizeof(uint32_t));
+    int* cache_pos = (int*) malloc(num_vertices * sizeof(int));
+    float* vertex_scores = (float*) malloc(num_vertices * sizeof(float));
+    float* tri_scores = (float*) malloc(num_tris * sizeof(float));
+    uint8_t* emitted = (uint8_t*) calloc(num_tris, sizeof(uint8_t));
+    uint32_t* result = (uint32_t*) malloc(num_indices * sizeof(uint32_t));
+    if (!num_live || !adj_offsets || !adj_tris || !cache_pos || !vertex_scores || !tri_scores || !emitted || !result) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < num_indices; i++) {
+        assert(indices[i] < num_vertices);
+        num_live[indices[i]]++;
+    }
+    uint32_t offset = 0;
+    for (size_t v = 0; v < num_vertices; v++) {
+        adj_offsets[v] = offset;
+        offset += num_live[v];
+        num_live[v] = 0;
+    }
+    for (size_t t = 0; t < num_tris; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            const uint32_t v = indices[t * 3 + k];
+            adj_tris[adj_offsets[v] + num_live[v]++] = (uint32_t)t;
+        }
+    }
+    for (size_t v = 0; v < num_vertices; v++) {
+        cache_pos[v] = -1;
+        vertex_scores[v] = forsyth_vertex_score(-1, num_live[v]);
+    }
+    size_t best_tri = 0;
+    float best_score = -1.0f;
+    for (size_t t = 0; t < num_tris; t++) {
+        const uint32_t* tri = &indices[t * 3];
+        tri_scores[t] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+        if (tri_scores[t] > best_score) {
+            best_score = tri_scores[t];
+            best_tri = t;
+        }
+    }
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int cache_count = 0;
+    size_t next_unemitted = 0;
+    for (size_t num_emitted = 0; num_emitted < num_tris; num_emitted++) {
+        if (best_score < 0.0f) {
+            // no candidate around the cached vertices, continue with the next unemitted triangle
+            while (emitted[next_unemitted]) {
+                next_unemitted++;
+            }
+            best_tri = next_unemitted;
+        }
+        const uint32_t* tri = &indices[best_tri * 3];
+        memcpy(&result[num_emitted * 3], tri, 3 * sizeof(uint32_t));
+        emitted[best_tri] = 1;
+
+        // remove the triangle from its vertices' lists of live triangles
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = tri[k];
+            uint32_t* list = &adj_tris[adj_offsets[v]];
+            for (uint32_t i = 0; i < num_live[v]; i++) {
+                if (list[i] == best_tri) {
+                    list[i] = list[--num_live[v]];
+                    break;
+                }
+            }
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+        int new_count = 0;
+        for (int k = 0; k < 3; k++) {
+            if ((k == 0) || ((tri[k] != tri[0]) && ((k == 1) || (tri[k] != tri[1])))) {
+                new_cache[new_count++] = tri[k];
+            }
+        }
+        for (int i = 0; i < cache_count; i++) {
+            const uint32_t v = cache[i];
+            if ((v != tri[0]) && (v != tri[1]) && (v != tri[2])) {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        // update the vertex scores, including vertices which dropped out of the cache
+        for (int i = 0; i < new_count; i++) {
+            const uint32_t v = new_cache[i];
+            cache_pos[v] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+            vertex_scores[v] = forsyth_vertex_score(cache_pos[v], num_live[v]);
+        }
+
+        // ...update the scores of the affected triangles, and find the next best triangle
+        best_score = -1.0f;
+        for (int i = 0; i < new_count; i++) {
+            const uint32_t v = new_cache[i];
+            const uint32_t* list = &adj_tris[adj_offsets[v]];
+            for (uint32_t j = 0; j < num_live[v]; j++) {
+                const uint32_t t = list[j];
+                const uint32_t* adj_tri = &indices[t * 3];
+                tri_scores[t] = vertex_scores[adj_tri[0]] + vertex_scores[adj_tri[1]] + vertex_scores[adj_tri[2]];
+                if (tri_scores[t] > best_score) {
+                    best_score = tri_scores[t];
+                    best_tri = t;
+                }
+            }
+        }
+        cache_count = (new_count < FORSYTH_CACHE_SIZE) ? new_count : FORSYTH_CACHE_SIZE;
+        memcpy(cache, new_cache, (size_t)cache_count * sizeof(uint32_t));
+    }
+    memcpy(indices, result, num_indices * sizeof(uint32_t));
+
+done:
+    free(result);
+    free(emitted);
+    free(tri_scores);
+    free(vertex_scores);
+    free(cache_pos);
+    free(adj_tris);
+    free(adj_offsets);
+    free(num_live);
+}
+
+// a FIFO cache simulation with timestamps, a vertex is in the cache if it
+// has been inserted within the last cache_size insertions
+typedef struct {
+    uint32_t* stamps;
+    uint32_t time;
+    uint32_t cache_size;
+} fifo_cache_t;
+
+static void fifo_cache_init(fifo_cache_t* cache, size_t num_vertices, int cache_size) {
+    cache->stamps = (uint32_t*) calloc(num_vertices, sizeof(uint32_t));
+    cache->cache_size = (uint32_t)cache_size;
+    cache->time = cache->cache_size + 1;
+}
+
+static void fifo_cache_reset(fifo_cache_t* cache) {
+    // move the time forward so that all cached vertices expire
+    cache->time += cache->cache_size + 1;
+}
+
+// returns 1 for a cache miss, 0 for a hit
+static int fifo_cache_access(fifo_cache_t* cache, uint32_t v) {
+    if ((cache->time - cache->stamps[v]) > cache->cache_size) {
+        cache->stamps[v] = cache->time++;
+        return 1;
+    }
+    return 0;
+}
+
+static int fifo_cache_access_tri(fifo_cache_t* cache, const uint32_t* tri) {
+    return fifo_cache_access(cache, tri[0]) + fifo_cache_access(cache, tri[1]) + fifo_cache_access(cache, tri[2]);
+}
+
+float meshopt_acmr(const uint32_t* indices, size_t num_indices, size_t num_vertices, int cache_size) {
+    assert(indices && ((num_indices % 3) == 0) && (cache_size > 0));
+    const size_t num_tris = num_indices / 3;
+    if (num_tris == 0) {
+        return 0.0f;
+    }
+    fifo_cache_t cache;
+    fifo_cache_init(&cache, num_vertices, cache_size);
+    if (!cache.stamps) {
+        return 0.0f;
+    }
+    size_t num_misses = 0;
+    for (size_t t = 0; t < num_tris; t++) {
+        num_misses += (size_t)fifo_cache_access_tri(&cache, &indices[t * 3]);
+    }
+    free(cache.stamps);
+    return (float)num_misses / (float)num_tris;
+}
+
+typedef struct {
+    uint32_t first_tri;
+    uint32_t num_tris;
+    float sort_key;
+} overdraw_cluster_t;
+
+static int overdraw_cluster_cmp(const void* a, const void* b) {
+    const float ka = ((const overdraw_cluster_t*)a)->sort_key;
+    const float kb = ((const overdraw_cluster_t*)b)->sort_key;
+    return (ka > kb) ? -1 : ((ka < kb) ? 1 : 0);
+}
+
+static const float* position_at(const float* positions, size_t stride, uint32_t v) {
+    return (const float*)((const uint8_t*)positions + v * stride);
+}
+
+void meshopt_optimize_overdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t num_vertices, size_t position_stride, float threshold) {
+    assert(indices && ((num_indices % 3) == 0) && positions);
+    const size_t num_tris = num_indices / 3;
+    if (num_tris < 2) {
+        return;
+    }
+    overdraw_cluster_t* clusters = (overdraw_cluster_t*) malloc(num_tris * sizeof(overdraw_cluster_t));
+    uint32_t* result = (uint32_t*) malloc(num_indices * sizeof(uint32_t));
+    fifo_cache_t cache;
+    fifo_cache_init(&cache, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+    if (!clusters || !result || !cache.stamps) {
+        free(cache.stamps);
+        free(result);
+        free(clusters);
+        return;
+    }
+    size_t num_clusters = 0;
+
+    // hard boundaries are where the cache was flushed anyway (all 3 vertices of a
+    // triangle are misses), within a hard cluster, soft boundaries are inserted where
+    // the cluster's ACMR is still within threshold, restarting a cluster there costs
+    // at most that much vertex cache efficiency
+    size_t hard_start = 0;
+    for (size_t t = 0; t <= num_tris; t++) {
+        const bool at_end = (t == num_tris);
+        if (!at_end && ((fifo_cache_access_tri(&cache, &indices[t * 3]) < 3) || (t == hard_start))) {
+            continue;
+        }
+        // the hard cluster [hard_start, t), compute its ACMR with a cold cache
+        fifo_cache_reset(&cache);
+        size_t misses = 0;
+        for (size_t i = hard_start; i < t; i++) {
+            misses += (size_t)fifo_cache_access_tri(&cache, &indices[i * 3]);
+        }
+        const float cluster_acmr = (float)misses / (float)(t - hard_start);
+
+        // split into soft clusters
+        fifo_cache_reset(&cache);
+        size_t soft_start = hard_start;
+        size_t soft_misses = 0;
+        for (size_t i = hard_start; i < t; i++) {
+            soft_misses += (size_t)fifo_cache_access_tri(&cache, &indices[i * 3]);
+            const float soft_acmr = (float)soft_misses / (float)(i + 1 - soft_start);
+            if ((i + 1) == t) {
+                // a tail that doesn't reach the threshold on its own stays with the previous soft cluster
+                if ((soft_acmr > (cluster_acmr * threshold)) && (soft_start > hard_start)) {
+                    clusters[num_clusters - 1].num_tris += (uint32_t)(i + 1 - soft_start);
+                    break;
+                }
+            }
+            if ((soft_acmr <= (cluster_acmr * threshold)) || ((i + 1) == t)) {
+                clusters[num_clusters].first_tri = (uint32_t)soft_start;
+                clusters[num_clusters].num_tris = (uint32_t)(i + 1 - soft_start);
+                num_clusters++;
+                soft_start = i + 1;
+                soft_misses = 0;
+                fifo_cache_reset(&cache);
+            }
+        }
+        // the triangle at t starts the next hard cluster, and has just been
+        // evaluated against a warm cache, re-insert its vertices
+        fifo_cache_reset(&cache);
+        if (!at_end) {
+            fifo_cache_access_tri(&cache, &indices[t * 3]);
+        }
+        hard_start = t;
+    }
+    free(cache.stamps);
+
+    // area-weighted mesh centroid
+    float mesh_center[3] = { 0.0f, 0.0f, 0.0f };
+    float mesh_area = 0.0f;
+    for (size_t t = 0; t < num_tris; t++) {
+        const float* p0 = position_at(positions, position_stride, indices[t * 3 + 0]);
+        const float* p1 = position_at(positions, position_stride, indices[t * 3 + 1]);
+        const float* p2 = position_at(positions, position_stride, indices[t * 3 + 2]);
+        const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        const float n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+        const float area = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        for (int c = 0; c < 3; c++) {
+            mesh_center[c] += area * (p0[c] + p1[c] + p2[c]) / 3.0f;
+        }
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0f) {
+        for (int c = 0; c < 3; c++) {
+            mesh_center[c] /= mesh_area;
+        }
+    }
+
+    // clusters which face away from the mesh center are likely to occlude others, draw them first
+    for (size_t ci = 0; ci < num_clusters; ci++) {
+        overdraw_cluster_t* cluster = &clusters[ci];
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area_sum = 0.0f;
+        for (uint32_t t = cluster->first_tri; t < (cluster->first_tri + cluster->num_tris); t++) {
+            const float* p0 = position_at(positions, position_stride, indices[t * 3 + 0]);
+            const float* p1 = position_at(positions, position_stride, indices[t * 3 + 1]);
+            const float* p2 = position_at(positions, position_stride, indices[t * 3 + 2]);
+            const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+            const float area = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            for (int c = 0; c < 3; c++) {
+                center[c] += area * (p0[c] + p1[c] + p2[c]) / 3.0f;
+                normal[c] += n[c];
+            }
+            area_sum += area;
+        }
+        float key = 0.0f;
+        const float normal_len = sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+        if ((area_sum > 0.0f) && (normal_len > 0.0f)) {
+            for (int c = 0; c < 3; c++) {
+                key += (center[c] / area_sum - mesh_center[c]) * (normal[c] / normal_len);
+            }
+        }
+        cluster->sort_key = key;
+    }
+    qsort(clusters, num_clusters, sizeof(overdraw_cluster_t), overdraw_cluster_cmp);
+
+    size_t dst = 0;
+    for (size_t ci = 0; ci < num_clusters; ci++) {
+        const size_t num = (size_t)clusters[ci].num_tris * 3;
+        memcpy(&result[dst], &indices[clusters[ci].first_tri * 3], num * sizeof(uint32_t));
+        dst += num;
+    }
+    assert(dst == num_indices);
+    memcpy(indices, result, num_indices * sizeof(uint32_t));
+    free(result);
+    free(clusters);
+}
+
+size_t meshopt_optimize_vertex_fetch(void* vertices, size_t num_vertices, size_t vertex_size, uint32_t* indices, size_t num_indices) {
+    assert(vertices && indices && (vertex_size > 0));
+    uint32_t* remap = (uint32_t*) malloc(num_vertices * sizeof(uint32_t));
+    uint8_t* src = (uint8_t*) malloc(num_vertices * vertex_size);
+    if (!remap || !src) {
+        free(src);
+        free(remap);
+        return num_vertices;
+    }
+    memset(remap, 0xFF, num_vertices * sizeof(uint32_t));
+    uint32_t next = 0;
+    for (size_t i = 0; i < num_indices; i++) {
+        const uint32_t v = indices[i];
+        assert(v < num_vertices);
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = next++;
+        }
+        indices[i] = remap[v];
+    }
+    const size_t num_used = next;
+    for (size_t v = 0; v < num_vertices; v++) {
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = next++;
+        }
+    }
+    memcpy(src, vertices, num_vertices * vertex_size);
+    for (size_t v = 0; v < num_vertices; v++) {
+        memcpy((uint8_t*)vertices + remap[v] * vertex_size, src + v * vertex_size, vertex_size);
+    }
+    free(src);
+    free(remap);
+    return num_used;
+}
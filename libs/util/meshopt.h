@@ -0,0 +1,44 @@
+#pragma once
+/*
+    Mesh optimization helpers for indexed triangle lists:
+
+    - meshopt_optimize_vertex_cache(): reorders triangles for the post-transform
+      vertex cache (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+    - meshopt_optimize_overdraw(): splits the cache-optimized triangle order into
+      clusters and sorts the clusters front-to-back from the outside (Sander,
+      Nehab, Barczak: "Fast Triangle Reordering for Vertex Locality and Reduced
+      Overdraw"), trading a little vertex cache efficiency for less overdraw
+    - meshopt_optimize_vertex_fetch(): reorders vertices in the order they are
+      first referenced by the index buffer, for better vertex fetch locality
+    - meshopt_acmr(): computes the average cache miss ratio (number of vertex
+      shader invocations per triangle) with a simulated FIFO cache
+
+    The typical order is vertex cache, then overdraw, then vertex fetch.
+    All functions work on 32-bit indices and allocate temporary memory
+    with malloc(), if the allocation fails the data is left unchanged
+    (and meshopt_acmr() returns 0).
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// the cache size for meshopt_acmr() which matches common GPUs reasonably well
+#define MESHOPT_DEFAULT_CACHE_SIZE (16)
+
+// reorder triangles in place for vertex cache locality
+void meshopt_optimize_vertex_cache(uint32_t* indices, size_t num_indices, size_t num_vertices);
+// reorder triangles in place to reduce overdraw, expects cache-optimized indices, threshold is the
+// allowed ACMR degradation (e.g. 1.05 allows 5% more vertex shader invocations), positions are float3
+void meshopt_optimize_overdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t num_vertices, size_t position_stride, float threshold);
+// reorder vertices and remap indices in place, returns the number of referenced vertices (unreferenced vertices are moved to the end),
+// or num_vertices if nothing was reordered
+size_t meshopt_optimize_vertex_fetch(void* vertices, size_t num_vertices, size_t vertex_size, uint32_t* indices, size_t num_indices);
+// compute the average cache miss ratio (0.5 is the ideal for a regular grid, 3.0 the worst case)
+float meshopt_acmr(const uint32_t* indices, size_t num_indices, size_t num_vertices, int cache_size);
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
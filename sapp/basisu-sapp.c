@@ -14,11 +14,18 @@
 //  ETC1S. The regions fit into 4x4 bounds, with flat areas having only two
 //  colours (and gradients designed to work across the endpoints in a block).
 //  @PVBroadz created it when we were experimenting with BasisU."
+//
+//  The transcoded textures can be cached on disk, so that only the first
+//  start needs to transcode them, by passing a cache directory on the
+//  command line (delete the directory for a cold start):
+//
+//  > basisu-sapp cache=basisu-cache
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
 #define SOKOL_GL_IMPL
 #include "sokol_gl.h"
 #define SOKOL_DEBUGTEXT_IMPL
@@ -26,14 +33,21 @@
 #include "dbgui/dbgui.h"
 #include "data/basisu-assets.h"
 #include "basisu/sokol_basisu.h"
+#include "basisu/basisu_stream.h"
+#include <string.h>
+
+// optional directory for the transcoded textures (see the cache= command line arg)
+static const char* cache_dir;
 
 static struct {
     sg_pass_action pass_action;
     sgl_pipeline alpha_pip;
-    sg_image opaque_img;
-    sg_image alpha_img;
+    sbasisu_stream_texture_t* opaque_tex;
+    sbasisu_stream_texture_t* alpha_tex;
     sg_sampler smp;
     double angle_deg;
+    uint64_t start_time;
+    double startup_ms;      // until both textures have all their mips, 0 before
 } state = {
     .pass_action = {
         .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.25f, 0.25f, 1.0f, 1.0f }}
@@ -67,12 +81,24 @@ void init(void) {
         .logger.func = slog_func
     });
 
-    // setup Basis Universal via our own minimal wrapper code
-    sbasisu_setup();
+    // setup Basis Universal via our own minimal wrapper code, the transcoded
+    // textures are only cached with a cache directory on the command line
+    sbasisu_setup(&(sbasisu_desc_t){
+        .cache_dir = cache_dir,
+    });
 
-    // create sokol-gfx textures from the embedded Basis Universal textures
-    state.opaque_img = sbasisu_make_image(SG_RANGE(embed_testcard_basis));
-    state.alpha_img  = sbasisu_make_image(SG_RANGE(embed_testcard_rgba_basis));
+    // create streamed sokol-gfx textures from the embedded Basis Universal textures,
+    // they start with their 16x16 mips, and the higher-resolution mips are transcoded
+    // in the background and swapped in over the next frames (the small frame budget
+    // makes that visible), textures from the cache are complete right away
+    sbasisu_stream_setup(&(sbasisu_stream_desc_t){
+        .frame_budget_ms = 0.1,
+        .initial_size = 16,
+    });
+    stm_setup();
+    state.start_time = stm_now();
+    state.opaque_tex = sbasisu_stream_create(SG_RANGE(embed_testcard_basis));
+    state.alpha_tex  = sbasisu_stream_create(SG_RANGE(embed_testcard_rgba_basis));
 
     // create a sampler object
     state.smp = sg_make_sampler(&(sg_sampler_desc){
@@ -99,12 +125,13 @@ typedef struct {
     struct { float x; float y; } pos;
     struct { float x; float y; } scale;
     float rot;
-    sg_image img;
+    sbasisu_stream_texture_t* tex;
     sgl_pipeline pip;
 } quad_params_t;
 
 static void draw_quad(quad_params_t params) {
-    sgl_texture(params.img, state.smp);
+    sbasisu_stream_use(params.tex);
+    sgl_texture(sbasisu_stream_image(params.tex), state.smp);
     if (params.pip.id) {
         sgl_load_pipeline(params.pip);
     }
@@ -129,7 +156,18 @@ void frame(void) {
     sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
     sdtx_origin(0.5f, 2.0f);
     sdtx_printf("Opaque format: %s\n\n", pixelformat_to_str(sbasisu_pixelformat(false)));
-    sdtx_printf("Alpha format: %s", pixelformat_to_str(sbasisu_pixelformat(true)));
+    sdtx_printf("Alpha format: %s\n\n", pixelformat_to_str(sbasisu_pixelformat(true)));
+    const sbasisu_stream_stats_t stream_stats = sbasisu_stream_stats();
+    if (state.startup_ms > 0.0) {
+        sdtx_printf("Textures: %.2f ms (full resolution)\n\n", state.startup_ms);
+    }
+    else {
+        sdtx_printf("Textures: loading...\n\n");
+    }
+    sdtx_printf("Mip levels: %d/%d\n\n", sbasisu_stream_first_level(state.opaque_tex), sbasisu_stream_first_level(state.alpha_tex));
+    sdtx_printf("Resident: %d KB\n\n", (int)(stream_stats.resident_bytes / 1024));
+    sdtx_printf("Pending: %d (%d KB), transcoding: %d\n\n", stream_stats.num_pending, (int)(stream_stats.pending_bytes / 1024), stream_stats.num_transcoding);
+    sdtx_printf("Cached: %d", sbasisu_stats().num_cache_hits);
 
     // draw some textured quads via sokol-gl
     sgl_defaults();
@@ -143,13 +181,13 @@ void frame(void) {
         .pos = { -0.425f, 0.0f },
         .scale = { 0.4f, 0.4f },
         .rot = sgl_rad((float)state.angle_deg),
-        .img = state.opaque_img,
+        .tex = state.opaque_tex,
     });
     draw_quad((quad_params_t){
         .pos = { +0.425f, 0.0f },
         .scale = { 0.4f, 0.4f },
         .rot = -sgl_rad((float)state.angle_deg),
-        .img = state.alpha_img,
+        .tex = state.alpha_tex,
         .pip = state.alpha_pip,
     });
 
@@ -160,9 +198,20 @@ void frame(void) {
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
+
+    // swap in the transcoded higher-resolution mips, and start transcoding the next ones
+    sbasisu_dowork();
+    sbasisu_stream_update();
+    if ((state.startup_ms == 0.0) &&
+        (sbasisu_stream_first_level(state.opaque_tex) == 0) &&
+        (sbasisu_stream_first_level(state.alpha_tex) == 0))
+    {
+        state.startup_ms = stm_ms(stm_since(state.start_time));
+    }
 }
 
 void cleanup(void) {
+    sbasisu_stream_shutdown();
     sbasisu_shutdown();
     sgl_shutdown();
     sdtx_shutdown();
@@ -171,7 +220,11 @@ void cleanup(void) {
 }
 
 sapp_desc sokol_main(int argc, char* argv[]) {
-    (void)argc; (void)argv;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "cache=", 6)) {
+            cache_dir = argv[i] + 6;
+        }
+    }
     return (sapp_desc){
         .init_cb = init,
         .frame_cb = frame,
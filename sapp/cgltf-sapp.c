@@ -2,7 +2,24 @@
 //  cgltf-sapp.c
 //
 //  A simple(!) GLTF viewer, cgltf + basisu + sokol_app.h + sokol_gfx.h + sokol_fetch.h.
-//  Doesn't support all GLTF features.
+//  Doesn't support all GLTF features. Loads .gltf files with external or
+//  base64 data URI resources, and binary .glb files. Skinned meshes play
+//  the first animation through ozz-animation (see libs/ozzutil/ozzgltf.h).
+//  The GLTF file can be passed on the command line, its resources are
+//  loaded relative to it. The transcoded Basis Universal textures are
+//  cached on disk with a cache directory on the command line:
+//
+//  > cgltf-sapp DamagedHelmet.gltf cache=basisu-cache
+//
+//  The cgltf-sapp-bench build (CGLTF_BENCH) prints the load and render
+//  timing to stdout after BENCH_NUM_FRAMES frames and quits, e.g. with a
+//  scene from libs/util/gltf-stress-gen.c:
+//
+//  > cgltf-sapp-bench stress.gltf
+//
+//  Index data is rendered as is, GLTF files should be optimized offline. With
+//  CGLTF_MESHOPT defined the triangles are reordered for the vertex cache
+//  (util/meshopt.h) while loading, and the ACMR is shown in the stats.
 //
 //  https://github.com/jkuhlmann/cgltf
 //------------------------------------------------------------------------------
@@ -14,12 +31,15 @@
 #include "sokol_audio.h"
 #include "sokol_fetch.h"
 #include "sokol_log.h"
+#include "sokol_time.h"
 #define SOKOL_DEBUGTEXT_IMPL
 #include "sokol_debugtext.h"
 #include "sokol_glue.h"
 #include "dbgui/dbgui.h"
 #include "cgltf-sapp.glsl.h"
 #include "basisu/sokol_basisu.h"
+#include "ozzutil/ozzutil.h"
+#include "ozzutil/ozzgltf.h"
 #define CGLTF_IMPLEMENTATION
 #define _CRT_SECURE_NO_WARNINGS
 #if defined(__GNUC__) || defined(__clang__)
@@ -28,30 +48,44 @@
 #include "cgltf/cgltf.h"
 #include "util/camera.h"
 #include "util/fileutil.h"
+#include "util/meshopt.h"
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic ignored "-Wmissing-braces"
 #endif
 
 static const char* filename = "DamagedHelmet.gltf";
+// optional directory for the transcoded textures (see the cache= command line arg)
+static const char* cache_dir;
 
 #define SCENE_INVALID_INDEX (-1)
-#define SCENE_MAX_BUFFERS (16)
-#define SCENE_MAX_IMAGES (16)
-#define SCENE_MAX_MATERIALS (16)
-#define SCENE_MAX_PIPELINES (16)
-#define SCENE_MAX_PRIMITIVES (16)   // aka submesh
-#define SCENE_MAX_MESHES (16)
-#define SCENE_MAX_NODES (16)
-
-// statically allocated buffers for file downloads
+
+// the load-time index optimization is opt-in, it costs load time on every run
+#if defined(CGLTF_MESHOPT)
+#define OPTIMIZE_INDICES (true)
+#else
+#define OPTIMIZE_INDICES (false)
+#endif
+
+// number of frames which are timed by cgltf-sapp-bench once everything is loaded
+#define BENCH_NUM_FRAMES (300)
+
+// files are loaded in chunks directly into their heap-allocated destination
+// buffers, so there is no upper limit on the file size
 #define SFETCH_NUM_CHANNELS (1)
 #define SFETCH_NUM_LANES (4)
-#define MAX_FILE_SIZE (1024*1024)
-uint8_t sfetch_buffers[SFETCH_NUM_CHANNELS][SFETCH_NUM_LANES][MAX_FILE_SIZE];
+#define SFETCH_CHUNK_SIZE (256 * 1024)
 
-// per-material texture indices into scene.images for metallic material
+// the ozz-animation joint texture has one row per skinned node and 3 texels per joint
+#define SKIN_MAX_JOINTS (128)
+#define SKIN_MAX_INSTANCES (256)
+
+// per-material texture indices into scene.images for metallic material,
+// or SCENE_INVALID_INDEX for textures which are rendered with a placeholder
 typedef struct {
     int base_color;
     int metallic_roughness;
@@ -60,7 +94,8 @@ typedef struct {
     int emissive;
 } metallic_images_t;
 
-// per-material texture indices into scene.images for specular material
+// per-material texture indices into scene.images for specular material,
+// or SCENE_INVALID_INDEX for textures which are rendered with a placeholder
 typedef struct {
     int diffuse;
     int specular_glossiness;
@@ -100,48 +135,98 @@ typedef struct {
 
 // a 'primitive' (aka submesh) contains everything needed to issue a draw call
 typedef struct {
-    int pipeline;           // index into scene.pipelines array
+    int pipeline;           // index into pip_cache.items
+    int instanced_pipeline; // index into pip_cache.items, or SCENE_INVALID_INDEX if no free vertex buffer slot
     int material;           // index into scene.materials array
     vertex_buffer_mapping_t vertex_buffers; // indices into bufferview array by vbuf bind slot
     int index_buffer;       // index into bufferview array for index buffer, or SCENE_INVALID_INDEX
     int base_element;       // index of first index or vertex to draw
     int num_elements;       // number of vertices or indices to draw
+    bool skinned;           // drawn with the skinned pipeline by skinned nodes, never instanced
+    bool ready;             // true once all buffers and textures have been created
 } primitive_t;
 
 // a mesh is just a group of primitives (aka submeshes)
 typedef struct {
     int first_primitive;    // index into scene.primitives
     int num_primitives;
+    int first_instance;     // index into scene.instance_nodes
+    int num_instances;      // number of nodes using this mesh
 } mesh_t;
 
-// a node associates a transform with an mesh,
-// currently, the transform matrices are 'baked' upfront into world space
+// a node associates a node of the transform hierarchy with a mesh
 typedef struct {
     int mesh;           // index into scene.meshes
-    hmm_mat4 transform;
+    int hierarchy_node; // index into scene.hierarchy
+    int skin;           // index into scene.skins, or SCENE_INVALID_INDEX
+    ozz_instance_t* ozz;    // the skinned node's animation state, null until its skin has been imported
 } node_t;
 
+// the flattened transform hierarchy of all GLTF nodes, sorted so that parents
+// come before their children, with the local transforms as structure-of-arrays
+typedef struct {
+    int num_nodes;
+    int first_dirty;                // lowest index of a node with a changed local transform, or num_nodes
+    int num_updated;                // number of world transforms updated by the last update_world_transforms()
+    int* parents;                   // index into the hierarchy, or SCENE_INVALID_INDEX for root nodes
+    bool* dirty;
+    bool* has_matrix;               // the local transform is a matrix instead of TRS
+    hmm_vec3* translations;
+    hmm_quaternion* rotations;
+    hmm_vec3* scales;
+    hmm_mat4* local_transforms;
+    hmm_mat4* world_transforms;
+} hierarchy_t;
+
+// a GLTF skin with the animation channels targeting its joints, converted into
+// a shared ozz-animation asset as soon as all of its data has been loaded
+typedef struct {
+    int first_joint;            // index into creation_params.joints
+    int num_joints;
+    int first_channel;          // index into creation_params.channels
+    int num_channels;
+    const float* inverse_bind_matrices; // in creation_params.skin_data, or null
+    int num_pending_ranges;     // number of data ranges which haven't been copied yet
+    int skeleton_node;          // hierarchy node which places the skeleton, or SCENE_INVALID_INDEX
+    ozz_asset_t* asset;         // null until imported
+} skin_t;
+
 typedef struct {
     sg_image img;
     sg_sampler smp;
 } image_sampler_t;
 
-// the complete scene
+// a linear allocator, all per-scene arrays are carved out of a single
+// allocation which is sized after parsing and freed in one go on unload
+typedef struct {
+    uint8_t* buf;       // null while measuring the required size
+    size_t size;
+    size_t offset;
+} arena_t;
+
+// the complete scene, the arrays live in the scene's arena
 typedef struct {
+    arena_t arena;
     int num_buffers;
     int num_images;
-    int num_pipelines;
     int num_materials;
     int num_primitives; // aka 'submeshes'
     int num_meshes;
     int num_nodes;
-    sg_buffer buffers[SCENE_MAX_BUFFERS];
-    image_sampler_t image_samplers[SCENE_MAX_IMAGES];
-    sg_pipeline pipelines[SCENE_MAX_PIPELINES];
-    material_t materials[SCENE_MAX_MATERIALS];
-    primitive_t primitives[SCENE_MAX_PRIMITIVES];
-    mesh_t meshes[SCENE_MAX_MESHES];
-    node_t nodes[SCENE_MAX_NODES];
+    int num_skins;
+    int num_skin_instances;
+    int max_draw_items;
+    sg_buffer* buffers;
+    image_sampler_t* image_samplers;
+    material_t* materials;
+    primitive_t* primitives;
+    mesh_t* meshes;
+    node_t* nodes;
+    hierarchy_t hierarchy;
+    skin_t* skins;
+    ozz_instance_t** skin_instances;    // of all skinned nodes, by joint texture row
+    int* instance_nodes;        // node indices grouped by mesh
+    sg_buffer instance_buffer;  // per-instance model matrices in instance_nodes order
 } scene_t;
 
 // resource creation helper params, these are stored until the
@@ -151,8 +236,44 @@ typedef struct {
     int offset;
     int size;
     int gltf_buffer_index;
+    int first_index_optimization;   // index into creation_params.primitives, or SCENE_INVALID_INDEX
+    bool created;
 } buffer_creation_params_t;
 
+// params to reorder the indices of a triangle-list primitive in place
+// for the vertex cache and against overdraw before the index buffer is created
+typedef struct {
+    bool valid;
+    int next;               // next index optimization of the same buffer view, or SCENE_INVALID_INDEX
+    int index_buffer;       // index into bufferview array
+    int index_offset;       // byte offset of first index in the GLTF buffer
+    int num_indices;
+    bool index_32bit;
+    int num_vertices;
+    int position_gltf_buffer_index;
+    int position_offset;    // byte offset of first position in the GLTF buffer
+    int position_stride;
+} index_optimization_params_t;
+
+// where the data of a GLTF image comes from when it's embedded in a GLTF buffer
+typedef struct {
+    int gltf_buffer_index;  // SCENE_INVALID_INDEX if the image has its own file or data URI
+    int offset;             // byte offset of the image data in the GLTF buffer
+    int size;
+    bool created;
+} embedded_image_params_t;
+
+// a range of skin data (inverse bind matrices, keyframe times or values) in a GLTF
+// buffer, which is copied into the skin data staging buffer once it has been loaded
+typedef struct {
+    int gltf_buffer_index;
+    int offset;             // byte offset in the GLTF buffer
+    int size;
+    int staging_offset;     // byte offset in creation_params.skin_data
+    int skin;               // index into scene.skins
+    bool copied;
+} skin_range_params_t;
+
 typedef struct {
     sg_filter min_filter;
     sg_filter mag_filter;
@@ -162,14 +283,54 @@ typedef struct {
     int gltf_image_index;
 } image_sampler_creation_params_t;
 
-// pipeline cache helper struct to avoid duplicate pipeline-state-objects
+// pipeline cache helper structs to avoid duplicate pipeline-state-objects,
+// the cache lives outside the scene so that pipelines are shared across scenes
 typedef struct {
     sg_vertex_layout_state layout;
     sg_primitive_type prim_type;
     sg_index_type index_type;
     bool alpha;
+    bool metallic;
+    bool instanced;
+    bool skinned;
 } pipeline_cache_params_t;
 
+typedef struct {
+    uint64_t hash;
+    pipeline_cache_params_t params;
+    sg_pipeline pip;
+} pipeline_cache_item_t;
+
+// a render queue item, the sort key groups draws by render state
+typedef struct {
+    uint64_t key;
+    int node;           // index into scene.nodes, or SCENE_INVALID_INDEX for instanced draws
+    int primitive;      // index into scene.primitives
+    int first_instance; // index into scene.instance_nodes for instanced draws
+    int num_instances;
+} draw_item_t;
+
+// an async-loaded file, the chunks are fetched directly into the data buffer,
+// which is freed as soon as the resources have been created from it
+typedef struct {
+    char name[32];
+    uint8_t* data;
+    size_t size;            // number of bytes loaded so far
+    size_t capacity;
+    double start_ms;        // load timing in milliseconds since the GLTF file was requested
+    double first_chunk_ms;
+    double finished_ms;
+} resource_t;
+
+// per-frame counters of the actually applied render state
+typedef struct {
+    int num_draws;
+    int num_instances;
+    int num_apply_pipeline;
+    int num_apply_bindings;
+    int num_apply_uniforms;
+} frame_stats_t;
+
 // the top-level application state struct
 static struct {
     bool failed;
@@ -179,6 +340,8 @@ static struct {
     } pass_actions;
     struct {
         sg_shader metallic;
+        sg_shader metallic_instanced;
+        sg_shader metallic_skinned;
         sg_shader specular;
     } shaders;
     sg_sampler smp;
@@ -188,12 +351,65 @@ static struct {
     hmm_mat4 root_transform;
     float rx, ry;
     struct {
-        buffer_creation_params_t buffers[SCENE_MAX_BUFFERS];
-        image_sampler_creation_params_t images[SCENE_MAX_IMAGES];
+        buffer_creation_params_t* buffers;
+        image_sampler_creation_params_t* images;
+        index_optimization_params_t* primitives;
+        embedded_image_params_t* embedded_images;  // per GLTF image
+        ozz_gltf_joint_t* joints;           // of all skins
+        ozz_gltf_channel_t* channels;       // of all skins, the keys point into skin_data
+        skin_range_params_t* skin_ranges;
+        int num_skin_ranges;
+        uint8_t* skin_data;     // staging buffer, freed once all skins have been imported
+        int num_pending_skins;
     } creation_params;
     struct {
-        pipeline_cache_params_t items[SCENE_MAX_PIPELINES];
+        int num_triangles;
+        float misses_before;    // simulated vertex cache misses before/after index optimization
+        float misses_after;
+    } meshopt;
+    struct {
+        int num_items;
+        int max_items;
+        pipeline_cache_item_t* items;   // append-only, primitives keep indices into this
+        int num_slots;                  // power of 2
+        int* slots;                     // open-addressing hash table of item index + 1, 0 if empty
     } pip_cache;
+    struct {
+        int num_items;
+        draw_item_t* items;
+    } render_queue;
+    hmm_mat4* instance_transforms;
+    double anim_time;       // animation time of the skinned nodes in seconds
+    struct {
+        bool enabled;       // toggled with the N key, spins one node with its subtree
+        bool running;       // a node has been picked and is animated
+        int node;           // index into scene.hierarchy
+        hmm_quaternion rotation;    // the node's original rotation
+        float angle;
+    } node_anim;
+    frame_stats_t frame_stats;
+    struct {
+        double parse_ms;        // parsing the GLTF file and building the scene
+        double render_ms;       // building and issuing the render queue
+    } timing;
+    struct {
+        int num_frames;         // timed frames since everything has loaded
+        double render_ms;       // sum of timing.render_ms
+        double max_render_ms;
+        double frame_ms;        // sum of the frame durations
+        bool done;
+    } bench;
+    struct {
+        uint64_t start_time;
+        int num_pending;        // number of resources which haven't finished loading
+        resource_t file;        // the GLTF file itself
+        int num_buffers;
+        int num_images;
+        resource_t* buffers;    // per GLTF buffer, in the scene arena
+        resource_t* images;     // per GLTF image, in the scene arena
+        double first_draw_ms;   // when the first primitive was drawn
+        double all_loaded_ms;   // when the last resource has finished loading
+    } loader;
     struct {
         sg_image white;
         sg_image normal;
@@ -202,25 +418,56 @@ static struct {
     } placeholders;
 } state;
 
-static void gltf_parse(sfetch_range_t file_data);
+static void scene_alloc(const cgltf_data* gltf);
+static void scene_unload(void);
+static void pip_cache_shutdown(void);
+static void gltf_parse(uint8_t* file_data, size_t file_size);
 static void gltf_parse_buffers(const cgltf_data* gltf);
 static void gltf_parse_images(const cgltf_data* gltf);
 static void gltf_parse_materials(const cgltf_data* gltf);
 static void gltf_parse_meshes(const cgltf_data* gltf);
 static void gltf_parse_nodes(const cgltf_data* gltf);
+static bool gltf_uri_is_embedded(const char* uri);
+static const char* gltf_resource_path(const char* uri, char* buf, size_t buf_size);
+static void gltf_load_embedded_data(const cgltf_data* gltf, uint8_t* file_data, size_t file_size);
 
 static void gltf_fetch_callback(const sfetch_response_t*);
 static void gltf_buffer_fetch_callback(const sfetch_response_t*);
 static void gltf_image_fetch_callback(const sfetch_response_t*);
 
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data);
+static void resource_start(resource_t* res, const char* uri);
+static bool resource_fetch_response(resource_t* res, const sfetch_response_t* response);
+static void resource_reserve(resource_t* res, size_t size);
+static void resource_bind_next_chunk(resource_t* res, const sfetch_response_t* response);
+static void resource_finish(resource_t* res);
+
+static bool index_optimization_ready(int buffer_view_index, size_t loaded_size);
+static void optimize_indices_for_buffer_view(int buffer_view_index, uint8_t* data);
+static bool create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, uint8_t* data, size_t loaded_size);
+static bool create_sg_image_samplers_for_gltf_buffer(int gltf_buffer_index, const uint8_t* data, size_t loaded_size);
 static void create_sg_image_samplers_for_gltf_image(int gltf_image_index, sg_range data);
+static void gltf_image_transcode_callback(const sbasisu_response_t* response);
 static vertex_buffer_mapping_t create_vertex_buffer_mapping_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim);
-static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map);
-static hmm_mat4 build_transform_for_gltf_node(const cgltf_data* gltf, const cgltf_node* node);
-
+static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map, bool instanced, bool skinned);
+static void gltf_parse_hierarchy(const cgltf_data* gltf, int* hierarchy_index_map);
+static void gltf_parse_skins(const cgltf_data* gltf, const int* hierarchy_index_map);
+static bool copy_skin_data_for_gltf_buffer(int gltf_buffer_index, const uint8_t* data, size_t loaded_size);
+static void create_ozz_asset_for_skin(int skin_index);
+
+static void hierarchy_set_trs(int node_index, hmm_vec3 translation, hmm_quaternion rotation, hmm_vec3 scale);
+static void update_world_transforms(void);
+static void update_node_anim(void);
 static void update_scene(void);
+static void update_skins(void);
+#if defined(CGLTF_BENCH)
+static void bench_frame(void);
+#endif
 static vs_params_t vs_params_for_node(int node_index);
+static vs_skin_params_t vs_skin_params_for_node(int node_index, const pipeline_cache_params_t* pip_params);
+static void update_instance_buffer(void);
+static bool primitive_ready(primitive_t* prim);
+static void build_render_queue(void);
+static void draw_render_queue(void);
 
 // sokol-app init callback, called once at startup
 static void init(void) {
@@ -239,8 +486,21 @@ static void init(void) {
         .distance = 3.0f
     });
 
-    // initialize Basis Universal
-    sbasisu_setup();
+    // initialize Basis Universal, the textures are transcoded on worker threads,
+    // and only cached on disk with a cache directory on the command line
+    sbasisu_setup(&(sbasisu_desc_t){
+        .cache_dir = cache_dir,
+    });
+
+    // setup ozz-animation for the skinned meshes, each skinned node gets one
+    // row in the joint texture
+    ozz_setup(&(ozz_desc_t){
+        .max_palette_joints = SKIN_MAX_JOINTS,
+        .max_instances = SKIN_MAX_INSTANCES,
+    });
+
+    // setup sokol-time for the load and frame timing
+    stm_setup();
 
     // setup sokol-debugtext
     sdtx_setup(&(sdtx_desc_t){
@@ -269,6 +529,8 @@ static void init(void) {
 
     // create shaders
     state.shaders.metallic = sg_make_shader(cgltf_metallic_shader_desc(sg_query_backend()));
+    state.shaders.metallic_instanced = sg_make_shader(cgltf_metallic_instanced_shader_desc(sg_query_backend()));
+    state.shaders.metallic_skinned = sg_make_shader(cgltf_metallic_skinned_shader_desc(sg_query_backend()));
     //state.shaders.specular = sg_make_shader(cgltf_specular_shader_desc());
 
     // setup the point light
@@ -280,10 +542,13 @@ static void init(void) {
     };
 
     // start loading the base gltf file...
+    state.loader.start_time = stm_now();
+    resource_start(&state.loader.file, filename);
     char path_buf[512];
     sfetch_send(&(sfetch_request_t){
         .path = fileutil_get_path(filename, path_buf, sizeof(path_buf)),
         .callback = gltf_fetch_callback,
+        .chunk_size = SFETCH_CHUNK_SIZE,
     });
 
     // create placeholder textures and sampler
@@ -322,19 +587,75 @@ static void init(void) {
     });
 }
 
+// milliseconds since the GLTF file was requested
+static double loader_ms(void) {
+    return stm_ms(stm_since(state.loader.start_time));
+}
+
+// print the per-resource load timing, the resource which finished
+// loading last is at the end of the critical path
+#define LOAD_TIMING_MAX_LINES (8)
+static void print_load_timing(void) {
+    sdtx_printf("\n\n%-12s %7s %7s %7s\n", "load", "KB", "first", "done");
+    const int num_resources = 1 + state.loader.num_buffers + state.loader.num_images;
+    const resource_t* last = &state.loader.file;
+    for (int i = 0; i < num_resources; i++) {
+        const resource_t* res = &state.loader.file;
+        if (i > state.loader.num_buffers) {
+            res = &state.loader.images[i - 1 - state.loader.num_buffers];
+        } else if (i > 0) {
+            res = &state.loader.buffers[i - 1];
+        }
+        if (res->finished_ms > last->finished_ms) {
+            last = res;
+        }
+        if (i < LOAD_TIMING_MAX_LINES) {
+            sdtx_printf("%-12.12s %7d %7.1f %7.1f\n", res->name, (int)(res->size / 1024), res->first_chunk_ms, res->finished_ms);
+        } else if (i == LOAD_TIMING_MAX_LINES) {
+            sdtx_printf("(%d more)\n", num_resources - LOAD_TIMING_MAX_LINES);
+        }
+    }
+    sdtx_printf("first draw:  %.1f ms\n", state.loader.first_draw_ms);
+    sdtx_printf("all loaded:  %.1f ms\n", state.loader.all_loaded_ms);
+    if (state.loader.num_pending == 0) {
+        sdtx_printf("critical:    %s\n", last->name);
+    }
+}
+
 // sokol-app frame callback
 static void frame(void) {
-    // pump the sokol-fetch message queue
+    // pump the sokol-fetch message queue, and create the images which finished transcoding
     sfetch_dowork();
+    sbasisu_dowork();
 
     // print help text
     sdtx_canvas(sapp_width() * 0.5f, sapp_height() * 0.5f);
     sdtx_color1i(0xFFFFFFFF);
     sdtx_origin(1.0f, 2.0f);
     sdtx_puts("LMB + drag:  rotate\n");
-    sdtx_puts("mouse wheel: zoom");
+    sdtx_puts("mouse wheel: zoom\n");
+    sdtx_printf("N:           animate node (%s)\n\n", state.node_anim.enabled ? "on" : "off");
+    sdtx_printf("draws:       %d\n", state.frame_stats.num_draws);
+    sdtx_printf("instances:   %d\n", state.frame_stats.num_instances);
+    sdtx_printf("pipelines:   %d\n", state.frame_stats.num_apply_pipeline);
+    sdtx_printf("bindings:    %d\n", state.frame_stats.num_apply_bindings);
+    sdtx_printf("uniforms:    %d\n", state.frame_stats.num_apply_uniforms);
+    sdtx_printf("nodes:       %d\n", state.scene.num_nodes);
+    sdtx_printf("transforms:  %d\n", state.scene.hierarchy.num_updated);
+    sdtx_printf("skinned:     %d\n", state.scene.num_skin_instances);
+    sdtx_printf("transcoding: %d\n", sbasisu_num_pending());
+    sdtx_printf("scratch:     %d KB peak\n", (int)(sbasisu_stats().peak_scratch_bytes / 1024));
+    sdtx_printf("parse:       %.2f ms\n", state.timing.parse_ms);
+    sdtx_printf("render:      %.2f ms\n", state.timing.render_ms);
+    if (state.meshopt.num_triangles > 0) {
+        sdtx_printf("\nACMR:        %.3f => %.3f",
+            state.meshopt.misses_before / (float)state.meshopt.num_triangles,
+            state.meshopt.misses_after / (float)state.meshopt.num_triangles);
+    }
+    print_load_timing();
 
     update_scene();
+    update_skins();
     const int fb_width = sapp_width();
     const int fb_height = sapp_height();
     cam_update(&state.camera, fb_width, fb_height);
@@ -347,88 +668,30 @@ static void frame(void) {
         sg_end_pass();
     } else {
         sg_begin_default_pass(&state.pass_actions.ok, fb_width, fb_height);
-        for (int node_index = 0; node_index < state.scene.num_nodes; node_index++) {
-            const node_t* node = &state.scene.nodes[node_index];
-            vs_params_t vs_params = vs_params_for_node(node_index);
-            const mesh_t* mesh = &state.scene.meshes[node->mesh];
-            for (int i = 0; i < mesh->num_primitives; i++) {
-                const primitive_t* prim = &state.scene.primitives[i + mesh->first_primitive];
-                const material_t* mat = &state.scene.materials[prim->material];
-                sg_apply_pipeline(state.scene.pipelines[prim->pipeline]);
-                sg_bindings bind = { 0 };
-                for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
-                    bind.vertex_buffers[vb_slot] = state.scene.buffers[prim->vertex_buffers.buffer[vb_slot]];
-                }
-                if (prim->index_buffer != SCENE_INVALID_INDEX) {
-                    bind.index_buffer = state.scene.buffers[prim->index_buffer];
-                }
-                sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(vs_params));
-                sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_light_params, &SG_RANGE(state.point_light));
-                if (mat->is_metallic) {
-                    sg_image base_color_tex = state.scene.image_samplers[mat->metallic.images.base_color].img;
-                    sg_image metallic_roughness_tex = state.scene.image_samplers[mat->metallic.images.metallic_roughness].img;
-                    sg_image normal_tex = state.scene.image_samplers[mat->metallic.images.normal].img;
-                    sg_image occlusion_tex = state.scene.image_samplers[mat->metallic.images.occlusion].img;
-                    sg_image emissive_tex = state.scene.image_samplers[mat->metallic.images.emissive].img;
-                    sg_sampler base_color_smp = state.scene.image_samplers[mat->metallic.images.base_color].smp;
-                    sg_sampler metallic_roughness_smp = state.scene.image_samplers[mat->metallic.images.metallic_roughness].smp;
-                    sg_sampler normal_smp = state.scene.image_samplers[mat->metallic.images.normal].smp;
-                    sg_sampler occlusion_smp = state.scene.image_samplers[mat->metallic.images.occlusion].smp;
-                    sg_sampler emissive_smp = state.scene.image_samplers[mat->metallic.images.emissive].smp;
-
-                    if (!base_color_tex.id) {
-                        base_color_tex = state.placeholders.white;
-                        base_color_smp = state.placeholders.smp;
-                    }
-                    if (!metallic_roughness_tex.id) {
-                        metallic_roughness_tex = state.placeholders.white;
-                        metallic_roughness_smp = state.placeholders.smp;
-                    }
-                    if (!normal_tex.id) {
-                        normal_tex = state.placeholders.normal;
-                        normal_smp = state.placeholders.smp;
-                    }
-                    if (!occlusion_tex.id) {
-                        occlusion_tex = state.placeholders.white;
-                        occlusion_smp = state.placeholders.smp;
-                    }
-                    if (!emissive_tex.id) {
-                        emissive_tex = state.placeholders.black;
-                        emissive_smp = state.placeholders.smp;
-                    }
-                    bind.fs.images[SLOT_base_color_tex] = base_color_tex;
-                    bind.fs.images[SLOT_metallic_roughness_tex] = metallic_roughness_tex;
-                    bind.fs.images[SLOT_normal_tex] = normal_tex;
-                    bind.fs.images[SLOT_occlusion_tex] = occlusion_tex;
-                    bind.fs.images[SLOT_emissive_tex] = emissive_tex;
-                    bind.fs.samplers[SLOT_base_color_smp] = base_color_smp;
-                    bind.fs.samplers[SLOT_metallic_roughness_smp] = metallic_roughness_smp;
-                    bind.fs.samplers[SLOT_normal_smp] = normal_smp;
-                    bind.fs.samplers[SLOT_occlusion_smp] = occlusion_smp;
-                    bind.fs.samplers[SLOT_emissive_tex] = emissive_smp;
-                    sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_metallic_params, &SG_RANGE(mat->metallic.fs_params));
-                } else {
-                /*
-                    sg_apply_uniforms(SG_SHADERSTAGE_VS,
-                        SLOT_specular_params,
-                        &mat->specular.fs_params,
-                        sizeof(specular_params_t));
-                */
-                }
-                sg_apply_bindings(&bind);
-                sg_draw(prim->base_element, prim->num_elements, 1);
-            }
+        const uint64_t render_start = stm_now();
+        update_instance_buffer();
+        build_render_queue();
+        if ((state.loader.first_draw_ms == 0.0) && (state.render_queue.num_items > 0)) {
+            state.loader.first_draw_ms = loader_ms();
         }
+        draw_render_queue();
+        state.timing.render_ms = stm_ms(stm_since(render_start));
         sdtx_draw();
         __dbgui_draw();
         sg_end_pass();
     }
     sg_commit();
+    #if defined(CGLTF_BENCH)
+    bench_frame();
+    #endif
 }
 
 // sokol-app cleanup callback, called once at shutdown
 static void cleanup(void) {
     sfetch_shutdown();
+    scene_unload();
+    pip_cache_shutdown();
+    ozz_shutdown();
     __dbgui_shutdown();
     sbasisu_shutdown();
     sg_shutdown();
@@ -440,41 +703,153 @@ static void input(const sapp_event* ev) {
         return;
     }
     cam_handle_event(&state.camera, ev);
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_N)) {
+        state.node_anim.enabled = !state.node_anim.enabled;
+    }
 }
 
-// load-callback for the GLTF base file
-static void gltf_fetch_callback(const sfetch_response_t* response) {
+#if defined(CGLTF_BENCH)
+// time BENCH_NUM_FRAMES frames once all resources and textures have loaded,
+// then print the load and render timing and quit
+static void bench_frame(void) {
+    if (state.bench.done) {
+        return;
+    }
+    if (state.failed) {
+        fprintf(stderr, "failed to load '%s'\n", filename);
+        state.bench.done = true;
+        sapp_request_quit();
+        return;
+    }
+    if ((state.loader.num_pending > 0) || (sbasisu_num_pending() > 0)) {
+        return;
+    }
+    state.bench.num_frames++;
+    state.bench.render_ms += state.timing.render_ms;
+    state.bench.frame_ms += sapp_frame_duration() * 1000.0;
+    if (state.timing.render_ms > state.bench.max_render_ms) {
+        state.bench.max_render_ms = state.timing.render_ms;
+    }
+    if (state.bench.num_frames == BENCH_NUM_FRAMES) {
+        printf("%s: %d nodes, %d draws, %d instances\n", filename, state.scene.num_nodes, state.frame_stats.num_draws, state.frame_stats.num_instances);
+        printf("  parse:      %8.2f ms\n", state.timing.parse_ms);
+        printf("  first draw: %8.2f ms\n", state.loader.first_draw_ms);
+        printf("  all loaded: %8.2f ms\n", state.loader.all_loaded_ms);
+        printf("  render:     %8.3f ms avg, %.3f ms max (%d frames)\n",
+            state.bench.render_ms / BENCH_NUM_FRAMES, state.bench.max_render_ms, BENCH_NUM_FRAMES);
+        printf("  frame:      %8.3f ms avg\n", state.bench.frame_ms / BENCH_NUM_FRAMES);
+        state.bench.done = true;
+        sapp_request_quit();
+    }
+}
+#endif
+
+// start tracking an async-loaded resource, named after the file part of its URI
+static void resource_start(resource_t* res, const char* uri) {
+    const char* name = strrchr(uri, '/');
+    name = name ? (name + 1) : uri;
+    strncpy(res->name, name, sizeof(res->name) - 1);
+    state.loader.num_pending++;
+}
+
+// common sokol-fetch response handling for resources, returns true
+// when a chunk has been loaded to the end of the resource's data
+static bool resource_fetch_response(resource_t* res, const sfetch_response_t* response) {
     if (response->dispatched) {
-        // bind buffer to load file into
-        sfetch_bind_buffer(response->handle, SFETCH_RANGE(sfetch_buffers[response->channel][response->lane]));
+        res->start_ms = loader_ms();
+        resource_bind_next_chunk(res, response);
     } else if (response->fetched) {
-        // file has been loaded, parse as GLTF
-        gltf_parse(response->data);
+        if (res->first_chunk_ms == 0.0) {
+            res->first_chunk_ms = loader_ms();
+        }
+        assert((const uint8_t*)response->data.ptr == (res->data + response->data_offset));
+        res->size = response->data_offset + response->data.size;
+        return true;
+    }
+    return false;
+}
+
+// grow the resource's data buffer to hold at least size bytes, rounded up
+// so that a whole chunk always fits behind each chunk-aligned offset
+static void resource_reserve(resource_t* res, size_t size) {
+    const size_t capacity = ((size + SFETCH_CHUNK_SIZE - 1) / SFETCH_CHUNK_SIZE) * SFETCH_CHUNK_SIZE;
+    if (capacity > res->capacity) {
+        res->data = (uint8_t*) realloc(res->data, capacity);
+        res->capacity = capacity;
+    }
+}
+
+// bind the free space behind the loaded data as destination for the next chunk,
+// the data buffer is grown if less than one chunk is left
+static void resource_bind_next_chunk(resource_t* res, const sfetch_response_t* response) {
+    sfetch_unbind_buffer(response->handle);
+    if ((res->capacity - res->size) < SFETCH_CHUNK_SIZE) {
+        resource_reserve(res, (res->capacity == 0) ? SFETCH_CHUNK_SIZE : (res->capacity * 2));
+    }
+    sfetch_bind_buffer(response->handle, (sfetch_range_t){ res->data + res->size, res->capacity - res->size });
+}
+
+// free the resource's data once it has been consumed, and record the load timing
+static void resource_finish(resource_t* res) {
+    free(res->data);
+    res->data = 0;
+    res->capacity = 0;
+    res->finished_ms = loader_ms();
+    assert(state.loader.num_pending > 0);
+    if (--state.loader.num_pending == 0) {
+        state.loader.all_loaded_ms = res->finished_ms;
+    }
+}
+
+// load-callback for the GLTF base file
+static void gltf_fetch_callback(const sfetch_response_t* response) {
+    resource_t* res = &state.loader.file;
+    if (resource_fetch_response(res, response) && !response->finished) {
+        // the GLB header contains the total file size, reserve the
+        // space for the remaining chunks so they're loaded in place
+        if ((response->data_offset == 0) && (res->size >= 12) && (0 == memcmp(res->data, "glTF", 4))) {
+            uint32_t glb_size;
+            memcpy(&glb_size, res->data + 8, sizeof(glb_size));
+            resource_reserve(res, glb_size);
+        }
+        resource_bind_next_chunk(res, response);
     }
     if (response->finished) {
         if (response->failed) {
             state.failed = true;
+        } else {
+            // file has been loaded, parse as GLTF
+            gltf_parse(res->data, res->size);
         }
+        resource_finish(res);
     }
 }
 
-// load-callback for GLTF buffer files
+// load-callback for GLTF buffer files, the sokol-gfx buffers are
+// created as soon as their buffer view has been loaded
 typedef struct {
     cgltf_size buffer_index;
 } gltf_buffer_fetch_userdata_t;
 
 static void gltf_buffer_fetch_callback(const sfetch_response_t* response) {
-    if (response->dispatched) {
-        sfetch_bind_buffer(response->handle, SFETCH_RANGE(sfetch_buffers[response->channel][response->lane]));
-    } else if (response->fetched) {
-        const gltf_buffer_fetch_userdata_t* user_data = (const gltf_buffer_fetch_userdata_t*)response->user_data;
-        int gltf_buffer_index = (int)user_data->buffer_index;
-        create_sg_buffers_for_gltf_buffer(gltf_buffer_index, (sg_range){response->data.ptr, response->data.size});
+    const gltf_buffer_fetch_userdata_t* user_data = (const gltf_buffer_fetch_userdata_t*)response->user_data;
+    const int gltf_buffer_index = (int)user_data->buffer_index;
+    resource_t* res = &state.loader.buffers[gltf_buffer_index];
+    bool all_created = false;
+    if (resource_fetch_response(res, response)) {
+        // the data lives in our own buffer, so it's fine to modify it in place
+        all_created = create_sg_buffers_for_gltf_buffer(gltf_buffer_index, res->data, res->size);
+        all_created &= create_sg_image_samplers_for_gltf_buffer(gltf_buffer_index, res->data, res->size);
+        all_created &= copy_skin_data_for_gltf_buffer(gltf_buffer_index, res->data, res->size);
+        if (!response->finished) {
+            resource_bind_next_chunk(res, response);
+        }
     }
     if (response->finished) {
-        if (response->failed) {
+        if (response->failed || !all_created) {
             state.failed = true;
         }
+        resource_finish(res);
     }
 }
 
@@ -484,33 +859,170 @@ typedef struct {
 } gltf_image_fetch_userdata_t;
 
 static void gltf_image_fetch_callback(const sfetch_response_t* response) {
-    if (response->dispatched) {
-        sfetch_bind_buffer(response->handle, SFETCH_RANGE(sfetch_buffers[response->channel][response->lane]));
-    } else if (response->fetched) {
-        const gltf_image_fetch_userdata_t* user_data = (const gltf_image_fetch_userdata_t*)response->user_data;
-        int gltf_image_index = (int)user_data->image_index;
-        create_sg_image_samplers_for_gltf_image(gltf_image_index, (sg_range){response->data.ptr, response->data.size});
+    const gltf_image_fetch_userdata_t* user_data = (const gltf_image_fetch_userdata_t*)response->user_data;
+    const int gltf_image_index = (int)user_data->image_index;
+    resource_t* res = &state.loader.images[gltf_image_index];
+    if (resource_fetch_response(res, response) && !response->finished) {
+        resource_bind_next_chunk(res, response);
     }
     if (response->finished) {
         if (response->failed) {
             state.failed = true;
+        } else {
+            create_sg_image_samplers_for_gltf_image(gltf_image_index, (sg_range){ res->data, res->size });
+        }
+        resource_finish(res);
+    }
+}
+
+// allocate from an arena, or only bump the offset if the arena is measuring
+static void* arena_alloc(arena_t* arena, size_t num, size_t elem_size) {
+    const size_t offset = (arena->offset + 15) & ~(size_t)15;
+    arena->offset = offset + num * elem_size;
+    if (0 == arena->buf) {
+        return 0;
+    }
+    assert(arena->offset <= arena->size);
+    return arena->buf + offset;
+}
+
+// carve all per-scene arrays out of the arena, in traversal order
+static void scene_alloc_arrays(arena_t* arena, const cgltf_data* gltf, int num_primitives, int num_draw_items, int num_skin_joints, int num_skin_channels) {
+    const size_t num_buffers = gltf->buffer_views_count;
+    const size_t num_images = gltf->textures_count;
+    const size_t num_prims = (size_t)num_primitives;
+    const size_t num_nodes = gltf->nodes_count;
+    state.scene.nodes = (node_t*) arena_alloc(arena, num_nodes, sizeof(node_t));
+    hierarchy_t* h = &state.scene.hierarchy;
+    h->parents = (int*) arena_alloc(arena, num_nodes, sizeof(int));
+    h->dirty = (bool*) arena_alloc(arena, num_nodes, sizeof(bool));
+    h->has_matrix = (bool*) arena_alloc(arena, num_nodes, sizeof(bool));
+    h->translations = (hmm_vec3*) arena_alloc(arena, num_nodes, sizeof(hmm_vec3));
+    h->rotations = (hmm_quaternion*) arena_alloc(arena, num_nodes, sizeof(hmm_quaternion));
+    h->scales = (hmm_vec3*) arena_alloc(arena, num_nodes, sizeof(hmm_vec3));
+    h->local_transforms = (hmm_mat4*) arena_alloc(arena, num_nodes, sizeof(hmm_mat4));
+    h->world_transforms = (hmm_mat4*) arena_alloc(arena, num_nodes, sizeof(hmm_mat4));
+    state.scene.instance_nodes = (int*) arena_alloc(arena, num_nodes, sizeof(int));
+    state.instance_transforms = (hmm_mat4*) arena_alloc(arena, num_nodes, sizeof(hmm_mat4));
+    state.scene.meshes = (mesh_t*) arena_alloc(arena, gltf->meshes_count, sizeof(mesh_t));
+    state.scene.primitives = (primitive_t*) arena_alloc(arena, num_prims, sizeof(primitive_t));
+    state.render_queue.items = (draw_item_t*) arena_alloc(arena, (size_t)num_draw_items, sizeof(draw_item_t));
+    state.scene.materials = (material_t*) arena_alloc(arena, gltf->materials_count, sizeof(material_t));
+    state.scene.image_samplers = (image_sampler_t*) arena_alloc(arena, num_images, sizeof(image_sampler_t));
+    state.scene.buffers = (sg_buffer*) arena_alloc(arena, num_buffers, sizeof(sg_buffer));
+    state.creation_params.buffers = (buffer_creation_params_t*) arena_alloc(arena, num_buffers, sizeof(buffer_creation_params_t));
+    state.creation_params.images = (image_sampler_creation_params_t*) arena_alloc(arena, num_images, sizeof(image_sampler_creation_params_t));
+    state.creation_params.primitives = (index_optimization_params_t*) arena_alloc(arena, num_prims, sizeof(index_optimization_params_t));
+    state.creation_params.embedded_images = (embedded_image_params_t*) arena_alloc(arena, gltf->images_count, sizeof(embedded_image_params_t));
+    state.loader.buffers = (resource_t*) arena_alloc(arena, gltf->buffers_count, sizeof(resource_t));
+    state.loader.images = (resource_t*) arena_alloc(arena, gltf->images_count, sizeof(resource_t));
+    state.scene.skins = (skin_t*) arena_alloc(arena, gltf->skins_count, sizeof(skin_t));
+    state.scene.skin_instances = (ozz_instance_t**) arena_alloc(arena, num_nodes, sizeof(ozz_instance_t*));
+    state.creation_params.joints = (ozz_gltf_joint_t*) arena_alloc(arena, (size_t)num_skin_joints, sizeof(ozz_gltf_joint_t));
+    state.creation_params.channels = (ozz_gltf_channel_t*) arena_alloc(arena, (size_t)num_skin_channels, sizeof(ozz_gltf_channel_t));
+    // one range for the inverse bind matrices, and two for the times and values of each channel
+    const size_t num_skin_ranges = gltf->skins_count + 2 * (size_t)num_skin_channels;
+    state.creation_params.skin_ranges = (skin_range_params_t*) arena_alloc(arena, num_skin_ranges, sizeof(skin_range_params_t));
+    state.scene.max_draw_items = num_draw_items;
+}
+
+// size the scene arena from the GLTF element counts, and allocate it
+static void scene_alloc(const cgltf_data* gltf) {
+    assert(0 == state.scene.arena.buf);
+    int num_primitives = 0;
+    for (cgltf_size i = 0; i < gltf->meshes_count; i++) {
+        num_primitives += (int)gltf->meshes[i].primitives_count;
+    }
+    int num_draw_items = 0;
+    for (cgltf_size i = 0; i < gltf->nodes_count; i++) {
+        if (gltf->nodes[i].mesh) {
+            num_draw_items += (int)gltf->nodes[i].mesh->primitives_count;
+        }
+    }
+    // only the first animation is played, each skin gets its own copy of the channels targeting its joints
+    int num_skin_joints = 0;
+    for (cgltf_size i = 0; i < gltf->skins_count; i++) {
+        num_skin_joints += (int)gltf->skins[i].joints_count;
+    }
+    const int num_skin_channels = (gltf->animations_count > 0) ? (int)(gltf->skins_count * gltf->animations[0].channels_count) : 0;
+    // first measure, then allocate and assign the actual arrays
+    arena_t arena = { 0 };
+    scene_alloc_arrays(&arena, gltf, num_primitives, num_draw_items, num_skin_joints, num_skin_channels);
+    arena.size = arena.offset;
+    arena.offset = 0;
+    arena.buf = (uint8_t*) calloc(1, arena.size > 0 ? arena.size : 1);
+    scene_alloc_arrays(&arena, gltf, num_primitives, num_draw_items, num_skin_joints, num_skin_channels);
+    state.scene.arena = arena;
+}
+
+// destroy the scene's sokol-gfx resources and free the scene arena in one go,
+// pipelines are owned by the pipeline cache and outlive the scene
+static void scene_unload(void) {
+    for (int i = 0; i < state.scene.num_buffers; i++) {
+        sg_destroy_buffer(state.scene.buffers[i]);
+    }
+    for (int i = 0; i < state.scene.num_images; i++) {
+        sg_destroy_image(state.scene.image_samplers[i].img);
+        sg_destroy_sampler(state.scene.image_samplers[i].smp);
+    }
+    sg_destroy_buffer(state.scene.instance_buffer);
+    // the skin assets are shared through the ozz_gltf cache
+    for (int i = 0; i < state.scene.num_skin_instances; i++) {
+        ozz_destroy_instance(state.scene.skin_instances[i]);
+    }
+    for (int i = 0; i < state.scene.num_skins; i++) {
+        if (state.scene.skins[i].asset) {
+            ozz_gltf_release(state.scene.skins[i].asset);
         }
     }
+    free(state.creation_params.skin_data);
+    // free the data of resources which haven't finished loading
+    for (int i = 0; i < state.loader.num_buffers; i++) {
+        free(state.loader.buffers[i].data);
+    }
+    for (int i = 0; i < state.loader.num_images; i++) {
+        free(state.loader.images[i].data);
+    }
+    free(state.loader.file.data);
+    memset(&state.loader, 0, sizeof(state.loader));
+    free(state.scene.arena.buf);
+    state.scene = (scene_t){ 0 };
+    state.creation_params.buffers = 0;
+    state.creation_params.images = 0;
+    state.creation_params.primitives = 0;
+    state.creation_params.embedded_images = 0;
+    state.creation_params.joints = 0;
+    state.creation_params.channels = 0;
+    state.creation_params.skin_ranges = 0;
+    state.creation_params.num_skin_ranges = 0;
+    state.creation_params.skin_data = 0;
+    state.creation_params.num_pending_skins = 0;
+    state.anim_time = 0.0;
+    memset(&state.node_anim, 0, sizeof(state.node_anim));
+    state.render_queue.items = 0;
+    state.render_queue.num_items = 0;
+    state.instance_transforms = 0;
 }
 
 // load GLTF data from memory, build scene and issue resource fetch requests
-static void gltf_parse(sfetch_range_t file_data) {
+static void gltf_parse(uint8_t* file_data, size_t file_size) {
+    const uint64_t start = stm_now();
     cgltf_options options = { 0 };
     cgltf_data* data = 0;
-    const cgltf_result result = cgltf_parse(&options, file_data.ptr, file_data.size, &data);
+    const cgltf_result result = cgltf_parse(&options, file_data, file_size, &data);
     if (result == cgltf_result_success) {
+        scene_alloc(data);
         gltf_parse_buffers(data);
         gltf_parse_images(data);
         gltf_parse_materials(data);
         gltf_parse_meshes(data);
         gltf_parse_nodes(data);
+        gltf_load_embedded_data(data, file_data, file_size);
         cgltf_free(data);
+    } else {
+        state.failed = true;
     }
+    state.timing.parse_ms = stm_ms(stm_since(start));
 }
 
 // compute indices from cgltf element pointers
@@ -529,8 +1041,11 @@ static int gltf_image_index(const cgltf_data* gltf, const cgltf_image* img) {
     return (int) (img - gltf->images);
 }
 
+// material textures are optional, missing textures are SCENE_INVALID_INDEX
 static int gltf_texture_index(const cgltf_data* gltf, const cgltf_texture* tex) {
-    assert(tex);
+    if (!tex) {
+        return SCENE_INVALID_INDEX;
+    }
     return (int) (tex - gltf->textures);
 }
 
@@ -546,11 +1061,6 @@ static int gltf_mesh_index(const cgltf_data* gltf, const cgltf_mesh* mesh) {
 
 // parse the GLTF buffer definitions and start loading buffer blobs
 static void gltf_parse_buffers(const cgltf_data* gltf) {
-    if (gltf->buffer_views_count > SCENE_MAX_BUFFERS) {
-        state.failed = true;
-        return;
-    }
-
     // parse the buffer-view attributes
     state.scene.num_buffers = (int) gltf->buffer_views_count;
     for (int i = 0; i < state.scene.num_buffers; i++) {
@@ -564,20 +1074,40 @@ static void gltf_parse_buffers(const cgltf_data* gltf) {
         } else {
             p->type = SG_BUFFERTYPE_VERTEXBUFFER;
         }
+        p->first_index_optimization = SCENE_INVALID_INDEX;
+        // buffer views with embedded image data don't need a sokol-gfx buffer
+        for (cgltf_size img_index = 0; img_index < gltf->images_count; img_index++) {
+            if (gltf->images[img_index].buffer_view == gltf_buf_view) {
+                p->created = true;
+            }
+        }
         // allocate a sokol-gfx buffer handle
-        state.scene.buffers[i] = sg_alloc_buffer();
+        if (!p->created) {
+            state.scene.buffers[i] = sg_alloc_buffer();
+        }
     }
 
-    // start loading all buffers
+    // start loading all buffers, the buffer sizes are known upfront, so the
+    // chunks can be loaded into place without growing the destination
+    state.loader.num_buffers = (int) gltf->buffers_count;
     for (cgltf_size i = 0; i < gltf->buffers_count; i++) {
         const cgltf_buffer* gltf_buf = &gltf->buffers[i];
+        resource_t* res = &state.loader.buffers[i];
+        if (gltf_uri_is_embedded(gltf_buf->uri)) {
+            // the GLB binary chunk or a data URI, see gltf_load_embedded_data()
+            strncpy(res->name, gltf_buf->uri ? "(data uri)" : "(glb)", sizeof(res->name) - 1);
+            continue;
+        }
+        resource_start(res, gltf_buf->uri);
+        resource_reserve(res, gltf_buf->size);
         gltf_buffer_fetch_userdata_t user_data = {
             .buffer_index = i
         };
         char path_buf[512];
         sfetch_send(&(sfetch_request_t){
-            .path = fileutil_get_path(gltf_buf->uri, path_buf, sizeof(path_buf)),
+            .path = gltf_resource_path(gltf_buf->uri, path_buf, sizeof(path_buf)),
             .callback = gltf_buffer_fetch_callback,
+            .chunk_size = SFETCH_CHUNK_SIZE,
             .user_data = SFETCH_RANGE(user_data),
         });
     }
@@ -625,11 +1155,6 @@ static sg_wrap gltf_to_sg_wrap(int gltf_wrap) {
 }
 
 static void gltf_parse_images(const cgltf_data* gltf) {
-    if (gltf->textures_count > SCENE_MAX_IMAGES) {
-        state.failed = true;
-        return;
-    }
-
     // parse the texture and sampler attributes
     state.scene.num_images = (int) gltf->textures_count;
     for (int i = 0; i < state.scene.num_images; i++) {
@@ -645,27 +1170,143 @@ static void gltf_parse_images(const cgltf_data* gltf) {
         state.scene.image_samplers[i].smp.id = SG_INVALID_ID;
     }
 
-    // start loading all images
+    // start loading all images which are not embedded in a GLTF buffer or data URI
+    state.loader.num_images = (int) gltf->images_count;
     for (cgltf_size i = 0; i < gltf->images_count; i++) {
         const cgltf_image* gltf_img = &gltf->images[i];
+        embedded_image_params_t* p = &state.creation_params.embedded_images[i];
+        p->gltf_buffer_index = SCENE_INVALID_INDEX;
+        if (gltf_img->buffer_view) {
+            p->gltf_buffer_index = gltf_buffer_index(gltf, gltf_img->buffer_view->buffer);
+            p->offset = (int) gltf_img->buffer_view->offset;
+            p->size = (int) gltf_img->buffer_view->size;
+        }
+        if (gltf_img->buffer_view || gltf_uri_is_embedded(gltf_img->uri)) {
+            strncpy(state.loader.images[i].name, gltf_img->uri ? "(data uri)" : "(buffer view)", sizeof(state.loader.images[i].name) - 1);
+            continue;
+        }
+        resource_start(&state.loader.images[i], gltf_img->uri);
         gltf_image_fetch_userdata_t user_data = {
             .image_index = i
         };
         char path_buf[512];
         sfetch_send(&(sfetch_request_t){
-            .path = fileutil_get_path(gltf_img->uri, path_buf, sizeof(path_buf)),
+            .path = gltf_resource_path(gltf_img->uri, path_buf, sizeof(path_buf)),
             .callback = gltf_image_fetch_callback,
+            .chunk_size = SFETCH_CHUNK_SIZE,
             .user_data = SFETCH_RANGE(user_data),
         });
     }
 }
 
+// check if a GLTF buffer or image URI refers to embedded data instead of a file,
+// a missing URI refers to the binary chunk of a GLB file (or a buffer view for images)
+static bool gltf_uri_is_embedded(const char* uri) {
+    return (0 == uri) || (0 == strncmp(uri, "data:", 5));
+}
+
+// the path of a GLTF buffer or image file, which is relative to the GLTF file
+static const char* gltf_resource_path(const char* uri, char* buf, size_t buf_size) {
+    const char* sep = strrchr(filename, '/');
+    const char* win_sep = strrchr(filename, '\\');
+    if (win_sep && (!sep || (win_sep > sep))) {
+        sep = win_sep;
+    }
+    const int dir_len = sep ? (int)(sep - filename + 1) : 0;
+    char rel_path[512];
+    snprintf(rel_path, sizeof(rel_path), "%.*s%s", dir_len, filename, uri);
+    return fileutil_get_path(rel_path, buf, buf_size);
+}
+
+// decode a base64 data URI into a malloc'ed buffer, returns null if the URI is not base64
+static uint8_t* gltf_decode_data_uri(const char* uri, size_t size) {
+    const char* comma = strchr(uri, ',');
+    if ((0 == comma) || ((comma - uri) < 7) || (0 != strncmp(comma - 7, ";base64", 7))) {
+        return 0;
+    }
+    cgltf_options options = { 0 };
+    void* data = 0;
+    if (cgltf_load_buffer_base64(&options, size, comma + 1, &data) != cgltf_result_success) {
+        return 0;
+    }
+    return (uint8_t*) data;
+}
+
+// the decoded size of a base64 data URI, for images which don't declare their size
+static size_t gltf_data_uri_size(const char* uri) {
+    const char* comma = strchr(uri, ',');
+    if (0 == comma) {
+        return 0;
+    }
+    size_t len = strlen(comma + 1);
+    while ((len > 0) && (comma[len] == '=')) {
+        len--;
+    }
+    return (len * 3) / 4;
+}
+
+// Create the buffers and images which are embedded in the GLTF file itself. The
+// sokol-gfx buffers are created straight from the GLB binary chunk in the loaded
+// file data, data URIs are decoded once into the resource's data buffer. This must
+// happen after parsing the meshes, since the index buffers are optimized in place.
+static void gltf_load_embedded_data(const cgltf_data* gltf, uint8_t* file_data, size_t file_size) {
+    for (cgltf_size i = 0; i < gltf->buffers_count; i++) {
+        const cgltf_buffer* gltf_buf = &gltf->buffers[i];
+        resource_t* res = &state.loader.buffers[i];
+        uint8_t* data = 0;
+        if (0 == gltf_buf->uri) {
+            // cgltf points into our own file data, so it can be modified in place
+            if ((0 == gltf->bin) || (gltf->bin_size < gltf_buf->size)) {
+                state.failed = true;
+                continue;
+            }
+            const size_t bin_offset = (size_t)((const uint8_t*)gltf->bin - file_data);
+            assert((bin_offset + gltf->bin_size) <= file_size);
+            data = file_data + bin_offset;
+        } else if (gltf_uri_is_embedded(gltf_buf->uri)) {
+            res->data = gltf_decode_data_uri(gltf_buf->uri, gltf_buf->size);
+            if (0 == res->data) {
+                state.failed = true;
+                continue;
+            }
+            data = res->data;
+        } else {
+            continue;
+        }
+        res->start_ms = res->first_chunk_ms = loader_ms();
+        res->size = gltf_buf->size;
+        bool all_created = create_sg_buffers_for_gltf_buffer((int)i, data, gltf_buf->size);
+        all_created &= create_sg_image_samplers_for_gltf_buffer((int)i, data, gltf_buf->size);
+        all_created &= copy_skin_data_for_gltf_buffer((int)i, data, gltf_buf->size);
+        if (!all_created) {
+            state.failed = true;
+        }
+        free(res->data);
+        res->data = 0;
+        res->finished_ms = loader_ms();
+    }
+    for (cgltf_size i = 0; i < gltf->images_count; i++) {
+        const cgltf_image* gltf_img = &gltf->images[i];
+        if ((0 == gltf_img->uri) || !gltf_uri_is_embedded(gltf_img->uri)) {
+            continue;
+        }
+        resource_t* res = &state.loader.images[i];
+        res->start_ms = res->first_chunk_ms = loader_ms();
+        res->size = gltf_data_uri_size(gltf_img->uri);
+        res->data = gltf_decode_data_uri(gltf_img->uri, res->size);
+        if (0 == res->data) {
+            state.failed = true;
+            continue;
+        }
+        create_sg_image_samplers_for_gltf_image((int)i, (sg_range){ res->data, res->size });
+        free(res->data);
+        res->data = 0;
+        res->finished_ms = loader_ms();
+    }
+}
+
 // parse GLTF materials into our own material definition
 static void gltf_parse_materials(const cgltf_data* gltf) {
-    if (gltf->materials_count > SCENE_MAX_MATERIALS) {
-        state.failed = true;
-        return;
-    }
     state.scene.num_materials = (int) gltf->materials_count;
     for (int i = 0; i < state.scene.num_materials; i++) {
         const cgltf_material* gltf_mat = &gltf->materials[i];
@@ -715,30 +1356,85 @@ static void gltf_parse_materials(const cgltf_data* gltf) {
     }
 }
 
+// gather the information to optimize the index buffer of a triangle-list primitive,
+// the positions are optional (only needed for overdraw optimization)
+static index_optimization_params_t index_optimization_params_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim) {
+    const cgltf_accessor* idx = prim->indices;
+    index_optimization_params_t p = {
+        .valid = true,
+        .index_buffer = gltf_bufferview_index(gltf, idx->buffer_view),
+        .index_offset = (int) (idx->buffer_view->offset + idx->offset),
+        .num_indices = (int) idx->count,
+        .index_32bit = idx->component_type == cgltf_component_type_r_32u,
+        .num_vertices = (int) prim->attributes->data->count,
+        .position_gltf_buffer_index = SCENE_INVALID_INDEX,
+    };
+    for (cgltf_size attr_index = 0; attr_index < prim->attributes_count; attr_index++) {
+        const cgltf_attribute* attr = &prim->attributes[attr_index];
+        const cgltf_accessor* acc = attr->data;
+        if ((attr->type == cgltf_attribute_type_position) &&
+            (acc->component_type == cgltf_component_type_r_32f) &&
+            (acc->type == cgltf_type_vec3))
+        {
+            p.position_gltf_buffer_index = gltf_buffer_index(gltf, acc->buffer_view->buffer);
+            p.position_offset = (int) (acc->buffer_view->offset + acc->offset);
+            p.position_stride = (int) acc->stride;
+        }
+    }
+    return p;
+}
+
+// check if a mesh is used by a node with a skin
+static bool gltf_mesh_is_skinned(const cgltf_data* gltf, const cgltf_mesh* mesh) {
+    for (cgltf_size i = 0; i < gltf->nodes_count; i++) {
+        if ((gltf->nodes[i].mesh == mesh) && gltf->nodes[i].skin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// check if a primitive has the first set of joint indices and weights
+static bool gltf_primitive_has_skin_attributes(const cgltf_primitive* prim) {
+    bool has_joints = false;
+    bool has_weights = false;
+    for (cgltf_size attr_index = 0; attr_index < prim->attributes_count; attr_index++) {
+        const cgltf_attribute* attr = &prim->attributes[attr_index];
+        if (attr->index == 0) {
+            has_joints |= (attr->type == cgltf_attribute_type_joints);
+            has_weights |= (attr->type == cgltf_attribute_type_weights);
+        }
+    }
+    return has_joints && has_weights;
+}
+
 // parse GLTF meshes into our own mesh and submesh definition
 static void gltf_parse_meshes(const cgltf_data* gltf) {
-    if (gltf->meshes_count > SCENE_MAX_MESHES) {
-        state.failed = true;
-        return;
-    }
+    // index accessors shared by several primitives must only be optimized once
+    bool* index_accessor_seen = (bool*) calloc(gltf->accessors_count + 1, sizeof(bool));
     state.scene.num_meshes = (int) gltf->meshes_count;
     for (cgltf_size mesh_index = 0; mesh_index < gltf->meshes_count; mesh_index++) {
         const cgltf_mesh* gltf_mesh = &gltf->meshes[mesh_index];
-        if (((int)gltf_mesh->primitives_count + state.scene.num_primitives) > SCENE_MAX_PRIMITIVES) {
-            state.failed = true;
-            return;
-        }
         mesh_t* mesh = &state.scene.meshes[mesh_index];
         mesh->first_primitive = state.scene.num_primitives;
         mesh->num_primitives = (int) gltf_mesh->primitives_count;
+        const bool mesh_skinned = gltf_mesh_is_skinned(gltf, gltf_mesh);
         for (cgltf_size prim_index = 0; prim_index < gltf_mesh->primitives_count; prim_index++) {
             const cgltf_primitive* gltf_prim = &gltf_mesh->primitives[prim_index];
             primitive_t* prim = &state.scene.primitives[state.scene.num_primitives++];
 
             // a mapping from sokol-gfx vertex buffer bind slots into the scene.buffers array
             prim->vertex_buffers = create_vertex_buffer_mapping_for_gltf_primitive(gltf, gltf_prim);
-            // create or reuse a matching pipeline state object
-            prim->pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers);
+            // create or reuse matching pipeline state objects, the instanced
+            // variant needs a free vertex buffer bind slot for the instance data,
+            // skinned primitives are always drawn per node with their own joints
+            prim->skinned = mesh_skinned && gltf_primitive_has_skin_attributes(gltf_prim);
+            prim->pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers, false, prim->skinned);
+            if (!prim->skinned && (prim->vertex_buffers.num < SG_MAX_VERTEX_BUFFERS)) {
+                prim->instanced_pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers, true, false);
+            } else {
+                prim->instanced_pipeline = SCENE_INVALID_INDEX;
+            }
             // the material parameters
             prim->material = gltf_material_index(gltf, gltf_prim->material);
             // index buffer, base element, num elements
@@ -748,6 +1444,16 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
                 assert(gltf_prim->indices->stride != 0);
                 prim->base_element = 0;
                 prim->num_elements = (int) gltf_prim->indices->count;
+                const cgltf_size accessor_index = (cgltf_size) (gltf_prim->indices - gltf->accessors);
+                if (OPTIMIZE_INDICES && (gltf_prim->type == cgltf_primitive_type_triangles) && !index_accessor_seen[accessor_index]) {
+                    index_accessor_seen[accessor_index] = true;
+                    const int opt_index = state.scene.num_primitives - 1;
+                    buffer_creation_params_t* buf_params = &state.creation_params.buffers[prim->index_buffer];
+                    index_optimization_params_t* opt = &state.creation_params.primitives[opt_index];
+                    *opt = index_optimization_params_for_gltf_primitive(gltf, gltf_prim);
+                    opt->next = buf_params->first_index_optimization;
+                    buf_params->first_index_optimization = opt_index;
+                }
             } else {
                 // hmm... looking up the number of elements to render from
                 // a random vertex component accessor looks a bit shady
@@ -757,49 +1463,441 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
             }
         }
     }
+    free(index_accessor_seen);
+}
+
+// flatten the GLTF node tree into the hierarchy arrays in breadth-first order, which
+// puts parents before their children, and map GLTF node indices to hierarchy indices
+static void gltf_parse_hierarchy(const cgltf_data* gltf, int* hierarchy_index_map) {
+    hierarchy_t* h = &state.scene.hierarchy;
+    const cgltf_node** queue = (const cgltf_node**) malloc((gltf->nodes_count + 1) * sizeof(cgltf_node*));
+    int queue_end = 0;
+    for (cgltf_size i = 0; i < gltf->nodes_count; i++) {
+        if (0 == gltf->nodes[i].parent) {
+            queue[queue_end++] = &gltf->nodes[i];
+        }
+    }
+    for (int queue_pos = 0; queue_pos < queue_end; queue_pos++) {
+        const cgltf_node* gltf_node = queue[queue_pos];
+        for (cgltf_size i = 0; i < gltf_node->children_count; i++) {
+            queue[queue_end++] = gltf_node->children[i];
+        }
+        const int node_index = h->num_nodes++;
+        hierarchy_index_map[gltf_node - gltf->nodes] = node_index;
+        h->parents[node_index] = gltf_node->parent ? hierarchy_index_map[gltf_node->parent - gltf->nodes] : SCENE_INVALID_INDEX;
+        h->has_matrix[node_index] = gltf_node->has_matrix;
+        if (gltf_node->has_matrix) {
+            // GLTF matrices are column-major like HandmadeMath
+            memcpy(&h->local_transforms[node_index], gltf_node->matrix, sizeof(hmm_mat4));
+        }
+        hmm_vec3 translation = HMM_Vec3(0.0f, 0.0f, 0.0f);
+        hmm_quaternion rotation = HMM_Quaternion(0.0f, 0.0f, 0.0f, 1.0f);
+        hmm_vec3 scale = HMM_Vec3(1.0f, 1.0f, 1.0f);
+        if (gltf_node->has_translation) {
+            translation = HMM_Vec3(gltf_node->translation[0], gltf_node->translation[1], gltf_node->translation[2]);
+        }
+        if (gltf_node->has_rotation) {
+            rotation = HMM_Quaternion(gltf_node->rotation[0], gltf_node->rotation[1], gltf_node->rotation[2], gltf_node->rotation[3]);
+        }
+        if (gltf_node->has_scale) {
+            scale = HMM_Vec3(gltf_node->scale[0], gltf_node->scale[1], gltf_node->scale[2]);
+        }
+        hierarchy_set_trs(node_index, translation, rotation, scale);
+    }
+    free(queue);
 }
 
 // parse GLTF nodes into our own node definition
 static void gltf_parse_nodes(const cgltf_data* gltf) {
-    if (gltf->nodes_count > SCENE_MAX_NODES) {
-        state.failed = true;
-        return;
-    }
+    int* hierarchy_index_map = (int*) malloc((gltf->nodes_count + 1) * sizeof(int));
+    gltf_parse_hierarchy(gltf, hierarchy_index_map);
     for (cgltf_size node_index = 0; node_index < gltf->nodes_count; node_index++) {
         const cgltf_node* gltf_node = &gltf->nodes[node_index];
-        // ignore nodes without mesh, those are not relevant since we
-        // bake the transform hierarchy into per-node world space transforms
+        // only nodes with a mesh are drawn, the others are only part of the hierarchy
         if (gltf_node->mesh) {
             node_t* node = &state.scene.nodes[state.scene.num_nodes++];
             node->mesh = gltf_mesh_index(gltf, gltf_node->mesh);
-            node->transform = build_transform_for_gltf_node(gltf, gltf_node);
+            node->hierarchy_node = hierarchy_index_map[node_index];
+            node->skin = gltf_node->skin ? (int)(gltf_node->skin - gltf->skins) : SCENE_INVALID_INDEX;
+            node->ozz = 0;
         }
     }
+    gltf_parse_skins(gltf, hierarchy_index_map);
+    free(hierarchy_index_map);
+    update_world_transforms();
+
+    // group the nodes by mesh, meshes used by more than one node are drawn instanced
+    int first_instance = 0;
+    for (int mesh_index = 0; mesh_index < state.scene.num_meshes; mesh_index++) {
+        mesh_t* mesh = &state.scene.meshes[mesh_index];
+        mesh->first_instance = first_instance;
+        mesh->num_instances = 0;
+        for (int node_index = 0; node_index < state.scene.num_nodes; node_index++) {
+            if (state.scene.nodes[node_index].mesh == mesh_index) {
+                state.scene.instance_nodes[first_instance + mesh->num_instances++] = node_index;
+            }
+        }
+        first_instance += mesh->num_instances;
+    }
+    if (state.scene.num_nodes > 0) {
+        state.scene.instance_buffer = sg_make_buffer(&(sg_buffer_desc){
+            .size = (size_t)state.scene.num_nodes * sizeof(hmm_mat4),
+            .usage = SG_USAGE_STREAM,
+        });
+    }
+}
+
+// index of a GLTF node in a skin's joints, or SCENE_INVALID_INDEX
+static int gltf_skin_joint_index(const cgltf_skin* skin, const cgltf_node* node) {
+    for (cgltf_size i = 0; i < skin->joints_count; i++) {
+        if (skin->joints[i] == node) {
+            return (int)i;
+        }
+    }
+    return SCENE_INVALID_INDEX;
+}
+
+// keyframes and inverse bind matrices are copied as is, so only
+// tightly packed float accessors are supported (no quantized keyframes)
+static bool gltf_accessor_is_packed_float(const cgltf_accessor* acc, cgltf_type type, cgltf_size num_floats) {
+    return acc && acc->buffer_view && !acc->is_sparse && (acc->count > 0) &&
+           (acc->component_type == cgltf_component_type_r_32f) &&
+           (acc->type == type) &&
+           (acc->stride == num_floats * sizeof(float));
 }
 
-// create the sokol-gfx buffer objects associated with a GLTF buffer view
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data) {
+// check if an animation channel can be converted for a skin
+static bool gltf_channel_supported(const cgltf_skin* skin, const cgltf_animation_channel* chn) {
+    if (!chn->target_node || (SCENE_INVALID_INDEX == gltf_skin_joint_index(skin, chn->target_node))) {
+        return false;
+    }
+    const cgltf_animation_sampler* smp = chn->sampler;
+    const cgltf_size num_values = (smp->interpolation == cgltf_interpolation_type_cubic_spline) ? 3 : 1;
+    switch (chn->target_path) {
+        case cgltf_animation_path_type_translation:
+        case cgltf_animation_path_type_scale:
+            return gltf_accessor_is_packed_float(smp->input, cgltf_type_scalar, 1) &&
+                   gltf_accessor_is_packed_float(smp->output, cgltf_type_vec3, 3) &&
+                   (smp->output->count == smp->input->count * num_values);
+        case cgltf_animation_path_type_rotation:
+            return gltf_accessor_is_packed_float(smp->input, cgltf_type_scalar, 1) &&
+                   gltf_accessor_is_packed_float(smp->output, cgltf_type_vec4, 4) &&
+                   (smp->output->count == smp->input->count * num_values);
+        default:
+            // morph target weights aren't supported
+            return false;
+    }
+}
+
+static ozz_gltf_path_t gltf_to_ozz_path(cgltf_animation_path_type path) {
+    switch (path) {
+        case cgltf_animation_path_type_rotation: return OZZ_GLTF_PATH_ROTATION;
+        case cgltf_animation_path_type_scale: return OZZ_GLTF_PATH_SCALE;
+        default: return OZZ_GLTF_PATH_TRANSLATION;
+    }
+}
+
+static ozz_gltf_interpolation_t gltf_to_ozz_interpolation(cgltf_interpolation_type interpolation) {
+    switch (interpolation) {
+        case cgltf_interpolation_type_step: return OZZ_GLTF_INTERPOLATION_STEP;
+        case cgltf_interpolation_type_cubic_spline: return OZZ_GLTF_INTERPOLATION_CUBICSPLINE;
+        default: return OZZ_GLTF_INTERPOLATION_LINEAR;
+    }
+}
+
+// reserve the space of an accessor's data in the skin data staging buffer, and record
+// the range to copy once the GLTF buffer has been loaded (nothing but the size while measuring)
+static const float* gltf_skin_data_range(arena_t* staging, const cgltf_data* gltf, const cgltf_accessor* acc, int skin_index) {
+    const size_t size = acc->count * acc->stride;
+    const float* ptr = (const float*) arena_alloc(staging, size, 1);
+    if (0 == staging->buf) {
+        return 0;
+    }
+    skin_range_params_t* p = &state.creation_params.skin_ranges[state.creation_params.num_skin_ranges++];
+    p->gltf_buffer_index = gltf_buffer_index(gltf, acc->buffer_view->buffer);
+    p->offset = (int) (acc->buffer_view->offset + acc->offset);
+    p->size = (int) size;
+    p->staging_offset = (int) ((const uint8_t*)ptr - staging->buf);
+    p->skin = skin_index;
+    p->copied = false;
+    state.scene.skins[skin_index].num_pending_ranges++;
+    return ptr;
+}
+
+// gather the inverse bind matrices and the supported channels of the first animation of
+// all skins, in the same order for measuring the staging buffer and for filling it in
+static void gltf_parse_skin_data(arena_t* staging, const cgltf_data* gltf) {
+    const cgltf_animation* anim = (gltf->animations_count > 0) ? &gltf->animations[0] : 0;
+    for (cgltf_size skin_index = 0; skin_index < gltf->skins_count; skin_index++) {
+        const cgltf_skin* gltf_skin = &gltf->skins[skin_index];
+        skin_t* skin = &state.scene.skins[skin_index];
+        if (gltf_accessor_is_packed_float(gltf_skin->inverse_bind_matrices, cgltf_type_mat4, 16) &&
+            (gltf_skin->inverse_bind_matrices->count == gltf_skin->joints_count))
+        {
+            const float* ibm = gltf_skin_data_range(staging, gltf, gltf_skin->inverse_bind_matrices, (int)skin_index);
+            if (staging->buf) {
+                skin->inverse_bind_matrices = ibm;
+            }
+        }
+        const cgltf_size num_anim_channels = anim ? anim->channels_count : 0;
+        for (cgltf_size chn_index = 0; chn_index < num_anim_channels; chn_index++) {
+            const cgltf_animation_channel* gltf_chn = &anim->channels[chn_index];
+            if (!gltf_channel_supported(gltf_skin, gltf_chn)) {
+                continue;
+            }
+            const float* times = gltf_skin_data_range(staging, gltf, gltf_chn->sampler->input, (int)skin_index);
+            const float* values = gltf_skin_data_range(staging, gltf, gltf_chn->sampler->output, (int)skin_index);
+            if (staging->buf) {
+                state.creation_params.channels[skin->first_channel + skin->num_channels++] = (ozz_gltf_channel_t){
+                    .joint = gltf_skin_joint_index(gltf_skin, gltf_chn->target_node),
+                    .path = gltf_to_ozz_path(gltf_chn->target_path),
+                    .interpolation = gltf_to_ozz_interpolation(gltf_chn->sampler->interpolation),
+                    .num_keys = (int) gltf_chn->sampler->input->count,
+                    .times = times,
+                    .values = values,
+                };
+            }
+        }
+    }
+}
+
+// parse the GLTF skins into the joint hierarchies for ozz-animation, the inverse bind matrices
+// and keyframes are copied into a staging buffer while the GLTF buffers are loading, since
+// the cgltf data is gone by then, skins without any data to load are imported right away
+static void gltf_parse_skins(const cgltf_data* gltf, const int* hierarchy_index_map) {
+    state.scene.num_skins = (int) gltf->skins_count;
+    if (0 == state.scene.num_skins) {
+        return;
+    }
+    const int num_anim_channels = (gltf->animations_count > 0) ? (int)gltf->animations[0].channels_count : 0;
+    int first_joint = 0;
+    for (int skin_index = 0; skin_index < state.scene.num_skins; skin_index++) {
+        const cgltf_skin* gltf_skin = &gltf->skins[skin_index];
+        skin_t* skin = &state.scene.skins[skin_index];
+        skin->first_joint = first_joint;
+        skin->num_joints = (int) gltf_skin->joints_count;
+        skin->first_channel = skin_index * num_anim_channels;
+        skin->skeleton_node = SCENE_INVALID_INDEX;
+        first_joint += skin->num_joints;
+        for (int i = 0; i < skin->num_joints; i++) {
+            const cgltf_node* gltf_node = gltf_skin->joints[i];
+            ozz_gltf_joint_t* joint = &state.creation_params.joints[skin->first_joint + i];
+            // the closest ancestor which is a joint of the same skin
+            joint->parent = SCENE_INVALID_INDEX;
+            const cgltf_node* ancestor = gltf_node->parent;
+            for (; ancestor && (joint->parent == SCENE_INVALID_INDEX); ancestor = ancestor->parent) {
+                joint->parent = gltf_skin_joint_index(gltf_skin, ancestor);
+            }
+            // the skeleton is placed by the parent node of its (first) root joint
+            if ((joint->parent == SCENE_INVALID_INDEX) && (skin->skeleton_node == SCENE_INVALID_INDEX) && gltf_node->parent) {
+                skin->skeleton_node = hierarchy_index_map[gltf_node->parent - gltf->nodes];
+            }
+            const float identity_rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            const float identity_scale[3] = { 1.0f, 1.0f, 1.0f };
+            memcpy(joint->translation, gltf_node->translation, sizeof(joint->translation));
+            memcpy(joint->rotation, gltf_node->has_rotation ? gltf_node->rotation : identity_rotation, sizeof(joint->rotation));
+            memcpy(joint->scale, gltf_node->has_scale ? gltf_node->scale : identity_scale, sizeof(joint->scale));
+            joint->has_matrix = gltf_node->has_matrix;
+            memcpy(joint->matrix, gltf_node->matrix, sizeof(joint->matrix));
+        }
+    }
+
+    // first measure, then allocate the staging buffer and record the data ranges
+    arena_t staging = { 0 };
+    gltf_parse_skin_data(&staging, gltf);
+    staging.size = staging.offset;
+    staging.offset = 0;
+    staging.buf = (uint8_t*) malloc(staging.size > 0 ? staging.size : 1);
+    gltf_parse_skin_data(&staging, gltf);
+    state.creation_params.skin_data = staging.buf;
+    state.creation_params.num_pending_skins = state.scene.num_skins;
+    for (int skin_index = 0; skin_index < state.scene.num_skins; skin_index++) {
+        if (state.scene.skins[skin_index].num_pending_ranges == 0) {
+            create_ozz_asset_for_skin(skin_index);
+        }
+    }
+}
+
+// copy the completely loaded skin data ranges of a partially loaded GLTF buffer into the
+// staging buffer, and import the skins whose data is complete, returns true if all skin
+// data ranges of the GLTF buffer have been copied
+static bool copy_skin_data_for_gltf_buffer(int gltf_buffer_index, const uint8_t* data, size_t loaded_size) {
+    bool all_copied = true;
+    for (int i = 0; i < state.creation_params.num_skin_ranges; i++) {
+        skin_range_params_t* p = &state.creation_params.skin_ranges[i];
+        if ((p->gltf_buffer_index != gltf_buffer_index) || p->copied) {
+            continue;
+        }
+        if ((size_t)(p->offset + p->size) > loaded_size) {
+            all_copied = false;
+            continue;
+        }
+        memcpy(state.creation_params.skin_data + p->staging_offset, data + p->offset, (size_t)p->size);
+        p->copied = true;
+        assert(state.scene.skins[p->skin].num_pending_ranges > 0);
+        if (--state.scene.skins[p->skin].num_pending_ranges == 0) {
+            create_ozz_asset_for_skin(p->skin);
+        }
+    }
+    return all_copied;
+}
+
+// convert a skin and its animation channels into a (possibly cached) ozz-animation asset,
+// and create the animation instances of all nodes using the skin, the staging buffer is
+// freed once the last skin has been imported
+static void create_ozz_asset_for_skin(int skin_index) {
+    skin_t* skin = &state.scene.skins[skin_index];
+    assert(0 == skin->asset);
+    skin->asset = ozz_gltf_import(&(ozz_gltf_desc_t){
+        .num_joints = skin->num_joints,
+        .joints = &state.creation_params.joints[skin->first_joint],
+        .inverse_bind_matrices = skin->inverse_bind_matrices,
+        .num_channels = skin->num_channels,
+        .channels = &state.creation_params.channels[skin->first_channel],
+    });
+    if (ozz_load_failed(skin->asset)) {
+        state.failed = true;
+    } else {
+        for (int i = 0; i < state.scene.num_nodes; i++) {
+            node_t* node = &state.scene.nodes[i];
+            if ((node->skin == skin_index) && (state.scene.num_skin_instances < SKIN_MAX_INSTANCES)) {
+                node->ozz = ozz_create_instance(skin->asset, state.scene.num_skin_instances);
+                state.scene.skin_instances[state.scene.num_skin_instances++] = node->ozz;
+            }
+        }
+    }
+    skin->inverse_bind_matrices = 0;
+    assert(state.creation_params.num_pending_skins > 0);
+    if (--state.creation_params.num_pending_skins == 0) {
+        free(state.creation_params.skin_data);
+        state.creation_params.skin_data = 0;
+    }
+}
+
+// check if the positions needed to optimize the indices of a buffer view have been
+// loaded, positions in a different GLTF buffer are ignored by the optimization
+static bool index_optimization_ready(int buffer_view_index, size_t loaded_size) {
+    const buffer_creation_params_t* buf_params = &state.creation_params.buffers[buffer_view_index];
+    for (int i = buf_params->first_index_optimization; i != SCENE_INVALID_INDEX; i = state.creation_params.primitives[i].next) {
+        const index_optimization_params_t* p = &state.creation_params.primitives[i];
+        if (p->position_gltf_buffer_index == buf_params->gltf_buffer_index) {
+            const size_t positions_end = (size_t)p->position_offset + (size_t)(p->num_vertices - 1) * (size_t)p->position_stride + 3 * sizeof(float);
+            if (positions_end > loaded_size) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// reorder the triangles of all primitives with index data in a buffer view
+// for the vertex cache (and against overdraw if the positions are in the same buffer),
+// this must happen before the index buffer is created from the data
+static void optimize_indices_for_buffer_view(int buffer_view_index, uint8_t* data) {
+    const buffer_creation_params_t* buf_params = &state.creation_params.buffers[buffer_view_index];
+    for (int i = buf_params->first_index_optimization; i != SCENE_INVALID_INDEX; i = state.creation_params.primitives[i].next) {
+        const index_optimization_params_t* p = &state.creation_params.primitives[i];
+        assert(p->valid && (p->index_buffer == buffer_view_index));
+        const size_t num_indices = (size_t)p->num_indices;
+        const size_t num_vertices = (size_t)p->num_vertices;
+        uint8_t* src = data + p->index_offset;
+        uint32_t* indices = (uint32_t*) malloc(num_indices * sizeof(uint32_t));
+        if (!indices) {
+            // keep the original triangle order
+            continue;
+        }
+        for (size_t n = 0; n < num_indices; n++) {
+            indices[n] = p->index_32bit ? ((const uint32_t*)src)[n] : ((const uint16_t*)src)[n];
+        }
+        const float acmr_before = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+        meshopt_optimize_vertex_cache(indices, num_indices, num_vertices);
+        if (p->position_gltf_buffer_index == buf_params->gltf_buffer_index) {
+            const float* positions = (const float*)(data + p->position_offset);
+            meshopt_optimize_overdraw(indices, num_indices, positions, num_vertices, (size_t)p->position_stride, 1.05f);
+        }
+        const float acmr_after = meshopt_acmr(indices, num_indices, num_vertices, MESHOPT_DEFAULT_CACHE_SIZE);
+        for (size_t n = 0; n < num_indices; n++) {
+            if (p->index_32bit) {
+                ((uint32_t*)src)[n] = indices[n];
+            } else {
+                ((uint16_t*)src)[n] = (uint16_t)indices[n];
+            }
+        }
+        free(indices);
+        const int num_triangles = p->num_indices / 3;
+        state.meshopt.num_triangles += num_triangles;
+        state.meshopt.misses_before += acmr_before * (float)num_triangles;
+        state.meshopt.misses_after += acmr_after * (float)num_triangles;
+    }
+}
+
+// create the sokol-gfx buffer objects of all completely loaded buffer views of a
+// partially loaded GLTF buffer, returns true if all buffer views have been created
+static bool create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, uint8_t* data, size_t loaded_size) {
+    bool all_created = true;
     for (int i = 0; i < state.scene.num_buffers; i++) {
-        const buffer_creation_params_t* p = &state.creation_params.buffers[i];
-        if (p->gltf_buffer_index == gltf_buffer_index) {
-            assert((size_t)(p->offset + p->size) <= data.size);
-            sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){
-                .type = p->type,
-                .data = {
-                    .ptr = (const uint8_t*)data.ptr + p->offset,
-                    .size = (size_t)p->size,
-                }
-            });
+        buffer_creation_params_t* p = &state.creation_params.buffers[i];
+        if ((p->gltf_buffer_index != gltf_buffer_index) || p->created) {
+            continue;
         }
+        if (((size_t)(p->offset + p->size) > loaded_size) || !index_optimization_ready(i, loaded_size)) {
+            all_created = false;
+            continue;
+        }
+        optimize_indices_for_buffer_view(i, data);
+        sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){
+            .type = p->type,
+            .data = {
+                .ptr = data + p->offset,
+                .size = (size_t)p->size,
+            }
+        });
+        p->created = true;
     }
+    return all_created;
 }
 
-// create the sokol-gfx image objects associated with a GLTF image
+// create the sokol-gfx images embedded in the completely loaded buffer views of a
+// partially loaded GLTF buffer, returns true if all embedded images have been created
+static bool create_sg_image_samplers_for_gltf_buffer(int gltf_buffer_index, const uint8_t* data, size_t loaded_size) {
+    bool all_created = true;
+    for (int i = 0; i < state.loader.num_images; i++) {
+        embedded_image_params_t* p = &state.creation_params.embedded_images[i];
+        if ((p->gltf_buffer_index != gltf_buffer_index) || p->created) {
+            continue;
+        }
+        if ((size_t)(p->offset + p->size) > loaded_size) {
+            all_created = false;
+            continue;
+        }
+        create_sg_image_samplers_for_gltf_image(i, (sg_range){ data + p->offset, (size_t)p->size });
+        p->created = true;
+    }
+    return all_created;
+}
+
+// start transcoding a GLTF image on the Basis Universal worker threads, the
+// data is copied so the caller can free it right away
 static void create_sg_image_samplers_for_gltf_image(int gltf_image_index, sg_range data) {
+    sbasisu_transcode_async(&(sbasisu_request_t){
+        .data = data,
+        .callback = gltf_image_transcode_callback,
+        .user_data = SG_RANGE(gltf_image_index),
+    });
+}
+
+// create the sokol-gfx image objects associated with a transcoded GLTF image,
+// called from sbasisu_dowork() on the render thread
+static void gltf_image_transcode_callback(const sbasisu_response_t* response) {
+    if (response->failed) {
+        state.failed = true;
+        return;
+    }
+    const int gltf_image_index = *(const int*)response->user_data;
     for (int i = 0; i < state.scene.num_images; i++) {
         image_sampler_creation_params_t* p = &state.creation_params.images[i];
         if (p->gltf_image_index == gltf_image_index) {
-            state.scene.image_samplers[i].img = sbasisu_make_image(data);
+            state.scene.image_samplers[i].img = sg_make_image(response->desc);
             state.scene.image_samplers[i].smp = sg_make_sampler(&(sg_sampler_desc){
                 .min_filter = p->min_filter,
                 .mag_filter = p->mag_filter,
@@ -828,6 +1926,11 @@ static sg_vertex_format gltf_to_vertex_format(cgltf_accessor* acc) {
                 default: break;
             }
             break;
+        case cgltf_component_type_r_16u:
+            if ((acc->type == cgltf_type_vec4) && acc->normalized) {
+                return SG_VERTEXFORMAT_USHORT4N;
+            }
+            break;
         case cgltf_component_type_r_32f:
             switch (acc->type) {
                 case cgltf_type_scalar: return SG_VERTEXFORMAT_FLOAT;
@@ -842,11 +1945,14 @@ static sg_vertex_format gltf_to_vertex_format(cgltf_accessor* acc) {
     return SG_VERTEXFORMAT_INVALID;
 }
 
-static int gltf_attr_type_to_vs_input_slot(cgltf_attribute_type attr_type) {
-    switch (attr_type) {
+// the skinned vertex shader has the same attribute locations, plus the first set of joints and weights
+static int gltf_attr_to_vs_input_slot(const cgltf_attribute* attr, bool skinned) {
+    switch (attr->type) {
         case cgltf_attribute_type_position: return ATTR_vs_position;
         case cgltf_attribute_type_normal: return ATTR_vs_normal;
         case cgltf_attribute_type_texcoord: return ATTR_vs_texcoord;
+        case cgltf_attribute_type_joints: return (skinned && (attr->index == 0)) ? ATTR_vs_skin_joints : SCENE_INVALID_INDEX;
+        case cgltf_attribute_type_weights: return (skinned && (attr->index == 0)) ? ATTR_vs_skin_weights : SCENE_INVALID_INDEX;
         default: return SCENE_INVALID_INDEX;
     }
 }
@@ -898,13 +2004,21 @@ static vertex_buffer_mapping_t create_vertex_buffer_mapping_for_gltf_primitive(c
     return map;
 }
 
-static sg_vertex_layout_state create_sg_layout_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map) {
+static sg_vertex_layout_state create_sg_layout_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map, bool skinned) {
     assert(prim->attributes_count <= SG_MAX_VERTEX_ATTRIBUTES);
     sg_vertex_layout_state layout = { 0 };
     for (cgltf_size attr_index = 0; attr_index < prim->attributes_count; attr_index++) {
         const cgltf_attribute* attr = &prim->attributes[attr_index];
-        int attr_slot = gltf_attr_type_to_vs_input_slot(attr->type);
-        if (attr_slot != SCENE_INVALID_INDEX) {
+        int attr_slot = gltf_attr_to_vs_input_slot(attr, skinned);
+        if (attr_slot == SCENE_INVALID_INDEX) {
+            continue;
+        }
+        if (attr->type == cgltf_attribute_type_joints) {
+            // integer vertex formats can't be read as floats everywhere, so the joint
+            // indices are normalized and scaled back in the vertex shader
+            const bool ushort = attr->data->component_type == cgltf_component_type_r_16u;
+            layout.attrs[attr_slot].format = ushort ? SG_VERTEXFORMAT_USHORT4N : SG_VERTEXFORMAT_UBYTE4N;
+        } else {
             layout.attrs[attr_slot].format = gltf_to_vertex_format(attr->data);
         }
         int buffer_view_index = gltf_bufferview_index(gltf, attr->data->buffer_view);
@@ -928,6 +2042,25 @@ static bool pipelines_equal(const pipeline_cache_params_t* p0, const pipeline_ca
     if (p0->index_type != p1->index_type) {
         return false;
     }
+    if (p0->metallic != p1->metallic) {
+        return false;
+    }
+    if (p0->instanced != p1->instanced) {
+        return false;
+    }
+    if (p0->skinned != p1->skinned) {
+        return false;
+    }
+    for (int i = 0; i < SG_MAX_VERTEX_BUFFERS; i++) {
+        const sg_buffer_layout_state* b0 = &p0->layout.buffers[i];
+        const sg_buffer_layout_state* b1 = &p1->layout.buffers[i];
+        if ((b0->stride != b1->stride) ||
+            (b0->step_func != b1->step_func) ||
+            (b0->step_rate != b1->step_rate))
+        {
+            return false;
+        }
+    }
     for (int i = 0; i < SG_MAX_VERTEX_ATTRIBUTES; i++) {
         const sg_vertex_attr_state* a0 = &p0->layout.attrs[i];
         const sg_vertex_attr_state* a1 = &p1->layout.attrs[i];
@@ -941,78 +2074,256 @@ static bool pipelines_equal(const pipeline_cache_params_t* p0, const pipeline_ca
     return true;
 }
 
+// FNV-1a over the pipeline params fields (not the raw struct bytes, which may contain padding)
+static uint64_t hash_u32(uint64_t hash, uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        hash ^= (val >> (i * 8)) & 0xFF;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t pipeline_params_hash(const pipeline_cache_params_t* p) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = hash_u32(hash, (uint32_t)p->prim_type);
+    hash = hash_u32(hash, (uint32_t)p->index_type);
+    hash = hash_u32(hash, (p->alpha ? 1u : 0u) | (p->metallic ? 2u : 0u) | (p->instanced ? 4u : 0u) | (p->skinned ? 8u : 0u));
+    for (int i = 0; i < SG_MAX_VERTEX_BUFFERS; i++) {
+        const sg_buffer_layout_state* b = &p->layout.buffers[i];
+        hash = hash_u32(hash, (uint32_t)b->stride);
+        hash = hash_u32(hash, (uint32_t)b->step_func);
+        hash = hash_u32(hash, (uint32_t)b->step_rate);
+    }
+    for (int i = 0; i < SG_MAX_VERTEX_ATTRIBUTES; i++) {
+        const sg_vertex_attr_state* a = &p->layout.attrs[i];
+        hash = hash_u32(hash, (uint32_t)a->buffer_index);
+        hash = hash_u32(hash, (uint32_t)a->offset);
+        hash = hash_u32(hash, (uint32_t)a->format);
+    }
+    return hash;
+}
+
+// returns the hash table slot for a hash, which is either empty or holds a matching item
+static int pip_cache_find_slot(uint64_t hash, const pipeline_cache_params_t* params) {
+    const int mask = state.pip_cache.num_slots - 1;
+    int slot = (int)(hash & (uint64_t)mask);
+    while (state.pip_cache.slots[slot] != 0) {
+        const pipeline_cache_item_t* item = &state.pip_cache.items[state.pip_cache.slots[slot] - 1];
+        if ((item->hash == hash) && pipelines_equal(&item->params, params)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// grow the hash table to keep the load factor below 1/2, and rehash the items
+static void pip_cache_grow_slots(void) {
+    free(state.pip_cache.slots);
+    state.pip_cache.num_slots = (state.pip_cache.num_slots == 0) ? 64 : (state.pip_cache.num_slots * 2);
+    state.pip_cache.slots = (int*) calloc((size_t)state.pip_cache.num_slots, sizeof(int));
+    const int mask = state.pip_cache.num_slots - 1;
+    for (int i = 0; i < state.pip_cache.num_items; i++) {
+        int slot = (int)(state.pip_cache.items[i].hash & (uint64_t)mask);
+        while (state.pip_cache.slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        state.pip_cache.slots[slot] = i + 1;
+    }
+}
+
+static void pip_cache_shutdown(void) {
+    for (int i = 0; i < state.pip_cache.num_items; i++) {
+        sg_destroy_pipeline(state.pip_cache.items[i].pip);
+    }
+    free(state.pip_cache.items);
+    free(state.pip_cache.slots);
+    memset(&state.pip_cache, 0, sizeof(state.pip_cache));
+}
+
 // Create a unique sokol-gfx pipeline object for GLTF primitive (aka submesh),
-// maintains a cache of shared, unique pipeline objects. Returns an index
-// into state.scene.pipelines
-static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map) {
+// maintains a hashed cache of shared, unique pipeline objects. Returns an index
+// into state.pip_cache.items. The instanced variant reads the model matrix
+// from a per-instance vertex buffer in the bind slot after the primitive's
+// vertex buffers. The skinned variant additionally reads joint indices and weights.
+static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map, bool instanced, bool skinned) {
+    assert(!(instanced && skinned));
     pipeline_cache_params_t pip_params = {
-        .layout = create_sg_layout_for_gltf_primitive(gltf, prim, vbuf_map),
+        .layout = create_sg_layout_for_gltf_primitive(gltf, prim, vbuf_map, skinned),
         .prim_type = gltf_to_prim_type(prim->type),
         .index_type = gltf_to_index_type(prim),
-        .alpha = prim->material->alpha_mode != cgltf_alpha_mode_opaque
+        .alpha = prim->material->alpha_mode != cgltf_alpha_mode_opaque,
+        .metallic = prim->material->has_pbr_metallic_roughness,
+        .instanced = instanced,
+        .skinned = skinned,
     };
-    int i = 0;
-    for (; i < state.scene.num_pipelines; i++) {
-        if (pipelines_equal(&state.pip_cache.items[i], &pip_params)) {
-            // an indentical pipeline already exists, reuse this
-            assert(state.scene.pipelines[i].id != SG_INVALID_ID);
-            return i;
-        }
-    }
-    if ((i == state.scene.num_pipelines) && (state.scene.num_pipelines < SCENE_MAX_PIPELINES)) {
-        state.pip_cache.items[i] = pip_params;
-        const bool is_metallic = prim->material->has_pbr_metallic_roughness;
-        state.scene.pipelines[i] = sg_make_pipeline(&(sg_pipeline_desc){
-            .layout = pip_params.layout,
-            .shader = is_metallic ? state.shaders.metallic : state.shaders.specular,
-            .primitive_type = pip_params.prim_type,
-            .index_type = pip_params.index_type,
-            .cull_mode = SG_CULLMODE_BACK,
-            .face_winding = SG_FACEWINDING_CCW,
-            .depth = {
-                .write_enabled = !pip_params.alpha,
-                .compare = SG_COMPAREFUNC_LESS_EQUAL,
-            },
-            .colors[0] = {
-                .write_mask = pip_params.alpha ? SG_COLORMASK_RGB : 0,
-                .blend = {
-                    .enabled = pip_params.alpha,
-                    .src_factor_rgb = pip_params.alpha ? SG_BLENDFACTOR_SRC_ALPHA : 0,
-                    .dst_factor_rgb = pip_params.alpha ? SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA : 0,
-                },
-            }
-        });
-        state.scene.num_pipelines++;
+    if (instanced) {
+        const int inst_slot = vbuf_map->num;
+        assert(inst_slot < SG_MAX_VERTEX_BUFFERS);
+        pip_params.layout.buffers[inst_slot].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+        pip_params.layout.attrs[ATTR_vs_inst_inst_mat0] = (sg_vertex_attr_state){ .buffer_index = inst_slot, .format = SG_VERTEXFORMAT_FLOAT4 };
+        pip_params.layout.attrs[ATTR_vs_inst_inst_mat1] = (sg_vertex_attr_state){ .buffer_index = inst_slot, .format = SG_VERTEXFORMAT_FLOAT4 };
+        pip_params.layout.attrs[ATTR_vs_inst_inst_mat2] = (sg_vertex_attr_state){ .buffer_index = inst_slot, .format = SG_VERTEXFORMAT_FLOAT4 };
+        pip_params.layout.attrs[ATTR_vs_inst_inst_mat3] = (sg_vertex_attr_state){ .buffer_index = inst_slot, .format = SG_VERTEXFORMAT_FLOAT4 };
+    }
+    if ((state.pip_cache.num_items + 1) * 2 > state.pip_cache.num_slots) {
+        pip_cache_grow_slots();
+    }
+    const uint64_t hash = pipeline_params_hash(&pip_params);
+    const int slot = pip_cache_find_slot(hash, &pip_params);
+    if (state.pip_cache.slots[slot] != 0) {
+        // an indentical pipeline already exists, reuse this
+        const int i = state.pip_cache.slots[slot] - 1;
+        assert(state.pip_cache.items[i].pip.id != SG_INVALID_ID);
+        return i;
+    }
+    if (state.pip_cache.num_items == state.pip_cache.max_items) {
+        state.pip_cache.max_items = (state.pip_cache.max_items == 0) ? 16 : (state.pip_cache.max_items * 2);
+        state.pip_cache.items = (pipeline_cache_item_t*) realloc(state.pip_cache.items, (size_t)state.pip_cache.max_items * sizeof(pipeline_cache_item_t));
     }
-    assert(state.scene.num_pipelines <= SCENE_MAX_PIPELINES);
+    const int i = state.pip_cache.num_items++;
+    state.pip_cache.slots[slot] = i + 1;
+    pipeline_cache_item_t* item = &state.pip_cache.items[i];
+    item->hash = hash;
+    item->params = pip_params;
+    sg_shader metallic_shader = state.shaders.metallic;
+    if (instanced) {
+        metallic_shader = state.shaders.metallic_instanced;
+    } else if (skinned) {
+        metallic_shader = state.shaders.metallic_skinned;
+    }
+    item->pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = pip_params.layout,
+        .shader = pip_params.metallic ? metallic_shader : state.shaders.specular,
+        .primitive_type = pip_params.prim_type,
+        .index_type = pip_params.index_type,
+        .cull_mode = SG_CULLMODE_BACK,
+        .face_winding = SG_FACEWINDING_CCW,
+        .depth = {
+            .write_enabled = !pip_params.alpha,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+        },
+        .colors[0] = {
+            .write_mask = pip_params.alpha ? SG_COLORMASK_RGB : 0,
+            .blend = {
+                .enabled = pip_params.alpha,
+                .src_factor_rgb = pip_params.alpha ? SG_BLENDFACTOR_SRC_ALPHA : 0,
+                .dst_factor_rgb = pip_params.alpha ? SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA : 0,
+            },
+        }
+    });
     return i;
 }
 
-static hmm_mat4 build_transform_for_gltf_node(const cgltf_data* gltf, const cgltf_node* node) {
-    hmm_mat4 parent_tform = HMM_Mat4d(1);
-    if (node->parent) {
-        parent_tform = build_transform_for_gltf_node(gltf, node->parent);
+// set the local transform of a hierarchy node, its world transform and the
+// world transforms of its children are updated in the next update_scene()
+static void hierarchy_set_trs(int node_index, hmm_vec3 translation, hmm_quaternion rotation, hmm_vec3 scale) {
+    hierarchy_t* h = &state.scene.hierarchy;
+    assert((node_index >= 0) && (node_index < h->num_nodes));
+    h->translations[node_index] = translation;
+    h->rotations[node_index] = rotation;
+    h->scales[node_index] = scale;
+    h->dirty[node_index] = true;
+    if (node_index < h->first_dirty) {
+        h->first_dirty = node_index;
     }
-    if (node->has_matrix) {
-        // needs testing, not sure if the element order is correct
-        hmm_mat4 tform = *(hmm_mat4*)node->matrix;
-        return tform;
-    } else {
-        hmm_mat4 translate = HMM_Mat4d(1);
-        hmm_mat4 rotate = HMM_Mat4d(1);
-        hmm_mat4 scale = HMM_Mat4d(1);
-        if (node->has_translation) {
-            translate = HMM_Translate(HMM_Vec3(node->translation[0], node->translation[1], node->translation[2]));
+}
+
+// Update the world transforms of all dirty nodes and their children in one linear
+// sweep. Since parents come before their children, a parent's world transform and
+// dirty flag are final when its children are reached, and everything before the
+// first dirty node is skipped.
+static void update_world_transforms(void) {
+    hierarchy_t* h = &state.scene.hierarchy;
+    h->num_updated = 0;
+    for (int i = h->first_dirty; i < h->num_nodes; i++) {
+        const int parent = h->parents[i];
+        if ((parent != SCENE_INVALID_INDEX) && h->dirty[parent]) {
+            h->dirty[i] = true;
+        }
+        if (!h->dirty[i]) {
+            continue;
+        }
+        if (!h->has_matrix[i]) {
+            const hmm_mat4 translate = HMM_Translate(h->translations[i]);
+            const hmm_mat4 rotate = HMM_QuaternionToMat4(h->rotations[i]);
+            const hmm_mat4 scale = HMM_Scale(h->scales[i]);
+            h->local_transforms[i] = HMM_MultiplyMat4(translate, HMM_MultiplyMat4(rotate, scale));
+        }
+        if (parent == SCENE_INVALID_INDEX) {
+            h->world_transforms[i] = h->local_transforms[i];
+        } else {
+            h->world_transforms[i] = HMM_MultiplyMat4(h->world_transforms[parent], h->local_transforms[i]);
+        }
+        h->num_updated++;
+    }
+    // the flags can only be cleared after the sweep, since children are checking them
+    for (int i = h->first_dirty; i < h->num_nodes; i++) {
+        h->dirty[i] = false;
+    }
+    h->first_dirty = h->num_nodes;
+}
+
+#if !defined(NDEBUG)
+// debug check that the incremental update matches a full rebuild of all world transforms,
+// the full rebuild does the same math for every node, so the results must be identical
+static void check_world_transforms(void) {
+    hierarchy_t* h = &state.scene.hierarchy;
+    const size_t size = (size_t)h->num_nodes * sizeof(hmm_mat4);
+    hmm_mat4* incremental = (hmm_mat4*) malloc(size > 0 ? size : 1);
+    memcpy(incremental, h->world_transforms, size);
+    const int num_updated = h->num_updated;
+    for (int i = 0; i < h->num_nodes; i++) {
+        h->dirty[i] = true;
+    }
+    h->first_dirty = 0;
+    update_world_transforms();
+    assert(0 == memcmp(incremental, h->world_transforms, size));
+    h->num_updated = num_updated;
+    free(incremental);
+}
+#endif
+
+// spin a node and its subtree around the node's Y axis while the N key
+// toggle is on, this exercises the incremental world transform update,
+// the first node with children is picked (nodes with a matrix can't be
+// rotated), and gets its original rotation back when toggled off
+static void update_node_anim(void) {
+    hierarchy_t* h = &state.scene.hierarchy;
+    if (state.node_anim.enabled && !state.node_anim.running) {
+        int node_index = SCENE_INVALID_INDEX;
+        for (int i = 0; i < h->num_nodes; i++) {
+            const int parent = h->parents[i];
+            if ((parent != SCENE_INVALID_INDEX) && !h->has_matrix[parent]) {
+                node_index = parent;
+                break;
+            }
         }
-        if (node->has_rotation) {
-            rotate = HMM_QuaternionToMat4(HMM_Quaternion(node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3]));
+        for (int i = 0; (i < h->num_nodes) && (node_index == SCENE_INVALID_INDEX); i++) {
+            if (!h->has_matrix[i]) {
+                node_index = i;
+            }
         }
-        if (node->has_scale) {
-            scale = HMM_Scale(HMM_Vec3(node->scale[0], node->scale[1], node->scale[2]));
+        if (node_index == SCENE_INVALID_INDEX) {
+            return;
         }
-        // NOTE: not sure if the multiplication order is correct
-        return HMM_MultiplyMat4(parent_tform, HMM_MultiplyMat4(HMM_MultiplyMat4(scale, rotate), translate));
+        state.node_anim.running = true;
+        state.node_anim.node = node_index;
+        state.node_anim.rotation = h->rotations[node_index];
+        state.node_anim.angle = 0.0f;
+    }
+    if (!state.node_anim.running) {
+        return;
+    }
+    const int node_index = state.node_anim.node;
+    hmm_quaternion rotation = state.node_anim.rotation;
+    if (state.node_anim.enabled) {
+        state.node_anim.angle += (float)sapp_frame_duration();
+        rotation = HMM_MultiplyQuaternion(rotation, HMM_QuaternionFromAxisAngle(HMM_Vec3(0.0f, 1.0f, 0.0f), state.node_anim.angle));
+    } else {
+        state.node_anim.running = false;
     }
+    hierarchy_set_trs(node_index, h->translations[node_index], rotation, h->scales[node_index]);
 }
 
 static void update_scene(void) {
@@ -1021,10 +2332,31 @@ static void update_scene(void) {
     state.ry += 2.0f;
     */
     state.root_transform = HMM_Rotate(state.rx, HMM_Vec3(0, 1, 0));
+    update_node_anim();
+    update_world_transforms();
+    #if !defined(NDEBUG)
+    if (state.node_anim.running) {
+        check_world_transforms();
+    }
+    #endif
+}
+
+// advance the animation of all skinned nodes, and upload their joint matrices
+static void update_skins(void) {
+    state.anim_time += sapp_frame_duration();
+    if (state.scene.num_skin_instances > 0) {
+        ozz_update_instances(state.scene.skin_instances, state.scene.num_skin_instances, state.anim_time);
+        ozz_update_joint_texture();
+    }
+}
+
+// the world transform of a mesh node
+static hmm_mat4 node_world_transform(int node_index) {
+    return state.scene.hierarchy.world_transforms[state.scene.nodes[node_index].hierarchy_node];
 }
 
 static vs_params_t vs_params_for_node(int node_index) {
-    hmm_mat4 model_transform = HMM_MultiplyMat4(state.root_transform, state.scene.nodes[node_index].transform);
+    hmm_mat4 model_transform = HMM_MultiplyMat4(state.root_transform, node_world_transform(node_index));
     vs_params_t vs_params = {
         .model = model_transform,
         .view_proj = state.camera.view_proj,
@@ -1033,9 +2365,295 @@ static vs_params_t vs_params_for_node(int node_index) {
     return vs_params;
 }
 
+// the joint matrices of a skinned node are relative to the parent of the skeleton's
+// root joint, the transform of the skinned mesh node itself is ignored (as in the GLTF spec)
+static vs_skin_params_t vs_skin_params_for_node(int node_index, const pipeline_cache_params_t* pip_params) {
+    const node_t* node = &state.scene.nodes[node_index];
+    const skin_t* skin = &state.scene.skins[node->skin];
+    hmm_mat4 model_transform = state.root_transform;
+    if (skin->skeleton_node != SCENE_INVALID_INDEX) {
+        model_transform = HMM_MultiplyMat4(model_transform, state.scene.hierarchy.world_transforms[skin->skeleton_node]);
+    }
+    const bool ushort_joints = pip_params->layout.attrs[ATTR_vs_skin_joints].format == SG_VERTEXFORMAT_USHORT4N;
+    vs_skin_params_t vs_skin_params = {
+        .model = model_transform,
+        .view_proj = state.camera.view_proj,
+        .eye_pos = state.camera.eye_pos,
+        .joint_index_scale = ushort_joints ? 65535.0f : 255.0f,
+        .joint_params = HMM_Vec4(ozz_joint_texture_u(node->ozz), ozz_joint_texture_v(node->ozz), ozz_joint_texture_pixel_width(), 0.0f),
+    };
+    return vs_skin_params;
+}
+
+// render queue sort key layout for opaque draws, from most to least significant bits:
+//
+//  63:      alpha-blended flag (alpha-blended draws go after opaque draws)
+//  52..62:  pipeline index
+//  40..51:  material index
+//  30..39:  first vertex buffer index
+//  20..29:  index buffer index
+//  0..19:   quantized view depth (front-to-back)
+//
+// alpha-blended draws must be drawn back-to-front regardless of their state,
+// so the depth goes right below the alpha-blended flag:
+//
+//  63:      alpha-blended flag
+//  43..62:  quantized inverted view depth (back-to-front)
+//  32..42:  pipeline index
+//  20..31:  material index
+//  10..19:  first vertex buffer index
+//  0..9:    index buffer index
+//
+// indices which don't fit into their bit range only degrade the draw order,
+// redundant state is detected by comparing the actual state in draw_render_queue()
+#define RENDER_QUEUE_DEPTH_BITS (20)
+
+static uint64_t sort_key_bits(int val, int num_bits, int shift) {
+    return ((uint64_t)(uint32_t)val & ((1ULL << num_bits) - 1)) << shift;
+}
+
+static uint64_t sort_key_for_draw(int node_index, int prim_index, int pip_index) {
+    const primitive_t* prim = &state.scene.primitives[prim_index];
+    const bool alpha = state.pip_cache.items[pip_index].params.alpha;
+    // view space depth of the node origin, normalized to the camera's far plane
+    const hmm_mat4 model = HMM_MultiplyMat4(state.root_transform, node_world_transform(node_index));
+    const hmm_vec4 view_pos = HMM_MultiplyMat4ByVec4(state.camera.view, HMM_Vec4(model.Elements[3][0], model.Elements[3][1], model.Elements[3][2], 1.0f));
+    float depth = -view_pos.Z / state.camera.farz;
+    depth = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+    const int max_depth = (1 << RENDER_QUEUE_DEPTH_BITS) - 1;
+    if (alpha) {
+        return sort_key_bits(1, 1, 63) |
+               sort_key_bits((int)((1.0f - depth) * (float)max_depth), RENDER_QUEUE_DEPTH_BITS, 43) |
+               sort_key_bits(pip_index, 11, 32) |
+               sort_key_bits(prim->material, 12, 20) |
+               sort_key_bits(prim->vertex_buffers.buffer[0], 10, 10) |
+               sort_key_bits(prim->index_buffer, 10, 0);
+    }
+    else {
+        return sort_key_bits(pip_index, 11, 52) |
+               sort_key_bits(prim->material, 12, 40) |
+               sort_key_bits(prim->vertex_buffers.buffer[0], 10, 30) |
+               sort_key_bits(prim->index_buffer, 10, 20) |
+               sort_key_bits((int)(depth * (float)max_depth), RENDER_QUEUE_DEPTH_BITS, 0);
+    }
+}
+
+static int draw_item_cmp(const void* a, const void* b) {
+    const uint64_t ka = ((const draw_item_t*)a)->key;
+    const uint64_t kb = ((const draw_item_t*)b)->key;
+    return (ka < kb) ? -1 : ((ka > kb) ? 1 : 0);
+}
+
+// write the world space transforms of all nodes into the instance buffer,
+// grouped by mesh so that each mesh's instances are a contiguous range
+static void update_instance_buffer(void) {
+    if (state.scene.num_nodes == 0) {
+        return;
+    }
+    for (int i = 0; i < state.scene.num_nodes; i++) {
+        state.instance_transforms[i] = HMM_MultiplyMat4(state.root_transform, node_world_transform(state.scene.instance_nodes[i]));
+    }
+    sg_update_buffer(state.scene.instance_buffer, &(sg_range){
+        .ptr = state.instance_transforms,
+        .size = (size_t)state.scene.num_nodes * sizeof(hmm_mat4),
+    });
+}
+
+// a primitive can be drawn as soon as its own buffers and material textures have
+// been created, without waiting for the rest of the scene to finish loading
+static bool primitive_ready(primitive_t* prim) {
+    if (prim->ready) {
+        return true;
+    }
+    for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
+        if (!state.creation_params.buffers[prim->vertex_buffers.buffer[vb_slot]].created) {
+            return false;
+        }
+    }
+    if ((prim->index_buffer != SCENE_INVALID_INDEX) && !state.creation_params.buffers[prim->index_buffer].created) {
+        return false;
+    }
+    const material_t* mat = &state.scene.materials[prim->material];
+    if (mat->is_metallic) {
+        const metallic_images_t* images = &mat->metallic.images;
+        const int image_indices[5] = {
+            images->base_color, images->metallic_roughness, images->normal, images->occlusion, images->emissive
+        };
+        for (int i = 0; i < 5; i++) {
+            if ((image_indices[i] != SCENE_INVALID_INDEX) && (state.scene.image_samplers[image_indices[i]].img.id == SG_INVALID_ID)) {
+                return false;
+            }
+        }
+    }
+    prim->ready = true;
+    return true;
+}
+
+// gather the primitives of all meshes into the render queue and sort by render state,
+// meshes used by several nodes get a single instanced draw per primitive,
+// primitives which are still loading are skipped
+static void build_render_queue(void) {
+    state.render_queue.num_items = 0;
+    for (int mesh_index = 0; mesh_index < state.scene.num_meshes; mesh_index++) {
+        const mesh_t* mesh = &state.scene.meshes[mesh_index];
+        for (int i = 0; i < mesh->num_primitives; i++) {
+            const int prim_index = mesh->first_primitive + i;
+            primitive_t* prim = &state.scene.primitives[prim_index];
+            if (!primitive_ready(prim)) {
+                continue;
+            }
+            if ((mesh->num_instances > 1) && (prim->instanced_pipeline != SCENE_INVALID_INDEX)) {
+                assert(state.render_queue.num_items < state.scene.max_draw_items);
+                const int first_node = state.scene.instance_nodes[mesh->first_instance];
+                state.render_queue.items[state.render_queue.num_items++] = (draw_item_t){
+                    .key = sort_key_for_draw(first_node, prim_index, prim->instanced_pipeline),
+                    .node = SCENE_INVALID_INDEX,
+                    .primitive = prim_index,
+                    .first_instance = mesh->first_instance,
+                    .num_instances = mesh->num_instances,
+                };
+            } else {
+                for (int inst = 0; inst < mesh->num_instances; inst++) {
+                    assert(state.render_queue.num_items < state.scene.max_draw_items);
+                    const int node_index = state.scene.instance_nodes[mesh->first_instance + inst];
+                    if (prim->skinned && (0 == state.scene.nodes[node_index].ozz)) {
+                        // the node's skin hasn't been imported yet
+                        continue;
+                    }
+                    state.render_queue.items[state.render_queue.num_items++] = (draw_item_t){
+                        .key = sort_key_for_draw(node_index, prim_index, prim->pipeline),
+                        .node = node_index,
+                        .primitive = prim_index,
+                        .num_instances = 1,
+                    };
+                }
+            }
+        }
+    }
+    if (state.render_queue.num_items > 1) {
+        qsort(state.render_queue.items, (size_t)state.render_queue.num_items, sizeof(draw_item_t), draw_item_cmp);
+    }
+}
+
+// the image and sampler of a material texture, or the placeholder if the
+// material has no such texture, or the texture hasn't been created yet
+static image_sampler_t image_sampler_or_placeholder(int image_sampler_index, sg_image placeholder) {
+    if ((image_sampler_index != SCENE_INVALID_INDEX) && (state.scene.image_samplers[image_sampler_index].img.id != SG_INVALID_ID)) {
+        return state.scene.image_samplers[image_sampler_index];
+    }
+    return (image_sampler_t){ .img = placeholder, .smp = state.placeholders.smp };
+}
+
+// resolve the sokol-gfx bindings of a primitive, with placeholders for missing textures
+static sg_bindings bindings_for_primitive(const primitive_t* prim) {
+    sg_bindings bind = { 0 };
+    for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
+        bind.vertex_buffers[vb_slot] = state.scene.buffers[prim->vertex_buffers.buffer[vb_slot]];
+    }
+    if (prim->index_buffer != SCENE_INVALID_INDEX) {
+        bind.index_buffer = state.scene.buffers[prim->index_buffer];
+    }
+    const material_t* mat = &state.scene.materials[prim->material];
+    if (mat->is_metallic) {
+        const metallic_images_t* images = &mat->metallic.images;
+        const image_sampler_t base_color = image_sampler_or_placeholder(images->base_color, state.placeholders.white);
+        const image_sampler_t metallic_roughness = image_sampler_or_placeholder(images->metallic_roughness, state.placeholders.white);
+        const image_sampler_t normal = image_sampler_or_placeholder(images->normal, state.placeholders.normal);
+        const image_sampler_t occlusion = image_sampler_or_placeholder(images->occlusion, state.placeholders.white);
+        const image_sampler_t emissive = image_sampler_or_placeholder(images->emissive, state.placeholders.black);
+        bind.fs.images[SLOT_base_color_tex] = base_color.img;
+        bind.fs.images[SLOT_metallic_roughness_tex] = metallic_roughness.img;
+        bind.fs.images[SLOT_normal_tex] = normal.img;
+        bind.fs.images[SLOT_occlusion_tex] = occlusion.img;
+        bind.fs.images[SLOT_emissive_tex] = emissive.img;
+        bind.fs.samplers[SLOT_base_color_smp] = base_color.smp;
+        bind.fs.samplers[SLOT_metallic_roughness_smp] = metallic_roughness.smp;
+        bind.fs.samplers[SLOT_normal_smp] = normal.smp;
+        bind.fs.samplers[SLOT_occlusion_smp] = occlusion.smp;
+        bind.fs.samplers[SLOT_emissive_smp] = emissive.smp;
+    }
+    if (prim->skinned) {
+        bind.vs.images[SLOT_joint_tex] = ozz_joint_texture();
+        bind.vs.samplers[SLOT_joint_smp] = ozz_joint_sampler();
+    }
+    return bind;
+}
+
+// draw the sorted render queue, only applying state which differs from the
+// previous draw, after a pipeline switch all bindings and uniforms must be re-applied
+static void draw_render_queue(void) {
+    state.frame_stats = (frame_stats_t){ 0 };
+    uint32_t cur_pip_id = SG_INVALID_ID;
+    int cur_node = SCENE_INVALID_INDEX;
+    int cur_material = SCENE_INVALID_INDEX;
+    sg_bindings cur_bind = { 0 };
+    for (int i = 0; i < state.render_queue.num_items; i++) {
+        const draw_item_t* item = &state.render_queue.items[i];
+        const primitive_t* prim = &state.scene.primitives[item->primitive];
+        const material_t* mat = &state.scene.materials[prim->material];
+        const bool instanced = item->node == SCENE_INVALID_INDEX;
+        const pipeline_cache_item_t* pip_item = &state.pip_cache.items[instanced ? prim->instanced_pipeline : prim->pipeline];
+        const sg_pipeline pip = pip_item->pip;
+        if (pip.id != cur_pip_id) {
+            cur_pip_id = pip.id;
+            cur_node = SCENE_INVALID_INDEX;
+            cur_material = SCENE_INVALID_INDEX;
+            cur_bind = (sg_bindings){ 0 };
+            sg_apply_pipeline(pip);
+            sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_light_params, &SG_RANGE(state.point_light));
+            state.frame_stats.num_apply_pipeline++;
+            state.frame_stats.num_apply_uniforms++;
+            if (instanced) {
+                // the instanced vertex shader only has per-frame uniforms
+                const vs_inst_params_t vs_inst_params = {
+                    .view_proj = state.camera.view_proj,
+                    .eye_pos = state.camera.eye_pos
+                };
+                sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_inst_params, &SG_RANGE(vs_inst_params));
+                state.frame_stats.num_apply_uniforms++;
+            }
+        }
+        sg_bindings bind = bindings_for_primitive(prim);
+        if (instanced) {
+            const int inst_slot = prim->vertex_buffers.num;
+            bind.vertex_buffers[inst_slot] = state.scene.instance_buffer;
+            bind.vertex_buffer_offsets[inst_slot] = item->first_instance * (int)sizeof(hmm_mat4);
+        }
+        if (0 != memcmp(&bind, &cur_bind, sizeof(bind))) {
+            cur_bind = bind;
+            sg_apply_bindings(&bind);
+            state.frame_stats.num_apply_bindings++;
+        }
+        if (!instanced && (item->node != cur_node)) {
+            cur_node = item->node;
+            if (prim->skinned) {
+                const vs_skin_params_t vs_skin_params = vs_skin_params_for_node(item->node, &pip_item->params);
+                sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_skin_params, &SG_RANGE(vs_skin_params));
+            } else {
+                const vs_params_t vs_params = vs_params_for_node(item->node);
+                sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(vs_params));
+            }
+            state.frame_stats.num_apply_uniforms++;
+        }
+        if ((prim->material != cur_material) && mat->is_metallic) {
+            cur_material = prim->material;
+            sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_metallic_params, &SG_RANGE(mat->metallic.fs_params));
+            state.frame_stats.num_apply_uniforms++;
+        }
+        sg_draw(prim->base_element, prim->num_elements, item->num_instances);
+        state.frame_stats.num_draws++;
+        state.frame_stats.num_instances += item->num_instances;
+    }
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
-    (void)argc;
-    (void)argv;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "cache=", 6)) {
+            cache_dir = argv[i] + 6;
+        } else {
+            filename = argv[i];
+        }
+    }
     return (sapp_desc){
         .init_cb = init,
         .frame_cb = frame,
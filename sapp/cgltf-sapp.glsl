@@ -33,6 +33,95 @@ void main() {
 }
 @end
 
+// instanced variant of the vertex shader, the model matrix comes
+// from a per-instance vertex buffer instead of a uniform
+@vs vs_inst
+uniform vs_inst_params {
+    mat4 view_proj;
+    vec3 eye_pos;
+};
+
+layout(location=0) in vec4 position;
+layout(location=1) in vec3 normal;
+layout(location=2) in vec2 texcoord;
+layout(location=3) in vec4 inst_mat0;
+layout(location=4) in vec4 inst_mat1;
+layout(location=5) in vec4 inst_mat2;
+layout(location=6) in vec4 inst_mat3;
+
+out vec3 v_pos;
+out vec3 v_nrm;
+out vec2 v_uv;
+out vec3 v_eye_pos;
+
+void main() {
+    mat4 model = mat4(inst_mat0, inst_mat1, inst_mat2, inst_mat3);
+    vec4 pos = model * position;
+    v_pos = pos.xyz / pos.w;
+    v_nrm = (model * vec4(normal, 0.0)).xyz;
+    v_uv = texcoord;
+    v_eye_pos = eye_pos;
+    gl_Position = view_proj * pos;
+}
+@end
+
+// skinned variant of the vertex shader, the joint matrices come from the
+// ozz-animation joint texture, 3 texels per joint (a transposed 4x3 matrix)
+@vs vs_skin
+uniform vs_skin_params {
+    mat4 model;
+    mat4 view_proj;
+    vec3 eye_pos;
+    float joint_index_scale;    // joint indices are normalized, 255 for bytes or 65535 for shorts
+    vec4 joint_params;          // xy: uv of the instance's row in the joint texture, z: texel width
+};
+
+uniform texture2D joint_tex;
+uniform sampler joint_smp;
+
+layout(location=0) in vec4 position;
+layout(location=1) in vec3 normal;
+layout(location=2) in vec2 texcoord;
+layout(location=3) in vec4 joints;
+layout(location=4) in vec4 weights;
+
+out vec3 v_pos;
+out vec3 v_nrm;
+out vec2 v_uv;
+out vec3 v_eye_pos;
+
+void skin_joint(float joint, float weight, vec4 pos, vec4 nrm, inout vec3 skin_pos, inout vec3 skin_nrm) {
+    if (weight > 0.0) {
+        vec2 uv = vec2(joint_params.x + 3.0 * joint * joint_params.z, joint_params.y);
+        vec2 step = vec2(joint_params.z, 0.0);
+        vec4 xxxx = textureLod(sampler2D(joint_tex, joint_smp), uv, 0.0);
+        vec4 yyyy = textureLod(sampler2D(joint_tex, joint_smp), uv + step, 0.0);
+        vec4 zzzz = textureLod(sampler2D(joint_tex, joint_smp), uv + 2.0 * step, 0.0);
+        skin_pos += vec3(dot(pos, xxxx), dot(pos, yyyy), dot(pos, zzzz)) * weight;
+        skin_nrm += vec3(dot(nrm, xxxx), dot(nrm, yyyy), dot(nrm, zzzz)) * weight;
+    }
+}
+
+void main() {
+    vec4 indices = joints * joint_index_scale;
+    vec4 w = weights / dot(weights, vec4(1.0));
+    vec4 nrm = vec4(normal, 0.0);
+    vec3 skin_pos = vec3(0.0);
+    vec3 skin_nrm = vec3(0.0);
+    skin_joint(indices.x, w.x, position, nrm, skin_pos, skin_nrm);
+    skin_joint(indices.y, w.y, position, nrm, skin_pos, skin_nrm);
+    skin_joint(indices.z, w.z, position, nrm, skin_pos, skin_nrm);
+    skin_joint(indices.w, w.w, position, nrm, skin_pos, skin_nrm);
+
+    vec4 pos = model * vec4(skin_pos, 1.0);
+    v_pos = pos.xyz / pos.w;
+    v_nrm = (model * vec4(skin_nrm, 0.0)).xyz;
+    v_uv = texcoord;
+    v_eye_pos = eye_pos;
+    gl_Position = view_proj * pos;
+}
+@end
+
 @fs metallic_fs
 
 in vec3 v_pos;
@@ -275,4 +364,6 @@ void main() {
 @end
 
 @program cgltf_metallic vs metallic_fs
+@program cgltf_metallic_instanced vs_inst metallic_fs
+@program cgltf_metallic_skinned vs_skin metallic_fs
 
@@ -35,6 +35,7 @@
 #include "ozz/base/containers/vector.h"
 #include "ozz/base/maths/soa_transform.h"
 #include "ozz/base/maths/vec_float.h"
+#include "ozzutil/spanstream.h"
 
 #include <memory>   // std::unique_ptr, std::make_unique
 #include <cmath>    // fmodf
@@ -292,12 +293,10 @@ static void draw_ui(void) {
 
 static void skeleton_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        // NOTE: if we derived our own ozz::io::Stream class we could
-        // avoid the extra allocation and memory copy that happens
+        // NOTE: a read-only span stream deserializes directly from the fetch
+        // buffer, avoiding the extra allocation and memory copy that happens
         // with the standard MemoryStream class
-        ozz::io::MemoryStream stream;
-        stream.Write(response->data.ptr, response->data.size);
-        stream.Seek(0, ozz::io::Stream::kSet);
+        ozz_span_stream_t stream(response->data.ptr, response->data.size);
         ozz::io::IArchive archive(&stream);
         if (archive.TestTag<ozz::animation::Skeleton>()) {
             archive >> state.ozz->skeleton;
@@ -319,9 +318,7 @@ static void skeleton_data_loaded(const sfetch_response_t* response) {
 
 static void animation_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz::io::MemoryStream stream;
-        stream.Write(response->data.ptr, response->data.size);
-        stream.Seek(0, ozz::io::Stream::kSet);
+        ozz_span_stream_t stream(response->data.ptr, response->data.size);
         ozz::io::IArchive archive(&stream);
         if (archive.TestTag<ozz::animation::Animation>()) {
             archive >> state.ozz->animation;
@@ -6,10 +6,20 @@
 //  https://guillaumeblanc.github.io/ozz-animation/
 //
 //  Joint palette data for vertex skinning is uploaded each frame to a dynamic
-//  RGBA32F texture and sampled in the vertex shader to perform weighted
-//  skinning with up to 4 influence joints per vertex.
+//  texture and sampled in the vertex shader to perform weighted skinning
+//  with up to 4 influence joints per vertex. The palette can be stored as
+//  4x3 matrices in an RGBA32F or RGBA16F texture, or as dual quaternions
+//  (2 instead of 3 pixels per joint, blended in the vertex shader).
 //
-//  Character instance matrices are stored in a vertex buffer.
+//  The skeleton, animation and mesh are loaded once into a shared ozzutil
+//  asset (the mesh has been converted offline by the ozzbake tool into a
+//  GPU-ready format), each character instance only owns its animation
+//  state, and instances are evaluated in parallel on the ozzutil worker
+//  threads.
+//
+//  Character instances are culled against the view frustum on the CPU,
+//  invisible instances skip animation sampling, and the matrices of the
+//  visible instances are compacted into a stream vertex buffer each frame.
 //
 //  Together this enables rendering many independently animated and positioned
 //  characters in a single draw call via hardware instancing.
@@ -17,7 +27,6 @@
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_fetch.h"
-#include "sokol_time.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
 
@@ -33,20 +42,10 @@
 
 #include "ozz-skin-sapp.glsl.h"
 
-// ozz-animation headers
-#include "ozz/animation/runtime/animation.h"
-#include "ozz/animation/runtime/skeleton.h"
-#include "ozz/animation/runtime/sampling_job.h"
-#include "ozz/animation/runtime/local_to_model_job.h"
-#include "ozz/base/io/stream.h"
-#include "ozz/base/io/archive.h"
-#include "ozz/base/containers/vector.h"
-#include "ozz/base/maths/soa_transform.h"
-#include "ozz/base/maths/vec_float.h"
-#include "ozz/util/mesh.h"
-
-#include <memory>   // std::unique_ptr, std::make_unique
-#include <cmath>    // fmodf
+// ozz-animation C-API wrapper
+#include "ozzutil/ozzutil.h"
+
+#include <thread>   // std::thread::hardware_concurrency
 
 // the upper limit for joint palette size is 256 (because the mesh joint indices
 // are stored in packed byte-size vertex formats), but the example mesh only needs less than 64
@@ -55,30 +54,10 @@
 // this defines the size of the instance-buffer and height of the joint-texture
 #define MAX_INSTANCES (512)
 
-// wrapper struct for managed ozz-animation C++ objects, must be deleted
-// before shutdown, otherwise ozz-animation will report a memory leak
-typedef struct {
-    ozz::animation::Skeleton skeleton;
-    ozz::animation::Animation animation;
-    ozz::vector<uint16_t> joint_remaps;
-    ozz::vector<ozz::math::Float4x4> mesh_inverse_bindposes;
-    ozz::vector<ozz::math::SoaTransform> local_matrices;
-    ozz::vector<ozz::math::Float4x4> model_matrices;
-    ozz::animation::SamplingCache cache;
-} ozz_t;
-
-// a skinned-mesh vertex, we don't need the texcoords and tangent
-// in our example renderer so we just drop them. Normals, joint indices
-// and joint weights are packed into BYTE4N and UBYTE4N
-//
-// NOTE: joint indices are packed as UBYTE4N and not UBYTE4 because of
-// D3D11 compatibility (see "A NOTE ON PORTABLE PACKED VERTEX FORMATS" in sokol_gfx.h)
-typedef struct {
-    float position[3];
-    uint32_t normal;
-    uint32_t joint_indices;
-    uint32_t joint_weights;
-} vertex_t;
+// bounding sphere of a character instance relative to its origin, generous
+// enough to contain all poses of the animation
+#define INSTANCE_BOUNDS_CENTER_Y (0.9f)
+#define INSTANCE_BOUNDS_RADIUS (1.2f)
 
 // per-instance data for hardware-instanced rendering includes the
 // transposed 4x3 model-to-world matrix, and information where the
@@ -91,32 +70,22 @@ typedef struct {
 } instance_t;
 
 static struct {
-    std::unique_ptr<ozz_t> ozz;
+    ozz_asset_t* asset;                         // shared skeleton, animation and mesh
+    ozz_instance_t* instances[MAX_INSTANCES];   // per-instance animation state
     sg_pass_action pass_action;
-    sg_pipeline pip;
-    sg_image joint_texture;
-    sg_sampler smp;
+    sg_pipeline pip;            // 4x3 matrix skinning (RGBA32F and RGBA16F palette)
+    sg_pipeline pip_dq;         // dual-quaternion skinning
     sg_bindings bind;
     int num_instances;          // current number of character instances
-    int num_triangle_indices;
-    int num_skeleton_joints;    // number of joints in the skeleton
-    int num_skin_joints;        // number of joints actually used by skinned mesh
-    int joint_texture_width;    // in number of pixels
-    int joint_texture_height;   // in number of pixels
-    int joint_texture_pitch;    // in number of floats
+    int num_visible_instances;  // number of instances which passed frustum culling
     camera_t camera;
     bool draw_enabled;
-    struct {
-        bool skeleton;
-        bool animation;
-        bool mesh;
-        bool failed;
-    } loaded;
+    bool anim_lod_enabled;      // distance-based animation update-rate throttling
+    bool culling_enabled;       // view-frustum culling of character instances
     struct {
         double frame_time_ms;
         double frame_time_sec;
         double abs_time_sec;
-        uint64_t anim_eval_time;
         float factor;
         bool paused;
     } time;
@@ -124,29 +93,38 @@ static struct {
         bool joint_texture_shown;
         int joint_texture_scale;
     } ui;
+    // size of the loaded data in the IO buffers, needed to reload
+    // the character asset when the palette format changes
+    struct {
+        size_t skel_size;
+        size_t anim_size;
+        size_t mesh_size;
+    } io;
 } state;
 
-// IO buffers (we know the max file sizes upfront)
-static uint8_t skel_io_buffer[32 * 1024];
-static uint8_t anim_io_buffer[96 * 1024];
-static uint8_t mesh_io_buffer[3 * 1024 * 1024];
+// IO buffers (we know the max file sizes upfront), 16-byte aligned because
+// the sections of a baked mesh are accessed in place
+alignas(16) static uint8_t skel_io_buffer[32 * 1024];
+alignas(16) static uint8_t anim_io_buffer[96 * 1024];
+alignas(16) static uint8_t mesh_io_buffer[3 * 1024 * 1024];
 
-// instance data buffer;
+// per-instance data of all character instances, and of the visible instances
+// compacted into the instance buffer
 static instance_t instance_data[MAX_INSTANCES];
-
-// joint-matrix upload buffer, each joint consists of transposed 4x3 matrix
-static float joint_upload_buffer[MAX_INSTANCES][MAX_PALETTE_JOINTS][3][4];
+static instance_t visible_instance_data[MAX_INSTANCES];
 
 static void init_instance_data(void);
 static void draw_ui(void);
+static void setup_ozz(ozz_palette_format_t palette_format);
 static void skel_data_loaded(const sfetch_response_t* respone);
 static void anim_data_loaded(const sfetch_response_t* respone);
 static void mesh_data_loaded(const sfetch_response_t* respone);
 
 static void init(void) {
-    state.ozz = std::make_unique<ozz_t>();
     state.num_instances = 1;
     state.draw_enabled = true;
+    state.anim_lod_enabled = true;
+    state.culling_enabled = true;
     state.time.factor = 1.0f;
     state.ui.joint_texture_scale = 4;
 
@@ -156,9 +134,6 @@ static void init(void) {
     sgdesc.logger.func = slog_func;
     sg_setup(&sgdesc);
 
-    // setup sokol-time
-    stm_setup();
-
     // setup sokol-fetch
     sfetch_desc_t sfdesc = { };
     sfdesc.max_requests = 3;
@@ -185,11 +160,15 @@ static void init(void) {
     camdesc.longitude = 20.0f;
     cam_init(&state.camera, &camdesc);
 
+    // setup the ozz-animation wrapper and the shared character asset
+    setup_ozz(OZZ_PALETTE_FORMAT_MATRIX_RGBA32F);
+
     // vertex-skinning shader and pipeline object for 3d rendering, note
-    // the hardware-instanced vertex layout
+    // the hardware-instanced vertex layout, the dual-quaternion shader
+    // has the same vertex layout and only differs in the palette lookup
     sg_pipeline_desc pip_desc = { };
     pip_desc.shader = sg_make_shader(skinned_shader_desc(sg_query_backend()));
-    pip_desc.layout.buffers[0].stride = sizeof(vertex_t);
+    pip_desc.layout.buffers[0].stride = sizeof(ozz_vertex_t);
     pip_desc.layout.buffers[1].stride = sizeof(instance_t);
     pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
     pip_desc.layout.attrs[ATTR_vs_position].format = SG_VERTEXFORMAT_FLOAT3;
@@ -211,35 +190,17 @@ static void init(void) {
     pip_desc.depth.write_enabled = true;
     pip_desc.depth.compare = SG_COMPAREFUNC_LESS_EQUAL;
     state.pip = sg_make_pipeline(&pip_desc);
+    pip_desc.shader = sg_make_shader(skinned_dq_shader_desc(sg_query_backend()));
+    state.pip_dq = sg_make_pipeline(&pip_desc);
 
-    // create a dynamic joint-palette texture and sampler
-    state.joint_texture_width = MAX_PALETTE_JOINTS * 3;
-    state.joint_texture_height = MAX_INSTANCES;
-    state.joint_texture_pitch = state.joint_texture_width * 4;
-    sg_image_desc img_desc = { };
-    img_desc.width = state.joint_texture_width;
-    img_desc.height = state.joint_texture_height;
-    img_desc.num_mipmaps = 1;
-    img_desc.pixel_format = SG_PIXELFORMAT_RGBA32F;
-    img_desc.usage = SG_USAGE_STREAM;
-    state.joint_texture = sg_make_image(&img_desc);
-    state.bind.vs.images[SLOT_joint_tex] = state.joint_texture;
-
-    sg_sampler_desc smp_desc = { };
-    smp_desc.min_filter = SG_FILTER_NEAREST;
-    smp_desc.mag_filter = SG_FILTER_NEAREST;
-    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
-    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
-    state.smp = sg_make_sampler(&smp_desc);
-    state.bind.vs.samplers[SLOT_smp] = state.smp;
-
-    // create a static instance-data buffer, in this demo, character instances
-    // don't move around and also are not clipped against the view volume,
-    // so we can just initialize a static instance data buffer upfront
+    // create an instance-data buffer, in this demo, character instances
+    // don't move around, but the set of visible instances and the joint
+    // texture coordinates change every frame
     init_instance_data();
     sg_buffer_desc buf_desc = { };
     buf_desc.type = SG_BUFFERTYPE_VERTEXBUFFER;
-    buf_desc.data = SG_RANGE(instance_data);
+    buf_desc.usage = SG_USAGE_STREAM;
+    buf_desc.size = sizeof(visible_instance_data);
     state.bind.vertex_buffers[1] = sg_make_buffer(&buf_desc);
 
     // start loading data
@@ -260,19 +221,61 @@ static void init(void) {
     }
     {
         sfetch_request_t req = { };
-        req.path = fileutil_get_path("ozz_skin_mesh.ozz", path_buf, sizeof(path_buf));
+        req.path = fileutil_get_path("ozz_skin_mesh.ozzmesh", path_buf, sizeof(path_buf));
         req.callback = mesh_data_loaded;
         req.buffer = SFETCH_RANGE(mesh_io_buffer);
         sfetch_send(&req);
     }
 }
 
-// initialize the static instance data, since the character instances don't
-// move around or are clipped against the view volume in this demo, the instance
-// data is initialized once and lives in an immutable instance buffer
-static void init_instance_data(void) {
-    assert((state.joint_texture_width > 0) && (state.joint_texture_height > 0));
+// setup the ozz-animation wrapper, this creates the dynamic joint-palette
+// texture, and a worker thread pool for evaluating character instances,
+// and one shared character asset (the lightweight per-instance animation
+// state is created and destroyed in update_num_instances())
+static void setup_ozz(ozz_palette_format_t palette_format) {
+    ozz_desc_t ozzdesc = { };
+    ozzdesc.max_palette_joints = MAX_PALETTE_JOINTS;
+    ozzdesc.max_instances = MAX_INSTANCES;
+    ozzdesc.palette_format = palette_format;
+    ozzdesc.num_workers = (int) std::thread::hardware_concurrency();
+    ozz_setup(&ozzdesc);
+    state.asset = ozz_create_asset();
+
+    // the joint-palette texture and sampler are owned by ozzutil, the
+    // texture will be bound in update_joint_texture()
+    state.bind.vs.samplers[SLOT_smp] = ozz_joint_sampler();
+    state.bind.vs.images[SLOT_joint_tex] = { };
+}
 
+static void shutdown_ozz(void) {
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        if (state.instances[i]) {
+            ozz_destroy_instance(state.instances[i]);
+            state.instances[i] = nullptr;
+        }
+    }
+    ozz_destroy_asset(state.asset);
+    state.asset = nullptr;
+    ozz_shutdown();
+}
+
+// switching the palette format requires a new joint texture, so the
+// ozzutil wrapper is setup again, and the character asset is reloaded
+// from the data that's still in the IO buffers
+static void change_palette_format(ozz_palette_format_t palette_format) {
+    shutdown_ozz();
+    setup_ozz(palette_format);
+    ozz_load_skeleton(state.asset, skel_io_buffer, state.io.skel_size);
+    ozz_load_animation(state.asset, anim_io_buffer, state.io.anim_size);
+    ozz_load_baked_mesh(state.asset, mesh_io_buffer, state.io.mesh_size);
+    state.bind.vertex_buffers[0] = ozz_vertex_buffer(state.asset);
+    state.bind.index_buffer = ozz_index_buffer(state.asset);
+}
+
+// initialize the instance data, since the character instances don't
+// move around in this demo, the instance transforms are initialized once,
+// the joint texture coordinates are written in update_instance_buffer()
+static void init_instance_data(void) {
     // initialize the character instance model-to-world matrices
     for (int i=0, x=0, y=0, dx=0, dy=0; i < MAX_INSTANCES; i++, x+=dx, y+=dy) {
         instance_t* inst = &instance_data[i];
@@ -299,64 +302,79 @@ static void init_instance_data(void) {
         }
     }
 
-    // the skin_info vertex component contains information about where to find
-    // the joint palette for this character instance in the joint texture
-    const float half_pixel_x = 0.5f / (float)state.joint_texture_width;
-    const float half_pixel_y = 0.5f / (float)state.joint_texture_height;
+}
+
+// create or destroy character instances to match the requested number,
+// instance i always uses row i of the joint texture, which keeps the live
+// instances packed into the top rows, and the joint texture small
+static void update_num_instances(void) {
     for (int i = 0; i < MAX_INSTANCES; i++) {
-        instance_t* inst = &instance_data[i];
-        inst->joint_uv[0] = half_pixel_x;
-        inst->joint_uv[1] = half_pixel_y + (i / (float)state.joint_texture_height);
+        if ((i < state.num_instances) && !state.instances[i]) {
+            // each character instance plays the animation with a small time offset
+            state.instances[i] = ozz_create_instance(state.asset, i);
+            ozz_set_time_offset(state.instances[i], i * 0.1);
+        }
+        else if ((i >= state.num_instances) && state.instances[i]) {
+            ozz_destroy_instance(state.instances[i]);
+            state.instances[i] = nullptr;
+        }
     }
 }
 
-// compute skinning matrices, and upload into joint texture
+// test the character instance bounding spheres against the view frustum,
+// culled instances are skipped by the animation update, and distant
+// instances update their animation less frequently
+static void cull_instances(void) {
+    const hmm_vec3 eye_pos = state.camera.eye_pos;
+    for (int i = 0; i < state.num_instances; i++) {
+        const instance_t* inst = &instance_data[i];
+        const hmm_vec3 pos = HMM_Vec3(inst->xxxx[3], inst->yyyy[3], inst->zzzz[3]);
+        bool visible = true;
+        if (state.culling_enabled) {
+            const hmm_vec3 center = HMM_AddVec3(pos, HMM_Vec3(0.0f, INSTANCE_BOUNDS_CENTER_Y, 0.0f));
+            visible = cam_sphere_visible(&state.camera, center, INSTANCE_BOUNDS_RADIUS);
+        }
+        ozz_set_visible(state.instances[i], visible);
+        float dist = 0.0f;
+        if (state.anim_lod_enabled) {
+            dist = HMM_LengthVec3(HMM_SubtractVec3(pos, eye_pos));
+        }
+        ozz_set_lod_distance(state.instances[i], dist);
+    }
+}
+
+// evaluate character animations on the ozzutil worker threads, and upload
+// the resulting skinning matrices into the joint texture
 static void update_joint_texture(void) {
+    ozz_update_instances(state.instances, state.num_instances, state.time.abs_time_sec);
+    ozz_update_joint_texture();
 
-    uint64_t start_time = stm_now();
-    const float anim_duration = state.ozz->animation.duration();
-    for (int instance = 0; instance < state.num_instances; instance++) {
-
-        // each character instance evaluates its own animation
-        const float anim_ratio = fmodf(((float)state.time.abs_time_sec + (instance*0.1f)) / anim_duration, 1.0f);
-
-        // sample animation
-        // NOTE: using one cache per instance versus one cache per animation
-        // makes a small difference, but not much
-        ozz::animation::SamplingJob sampling_job;
-        sampling_job.animation = &state.ozz->animation;
-        sampling_job.cache = &state.ozz->cache;
-        sampling_job.ratio = anim_ratio;
-        sampling_job.output = make_span(state.ozz->local_matrices);
-        sampling_job.Run();
-
-        // convert joint matrices from local to model space
-        ozz::animation::LocalToModelJob ltm_job;
-        ltm_job.skeleton = &state.ozz->skeleton;
-        ltm_job.input = make_span(state.ozz->local_matrices);
-        ltm_job.output = make_span(state.ozz->model_matrices);
-        ltm_job.Run();
-
-        // compute skinning matrices and write to joint texture upload buffer
-        for (int i = 0; i < state.num_skin_joints; i++) {
-            ozz::math::Float4x4 skin_matrix = state.ozz->model_matrices[state.ozz->joint_remaps[i]] * state.ozz->mesh_inverse_bindposes[i];
-            const ozz::math::SimdFloat4& c0 = skin_matrix.cols[0];
-            const ozz::math::SimdFloat4& c1 = skin_matrix.cols[1];
-            const ozz::math::SimdFloat4& c2 = skin_matrix.cols[2];
-            const ozz::math::SimdFloat4& c3 = skin_matrix.cols[3];
-
-            float* ptr = &joint_upload_buffer[instance][i][0][0];
-            *ptr++ = ozz::math::GetX(c0); *ptr++ = ozz::math::GetX(c1); *ptr++ = ozz::math::GetX(c2); *ptr++ = ozz::math::GetX(c3);
-            *ptr++ = ozz::math::GetY(c0); *ptr++ = ozz::math::GetY(c1); *ptr++ = ozz::math::GetY(c2); *ptr++ = ozz::math::GetY(c3);
-            *ptr++ = ozz::math::GetZ(c0); *ptr++ = ozz::math::GetZ(c1); *ptr++ = ozz::math::GetZ(c2); *ptr++ = ozz::math::GetZ(c3);
-        }
+    // the joint texture is recreated when its size changes
+    if (ozz_joint_texture().id != state.bind.vs.images[SLOT_joint_tex].id) {
+        state.bind.vs.images[SLOT_joint_tex] = ozz_joint_texture();
     }
-    state.time.anim_eval_time = stm_since(start_time);
+}
 
-    sg_image_data img_data = { };
-    // FIXME: upload partial texture? (needs sokol-gfx fixes)
-    img_data.subimage[0][0] = SG_RANGE(joint_upload_buffer);
-    sg_update_image(state.joint_texture, img_data);
+// compact the visible character instances into the instance buffer, the
+// joint_uv vertex component contains information about where to find the
+// joint palette of an instance in the joint texture, character instance i
+// lives in row i, and the texture height changes with the number of live
+// instances
+static void update_instance_buffer(void) {
+    int num_visible = 0;
+    for (int i = 0; i < state.num_instances; i++) {
+        if (ozz_visible(state.instances[i])) {
+            instance_t* inst = &visible_instance_data[num_visible++];
+            *inst = instance_data[i];
+            inst->joint_uv[0] = ozz_joint_texture_u(state.instances[i]);
+            inst->joint_uv[1] = ozz_joint_texture_v(state.instances[i]);
+        }
+    }
+    state.num_visible_instances = num_visible;
+    if (num_visible > 0) {
+        const sg_range range = { visible_instance_data, num_visible * sizeof(instance_t) };
+        sg_update_buffer(state.bind.vertex_buffers[1], &range);
+    }
 }
 
 static void frame(void) {
@@ -372,20 +390,28 @@ static void frame(void) {
     draw_ui();
 
     sg_begin_default_pass(&state.pass_action, fb_width, fb_height);
-    if (state.loaded.animation && state.loaded.skeleton && state.loaded.mesh) {
+    if (ozz_all_loaded(state.asset)) {
         if (!state.time.paused) {
             state.time.abs_time_sec += state.time.frame_time_sec * state.time.factor;
         }
+        update_num_instances();
+        cull_instances();
         update_joint_texture();
+        update_instance_buffer();
 
         vs_params_t vs_params = { };
         vs_params.view_proj = state.camera.view_proj;
-        vs_params.joint_pixel_width = 1.0f / (float)state.joint_texture_width;
-        sg_apply_pipeline(state.pip);
+        vs_params.joint_pixel_width = ozz_joint_texture_pixel_width();
+        if (ozz_palette_format() == OZZ_PALETTE_FORMAT_DUALQUAT_RGBA32F) {
+            sg_apply_pipeline(state.pip_dq);
+        }
+        else {
+            sg_apply_pipeline(state.pip);
+        }
         sg_apply_bindings(&state.bind);
         sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, SG_RANGE_REF(vs_params));
-        if (state.draw_enabled) {
-            sg_draw(0, state.num_triangle_indices, state.num_instances);
+        if (state.draw_enabled && (state.num_visible_instances > 0)) {
+            sg_draw(0, ozz_num_triangle_indices(state.asset), state.num_visible_instances);
         }
     }
     simgui_render();
@@ -401,12 +427,11 @@ static void input(const sapp_event* ev) {
 }
 
 static void cleanup(void) {
+    // free ozz-animation objects early, otherwise ozz-animation complains about memory leaks
+    shutdown_ozz();
     simgui_shutdown();
     sfetch_shutdown();
     sg_shutdown();
-
-    // free C++ objects early, otherwise ozz-animation complains about memory leaks
-    state.ozz = nullptr;
 }
 
 static void draw_ui(void) {
@@ -414,7 +439,7 @@ static void draw_ui(void) {
     ImGui::SetNextWindowSize({ 220, 150 }, ImGuiCond_Once);
     ImGui::SetNextWindowBgAlpha(0.35f);
     if (ImGui::Begin("Controls", nullptr, ImGuiWindowFlags_NoDecoration|ImGuiWindowFlags_AlwaysAutoResize)) {
-        if (state.loaded.failed) {
+        if (ozz_load_failed(state.asset)) {
             ImGui::Text("Failed loading character data!");
         }
         else {
@@ -423,11 +448,38 @@ static void draw_ui(void) {
                 state.camera.distance = state.camera.min_dist + dist_step * state.num_instances;
             }
             ImGui::Checkbox("Enable Mesh Drawing", &state.draw_enabled);
+            ImGui::Checkbox("Enable Anim LOD", &state.anim_lod_enabled);
+            ImGui::Checkbox("Enable Frustum Culling", &state.culling_enabled);
+            if (ozz_all_loaded(state.asset)) {
+                static const char* palette_format_names[] = { "Matrix RGBA32F", "Matrix RGBA16F", "DualQuat RGBA32F" };
+                int palette_format_index = (int)ozz_palette_format() - (int)OZZ_PALETTE_FORMAT_MATRIX_RGBA32F;
+                if (ImGui::Combo("Palette Format", &palette_format_index, palette_format_names, 3)) {
+                    change_palette_format((ozz_palette_format_t)(palette_format_index + (int)OZZ_PALETTE_FORMAT_MATRIX_RGBA32F));
+                }
+            }
             ImGui::Text("Frame Time: %.3fms\n", state.time.frame_time_ms);
-            ImGui::Text("Anim Eval Time: %.3fms\n", stm_ms(state.time.anim_eval_time));
-            ImGui::Text("Num Triangles: %d\n", (state.num_triangle_indices/3) * state.num_instances);
-            ImGui::Text("Num Animated Joints: %d\n", state.num_skeleton_joints * state.num_instances);
-            ImGui::Text("Num Skinning Joints: %d\n", state.num_skin_joints * state.num_instances);
+            const ozz_stats_t ozz_stats_info = ozz_stats();
+            ImGui::Text("Anim Eval Time: %.3fms\n", ozz_stats_info.anim_eval_time_ms);
+            ImGui::Text("Anim LODs: %d/%d/%d/%d (%d evaluated)\n",
+                ozz_stats_info.num_lod_instances[0], ozz_stats_info.num_lod_instances[1],
+                ozz_stats_info.num_lod_instances[2], ozz_stats_info.num_lod_instances[3],
+                ozz_stats_info.num_evaluated_instances);
+            ImGui::Text("Visible Instances: %d/%d\n", state.num_visible_instances, state.num_instances);
+            // estimated from the average animation time of the evaluated instances
+            double anim_time_saved_ms = 0.0;
+            if (ozz_stats_info.num_evaluated_instances > 0) {
+                anim_time_saved_ms = ozz_stats_info.anim_eval_time_ms * ozz_stats_info.num_culled_instances / ozz_stats_info.num_evaluated_instances;
+            }
+            ImGui::Text("Culling Saves: ~%.3fms\n", anim_time_saved_ms);
+            ImGui::Text("Anim Workers: %d\n", ozz_num_workers());
+            ImGui::Text("Num Triangles: %d\n", (ozz_num_triangle_indices(state.asset)/3) * state.num_visible_instances);
+            ImGui::Text("Num Animated Joints: %d\n", ozz_num_skeleton_joints(state.asset) * state.num_instances);
+            ImGui::Text("Num Skinning Joints: %d\n", ozz_num_skin_joints(state.asset) * state.num_instances);
+            if (state.instances[0]) {
+                ImGui::Text("Memory per Instance: %d bytes\n", (int)ozz_instance_memory_size(state.instances[0]));
+            }
+            ImGui::Text("Joint Texture Rows: %d/%d (%d dirty)\n", ozz_stats_info.num_live_rows, ozz_stats_info.joint_texture_height, ozz_stats_info.num_dirty_rows);
+            ImGui::Text("Joint Upload: %.1f KB/frame\n", (double)ozz_stats_info.upload_bytes / 1024.0);
             ImGui::Separator();
             ImGui::Text("Camera Controls:");
             ImGui::Text("  LMB + Mouse Move: Look");
@@ -457,8 +509,9 @@ static void draw_ui(void) {
             ImGui::SameLine();
             if (ImGui::Button("4x")) { state.ui.joint_texture_scale = 4; }
             ImGui::BeginChild("##frame", {0,0}, true, ImGuiWindowFlags_HorizontalScrollbar);
-            ImGui::Image((ImTextureID)(uintptr_t)state.joint_texture.id,
-                { (float)(state.joint_texture_width * state.ui.joint_texture_scale), (float)(state.joint_texture_height * state.ui.joint_texture_scale) },
+            const ozz_stats_t ozz_stats_info = ozz_stats();
+            ImGui::Image((ImTextureID)(uintptr_t)ozz_joint_texture().id,
+                { (float)(ozz_stats_info.joint_texture_width * state.ui.joint_texture_scale), (float)(ozz_stats_info.joint_texture_height * state.ui.joint_texture_scale) },
                 { 0.0f, 0.0f },
                 { 1.0f, 1.0f });
             ImGui::EndChild();
@@ -468,138 +521,36 @@ static void draw_ui(void) {
     ImGui::End();
 }
 
-// FIXME: all loading code is much less efficient than it should be!
+// the ozz archives are deserialized directly from the IO buffers
 static void skel_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz::io::MemoryStream stream;
-        stream.Write(response->data.ptr, response->data.size);
-        stream.Seek(0, ozz::io::Stream::kSet);
-        ozz::io::IArchive archive(&stream);
-        if (archive.TestTag<ozz::animation::Skeleton>()) {
-            archive >> state.ozz->skeleton;
-            state.loaded.skeleton = true;
-            const int num_soa_joints = state.ozz->skeleton.num_soa_joints();
-            const int num_joints = state.ozz->skeleton.num_joints();
-            state.ozz->local_matrices.resize(num_soa_joints);
-            state.ozz->model_matrices.resize(num_joints);
-            state.num_skeleton_joints = num_joints;
-            state.ozz->cache.Resize(num_joints);
-        }
-        else {
-            state.loaded.failed = true;
-        }
+        state.io.skel_size = response->data.size;
+        ozz_load_skeleton(state.asset, response->data.ptr, response->data.size);
     }
     else if (response->failed) {
-        state.loaded.failed = true;
+        ozz_set_load_failed(state.asset);
     }
 }
 
 static void anim_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz::io::MemoryStream stream;
-        stream.Write(response->data.ptr, response->data.size);
-        stream.Seek(0, ozz::io::Stream::kSet);
-        ozz::io::IArchive archive(&stream);
-        if (archive.TestTag<ozz::animation::Animation>()) {
-            archive >> state.ozz->animation;
-            state.loaded.animation = true;
-        }
-        else {
-            state.loaded.failed = true;
-        }
+        state.io.anim_size = response->data.size;
+        ozz_load_animation(state.asset, response->data.ptr, response->data.size);
     }
     else if (response->failed) {
-        state.loaded.failed = true;
+        ozz_set_load_failed(state.asset);
     }
 }
 
-static uint32_t pack_u32(uint8_t x, uint8_t y, uint8_t z, uint8_t w) {
-    return (uint32_t)(((uint32_t)w<<24)|((uint32_t)z<<16)|((uint32_t)y<<8)|x);
-}
-
-static uint32_t pack_f4_byte4n(float x, float y, float z, float w) {
-    int8_t x8 = (int8_t) (x * 127.0f);
-    int8_t y8 = (int8_t) (y * 127.0f);
-    int8_t z8 = (int8_t) (z * 127.0f);
-    int8_t w8 = (int8_t) (w * 127.0f);
-    return pack_u32((uint8_t)x8, (uint8_t)y8, (uint8_t)z8, (uint8_t)w8);
-}
-
-static uint32_t pack_f4_ubyte4n(float x, float y, float z, float w) {
-    uint8_t x8 = (uint8_t) (x * 255.0f);
-    uint8_t y8 = (uint8_t) (y * 255.0f);
-    uint8_t z8 = (uint8_t) (z * 255.0f);
-    uint8_t w8 = (uint8_t) (w * 255.0f);
-    return pack_u32(x8, y8, z8, w8);
-}
-
 static void mesh_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz::io::MemoryStream stream;
-        stream.Write(response->data.ptr, response->data.size);
-        stream.Seek(0, ozz::io::Stream::kSet);
-
-        ozz::vector<ozz::sample::Mesh> meshes;
-        ozz::io::IArchive archive(&stream);
-        while (archive.TestTag<ozz::sample::Mesh>()) {
-            meshes.resize(meshes.size() + 1);
-            archive >> meshes.back();
-        }
-        // assume one mesh and one submesh
-        assert((meshes.size() == 1) && (meshes[0].parts.size() == 1));
-        state.loaded.mesh = true;
-        state.num_skin_joints = meshes[0].num_joints();
-        state.num_triangle_indices = (int)meshes[0].triangle_index_count();
-        state.ozz->joint_remaps = std::move(meshes[0].joint_remaps);
-        state.ozz->mesh_inverse_bindposes = std::move(meshes[0].inverse_bind_poses);
-
-        // convert mesh data into packed vertices
-        size_t num_vertices = (meshes[0].parts[0].positions.size() / 3);
-        assert(meshes[0].parts[0].normals.size() == (num_vertices * 3));
-        assert(meshes[0].parts[0].joint_indices.size() == (num_vertices * 4));
-        assert(meshes[0].parts[0].joint_weights.size() == (num_vertices * 3));
-        const float* positions = &meshes[0].parts[0].positions[0];
-        const float* normals = &meshes[0].parts[0].normals[0];
-        const uint16_t* joint_indices = &meshes[0].parts[0].joint_indices[0];
-        const float* joint_weights = &meshes[0].parts[0].joint_weights[0];
-        vertex_t* vertices = (vertex_t*) calloc(num_vertices, sizeof(vertex_t));
-        for (int i = 0; i < (int)num_vertices; i++) {
-            vertex_t* v = &vertices[i];
-            v->position[0] = positions[i * 3 + 0];
-            v->position[1] = positions[i * 3 + 1];
-            v->position[2] = positions[i * 3 + 2];
-            const float nx = normals[i * 3 + 0];
-            const float ny = normals[i * 3 + 1];
-            const float nz = normals[i * 3 + 2];
-            v->normal = pack_f4_byte4n(nx, ny, nz, 0.0f);
-            const uint8_t ji0 = (uint8_t) joint_indices[i * 4 + 0];
-            const uint8_t ji1 = (uint8_t) joint_indices[i * 4 + 1];
-            const uint8_t ji2 = (uint8_t) joint_indices[i * 4 + 2];
-            const uint8_t ji3 = (uint8_t) joint_indices[i * 4 + 3];
-            v->joint_indices = pack_u32(ji0, ji1, ji2, ji3);
-            const float jw0 = joint_weights[i * 3 + 0];
-            const float jw1 = joint_weights[i * 3 + 1];
-            const float jw2 = joint_weights[i * 3 + 2];
-            const float jw3 = 1.0f - (jw0 + jw1 + jw2);
-            v->joint_weights = pack_f4_ubyte4n(jw0, jw1, jw2, jw3);
-        }
-
-        // create vertex- and index-buffer
-        sg_buffer_desc vbuf_desc = { };
-        vbuf_desc.type = SG_BUFFERTYPE_VERTEXBUFFER;
-        vbuf_desc.data.ptr = vertices;
-        vbuf_desc.data.size = num_vertices * sizeof(vertex_t);
-        state.bind.vertex_buffers[0] = sg_make_buffer(&vbuf_desc);
-        free(vertices); vertices = nullptr;
-
-        sg_buffer_desc ibuf_desc = { };
-        ibuf_desc.type = SG_BUFFERTYPE_INDEXBUFFER;
-        ibuf_desc.data.ptr = &meshes[0].triangle_indices[0];
-        ibuf_desc.data.size = state.num_triangle_indices * sizeof(uint16_t);
-        state.bind.index_buffer = sg_make_buffer(&ibuf_desc);
+        state.io.mesh_size = response->data.size;
+        ozz_load_baked_mesh(state.asset, response->data.ptr, response->data.size);
+        state.bind.vertex_buffers[0] = ozz_vertex_buffer(state.asset);
+        state.bind.index_buffer = ozz_index_buffer(state.asset);
     }
     else if (response->failed) {
-        state.loaded.failed = true;
+        ozz_set_load_failed(state.asset);
     }
 }
 
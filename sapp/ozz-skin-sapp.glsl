@@ -44,7 +44,36 @@ void skinned_pos_nrm(in vec4 pos, in vec4 nrm, in vec4 skin_weights, in vec4 ski
 }
 @end
 
-@vs vs
+// skinning with dual-quaternions, 2 texels per joint (real and dual part),
+// all 4 dual-quaternions are blended in the same hemisphere as the first
+@block skin_utils_dq
+void fetch_dq(in float skin_index, in vec2 joint_uv, out vec4 real, out vec4 dual) {
+    vec2 uv = vec2(joint_uv.x + (2.0 * skin_index)*joint_pixel_width, joint_uv.y);
+    real = textureLod(sampler2D(joint_tex, smp), uv, 0.0);
+    dual = textureLod(sampler2D(joint_tex, smp), uv + vec2(joint_pixel_width, 0.0), 0.0);
+}
+
+void skinned_pos_nrm(in vec4 pos, in vec4 nrm, in vec4 skin_weights, in vec4 skin_indices, in vec2 joint_uv, out vec4 skin_pos, out vec4 skin_nrm) {
+    vec4 weights = skin_weights / dot(skin_weights, vec4(1.0));
+    vec4 r0, d0, r1, d1, r2, d2, r3, d3;
+    fetch_dq(skin_indices.x, joint_uv, r0, d0);
+    fetch_dq(skin_indices.y, joint_uv, r1, d1);
+    fetch_dq(skin_indices.z, joint_uv, r2, d2);
+    fetch_dq(skin_indices.w, joint_uv, r3, d3);
+    vec3 w = weights.yzw * (step(0.0, vec3(dot(r0, r1), dot(r0, r2), dot(r0, r3))) * 2.0 - 1.0);
+    vec4 real = r0 * weights.x + r1 * w.x + r2 * w.y + r3 * w.z;
+    vec4 dual = d0 * weights.x + d1 * w.x + d2 * w.y + d3 * w.z;
+    float len = length(real);
+    real /= len;
+    dual /= len;
+    vec3 t = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    skin_pos = vec4(pos.xyz + 2.0 * cross(real.xyz, cross(real.xyz, pos.xyz) + real.w * pos.xyz) + t, 1.0);
+    skin_nrm = vec4(nrm.xyz + 2.0 * cross(real.xyz, cross(real.xyz, nrm.xyz) + real.w * nrm.xyz), 0.0);
+}
+@end
+
+// common vertex shader inputs, and the world space transform
+@block vs_common
 uniform vs_params {
     mat4 view_proj;
     float joint_pixel_width;
@@ -63,9 +92,9 @@ in vec4 inst_zzzz;
 in vec2 inst_joint_uv;
 
 out vec3 color;
+@end
 
-@include_block skin_utils
-
+@block vs_main
 void main() {
     // compute skinned model-space position and normal
     vec4 pos, nrm;
@@ -80,6 +109,20 @@ void main() {
 }
 @end
 
+// vertex shader for the 4x3 matrix palette formats (RGBA32F and RGBA16F)
+@vs vs
+@include_block vs_common
+@include_block skin_utils
+@include_block vs_main
+@end
+
+// vertex shader for the dual-quaternion palette format
+@vs vs_dq
+@include_block vs_common
+@include_block skin_utils_dq
+@include_block vs_main
+@end
+
 @fs fs
 in vec3 color;
 out vec4 frag_color;
@@ -90,3 +133,4 @@ void main() {
 @end
 
 @program skinned vs fs
+@program skinned_dq vs_dq fs
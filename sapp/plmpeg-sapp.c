@@ -15,6 +15,22 @@
 //  Downloading will be paused if the circular buffer queue is full, and
 //  decoding will be paused if the queue is empty.
 //
+//  Demuxing and decoding happens on a separate decode thread, so that
+//  decoding spikes don't cause hitches in rendering. The decode thread
+//  fills a small queue of decoded video frames, and the render thread picks
+//  the frame to show by its presentation timestamp. Frames which are
+//  already late are dropped, and the last frame stays on screen when the
+//  next frame hasn't been decoded in time. Audio is decoded on the decode
+//  thread ahead of the playback time and pushed to sokol-audio from there.
+//
+//  The download buffer queues and the frame queue are lock-free
+//  single-producer/single-consumer ring buffers between the render thread
+//  (which runs the sokol-fetch callbacks) and the decode thread.
+//
+//  The slices of each video picture are decoded in parallel on multiple
+//  threads. In web builds without thread support, everything happens on
+//  the main thread.
+//
 //  KNOWN ISSUES:
 //  - If you get bad audio playback artefacts, the reason is most likely
 //    that the audio playback device doesn't support the video's audio
@@ -29,6 +45,8 @@
 #include "sokol_fetch.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
 #include "dbgui/dbgui.h"
 #include "plmpeg-sapp.glsl.h"
 #define PL_MPEG_IMPLEMENTATION
@@ -43,8 +61,19 @@
 #pragma GCC diagnostic pop
 #endif
 #include <assert.h>
+#include <stdlib.h>
 #include "util/fileutil.h"
 
+// the decode thread uses the same thread support as pl_mpeg,
+// which isn't available in web builds without pthreads
+#if !defined(PLM_NO_THREADS)
+    #if defined(_WIN32)
+        #include <windows.h>
+    #else
+        #include <pthread.h>
+    #endif
+#endif
+
 static const char* filename = "bjork-all-is-full-of-love.mpg";
 
 // statically allocated streaming buffers
@@ -53,11 +82,30 @@ static const char* filename = "bjork-all-is-full-of-love.mpg";
 #define NUM_BUFFERS (4)
 static uint8_t buf[NUM_BUFFERS][BUFFER_SIZE];
 
-// a simple ring buffer for the circular buffer queue
-#define RING_NUM_SLOTS (NUM_BUFFERS+1)
+// number of video decoding threads, including the decode thread
+#define NUM_DECODE_THREADS (4)
+
+// max number of decoded video frames waiting to be shown
+#define NUM_FRAMES (8)
+
+// how far ahead of the playback time audio is decoded, in seconds
+#define AUDIO_LEAD_TIME (0.25)
+
+// a decoded video frame, the planes are owned by the frame
 typedef struct {
-    uint32_t head;
-    uint32_t tail;
+    double pts;
+    plm_plane_t y;
+    plm_plane_t cb;
+    plm_plane_t cr;
+} video_frame_t;
+
+// a lock-free single-producer/single-consumer ring buffer for the circular
+// buffer and frame queues, the head is only written by the producer thread,
+// and the tail only by the consumer thread
+#define RING_NUM_SLOTS (NUM_FRAMES+1)
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
     int buf[RING_NUM_SLOTS];
 } ring_t;
 static bool ring_empty(const ring_t* rb);
@@ -65,6 +113,7 @@ static bool ring_full(const ring_t* rb);
 static uint32_t ring_count(const ring_t* rb);
 static void ring_enqueue(ring_t* rb, int val);
 static int ring_dequeue(ring_t* rb);
+static int ring_peek(const ring_t* rb);
 
 // a vertex with position, normal and texcoords
 typedef struct {
@@ -77,6 +126,8 @@ typedef struct {
 static struct {
     plm_t* plm;
     plm_buffer_t* plm_buffer;
+    bool has_audio;
+    double frame_duration;
     sg_pipeline pip;
     sg_bindings bind;
     sg_pass_action pass_action;
@@ -90,6 +141,43 @@ static struct {
     int cur_download_buffer;
     int cur_read_buffer;
     uint32_t cur_read_pos;
+    // decoded frames, free frames are filled by the decode thread,
+    // and ready frames are shown and released by the render thread
+    video_frame_t frames[NUM_FRAMES];
+    ring_t free_frames;
+    ring_t ready_frames;
+    // playback time on the render thread, published to the decode thread in milliseconds
+    bool playing;
+    double play_time;
+    double shown_pts;
+    volatile uint32_t play_time_ms;
+    // only accessed by the decode thread
+    struct {
+        double audio_time;
+        double last_video_time;
+        double video_time_offset;
+        double last_audio_time;
+        double audio_time_offset;
+    } decoder;
+    #if !defined(PLM_NO_THREADS)
+    struct {
+        bool wake;
+        volatile uint32_t quit;
+        #if defined(_WIN32)
+            SRWLOCK lock;
+            CONDITION_VARIABLE cond;
+            HANDLE thread;
+        #else
+            pthread_mutex_t mutex;
+            pthread_cond_t cond;
+            pthread_t thread;
+        #endif
+    } thread;
+    #endif
+    struct {
+        uint32_t dropped_frames;    // decoded frames which were late and never shown
+        uint32_t repeated_frames;   // render frames when the next video frame was late
+    } stats;
     float ry;
     uint64_t cur_frame;
 } state;
@@ -98,10 +186,19 @@ static struct {
 static void fetch_callback(const sfetch_response_t* response);
 // plmpeg's data loading callback
 static void plmpeg_load_callback(plm_buffer_t* buf, void* user);
-// plmpeg's callback when a video frame is ready
-static void video_cb(plm_t *mpeg, plm_frame_t *frame, void *user);
-// plmpeg's callback when audio data is ready
-static void audio_cb(plm_t *mpeg, plm_samples_t *samples, void *user);
+// decode the next video frame and/or audio samples, returns false if there's nothing to do
+static bool decode_step(void);
+// show the decoded video frame for the current playback time
+static void update_video(void);
+// start, wake up and stop the decode thread
+#if !defined(PLM_NO_THREADS)
+static void decode_thread_start(void);
+static void decode_thread_wake(void);
+static void decode_thread_stop(void);
+#endif
+// atomic loads and stores for values shared between the render and decode thread
+static uint32_t atomic_load_u32(const volatile uint32_t* ptr);
+static void atomic_store_u32(volatile uint32_t* ptr, uint32_t val);
 
 // the sokol-app init-callback
 static void init(void) {
@@ -113,6 +210,11 @@ static void init(void) {
     state.cur_download_buffer = ring_dequeue(&state.free_buffers);
     state.cur_read_buffer = -1;
 
+    // all decoded frames are free in the beginning
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        ring_enqueue(&state.free_frames, i);
+    }
+
     // setup sokol-fetch and start fetching the file, once the first two buffers
     // have been filled with data, setup pl_mpeg (this happens down in the frame callback)
     sfetch_setup(&(sfetch_desc_t){
@@ -135,6 +237,10 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup(sapp_sample_count());
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
 
     // vertex-, index-buffer, shader, pipeline and a sampler object
     const vertex_t vertices[] = {
@@ -203,32 +309,38 @@ static void init(void) {
     // NOTE: texture creation is deferred until first frame is decoded
 }
 
-// the sokol-app frame callback (video decoding and rendering)
+// the sokol-app frame callback (video playback and rendering)
 static void frame(void) {
     state.cur_frame++;
 
     // pump the sokol-fetch message queues
     sfetch_dowork();
 
-    // stop decoding if there's not at least one buffer of downloaded
-    // data ready, to allow slow downloads to catch up
     if (state.plm) {
-        if (!ring_empty(&state.full_buffers)) {
-            plm_decode(state.plm, sapp_frame_duration());
-        }
+        // without a decode thread, decode as much as needed right here
+        #if defined(PLM_NO_THREADS)
+            while (decode_step());
+        #endif
+        update_video();
+        // the decode thread waits until the render thread has changed something
+        // (downloaded data, shown frames or the playback time)
+        #if !defined(PLM_NO_THREADS)
+            decode_thread_wake();
+        #endif
     }
-    // initialize plmpeg once two buffers are filled with data
+    // initialize plmpeg once two buffers are filled with data, and
+    // from then on decode on the decode thread
     else if (ring_count(&state.full_buffers) == 2) {
         state.plm_buffer = plm_buffer_create_with_capacity(BUFFER_SIZE);
         plm_buffer_set_load_callback(state.plm_buffer, plmpeg_load_callback, 0);
         state.plm = plm_create_with_buffer(state.plm_buffer, true);
         assert(state.plm);
-        plm_set_video_decode_callback(state.plm, video_cb, 0);
-        plm_set_audio_decode_callback(state.plm, audio_cb, 0);
+        plm_set_video_threads(state.plm, NUM_DECODE_THREADS);
         plm_set_loop(state.plm, true);
         plm_set_audio_enabled(state.plm, true, 0);
-        plm_set_audio_lead_time(state.plm, 0.25);
-        if (plm_get_num_audio_streams(state.plm) > 0) {
+        state.frame_duration = 1.0 / plm_get_framerate(state.plm);
+        state.has_audio = plm_get_num_audio_streams(state.plm) > 0;
+        if (state.has_audio) {
             saudio_setup(&(saudio_desc){
                 .sample_rate = plm_get_samplerate(state.plm),
                 .buffer_frames = 4096,
@@ -237,8 +349,19 @@ static void frame(void) {
                 .logger.func = slog_func,
             });
         }
+        #if !defined(PLM_NO_THREADS)
+            decode_thread_start();
+        #endif
     }
 
+    // playback stats
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("Queued frames: %d/%d\n", (int)ring_count(&state.ready_frames), NUM_FRAMES);
+    sdtx_printf("Dropped frames: %d\n", (int)state.stats.dropped_frames);
+    sdtx_printf("Repeated frames: %d\n", (int)state.stats.repeated_frames);
+    sdtx_printf("Download buffers: %d/%d", (int)ring_count(&state.full_buffers), NUM_BUFFERS);
+
     // compute model-view-projection matrix for vertex shader
     hmm_mat4 proj = HMM_Perspective(60.0f, sapp_widthf()/sapp_heightf(), 0.01f, 10.0f);
     hmm_mat4 view = HMM_LookAt(HMM_Vec3(0.0f, 0.0, 6.0f), HMM_Vec3(0.0f, 0.0f, 0.0f), HMM_Vec3(0.0f, 1.0f, 0.0f));
@@ -256,6 +379,7 @@ static void frame(void) {
         sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(vs_params));
         sg_draw(0, 24, 1);
     }
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
@@ -263,10 +387,20 @@ static void frame(void) {
 
 // the sokol-sapp cleanup callback
 static void cleanup(void) {
-    __dbgui_shutdown();
-    if (state.plm_buffer) {
-        plm_buffer_destroy(state.plm_buffer);
+    if (state.plm) {
+        #if !defined(PLM_NO_THREADS)
+        decode_thread_stop();
+        #endif
+        // this also joins the slice decoding threads and destroys the plm_buffer
+        plm_destroy(state.plm);
     }
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        free(state.frames[i].y.data);
+        free(state.frames[i].cb.data);
+        free(state.frames[i].cr.data);
+    }
+    sdtx_shutdown();
+    __dbgui_shutdown();
     sg_shutdown();
 }
 
@@ -302,18 +436,103 @@ static void validate_texture(int slot, plm_plane_t* plane) {
     }
 }
 
-// the pl_mpeg video callback, copies decoded video data into textures
-static void video_cb(plm_t* mpeg, plm_frame_t* frame, void* user) {
-    (void)mpeg; (void)user;
-    validate_texture(SLOT_tex_y, &frame->y);
-    validate_texture(SLOT_tex_cb, &frame->cb);
-    validate_texture(SLOT_tex_cr, &frame->cr);
+// pick the decoded frame to show by its presentation timestamp, and copy
+// it into the textures, frames which were overtaken by a later frame are
+// dropped, and the shown frame is repeated if the next frame is late
+static void update_video(void) {
+    if (!state.playing) {
+        // start the playback clock with the first decoded frame
+        if (ring_empty(&state.ready_frames)) {
+            return;
+        }
+        state.playing = true;
+        state.play_time = state.frames[ring_peek(&state.ready_frames)].pts;
+    }
+    else {
+        state.play_time += sapp_frame_duration();
+    }
+    atomic_store_u32(&state.play_time_ms, (uint32_t)(state.play_time * 1000.0));
+
+    int frame_index = -1;
+    while (!ring_empty(&state.ready_frames) && (state.frames[ring_peek(&state.ready_frames)].pts <= state.play_time)) {
+        if (frame_index != -1) {
+            state.stats.dropped_frames++;
+            ring_enqueue(&state.free_frames, frame_index);
+        }
+        frame_index = ring_dequeue(&state.ready_frames);
+    }
+    if (frame_index != -1) {
+        video_frame_t* frame = &state.frames[frame_index];
+        validate_texture(SLOT_tex_y, &frame->y);
+        validate_texture(SLOT_tex_cb, &frame->cb);
+        validate_texture(SLOT_tex_cr, &frame->cr);
+        state.shown_pts = frame->pts;
+        ring_enqueue(&state.free_frames, frame_index);
+    }
+    else if (state.play_time >= (state.shown_pts + state.frame_duration)) {
+        state.stats.repeated_frames++;
+    }
 }
 
-// the pl_mpeg audio callback, forwards decoded audio samples to sokol-audio
-static void audio_cb(plm_t* mpeg, plm_samples_t* samples, void* user) {
-    (void)mpeg; (void)user;
-    saudio_push(samples->interleaved, (int)samples->count);
+// pl_mpeg's timestamps start over when the video loops, this keeps them increasing
+static double loop_time(double time, double* last_time, double* offset, double duration) {
+    if (time < *last_time) {
+        *offset += *last_time + duration;
+    }
+    *last_time = time;
+    return time + *offset;
+}
+
+// copy a decoded video plane into a frame's plane
+static void copy_plane(plm_plane_t* dst, const plm_plane_t* src) {
+    const size_t size = src->width * src->height;
+    if ((dst->width != src->width) || (dst->height != src->height)) {
+        free(dst->data);
+        dst->data = malloc(size);
+        assert(dst->data);
+        dst->width = src->width;
+        dst->height = src->height;
+    }
+    memcpy(dst->data, src->data, size);
+}
+
+// called on the decode thread (or the main thread in web builds without thread support)
+static bool decode_step(void) {
+    // stop decoding if there's not at least one buffer of downloaded
+    // data ready, to allow slow downloads to catch up
+    if (ring_empty(&state.full_buffers)) {
+        return false;
+    }
+    bool did_work = false;
+
+    // decode audio up to the lead time ahead of the playback time
+    if (state.has_audio) {
+        const double play_time = atomic_load_u32(&state.play_time_ms) / 1000.0;
+        if (state.decoder.audio_time < (play_time + AUDIO_LEAD_TIME)) {
+            plm_samples_t* samples = plm_decode_audio(state.plm);
+            if (samples) {
+                const double duration = (double)samples->count / plm_get_samplerate(state.plm);
+                state.decoder.audio_time = loop_time(samples->time, &state.decoder.last_audio_time, &state.decoder.audio_time_offset, duration) + duration;
+                saudio_push(samples->interleaved, (int)samples->count);
+                did_work = true;
+            }
+        }
+    }
+
+    // decode video frames until the frame queue is full
+    if (!ring_empty(&state.free_frames)) {
+        plm_frame_t* plm_frame = plm_decode_video(state.plm);
+        if (plm_frame) {
+            video_frame_t* frame = &state.frames[ring_dequeue(&state.free_frames)];
+            frame->pts = loop_time(plm_frame->time, &state.decoder.last_video_time, &state.decoder.video_time_offset, state.frame_duration);
+            copy_plane(&frame->y, &plm_frame->y);
+            copy_plane(&frame->cb, &plm_frame->cb);
+            copy_plane(&frame->cr, &plm_frame->cr);
+            ring_enqueue(&state.ready_frames, (int)(frame - state.frames));
+            did_work = true;
+        }
+    }
+    return did_work;
 }
 
 // the sokol-fetch response callback
@@ -369,6 +588,81 @@ static void plmpeg_load_callback(plm_buffer_t* self, void* user) {
     }
 }
 
+//=== the decode thread =======================================================*/
+#if !defined(PLM_NO_THREADS)
+#if defined(_WIN32)
+static DWORD WINAPI decode_thread_func(LPVOID arg) {
+#else
+static void* decode_thread_func(void* arg) {
+#endif
+    (void)arg;
+    while (true) {
+        // wait until the render thread has something new
+        #if defined(_WIN32)
+            AcquireSRWLockExclusive(&state.thread.lock);
+            while (!state.thread.wake) {
+                SleepConditionVariableSRW(&state.thread.cond, &state.thread.lock, INFINITE, 0);
+            }
+            state.thread.wake = false;
+            ReleaseSRWLockExclusive(&state.thread.lock);
+        #else
+            pthread_mutex_lock(&state.thread.mutex);
+            while (!state.thread.wake) {
+                pthread_cond_wait(&state.thread.cond, &state.thread.mutex);
+            }
+            state.thread.wake = false;
+            pthread_mutex_unlock(&state.thread.mutex);
+        #endif
+        if (atomic_load_u32(&state.thread.quit)) {
+            break;
+        }
+        while (!atomic_load_u32(&state.thread.quit) && decode_step());
+    }
+    return 0;
+}
+
+static void decode_thread_start(void) {
+    #if defined(_WIN32)
+        InitializeSRWLock(&state.thread.lock);
+        InitializeConditionVariable(&state.thread.cond);
+        state.thread.thread = CreateThread(NULL, 0, decode_thread_func, NULL, 0, NULL);
+        assert(state.thread.thread);
+    #else
+        pthread_mutex_init(&state.thread.mutex, NULL);
+        pthread_cond_init(&state.thread.cond, NULL);
+        int res = pthread_create(&state.thread.thread, NULL, decode_thread_func, NULL);
+        assert(res == 0); (void)res;
+    #endif
+}
+
+static void decode_thread_wake(void) {
+    #if defined(_WIN32)
+        AcquireSRWLockExclusive(&state.thread.lock);
+        state.thread.wake = true;
+        ReleaseSRWLockExclusive(&state.thread.lock);
+        WakeConditionVariable(&state.thread.cond);
+    #else
+        pthread_mutex_lock(&state.thread.mutex);
+        state.thread.wake = true;
+        pthread_mutex_unlock(&state.thread.mutex);
+        pthread_cond_signal(&state.thread.cond);
+    #endif
+}
+
+static void decode_thread_stop(void) {
+    atomic_store_u32(&state.thread.quit, 1);
+    decode_thread_wake();
+    #if defined(_WIN32)
+        WaitForSingleObject(state.thread.thread, INFINITE);
+        CloseHandle(state.thread.thread);
+    #else
+        pthread_join(state.thread.thread, NULL);
+        pthread_mutex_destroy(&state.thread.mutex);
+        pthread_cond_destroy(&state.thread.cond);
+    #endif
+}
+#endif
+
 // sokol-app entry function
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc; (void)argv;
@@ -386,39 +680,80 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     };
 }
 
-//=== a simple ring buffer implementation ====================================*/
+//=== atomic loads and stores ================================================*/
+// acquire/release semantics, so that the ring buffer slots written
+// before a head or tail update are visible to the other thread
+#if defined(PLM_NO_THREADS)
+static uint32_t atomic_load_u32(const volatile uint32_t* ptr) {
+    return *ptr;
+}
+
+static void atomic_store_u32(volatile uint32_t* ptr, uint32_t val) {
+    *ptr = val;
+}
+#elif defined(_MSC_VER)
+static uint32_t atomic_load_u32(const volatile uint32_t* ptr) {
+    return (uint32_t)InterlockedCompareExchange((volatile LONG*)ptr, 0, 0);
+}
+
+static void atomic_store_u32(volatile uint32_t* ptr, uint32_t val) {
+    InterlockedExchange((volatile LONG*)ptr, (LONG)val);
+}
+#else
+static uint32_t atomic_load_u32(const volatile uint32_t* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_store_u32(volatile uint32_t* ptr, uint32_t val) {
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+#endif
+
+//=== a simple lock-free ring buffer implementation ==========================*/
 static uint32_t ring_wrap(uint32_t i) {
     return i % RING_NUM_SLOTS;
 }
 
 static bool ring_full(const ring_t* rb) {
-    return ring_wrap(rb->head + 1) == rb->tail;
+    return ring_wrap(atomic_load_u32(&rb->head) + 1) == atomic_load_u32(&rb->tail);
 }
 
 static bool ring_empty(const ring_t* rb) {
-    return rb->head == rb->tail;
+    return atomic_load_u32(&rb->head) == atomic_load_u32(&rb->tail);
 }
 
 static uint32_t ring_count(const ring_t* rb) {
+    const uint32_t head = atomic_load_u32(&rb->head);
+    const uint32_t tail = atomic_load_u32(&rb->tail);
     uint32_t count;
-    if (rb->head >= rb->tail) {
-        count = rb->head - rb->tail;
+    if (head >= tail) {
+        count = head - tail;
     }
     else {
-        count = (rb->head + RING_NUM_SLOTS) - rb->tail;
+        count = (head + RING_NUM_SLOTS) - tail;
     }
     return count;
 }
 
+// only called by the producer
 static void ring_enqueue(ring_t* rb, int val) {
     assert(!ring_full(rb));
-    rb->buf[rb->head] = val;
-    rb->head = ring_wrap(rb->head + 1);
+    const uint32_t head = rb->head;
+    rb->buf[head] = val;
+    atomic_store_u32(&rb->head, ring_wrap(head + 1));
 }
 
+// only called by the consumer
 static int ring_dequeue(ring_t* rb) {
     assert(!ring_empty(rb));
-    int slot_id = rb->buf[rb->tail];
-    rb->tail = ring_wrap(rb->tail + 1);
+    const uint32_t tail = rb->tail;
+    int slot_id = rb->buf[tail];
+    atomic_store_u32(&rb->tail, ring_wrap(tail + 1));
     return slot_id;
 }
+
+// only called by the consumer
+static int ring_peek(const ring_t* rb) {
+    assert(!ring_empty(rb));
+    return rb->buf[rb->tail];
+}
@@ -138,6 +138,7 @@ typedef struct {
 static struct {
     sg_pass_action pass_action;
     camera_t camera;
+    ozz_asset_t* ozz_asset;
     ozz_instance_t* ozz;
     double frame_time_sec;
     struct {
@@ -342,12 +343,13 @@ static void init(void) {
         .longitude = 20.0f
     });
 
-    // setup ozz-utility wrapper and create a character instance
+    // setup ozz-utility wrapper and create a character asset and instance
     ozz_setup(&(ozz_desc_t){
         .max_palette_joints = 64,
         .max_instances = 1
     });
-    state.ozz = ozz_create_instance(0);
+    state.ozz_asset = ozz_create_asset();
+    state.ozz = ozz_create_instance(state.ozz_asset, 0);
 
     // initialize per-shader-variation resources
     for (int i = 0; i < MAX_SHADER_VARIATIONS; i++) {
@@ -461,7 +463,7 @@ static void frame(void) {
 
     sg_begin_default_pass(&state.pass_action, fb_width, fb_height);
     sg_apply_viewport(vp_x, vp_y, vp_width, vp_height, true);
-    if (ozz_all_loaded(state.ozz)) {
+    if (ozz_all_loaded(state.ozz_asset)) {
 
         // update character animation
         if (state.skinning.enabled) {
@@ -500,7 +502,7 @@ static void frame(void) {
             sg_apply_uniforms(var->phong_params.stage, var->phong_params.slot, &(sg_range){phong_params_buffer, var->phong_params.num_bytes});
         }
 
-        sg_draw(0, ozz_num_triangle_indices(state.ozz), 1);
+        sg_draw(0, ozz_num_triangle_indices(state.ozz_asset), 1);
     }
     sgl_draw();
     simgui_render();
@@ -510,6 +512,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     ozz_destroy_instance(state.ozz);
+    ozz_destroy_asset(state.ozz_asset);
     ozz_shutdown();
     simgui_shutdown();
     sfetch_shutdown();
@@ -526,31 +529,31 @@ static void input(const sapp_event* ev) {
 
 static void skeleton_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz_load_skeleton(state.ozz, response->data.ptr, response->data.size);
+        ozz_load_skeleton(state.ozz_asset, response->data.ptr, response->data.size);
     } else if (response->failed) {
-        ozz_set_load_failed(state.ozz);
+        ozz_set_load_failed(state.ozz_asset);
     }
 }
 
 static void animation_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz_load_animation(state.ozz, response->data.ptr, response->data.size);
+        ozz_load_animation(state.ozz_asset, response->data.ptr, response->data.size);
     } else if (response->failed) {
-        ozz_set_load_failed(state.ozz);
+        ozz_set_load_failed(state.ozz_asset);
     }
 }
 
 static void mesh_data_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        ozz_load_mesh(state.ozz, response->data.ptr, response->data.size);
+        ozz_load_mesh(state.ozz_asset, response->data.ptr, response->data.size);
         for (int i = 0; i < MAX_SHADER_VARIATIONS; i++) {
             if (state.variations[i].valid) {
-                state.variations[i].bind.vertex_buffers[0] = ozz_vertex_buffer(state.ozz);
-                state.variations[i].bind.index_buffer = ozz_index_buffer(state.ozz);
+                state.variations[i].bind.vertex_buffers[0] = ozz_vertex_buffer(state.ozz_asset);
+                state.variations[i].bind.index_buffer = ozz_index_buffer(state.ozz_asset);
             }
         }
     } else if (response->failed) {
-        ozz_set_load_failed(state.ozz);
+        ozz_set_load_failed(state.ozz_asset);
     }
 }
 
@@ -669,7 +672,7 @@ static void draw_ui(void) {
     igSetNextWindowPos((ImVec2){20,20}, ImGuiCond_Once, (ImVec2){0,0});
     igSetNextWindowSize((ImVec2){220,150 }, ImGuiCond_Once);
     if (igBegin("Controls", 0, ImGuiWindowFlags_AlwaysAutoResize)) {
-        if (ozz_load_failed(state.ozz)) {
+        if (ozz_load_failed(state.ozz_asset)) {
             igText("Failed loading character data!");
         } else {
             const ImU32 green = 0xFF00FF00;